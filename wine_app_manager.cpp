@@ -5,9 +5,20 @@
 namespace WineWrapper {
 
 WineApplicationManager::WineApplicationManager()
-    : logger(), monitor(logger), prefix_manager(logger), 
-      executor(logger, monitor, prefix_manager), winetricks_manager(logger),
-      registry_manager(nullptr) {
+    : logger(), metrics(), monitor(logger), prefix_manager(logger), 
+      executor(logger, monitor, prefix_manager),
+      launch_scheduler(logger, executor, prefix_manager, monitor), registry_manager(nullptr),
+      winetricks_manager(logger), artifact_store(logger), shader_cache(logger), prefetch(logger), fleet(logger),
+      owns_trace(false), manager_pinned(false) {
+    PreparedLaunchProfile::original_affinity();
+    prefix_manager.set_winetricks_manager(&winetricks_manager);
+    winetricks_manager.set_artifact_store(&artifact_store);
+    executor.set_metrics(&metrics);
+    executor.set_shader_cache(&shader_cache);
+    executor.set_prefetch(&prefetch);
+    fleet.set_metrics(&metrics);
+    prefix_manager.set_metrics(&metrics);
+    winetricks_manager.set_metrics(&metrics);
 }
 
 WineApplicationManager::~WineApplicationManager() {
@@ -96,6 +107,13 @@ bool WineApplicationManager::initialize(const std::string& config_dir) {
     }
     
     executor.set_configuration(current_config);
+    update_tracing();
+    update_shader_cache();
+    update_prefetch();
+    update_server_pool();
+    update_fleet();
+    
+    artifact_store.set_root(Utils::join_paths(config_directory, "artifacts"));
     
     monitor.start_monitoring();
     
@@ -103,6 +121,8 @@ bool WineApplicationManager::initialize(const std::string& config_dir) {
     
     if (!current_config.wine_prefix.empty()) {
         registry_manager = new RegistryManager(current_config.wine_prefix, logger);
+        registry_manager->set_server_pool(&prefix_manager.get_server_pool(), current_config.wine_binary);
+        registry_manager->set_metrics(&metrics);
     }
     
     logger.info("Wine Application Manager initialized successfully");
@@ -115,8 +135,18 @@ void WineApplicationManager::shutdown() {
     
     save_application_shortcuts();
     
+    launch_scheduler.shutdown();
     monitor.stop_monitoring();
     
+    if (owns_trace) {
+        owns_trace = false;
+        if (TraceRecorder::stop()) {
+            logger.info("Trace written to " + current_config.trace_file);
+        } else {
+            logger.error("Failed to write trace to " + current_config.trace_file);
+        }
+    }
+    
     std::string default_config = Utils::join_paths(config_directory, "wine.conf");
     current_config.save_to_file(default_config);
     
@@ -125,7 +155,10 @@ void WineApplicationManager::shutdown() {
 
 pid_t WineApplicationManager::run_executable(const std::string& exe_path, 
                                             const std::vector<std::string>& args) {
+    TraceSpan span("run_executable", "manager", exe_path);
+    TraceSpan wait_span("wait manager_mutex", "lock");
     std::lock_guard<std::mutex> lock(manager_mutex);
+    wait_span.end();
     
     logger.info("Running executable: " + exe_path);
     
@@ -142,7 +175,10 @@ pid_t WineApplicationManager::run_executable(const std::string& exe_path,
 
 int WineApplicationManager::run_executable_sync(const std::string& exe_path, 
                                                const std::vector<std::string>& args) {
+    TraceSpan span("run_executable_sync", "manager", exe_path);
+    TraceSpan wait_span("wait manager_mutex", "lock");
     std::lock_guard<std::mutex> lock(manager_mutex);
+    wait_span.end();
     
     logger.info("Running executable synchronously: " + exe_path);
     
@@ -153,22 +189,67 @@ int WineApplicationManager::run_executable_sync(const std::string& exe_path,
     return exit_code;
 }
 
+LaunchHandle WineApplicationManager::queue_launch(const LaunchRequest& request) {
+    logger.info("Queueing executable: " + request.exe_path);
+    return launch_scheduler.submit(request);
+}
+
+std::vector<LaunchHandle> WineApplicationManager::execute_batch(const std::vector<LaunchRequest>& requests) {
+    logger.info("Queueing batch of " + std::to_string(requests.size()) + " executables");
+    return launch_scheduler.submit_batch(requests);
+}
+
+void WineApplicationManager::set_launch_concurrency(size_t global_limit, size_t per_prefix_limit) {
+    launch_scheduler.set_max_concurrency(global_limit);
+    launch_scheduler.set_max_per_prefix(per_prefix_limit);
+}
+
 void WineApplicationManager::set_wine_configuration(const WineConfiguration& config) {
     std::lock_guard<std::mutex> lock(manager_mutex);
     
-    current_config = config;
-    current_config.validate();
+    WineConfiguration validated = config;
+    validated.validate();
+    ConfigDiff changes = current_config.diff(validated);
+    {
+        std::lock_guard<std::mutex> config_lock(config_mutex);
+        current_config = std::move(validated);
+    }
     executor.set_configuration(current_config);
+    update_tracing();
+    update_shader_cache();
+    update_prefetch();
+    update_server_pool();
+    update_fleet();
     
-    if (registry_manager) {
+    if (!registry_manager || changes.affects(ConfigSchema::GROUP_REGISTRY)) {
         delete registry_manager;
+        registry_manager = new RegistryManager(current_config.wine_prefix, logger);
+        registry_manager->set_metrics(&metrics);
+    }
+    registry_manager->set_server_pool(&prefix_manager.get_server_pool(), current_config.wine_binary);
+    
+    std::vector<int> manager_cpus;
+    if (!current_config.manager_cpu_affinity.empty()) {
+        if (!LaunchProfile::parse_cpu_list(current_config.manager_cpu_affinity, manager_cpus)) {
+            logger.warning("Invalid manager_cpu_affinity: " + current_config.manager_cpu_affinity);
+        } else if (PreparedLaunchProfile::pin_current_process(manager_cpus)) {
+            manager_pinned = true;
+            logger.info("Pinned manager threads to CPUs " + LaunchProfile::format_cpu_list(manager_cpus));
+        } else {
+            logger.warning("Failed to pin manager threads to CPUs " + current_config.manager_cpu_affinity);
+        }
+    } else if (manager_pinned) {
+        manager_pinned = !PreparedLaunchProfile::pin_current_process(PreparedLaunchProfile::original_affinity());
+        if (!manager_pinned) {
+            logger.info("Restored manager threads to their original CPUs");
+        }
     }
-    registry_manager = new RegistryManager(current_config.wine_prefix, logger);
     
     logger.info("Updated Wine configuration");
 }
 
 WineConfiguration WineApplicationManager::get_wine_configuration() const {
+    std::lock_guard<std::mutex> lock(config_mutex);
     return current_config;
 }
 
@@ -209,6 +290,7 @@ bool WineApplicationManager::switch_wine_prefix(const std::string& name) {
     }
     
     WineConfiguration config = prefix_manager.get_prefix_config(name);
+    prefix_manager.get_server_pool().prewarm(config.wine_prefix, config.wine_binary);
     set_wine_configuration(config);
     
     logger.info("Switched to Wine prefix: " + name);
@@ -236,6 +318,10 @@ std::vector<ProcessInfo> WineApplicationManager::get_all_running_processes() {
     return monitor.get_all_processes();
 }
 
+std::shared_ptr<const ProcessTableSnapshot> WineApplicationManager::get_process_snapshot() {
+    return monitor.get_snapshot();
+}
+
 void WineApplicationManager::terminate_process(pid_t pid) {
     logger.info("Terminating process: " + std::to_string(pid));
     monitor.kill_process(pid, SIGTERM);
@@ -244,9 +330,9 @@ void WineApplicationManager::terminate_process(pid_t pid) {
 void WineApplicationManager::kill_all_processes() {
     logger.warning("Killing all Wine processes");
     
-    auto processes = monitor.get_all_processes();
-    for (const auto& info : processes) {
-        monitor.kill_process(info.pid, SIGKILL);
+    auto snapshot = monitor.get_snapshot();
+    for (const auto& summary : snapshot->processes) {
+        monitor.kill_process(summary.pid, SIGKILL);
     }
 }
 
@@ -307,6 +393,49 @@ bool WineApplicationManager::install_winetricks_component(const std::string& com
     return success;
 }
 
+bool WineApplicationManager::install_winetricks_components(const std::vector<std::string>& components) {
+    logger.info("Installing " + std::to_string(components.size()) + " winetricks components");
+    
+    bool success = winetricks_manager.install_verbs(components, current_config.wine_prefix);
+    
+    if (success) {
+        logger.info("Successfully installed " + std::to_string(components.size()) + " components");
+    } else {
+        logger.error("Failed to install some components");
+    }
+    
+    return success;
+}
+
+std::map<std::string, bool> WineApplicationManager::install_winetricks_components(
+    const std::vector<std::string>& prefix_names, const std::vector<std::string>& components) {
+    logger.info("Installing " + std::to_string(components.size()) + " winetricks components in " +
+                std::to_string(prefix_names.size()) + " prefixes");
+    
+    std::map<std::string, std::vector<std::string>> prefix_verbs;
+    std::map<std::string, std::string> names;
+    std::map<std::string, bool> results;
+    for (const auto& name : prefix_names) {
+        std::string path = prefix_manager.get_prefix_path(name);
+        if (path.empty() || !prefix_manager.prefix_exists(name)) {
+            logger.error("Wine prefix does not exist: " + name);
+            results[name] = false;
+            continue;
+        }
+        prefix_verbs[path] = components;
+        names[path] = name;
+    }
+    
+    for (const auto& pair : winetricks_manager.install_batch(prefix_verbs)) {
+        results[names[pair.first]] = pair.second;
+        if (!pair.second) {
+            logger.error("Failed to install some components in prefix: " + names[pair.first]);
+        }
+    }
+    
+    return results;
+}
+
 std::vector<std::string> WineApplicationManager::list_available_components() {
     return winetricks_manager.list_available_verbs();
 }
@@ -314,7 +443,7 @@ std::vector<std::string> WineApplicationManager::list_available_components() {
 std::map<std::string, std::string> WineApplicationManager::get_system_info() {
     std::map<std::string, std::string> info;
     
-    info["wine_version"] = executor.get_wine_version();
+    auto wine_version = std::async(std::launch::async, [this] { return executor.get_wine_version(); });
     info["wine_prefix"] = current_config.wine_prefix;
     info["architecture"] = (current_config.architecture == WineArchitecture::WIN32) ? "Win32" :
                           (current_config.architecture == WineArchitecture::WIN64) ? "Win64" : "Auto";
@@ -330,12 +459,202 @@ std::map<std::string, std::string> WineApplicationManager::get_system_info() {
     auto prefixes = prefix_manager.list_prefixes();
     info["prefix_count"] = std::to_string(prefixes.size());
     
-    auto processes = monitor.get_all_processes();
-    info["running_processes"] = std::to_string(processes.size());
+    info["running_processes"] = std::to_string(monitor.get_snapshot()->processes.size());
+    
+    info["wine_version"] = wine_version.get();
     
     return info;
 }
 
+void WineApplicationManager::update_tracing() {
+    if (current_config.trace_file.empty() || TraceRecorder::is_enabled()) {
+        return;
+    }
+    
+    if (TraceRecorder::start(current_config.trace_file)) {
+        owns_trace = true;
+        logger.info("Recording trace to " + current_config.trace_file);
+    }
+}
+
+void WineApplicationManager::update_shader_cache() {
+    std::string directory = current_config.shader_cache_dir;
+    if (directory.empty()) {
+        directory = Utils::join_paths(Utils::get_home_directory(), ".cache/wine-wrapper/shader-cache");
+    }
+    shader_cache.configure(directory, current_config.shader_cache_max_mb);
+}
+
+void WineApplicationManager::update_prefetch() {
+    std::string directory = current_config.prefetch_dir;
+    if (directory.empty()) {
+        directory = Utils::join_paths(Utils::get_home_directory(), ".cache/wine-wrapper/prefetch");
+    }
+    prefetch.configure(directory, current_config.prefetch_record_seconds);
+}
+
+void WineApplicationManager::update_server_pool() {
+    WineserverPool& pool = prefix_manager.get_server_pool();
+    pool.set_idle_timeout(std::chrono::seconds(current_config.server_pool_idle_seconds));
+    if (pool.is_enabled() != current_config.enable_server_pool) {
+        pool.set_enabled(current_config.enable_server_pool);
+    }
+}
+
+void WineApplicationManager::update_fleet() {
+    fleet.configure(current_config.fleet_nodes);
+}
+
+std::map<std::string, std::string> WineApplicationManager::get_node_status() {
+    std::map<std::string, std::string> status;
+    
+    char hostname[256] = {};
+    gethostname(hostname, sizeof(hostname) - 1);
+    status["hostname"] = hostname;
+    status["version"] = get_version();
+    status["gpu_driver"] = shader_cache.get_driver_key();
+    
+    for (const auto& pair : monitor.get_system_stats()) {
+        if (pair.first.compare(0, 8, "monitor_") == 0) continue;
+        char value[32];
+        snprintf(value, sizeof(value), "%.15g", pair.second);
+        status[pair.first] = value;
+    }
+    
+    size_t running = 0;
+    for (const auto& process : monitor.get_snapshot()->processes) {
+        if (process.state == ProcessState::STARTING || process.state == ProcessState::RUNNING ||
+            process.state == ProcessState::PAUSED || process.state == ProcessState::STOPPING) {
+            running++;
+        }
+    }
+    status["running_processes"] = std::to_string(running);
+    status["queue_depth"] = std::to_string(launch_scheduler.pending_count());
+    
+    std::set<std::string> prefixes;
+    for (const auto& name : prefix_manager.list_prefixes()) {
+        std::string path = prefix_manager.get_prefix_path(name);
+        if (!path.empty() && Utils::directory_exists(path)) prefixes.insert(path);
+    }
+    if (!current_config.wine_prefix.empty() && Utils::directory_exists(current_config.wine_prefix)) {
+        prefixes.insert(current_config.wine_prefix);
+    }
+    
+    std::string template_name = prefix_manager.get_template_prefix();
+    std::string template_path = template_name.empty() ? "" : prefix_manager.get_prefix_path(template_name);
+    status["templates"] = Utils::directory_exists(template_path) ? template_path : "";
+    
+    for (const auto& path : prefixes) {
+        status["prefixes"] += (status["prefixes"].empty() ? "" : "\n") + path;
+    }
+    for (const auto& path : prefix_manager.get_server_pool().get_warm_prefixes()) {
+        status["warm_prefixes"] += (status["warm_prefixes"].empty() ? "" : "\n") + path;
+    }
+    
+    return status;
+}
+
+std::string WineApplicationManager::get_metrics_text() {
+    std::string out;
+    metrics.render(out);
+    
+    auto system_stats = monitor.get_system_stats();
+    MetricsRegistry::add_family(out, "wine_monitor_ticks", "counter", "Process sampling ticks completed.");
+    MetricsRegistry::add_sample(out, "wine_monitor_ticks_total", {}, system_stats["monitor_ticks"]);
+    MetricsRegistry::add_family(out, "wine_monitor_tick_seconds", "counter", "Time spent in process sampling ticks.");
+    MetricsRegistry::add_sample(out, "wine_monitor_tick_seconds_total", {}, system_stats["monitor_total_tick_ms"] / 1000.0);
+    MetricsRegistry::add_family(out, "wine_monitor_last_tick_seconds", "gauge", "Duration of the last sampling tick.");
+    MetricsRegistry::add_sample(out, "wine_monitor_last_tick_seconds", {}, system_stats["monitor_last_tick_ms"] / 1000.0);
+    
+    LoggerStats log_stats = logger.get_stats();
+    MetricsRegistry::add_family(out, "wine_logger_queue_depth", "gauge", "Messages waiting in the async log queue.");
+    MetricsRegistry::add_sample(out, "wine_logger_queue_depth", {}, static_cast<double>(log_stats.queue_depth));
+    MetricsRegistry::add_family(out, "wine_logger_queue_capacity", "gauge", "Capacity of the async log queue.");
+    MetricsRegistry::add_sample(out, "wine_logger_queue_capacity", {}, static_cast<double>(log_stats.queue_capacity));
+    MetricsRegistry::add_family(out, "wine_logger_messages", "counter", "Log messages written.");
+    MetricsRegistry::add_sample(out, "wine_logger_messages_total", {}, static_cast<double>(log_stats.messages_logged));
+    MetricsRegistry::add_family(out, "wine_logger_dropped", "counter", "Log messages dropped under backpressure.");
+    MetricsRegistry::add_sample(out, "wine_logger_dropped_total", {}, static_cast<double>(log_stats.messages_dropped));
+    
+    WineserverPoolStats pool = prefix_manager.get_server_pool().get_stats();
+    MetricsRegistry::add_family(out, "wine_wineserver_spawns", "counter", "Wineservers started by the pool.");
+    MetricsRegistry::add_sample(out, "wine_wineserver_spawns_total", {}, static_cast<double>(pool.spawns));
+    MetricsRegistry::add_family(out, "wine_wineserver_hits", "counter", "Launches that reused a running wineserver.");
+    MetricsRegistry::add_sample(out, "wine_wineserver_hits_total", {}, static_cast<double>(pool.hits));
+    MetricsRegistry::add_family(out, "wine_wineservers_active", "gauge", "Wineservers currently kept warm.");
+    MetricsRegistry::add_sample(out, "wine_wineservers_active", {}, static_cast<double>(pool.active_servers));
+    
+    auto prefetch_reports = prefetch.get_reports();
+    if (!prefetch_reports.empty()) {
+        MetricsRegistry::add_family(out, "wine_prefetch_bytes", "gauge", "Bytes replayed by the last prefetch.");
+        for (const auto& report : prefetch_reports) {
+            MetricsRegistry::add_sample(out, "wine_prefetch_bytes", {{"application", report.application}},
+                                        static_cast<double>(report.bytes));
+        }
+        MetricsRegistry::add_family(out, "wine_prefetch_page_cache_hit_ratio", "gauge",
+                                    "Share of prefetched pages already resident before the last replay.");
+        for (const auto& report : prefetch_reports) {
+            MetricsRegistry::add_sample(out, "wine_prefetch_page_cache_hit_ratio", {{"application", report.application}},
+                                        report.hit_ratio());
+        }
+    }
+    
+    auto fleet_nodes = fleet.get_nodes();
+    if (!fleet_nodes.empty()) {
+        MetricsRegistry::add_family(out, "wine_fleet_node_up", "gauge", "Whether the fleet node answered its last status query.");
+        for (const auto& node : fleet_nodes) {
+            MetricsRegistry::add_sample(out, "wine_fleet_node_up", {{"node", node.name}}, node.reachable ? 1.0 : 0.0);
+        }
+        MetricsRegistry::add_family(out, "wine_fleet_node_queue_depth", "gauge",
+                                    "Launches queued, running or being placed on each fleet node.");
+        for (const auto& node : fleet_nodes) {
+            MetricsRegistry::add_sample(out, "wine_fleet_node_queue_depth", {{"node", node.name}},
+                                        static_cast<double>(node.queue_depth + node.inflight));
+        }
+        MetricsRegistry::add_family(out, "wine_fleet_node_load", "gauge", "One-minute load average per CPU of each fleet node.");
+        for (const auto& node : fleet_nodes) {
+            MetricsRegistry::add_sample(out, "wine_fleet_node_load", {{"node", node.name}}, node.load);
+        }
+    }
+    
+    auto subscribers = monitor.get_event_bus().get_stats();
+    MetricsRegistry::add_family(out, "wine_event_queue_depth", "gauge", "Events waiting for each subscriber.");
+    for (const auto& subscriber : subscribers) {
+        MetricsRegistry::add_sample(out, "wine_event_queue_depth", {{"subscriber", subscriber.name}},
+                                    static_cast<double>(subscriber.queue_depth));
+    }
+    MetricsRegistry::add_family(out, "wine_event_dropped", "counter", "Stats events dropped for each subscriber.");
+    for (const auto& subscriber : subscribers) {
+        MetricsRegistry::add_sample(out, "wine_event_dropped_total", {{"subscriber", subscriber.name}},
+                                    static_cast<double>(subscriber.dropped));
+    }
+    
+    auto snapshot = monitor.get_snapshot();
+    const std::pair<const char*, const char*> process_families[] = {
+        {"wine_process_resident_bytes", "Resident memory of the launched process."},
+        {"wine_process_cpu_percent", "CPU usage of the launched process."},
+        {"wine_process_tree_resident_bytes", "Resident memory of the process tree or cgroup."},
+        {"wine_process_tree_cpu_percent", "CPU usage of the process tree or cgroup."}
+    };
+    for (size_t family = 0; family < 4; ++family) {
+        MetricsRegistry::add_family(out, process_families[family].first, "gauge", process_families[family].second);
+        for (const auto& info : snapshot->processes) {
+            if (info.state == ProcessState::STOPPED || info.state == ProcessState::KILLED) {
+                continue;
+            }
+            double values[] = {static_cast<double>(info.memory_usage), info.cpu_usage,
+                               static_cast<double>(info.tree_memory_usage), info.tree_cpu_usage};
+            MetricsRegistry::add_sample(out, process_families[family].first,
+                                        {{"pid", std::to_string(info.pid)},
+                                         {"executable", Utils::get_filename(info.executable_path)},
+                                         {"prefix", info.wine_prefix}}, values[family]);
+        }
+    }
+    
+    out += "# EOF\n";
+    return out;
+}
+
 std::string WineApplicationManager::get_version() {
     return "WineApp 1.0.0";
 }
@@ -0,0 +1,476 @@
+#include "wine_wrapper.hpp"
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cerrno>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+namespace WineWrapper {
+
+namespace {
+
+const off_t MIN_DEDUP_SIZE = 4096;
+
+const char* const DEDUP_EXTENSIONS[] = {
+    ".dll", ".exe", ".sys", ".drv", ".ocx", ".cpl", ".acm", ".ax", ".tlb", ".nls", ".msi", ".cab"
+};
+
+std::string file_signature(const struct stat& st) {
+    char signature[96];
+    snprintf(signature, sizeof(signature), "%llx:%llx:%lld.%ld:%lld", static_cast<unsigned long long>(st.st_dev),
+             static_cast<unsigned long long>(st.st_ino), static_cast<long long>(st.st_mtim.tv_sec),
+             st.st_mtim.tv_nsec, static_cast<long long>(st.st_size));
+    return signature;
+}
+
+bool is_hash(const std::string& hash) {
+    if (hash.size() != 64) {
+        return false;
+    }
+    for (char c : hash) {
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool has_dedup_extension(const char* name) {
+    const char* dot = strrchr(name, '.');
+    if (!dot) {
+        return false;
+    }
+    for (const char* extension : DEDUP_EXTENSIONS) {
+        if (strcasecmp(dot, extension) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_wine_builtin(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    char marker[32] = {0};
+    ssize_t n = pread(fd, marker, sizeof(marker) - 1, 0x40);
+    close(fd);
+    return n > 0 && (strncmp(marker, "Wine builtin DLL", 16) == 0 || strncmp(marker, "Wine placeholder DLL", 20) == 0);
+}
+
+bool copy_contents(int in, int out, off_t size) {
+    if (ioctl(out, FICLONE, in) == 0) {
+        return true;
+    }
+    
+    off_t remaining = size;
+    while (remaining > 0) {
+        ssize_t n = copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(remaining), 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        remaining -= n;
+    }
+    if (remaining <= 0) {
+        return true;
+    }
+    
+    if (lseek(in, size - remaining, SEEK_SET) == -1) {
+        return false;
+    }
+    char buffer[1 << 16];
+    while (remaining > 0) {
+        ssize_t n = read(in, buffer, sizeof(buffer));
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        for (ssize_t offset = 0; offset < n;) {
+            ssize_t written = write(out, buffer + offset, static_cast<size_t>(n - offset));
+            if (written <= 0) return false;
+            offset += written;
+        }
+        remaining -= n;
+    }
+    return true;
+}
+
+}
+
+ArtifactStore::ArtifactStore(Logger& log)
+    : logger(log), method(CloneMethod::AUTO), files_deduplicated(0), bytes_deduplicated(0), integrity_failures(0),
+      temp_counter(0) {
+}
+
+void ArtifactStore::set_root(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(store_mutex);
+    root = directory;
+    verified_objects.clear();
+    hashed_files.clear();
+}
+
+void ArtifactStore::set_method(CloneMethod value) {
+    method = value;
+}
+
+std::string ArtifactStore::object_path(const std::string& hash) const {
+    return root + "/objects/" + hash.substr(0, 2) + "/" + hash.substr(2);
+}
+
+std::string ArtifactStore::temporary_path(const std::string& directory) {
+    return Utils::join_paths(directory, ".artifact-" + std::to_string(getpid()) + "-" +
+                                        std::to_string(temp_counter++));
+}
+
+bool ArtifactStore::contains(const std::string& hash) {
+    return is_hash(hash) && !root.empty() && access(object_path(hash).c_str(), F_OK) == 0;
+}
+
+bool ArtifactStore::verify(const std::string& hash) {
+    if (!is_hash(hash) || root.empty()) {
+        return false;
+    }
+    
+    std::string path = object_path(hash);
+    struct stat st;
+    if (lstat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    
+    std::string signature = file_signature(st);
+    {
+        std::lock_guard<std::mutex> lock(store_mutex);
+        auto it = verified_objects.find(hash);
+        if (it != verified_objects.end() && it->second == signature) {
+            return true;
+        }
+    }
+    
+    if (Sha256::hash_file(path) != hash) {
+        logger.error("Artifact " + hash + " failed integrity check, removing it from the store");
+        integrity_failures++;
+        unlink(path.c_str());
+        std::lock_guard<std::mutex> lock(store_mutex);
+        verified_objects.erase(hash);
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(store_mutex);
+    verified_objects[hash] = signature;
+    return true;
+}
+
+bool ArtifactStore::import_object(const std::string& source, const std::string& hash, bool adopt) {
+    if (verify(hash)) {
+        return true;
+    }
+    
+    std::string path = object_path(hash);
+    std::string directory = Utils::get_directory(path);
+    std::string staging = Utils::join_paths(root, "tmp");
+    if (!Utils::create_directory(directory) || !Utils::create_directory(staging)) {
+        logger.error("Failed to create artifact store directories under " + root);
+        return false;
+    }
+    
+    // Only files the store itself created may be adopted by linking: chmod on a prefix's file would
+    // make the live copy read-only and tie its inode to the store.
+    std::string temp = temporary_path(staging);
+    bool staged = adopt && link(source.c_str(), temp.c_str()) == 0;
+    
+    if (!staged) {
+        int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in == -1) {
+            logger.error("Failed to open " + source + ": " + strerror(errno));
+            return false;
+        }
+        int out = open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0444);
+        struct stat st;
+        staged = out != -1 && fstat(in, &st) == 0 && copy_contents(in, out, st.st_size);
+        close(in);
+        if (out != -1) {
+            close(out);
+        }
+        if (!staged) {
+            logger.error("Failed to stage " + source + " in artifact store: " + strerror(errno));
+            unlink(temp.c_str());
+            return false;
+        }
+    }
+    
+    if (Sha256::hash_file(temp) != hash) {
+        logger.error("Artifact source changed while storing: " + source);
+        unlink(temp.c_str());
+        return false;
+    }
+    
+    if (chmod(temp.c_str(), 0444) != 0 || rename(temp.c_str(), path.c_str()) != 0) {
+        logger.error("Failed to publish artifact " + hash + ": " + strerror(errno));
+        unlink(temp.c_str());
+        return false;
+    }
+    
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0) {
+        std::lock_guard<std::mutex> lock(store_mutex);
+        verified_objects[hash] = file_signature(st);
+    }
+    logger.debug("Stored artifact " + hash + " from " + source);
+    return true;
+}
+
+std::string ArtifactStore::store_file(const std::string& path) {
+    if (root.empty()) {
+        return "";
+    }
+    
+    std::string hash = Sha256::hash_file(path);
+    if (hash.empty() || !import_object(path, hash, false)) {
+        return "";
+    }
+    return hash;
+}
+
+std::string ArtifactStore::store_data(const std::string& data) {
+    if (root.empty()) {
+        return "";
+    }
+    
+    std::string hash = Sha256::hash(data);
+    if (verify(hash)) {
+        return hash;
+    }
+    
+    std::string staging = Utils::join_paths(root, "tmp");
+    if (!Utils::create_directory(staging)) {
+        return "";
+    }
+    std::string temp = temporary_path(staging);
+    bool stored = Utils::write_file(temp, data) && import_object(temp, hash, true);
+    unlink(temp.c_str());
+    return stored ? hash : "";
+}
+
+bool ArtifactStore::link_object(const std::string& object, const std::string& destination, bool hardlink) {
+    std::string temp = temporary_path(Utils::get_directory(destination));
+    
+    if (hardlink) {
+        if (link(object.c_str(), temp.c_str()) != 0) {
+            return false;
+        }
+        return rename(temp.c_str(), destination.c_str()) == 0 || (unlink(temp.c_str()), false);
+    }
+    if (method == CloneMethod::COPY) {
+        return false;
+    }
+    
+    int in = open(object.c_str(), O_RDONLY | O_CLOEXEC);
+    int out = in == -1 ? -1 : open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    bool cloned = out != -1 && ioctl(out, FICLONE, in) == 0;
+    if (cloned) {
+        struct stat st;
+        if (stat(destination.c_str(), &st) == 0) {
+            fchmod(out, st.st_mode & 07777);
+        }
+    }
+    if (in != -1) close(in);
+    if (out != -1) close(out);
+    
+    if (cloned) {
+        return rename(temp.c_str(), destination.c_str()) == 0 || (unlink(temp.c_str()), false);
+    }
+    unlink(temp.c_str());
+    return false;
+}
+
+bool ArtifactStore::materialize(const std::string& hash, const std::string& destination) {
+    if (!verify(hash)) {
+        return false;
+    }
+    
+    std::string object = object_path(hash);
+    if (method != CloneMethod::COPY && link_object(object, destination, method == CloneMethod::HARDLINK)) {
+        return true;
+    }
+    
+    std::string temp = temporary_path(Utils::get_directory(destination));
+    int in = open(object.c_str(), O_RDONLY | O_CLOEXEC);
+    int out = in == -1 ? -1 : open(temp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    struct stat st;
+    bool copied = out != -1 && fstat(in, &st) == 0 && copy_contents(in, out, st.st_size);
+    if (in != -1) close(in);
+    if (out != -1) close(out);
+    
+    if (!copied || rename(temp.c_str(), destination.c_str()) != 0) {
+        logger.error("Failed to materialize artifact " + hash + " at " + destination);
+        unlink(temp.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ArtifactStore::probe_reflink(const std::string& directory) {
+    std::string source = temporary_path(Utils::join_paths(root, "tmp"));
+    std::string target = temporary_path(directory);
+    
+    bool supported = false;
+    if (Utils::create_directory(Utils::join_paths(root, "tmp")) && Utils::write_file(source, "probe")) {
+        int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+        int out = open(target.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0600);
+        supported = in != -1 && out != -1 && ioctl(out, FICLONE, in) == 0;
+        if (in != -1) close(in);
+        if (out != -1) close(out);
+    }
+    
+    unlink(source.c_str());
+    unlink(target.c_str());
+    return supported;
+}
+
+size_t ArtifactStore::deduplicate_directory(const std::string& directory, dev_t store_device, bool reflinks,
+                                            bool hardlinks) {
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        return 0;
+    }
+    
+    size_t linked = 0;
+    std::vector<std::string> subdirectories;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        const char* name = entry->d_name;
+        if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+            continue;
+        }
+        
+        struct stat st;
+        if (fstatat(dirfd(dir), name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        
+        std::string path = Utils::join_paths(directory, name);
+        if (S_ISDIR(st.st_mode)) {
+            subdirectories.push_back(path);
+            continue;
+        }
+        if (!S_ISREG(st.st_mode) || st.st_size < MIN_DEDUP_SIZE || st.st_dev != store_device ||
+            !has_dedup_extension(name)) {
+            continue;
+        }
+        
+        std::string signature = file_signature(st);
+        std::string hash;
+        {
+            std::lock_guard<std::mutex> lock(store_mutex);
+            auto it = hashed_files.find(path);
+            if (it != hashed_files.end() && it->second.signature == signature) {
+                if (it->second.linked) {
+                    continue;
+                }
+                hash = it->second.hash;
+            }
+        }
+        
+        if (hash.empty()) {
+            hash = Sha256::hash_file(path);
+            if (hash.empty()) {
+                continue;
+            }
+        }
+        
+        bool hardlink = hardlinks && !reflinks && !is_wine_builtin(path);
+        if (!hardlink && !reflinks) {
+            continue;
+        }
+        
+        bool imported = !contains(hash) && import_object(path, hash, false);
+        struct stat object_st;
+        bool replaced = (imported && reflinks) ||
+                        (lstat(object_path(hash).c_str(), &object_st) == 0 && object_st.st_ino == st.st_ino);
+        if (!replaced && contains(hash) && verify(hash)) {
+            replaced = link_object(object_path(hash), path, hardlink);
+            if (replaced) {
+                files_deduplicated++;
+                bytes_deduplicated += static_cast<uint64_t>(st.st_size);
+                linked++;
+            }
+        }
+        
+        struct stat updated;
+        if (lstat(path.c_str(), &updated) == 0) {
+            std::lock_guard<std::mutex> lock(store_mutex);
+            hashed_files[path] = {file_signature(updated), hash, replaced};
+        }
+    }
+    closedir(dir);
+    
+    for (const auto& subdirectory : subdirectories) {
+        linked += deduplicate_directory(subdirectory, store_device, reflinks, hardlinks);
+    }
+    return linked;
+}
+
+size_t ArtifactStore::deduplicate_tree(const std::string& directory, bool allow_hardlinks) {
+    if (root.empty() || method == CloneMethod::COPY) {
+        return 0;
+    }
+    
+    std::string objects = Utils::join_paths(root, "objects");
+    struct stat store_st;
+    if (!Utils::create_directory(objects) || stat(objects.c_str(), &store_st) != 0) {
+        logger.error("Artifact store unavailable at " + root);
+        return 0;
+    }
+    
+    // Hardlinked files share one inode (and mode) with every other prefix, so an in-place write by Wine
+    // or winetricks would corrupt all of them. They are only used when explicitly requested.
+    bool hardlinks = method == CloneMethod::HARDLINK || (allow_hardlinks && method == CloneMethod::AUTO);
+    bool reflinks = method != CloneMethod::HARDLINK && probe_reflink(directory);
+    if (!reflinks && !hardlinks) {
+        if (method == CloneMethod::REFLINK) {
+            logger.warning("Filesystem does not support reflinks, skipping deduplication of " + directory);
+        } else {
+            logger.debug("Filesystem does not support reflinks, skipping deduplication of " + directory);
+        }
+        return 0;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    uint64_t bytes_before = bytes_deduplicated;
+    size_t linked = deduplicate_directory(directory, store_st.st_dev, reflinks, hardlinks);
+    
+    logger.info("Deduplicated " + std::to_string(linked) + " files (" +
+                std::to_string((bytes_deduplicated - bytes_before) >> 20) + " MB) in " + directory + " in " +
+                std::to_string(static_cast<int>(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count())) + " ms");
+    return linked;
+}
+
+size_t ArtifactStore::deduplicate_prefix(const std::string& prefix_path, bool allow_hardlinks) {
+    return deduplicate_tree(Utils::join_paths(prefix_path, "drive_c"), allow_hardlinks);
+}
+
+ArtifactStoreStats ArtifactStore::get_stats() {
+    ArtifactStoreStats stats;
+    stats.objects = 0;
+    stats.object_bytes = 0;
+    stats.files_deduplicated = files_deduplicated;
+    stats.bytes_deduplicated = bytes_deduplicated;
+    stats.integrity_failures = integrity_failures;
+    
+    std::string objects = Utils::join_paths(root, "objects");
+    for (const auto& shard : Utils::list_directory(objects)) {
+        std::string shard_path = Utils::join_paths(objects, shard);
+        for (const auto& name : Utils::list_directory(shard_path)) {
+            struct stat st;
+            if (lstat(Utils::join_paths(shard_path, name).c_str(), &st) == 0 && S_ISREG(st.st_mode)) {
+                stats.objects++;
+                stats.object_bytes += static_cast<uint64_t>(st.st_size);
+            }
+        }
+    }
+    return stats;
+}
+
+}
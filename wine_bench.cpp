@@ -0,0 +1,496 @@
+#include "wine_wrapper.hpp"
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <getopt.h>
+#include <sys/utsname.h>
+
+#ifndef WINE_APP_VERSION
+#define WINE_APP_VERSION "unknown"
+#endif
+
+using namespace WineWrapper;
+
+namespace {
+
+struct BenchResult {
+    std::string name;
+    std::map<std::string, std::string> parameters;
+    std::string unit;
+    double throughput;
+    std::vector<double> samples_us;
+    double total_ms;
+};
+
+std::string json_escape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string json_number(double value) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.3f", value);
+    return buffer;
+}
+
+double percentile(std::vector<double> samples, double fraction) {
+    if (samples.empty()) {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(fraction * static_cast<double>(samples.size() - 1));
+    std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+    return samples[index];
+}
+
+double elapsed_us(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
+
+class WineBenchmark {
+private:
+    std::string work_dir;
+    std::string filter;
+    bool quick;
+    unsigned seed;
+    Logger logger;
+    std::vector<BenchResult> results;
+    
+    bool selected(const std::string& name) {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+    
+    void record(BenchResult result) {
+        std::cerr << std::left << std::setw(40) << result.name << std::right << std::setw(14) << std::fixed
+                  << std::setprecision(1) << result.throughput << " " << result.unit;
+        if (!result.samples_us.empty()) {
+            std::cerr << "  p50 " << std::setprecision(2) << percentile(result.samples_us, 0.5) << " us  p99 "
+                      << percentile(result.samples_us, 0.99) << " us";
+        }
+        std::cerr << std::endl;
+        results.push_back(std::move(result));
+    }
+    
+    void bench_logger(bool async, int threads) {
+        std::string name = std::string("logger.") + (async ? "async" : "sync") + ".threads_" + std::to_string(threads);
+        if (!selected(name)) return;
+        
+        std::string log_path = Utils::join_paths(work_dir, "bench.log");
+        unlink(log_path.c_str());
+        const size_t per_thread = quick ? 20000 : 200000;
+        
+        BenchResult result;
+        result.name = name;
+        result.parameters["messages_per_thread"] = std::to_string(per_thread);
+        result.unit = "msgs/s";
+        {
+            Logger bench_logger(log_path, LogLevel::INFO);
+            bench_logger.set_console_output(false);
+            bench_logger.set_recent_capacity(0);
+            bench_logger.set_backpressure_policy(LogBackpressure::BLOCK);
+            bench_logger.enable_async_logging(async);
+            
+            std::vector<std::vector<double>> latencies(threads);
+            std::vector<std::thread> workers;
+            auto start = std::chrono::steady_clock::now();
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&bench_logger, &latencies, t, per_thread] {
+                    std::string message = "benchmark thread " + std::to_string(t) + " message payload ";
+                    latencies[t].reserve(per_thread / 16 + 1);
+                    for (size_t i = 0; i < per_thread; ++i) {
+                        if (i % 16 == 0) {
+                            auto call = std::chrono::steady_clock::now();
+                            bench_logger.info(message);
+                            latencies[t].push_back(elapsed_us(call));
+                        } else {
+                            bench_logger.info(message);
+                        }
+                    }
+                });
+            }
+            for (auto& worker : workers) {
+                worker.join();
+            }
+            bench_logger.flush();
+            result.total_ms = elapsed_us(start) / 1000.0;
+            
+            for (const auto& samples : latencies) {
+                result.samples_us.insert(result.samples_us.end(), samples.begin(), samples.end());
+            }
+            result.parameters["dropped"] = std::to_string(bench_logger.get_stats().messages_dropped);
+        }
+        result.throughput = static_cast<double>(per_thread * threads) * 1000.0 / result.total_ms;
+        unlink(log_path.c_str());
+        record(std::move(result));
+    }
+    
+    void bench_monitor_tick(size_t pid_count) {
+        std::string name = "monitor.tick.pids_" + std::to_string(pid_count);
+        if (!selected(name)) return;
+        
+        std::vector<pid_t> stubs;
+        for (size_t i = 0; i < pid_count; ++i) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                for (;;) pause();
+            }
+            if (pid > 0) stubs.push_back(pid);
+        }
+        
+        BenchResult result;
+        result.name = name;
+        result.parameters["pids"] = std::to_string(stubs.size());
+        result.unit = "ticks/s";
+        {
+            ProcessMonitor monitor(logger);
+            for (pid_t pid : stubs) {
+                ProcessInfo info;
+                info.pid = pid;
+                info.state = ProcessState::RUNNING;
+                info.executable_path = "stub.exe";
+                info.start_time = std::chrono::system_clock::now();
+                monitor.add_process(pid, info);
+            }
+            
+            monitor.set_update_interval(std::chrono::milliseconds(10));
+            monitor.start_monitoring();
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            
+            auto before = monitor.get_system_stats();
+            auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(quick ? 500 : 2000);
+            while (std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                result.samples_us.push_back(monitor.get_system_stats()["monitor_last_tick_ms"] * 1000.0);
+            }
+            auto after = monitor.get_system_stats();
+            
+            double ticks = after["monitor_ticks"] - before["monitor_ticks"];
+            result.total_ms = after["monitor_total_tick_ms"] - before["monitor_total_tick_ms"];
+            result.throughput = result.total_ms > 0 ? ticks * 1000.0 / result.total_ms : 0.0;
+            result.parameters["ticks"] = std::to_string(static_cast<uint64_t>(ticks));
+            monitor.stop_monitoring();
+        }
+        
+        for (pid_t pid : stubs) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+        }
+        record(std::move(result));
+    }
+    
+    void bench_executor() {
+        std::string name = "executor.time_to_exec";
+        if (!selected(name)) return;
+        
+        std::string fake_wine = Utils::join_paths(work_dir, "fake-wine");
+        std::string exe = Utils::join_paths(work_dir, "bench.exe");
+        std::string prefix = Utils::join_paths(work_dir, "prefix");
+        Utils::write_file(fake_wine, "#!/bin/sh\nexit 0\n");
+        Utils::set_file_permissions(fake_wine, 0755);
+        Utils::write_file(exe, "MZ");
+        Utils::create_directory(prefix);
+        
+        const size_t iterations = quick ? 50 : 500;
+        BenchResult result;
+        result.name = name;
+        result.parameters["iterations"] = std::to_string(iterations);
+        result.unit = "launches/s";
+        {
+            ProcessMonitor monitor(logger);
+            WinePrefixManager prefixes(logger);
+            WineExecutor executor(logger, monitor, prefixes);
+            monitor.start_monitoring();
+            
+            WineConfiguration cfg;
+            cfg.wine_prefix = prefix;
+            cfg.wine_binary = fake_wine;
+            cfg.capture_stdout = false;
+            cfg.capture_stderr = false;
+            auto env = executor.prepare_environment(cfg);
+            
+            auto start = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < iterations && env; ++i) {
+                auto launch = std::chrono::steady_clock::now();
+                pid_t pid = executor.execute(cfg, env, exe);
+                if (pid == -1) break;
+                result.samples_us.push_back(elapsed_us(launch));
+                executor.wait_for_exit(pid);
+            }
+            result.total_ms = elapsed_us(start) / 1000.0;
+            monitor.stop_monitoring();
+        }
+        
+        double exec_ms = 0;
+        for (double sample : result.samples_us) exec_ms += sample / 1000.0;
+        result.throughput = exec_ms > 0 ? static_cast<double>(result.samples_us.size()) * 1000.0 / exec_ms : 0.0;
+        record(std::move(result));
+    }
+    
+    void bench_registry_parse() {
+        std::string name = "registry.parse";
+        if (!selected(name)) return;
+        
+        const size_t target_bytes = (quick ? 5 : 50) << 20;
+        std::string hive_path = Utils::join_paths(work_dir, "bench.reg");
+        {
+            std::mt19937 random(seed);
+            std::ofstream hive(hive_path);
+            hive << "WINE REGISTRY Version 2\n;; All keys relative to \\\\Machine\n\n#arch=win64\n\n";
+            size_t key = 0;
+            while (static_cast<size_t>(hive.tellp()) < target_bytes) {
+                hive << "[Software\\\\Bench\\\\Vendor" << key % 97 << "\\\\Product" << key << "] 1700000000\n";
+                hive << "#time=1d9a1b2c3d4e5f6\n";
+                for (int value = 0; value < 8; ++value) {
+                    hive << "\"Value" << value << "\"=";
+                    if (value % 3 == 0) {
+                        hive << "dword:" << std::hex << std::setw(8) << std::setfill('0') << random() << std::dec << "\n";
+                    } else {
+                        hive << "\"C:\\\\Program Files\\\\Bench\\\\" << random() << "\\\\file" << value << ".dll\"\n";
+                    }
+                }
+                hive << "\n";
+                ++key;
+            }
+        }
+        size_t file_size = Utils::get_file_size(hive_path);
+        
+        const int iterations = quick ? 3 : 5;
+        BenchResult result;
+        result.name = name;
+        result.parameters["file_bytes"] = std::to_string(file_size);
+        result.parameters["iterations"] = std::to_string(iterations);
+        result.unit = "MB/s";
+        
+        size_t values = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            auto parse = std::chrono::steady_clock::now();
+            RegistryHive hive;
+            if (!hive.load(hive_path)) break;
+            std::map<std::string, std::map<std::string, std::string>> cache;
+            hive.for_each_value([&cache](const std::string& key, const std::string& value_name,
+                                         const std::string& value) {
+                cache[key][value_name] = value;
+            });
+            values = hive.value_count();
+            result.samples_us.push_back(elapsed_us(parse));
+        }
+        result.total_ms = elapsed_us(start) / 1000.0;
+        result.parameters["values"] = std::to_string(values);
+        result.throughput = result.samples_us.empty() ? 0.0 :
+            static_cast<double>(file_size) / (1 << 20) / (percentile(result.samples_us, 0.5) / 1e6);
+        
+        unlink(hive_path.c_str());
+        record(std::move(result));
+    }
+    
+    void bench_directory_size() {
+        std::string name = "utils.directory_size";
+        if (!selected(name)) return;
+        
+        std::string tree = Utils::join_paths(work_dir, "tree");
+        const int fanout = quick ? 6 : 10;
+        const int files_per_dir = 20;
+        size_t files = 0;
+        for (int a = 0; a < fanout; ++a) {
+            for (int b = 0; b < fanout; ++b) {
+                std::string dir = tree + "/d" + std::to_string(a) + "/d" + std::to_string(b);
+                Utils::create_directory(dir);
+                for (int f = 0; f < files_per_dir; ++f) {
+                    Utils::write_file(dir + "/f" + std::to_string(f), std::string(static_cast<size_t>(f) * 64, 'x'));
+                    ++files;
+                }
+            }
+        }
+        
+        const int iterations = quick ? 5 : 20;
+        BenchResult result;
+        result.name = name;
+        result.parameters["files"] = std::to_string(files);
+        result.parameters["iterations"] = std::to_string(iterations);
+        result.unit = "files/s";
+        
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            auto scan = std::chrono::steady_clock::now();
+            size_t size = Utils::get_directory_size(tree);
+            result.samples_us.push_back(elapsed_us(scan));
+            result.parameters["bytes"] = std::to_string(size);
+        }
+        result.total_ms = elapsed_us(start) / 1000.0;
+        result.throughput = static_cast<double>(files) / (percentile(result.samples_us, 0.5) / 1e6);
+        
+        Utils::remove_directory(tree);
+        record(std::move(result));
+    }
+    
+    void bench_path_resolver() {
+        std::string name = "path_resolver.windows_to_unix";
+        if (!selected(name)) return;
+        
+        std::string prefix = Utils::join_paths(work_dir, "resolver");
+        Utils::create_directory(prefix + "/drive_c/Program Files/Bench");
+        Utils::create_directory(prefix + "/dosdevices");
+        symlink("../drive_c", (prefix + "/dosdevices/c:").c_str());
+        symlink("/", (prefix + "/dosdevices/z:").c_str());
+        
+        std::mt19937 random(seed);
+        std::vector<std::string> paths;
+        for (int i = 0; i < 1024; ++i) {
+            paths.push_back(std::string(random() % 4 == 0 ? "Z:" : "C:") + "\\Program Files\\Bench\\Dir" +
+                            std::to_string(random() % 64) + "\\File" + std::to_string(i) + ".dll");
+        }
+        
+        const size_t lookups = quick ? 100000 : 1000000;
+        BenchResult result;
+        result.name = name;
+        result.parameters["lookups"] = std::to_string(lookups);
+        result.unit = "lookups/s";
+        
+        PathResolver resolver(prefix);
+        size_t checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < lookups; ++i) {
+            if (i % 64 == 0) {
+                auto lookup = std::chrono::steady_clock::now();
+                checksum += resolver.windows_to_unix(paths[i % paths.size()]).size();
+                result.samples_us.push_back(elapsed_us(lookup));
+            } else {
+                checksum += resolver.windows_to_unix(paths[i % paths.size()]).size();
+            }
+        }
+        result.total_ms = elapsed_us(start) / 1000.0;
+        result.throughput = static_cast<double>(lookups) * 1000.0 / result.total_ms;
+        result.parameters["checksum"] = std::to_string(checksum);
+        
+        Utils::remove_directory(prefix);
+        record(std::move(result));
+    }
+    
+    std::string to_json() {
+        struct utsname host;
+        uname(&host);
+        
+        std::ostringstream json;
+        json << "{\n  \"version\": \"" << WINE_APP_VERSION << "\",\n";
+        json << "  \"timestamp\": \"" << Utils::get_timestamp_string() << "\",\n";
+        json << "  \"host\": {\"kernel\": \"" << json_escape(host.release) << "\", \"machine\": \""
+             << json_escape(host.machine) << "\", \"cpus\": " << std::thread::hardware_concurrency() << "},\n";
+        json << "  \"quick\": " << (quick ? "true" : "false") << ",\n";
+        json << "  \"seed\": " << seed << ",\n";
+        json << "  \"benchmarks\": [";
+        
+        for (size_t i = 0; i < results.size(); ++i) {
+            const BenchResult& result = results[i];
+            json << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << json_escape(result.name) << "\"";
+            json << ", \"unit\": \"" << json_escape(result.unit) << "\"";
+            json << ", \"throughput\": " << json_number(result.throughput);
+            json << ", \"total_ms\": " << json_number(result.total_ms);
+            json << ", \"samples\": " << result.samples_us.size();
+            if (!result.samples_us.empty()) {
+                double sum = 0;
+                for (double sample : result.samples_us) sum += sample;
+                json << ", \"mean_us\": " << json_number(sum / static_cast<double>(result.samples_us.size()));
+                json << ", \"p50_us\": " << json_number(percentile(result.samples_us, 0.5));
+                json << ", \"p99_us\": " << json_number(percentile(result.samples_us, 0.99));
+                json << ", \"max_us\": " << json_number(*std::max_element(result.samples_us.begin(),
+                                                                          result.samples_us.end()));
+            }
+            json << ", \"parameters\": {";
+            bool first = true;
+            for (const auto& parameter : result.parameters) {
+                json << (first ? "" : ", ") << "\"" << json_escape(parameter.first) << "\": \""
+                     << json_escape(parameter.second) << "\"";
+                first = false;
+            }
+            json << "}}";
+        }
+        
+        json << "\n  ]\n}\n";
+        return json.str();
+    }
+    
+public:
+    WineBenchmark(const std::string& dir, const std::string& name_filter, bool quick_run, unsigned random_seed)
+        : work_dir(dir), filter(name_filter), quick(quick_run), seed(random_seed) {
+        logger.set_console_output(false);
+        logger.set_min_level(LogLevel::ERROR_LOG);
+    }
+    
+    std::string run() {
+        bench_logger(false, 1);
+        bench_logger(false, 4);
+        bench_logger(true, 1);
+        bench_logger(true, 4);
+        for (size_t pids : {1, 16, 64, 256}) {
+            if (quick && pids > 16) break;
+            bench_monitor_tick(pids);
+        }
+        bench_executor();
+        bench_registry_parse();
+        bench_directory_size();
+        bench_path_resolver();
+        return to_json();
+    }
+};
+
+int main(int argc, char* argv[]) {
+    std::string output;
+    std::string filter;
+    bool quick = false;
+    unsigned seed = 42;
+    
+    static struct option long_options[] = {
+        {"help", no_argument, 0, 'h'},
+        {"output", required_argument, 0, 'o'},
+        {"filter", required_argument, 0, 'f'},
+        {"quick", no_argument, 0, 'q'},
+        {"seed", required_argument, 0, 's'},
+        {0, 0, 0, 0}
+    };
+    
+    int c;
+    while ((c = getopt_long(argc, argv, "ho:f:qs:", long_options, nullptr)) != -1) {
+        switch (c) {
+            case 'o': output = optarg; break;
+            case 'f': filter = optarg; break;
+            case 'q': quick = true; break;
+            case 's': seed = static_cast<unsigned>(strtoul(optarg, nullptr, 10)); break;
+            default:
+                std::cout << "Usage: wine-bench [--quick] [--filter NAME] [--seed N] [--output FILE]\n"
+                          << "Runs the launch, monitor, logger, registry and filesystem benchmarks and\n"
+                          << "writes the results as JSON to FILE (default: stdout).\n";
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    
+    char dir_template[] = "/tmp/wine-bench-XXXXXX";
+    if (!mkdtemp(dir_template)) {
+        std::cerr << "Failed to create work directory: " << strerror(errno) << std::endl;
+        return 1;
+    }
+    
+    std::string json = WineBenchmark(dir_template, filter, quick, seed).run();
+    Utils::remove_directory(dir_template);
+    
+    if (output.empty()) {
+        std::cout << json;
+    } else if (!Utils::write_file(output, json)) {
+        std::cerr << "Failed to write " << output << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "wine_wrapper.hpp"
+#include <sys/stat.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+namespace {
+
+const char* const WANTED_CONTROLLERS[] = {"cpu", "memory", "io", "pids"};
+
+bool read_text(const std::string& path, std::string& content) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    char buffer[4096];
+    content.clear();
+    for (;;) {
+        ssize_t n = read(fd, buffer, sizeof(buffer));
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        content.append(buffer, static_cast<size_t>(n));
+    }
+    
+    close(fd);
+    return true;
+}
+
+bool read_value(const std::string& path, uint64_t& value) {
+    std::string content;
+    if (!read_text(path, content) || content.empty() || content.compare(0, 3, "max") == 0) {
+        return false;
+    }
+    value = strtoull(content.c_str(), nullptr, 10);
+    return true;
+}
+
+uint64_t keyed_value(const std::string& content, const char* key) {
+    size_t key_length = strlen(key);
+    size_t pos = 0;
+    while (pos < content.size()) {
+        size_t end = content.find('\n', pos);
+        if (end == std::string::npos) end = content.size();
+        if (content.compare(pos, key_length, key) == 0 && content[pos + key_length] == ' ') {
+            return strtoull(content.c_str() + pos + key_length + 1, nullptr, 10);
+        }
+        pos = end + 1;
+    }
+    return 0;
+}
+
+std::string sanitize_name(const std::string& name) {
+    std::string result;
+    for (char c : name) {
+        if (result.size() >= 64) break;
+        result += (isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == '-') ? c : '_';
+    }
+    return result.empty() ? "app" : result;
+}
+
+}
+
+CgroupManager::CgroupManager(Logger& log) : logger(log), next_id(1), root_checked(false) {
+}
+
+std::string CgroupManager::find_unified_mount() {
+    std::ifstream mountinfo("/proc/self/mountinfo");
+    std::string line;
+    while (std::getline(mountinfo, line)) {
+        size_t separator = line.find(" - ");
+        if (separator == std::string::npos || line.compare(separator + 3, 8, "cgroup2 ") != 0) {
+            continue;
+        }
+        
+        std::istringstream fields(line.substr(0, separator));
+        std::string field;
+        for (int i = 0; i < 5 && fields >> field; ++i) {
+        }
+        return field;
+    }
+    return "";
+}
+
+std::string CgroupManager::find_own_cgroup() {
+    std::ifstream cgroup("/proc/self/cgroup");
+    std::string line;
+    while (std::getline(cgroup, line)) {
+        if (line.compare(0, 3, "0::") == 0) {
+            return line.substr(3);
+        }
+    }
+    return "";
+}
+
+bool CgroupManager::write_control(const std::string& path, const std::string& file, const std::string& value) {
+    int fd = open((path + "/" + file).c_str(), O_WRONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    ssize_t written = write(fd, value.data(), value.size());
+    int saved_errno = errno;
+    close(fd);
+    
+    if (written != static_cast<ssize_t>(value.size())) {
+        logger.debug("Failed to write " + file + "=" + value + " in " + path + ": " + strerror(saved_errno));
+        return false;
+    }
+    return true;
+}
+
+bool CgroupManager::ensure_root(const std::string& configured_root) {
+    if (!root_path.empty()) {
+        return true;
+    }
+    if (root_checked && configured_root.empty()) {
+        return false;
+    }
+    root_checked = true;
+    
+    std::string mount = find_unified_mount();
+    if (mount.empty()) {
+        logger.warning("cgroup v2 hierarchy is not mounted, resource isolation disabled");
+        return false;
+    }
+    
+    std::string own = find_own_cgroup();
+    std::string candidate;
+    bool evacuate = false;
+    if (!configured_root.empty()) {
+        candidate = configured_root.compare(0, mount.size(), mount) == 0 ? configured_root
+                                                                           : Utils::join_paths(mount, configured_root);
+    } else if (own.empty() || own == "/") {
+        candidate = Utils::join_paths(mount, "wine-wrapper");
+    } else {
+        candidate = Utils::join_paths(mount, own);
+        evacuate = true;
+    }
+    
+    if (!evacuate && mkdir(candidate.c_str(), 0755) != 0 && errno != EEXIST) {
+        logger.warning("Cannot create cgroup " + candidate + ": " + strerror(errno) +
+                       ", resource isolation disabled");
+        return false;
+    }
+    if (access(candidate.c_str(), W_OK) != 0 || access((candidate + "/cgroup.procs").c_str(), W_OK) != 0) {
+        logger.warning("cgroup " + candidate + " is not delegated to this user, resource isolation disabled");
+        return false;
+    }
+    
+    std::string procs;
+    if (evacuate && read_text(candidate + "/cgroup.procs", procs) && !procs.empty()) {
+        std::string manager = Utils::join_paths(candidate, "manager");
+        if ((mkdir(manager.c_str(), 0755) != 0 && errno != EEXIST) || !write_control(manager, "cgroup.procs", "0")) {
+            logger.warning("Cannot move manager out of " + candidate + ", resource isolation disabled");
+            return false;
+        }
+    }
+    
+    root_path = candidate;
+    enable_controllers();
+    
+    std::string enabled;
+    for (const auto& controller : controllers) {
+        enabled += (enabled.empty() ? "" : " ") + controller;
+    }
+    logger.info("Using cgroup subtree " + root_path + " (controllers: " + (enabled.empty() ? "none" : enabled) + ")");
+    return true;
+}
+
+bool CgroupManager::enable_controllers() {
+    std::string parent = root_path.substr(0, root_path.find_last_of('/'));
+    std::set<std::string> present;
+    
+    for (int pass = 0; pass < 2; ++pass) {
+        std::string available;
+        read_text(root_path + "/cgroup.controllers", available);
+        std::istringstream names(available);
+        std::string name;
+        present.clear();
+        while (names >> name) {
+            present.insert(name);
+        }
+        
+        if (pass == 0) {
+            for (const char* controller : WANTED_CONTROLLERS) {
+                if (!present.count(controller)) {
+                    write_control(parent, "cgroup.subtree_control", std::string("+") + controller);
+                }
+            }
+        }
+    }
+    
+    for (const char* controller : WANTED_CONTROLLERS) {
+        if (present.count(controller) && write_control(root_path, "cgroup.subtree_control",
+                                                       std::string("+") + controller)) {
+            controllers.insert(controller);
+        }
+    }
+    return !controllers.empty();
+}
+
+bool CgroupManager::is_available() {
+    std::lock_guard<std::mutex> lock(cgroup_mutex);
+    return !root_path.empty();
+}
+
+std::string CgroupManager::get_root() {
+    std::lock_guard<std::mutex> lock(cgroup_mutex);
+    return root_path;
+}
+
+std::string CgroupManager::create(const std::string& name, const WineConfiguration& cfg) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(cgroup_mutex);
+        if (!ensure_root(cfg.cgroup_root)) {
+            return "";
+        }
+        
+        std::string base = "app-" + std::to_string(getpid()) + "-";
+        for (int attempt = 0; attempt < 64; ++attempt) {
+            std::string candidate = Utils::join_paths(root_path, base + std::to_string(next_id++) + "-" +
+                                                      sanitize_name(name));
+            if (mkdir(candidate.c_str(), 0755) == 0) {
+                path = candidate;
+                break;
+            }
+            if (errno != EEXIST) {
+                logger.warning("Failed to create cgroup " + candidate + ": " + strerror(errno));
+                return "";
+            }
+        }
+    }
+    
+    if (!path.empty()) {
+        apply_limits(path, cfg);
+    }
+    return path;
+}
+
+bool CgroupManager::apply_limits(const std::string& path, const WineConfiguration& cfg) {
+    std::set<std::string> enabled;
+    {
+        std::lock_guard<std::mutex> lock(cgroup_mutex);
+        enabled = controllers;
+    }
+    
+    bool ok = true;
+    if (enabled.count("cpu")) {
+        ok &= write_control(path, "cpu.weight", std::to_string(cfg.cgroup_cpu_weight));
+        ok &= write_control(path, "cpu.max", cfg.cgroup_cpu_max_percent > 0
+                                                 ? std::to_string(cfg.cgroup_cpu_max_percent * 1000) + " 100000"
+                                                 : "max 100000");
+    }
+    if (enabled.count("memory")) {
+        ok &= write_control(path, "memory.high", cfg.cgroup_memory_high_mb > 0
+                                                     ? std::to_string(cfg.cgroup_memory_high_mb << 20) : "max");
+        ok &= write_control(path, "memory.max", cfg.cgroup_memory_max_mb > 0
+                                                    ? std::to_string(cfg.cgroup_memory_max_mb << 20) : "max");
+        write_control(path, "memory.oom.group", "1");
+    }
+    if (enabled.count("io")) {
+        ok &= write_control(path, "io.weight", "default " + std::to_string(cfg.cgroup_io_weight));
+    }
+    
+    if (!ok) {
+        logger.warning("Some resource limits could not be applied to " + path);
+    }
+    return ok;
+}
+
+int CgroupManager::open_procs(const std::string& path) {
+    return open((path + "/cgroup.procs").c_str(), O_WRONLY | O_CLOEXEC);
+}
+
+bool CgroupManager::sample(const std::string& path, CgroupUsage& usage, bool monitor) {
+    std::string cpu_stat;
+    if (!read_text(path + "/cpu.stat", cpu_stat)) {
+        return false;
+    }
+    
+    memset(&usage, 0, sizeof(usage));
+    usage.cpu_usage_usec = keyed_value(cpu_stat, "usage_usec");
+    usage.cpu_user_usec = keyed_value(cpu_stat, "user_usec");
+    usage.cpu_system_usec = keyed_value(cpu_stat, "system_usec");
+    usage.throttled_usec = keyed_value(cpu_stat, "throttled_usec");
+    
+    read_value(path + "/memory.current", usage.memory_current);
+    read_value(path + "/memory.peak", usage.memory_peak);
+    
+    std::string events;
+    if (read_text(path + "/memory.events", events)) {
+        usage.oom_kills = keyed_value(events, "oom_kill");
+    }
+    
+    if (!read_value(path + "/pids.current", usage.process_count)) {
+        std::string procs;
+        read_text(path + "/cgroup.procs", procs);
+        usage.process_count = static_cast<uint64_t>(std::count(procs.begin(), procs.end(), '\n'));
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(cgroup_mutex);
+    // Ad-hoc queries keep their own baselines so they do not shorten the monitor's sampling interval.
+    std::map<std::string, CpuBaseline>& previous = monitor ? baselines : query_baselines;
+    auto it = previous.find(path);
+    if (it != previous.end()) {
+        double elapsed_usec = std::chrono::duration<double, std::micro>(now - it->second.sampled_at).count();
+        if (elapsed_usec > 0 && usage.cpu_usage_usec >= it->second.usage_usec) {
+            usage.cpu_usage = static_cast<double>(usage.cpu_usage_usec - it->second.usage_usec) * 100.0 / elapsed_usec;
+        }
+    }
+    previous[path] = {usage.cpu_usage_usec, now};
+    return true;
+}
+
+std::vector<pid_t> CgroupManager::get_members(const std::string& path) {
+    std::vector<pid_t> members;
+    std::string procs;
+    if (read_text(path + "/cgroup.procs", procs)) {
+        std::istringstream lines(procs);
+        pid_t pid;
+        while (lines >> pid) {
+            members.push_back(pid);
+        }
+    }
+    return members;
+}
+
+bool CgroupManager::kill_all(const std::string& path) {
+    return write_control(path, "cgroup.kill", "1");
+}
+
+bool CgroupManager::remove(const std::string& path) {
+    std::lock_guard<std::mutex> lock(cgroup_mutex);
+    baselines.erase(path);
+    query_baselines.erase(path);
+    if (rmdir(path.c_str()) == 0 || errno == ENOENT) {
+        pending_removal.erase(path);
+        return true;
+    }
+    
+    pending_removal.insert(path);
+    return false;
+}
+
+void CgroupManager::prune() {
+    std::lock_guard<std::mutex> lock(cgroup_mutex);
+    for (auto it = pending_removal.begin(); it != pending_removal.end();) {
+        if (rmdir(it->c_str()) == 0 || errno == ENOENT) {
+            logger.debug("Removed cgroup " + *it);
+            it = pending_removal.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+}
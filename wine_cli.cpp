@@ -3,91 +3,109 @@
 #include <iomanip>
 #include <cstring>
 #include <getopt.h>
+#include <shared_mutex>
+#include <csignal>
 
 using namespace WineWrapper;
 
 class WineApplicationCLI {
 private:
-    WineApplicationManager manager;
+    WineApplicationManager& manager;
+    std::ostream& out;
+    std::ostream& err;
     bool verbose;
     bool quiet;
+    bool follow;
+    std::string trace_path;
     
     void print_usage() {
-        std::cout << "Wine Application Manager - Command Line Interface\n";
-        std::cout << "Usage: wine-cli [OPTIONS] COMMAND [ARGS...]\n\n";
-        std::cout << "Options:\n";
-        std::cout << "  -h, --help              Show this help message\n";
-        std::cout << "  -v, --verbose           Enable verbose output\n";
-        std::cout << "  -q, --quiet             Suppress output\n";
-        std::cout << "  -c, --config DIR        Set configuration directory\n";
-        std::cout << "  -p, --prefix PATH       Set Wine prefix path\n";
-        std::cout << "  -a, --arch ARCH         Set architecture (win32/win64/auto)\n";
-        std::cout << "\nCommands:\n";
-        std::cout << "  run EXE [ARGS...]       Run an executable\n";
-        std::cout << "  exec EXE [ARGS...]      Execute and wait for completion\n";
-        std::cout << "  kill PID                Kill a process by PID\n";
-        std::cout << "  killall                 Kill all Wine processes\n";
-        std::cout << "  list-processes          List running Wine processes\n";
-        std::cout << "  prefix-create NAME      Create a new Wine prefix\n";
-        std::cout << "  prefix-delete NAME      Delete a Wine prefix\n";
-        std::cout << "  prefix-list             List all Wine prefixes\n";
-        std::cout << "  prefix-switch NAME      Switch to a Wine prefix\n";
-        std::cout << "  prefix-info NAME        Show prefix information\n";
-        std::cout << "  install COMPONENT       Install a winetricks component\n";
-        std::cout << "  list-components         List available winetricks components\n";
-        std::cout << "  shortcut-add NAME PATH  Add application shortcut\n";
-        std::cout << "  shortcut-remove NAME    Remove application shortcut\n";
-        std::cout << "  shortcut-list           List application shortcuts\n";
-        std::cout << "  shortcut-run NAME       Run application from shortcut\n";
-        std::cout << "  config-get KEY          Get configuration value\n";
-        std::cout << "  config-set KEY VALUE    Set configuration value\n";
-        std::cout << "  config-show             Show current configuration\n";
-        std::cout << "  version                 Show version information\n";
-        std::cout << "  info                    Show system information\n";
-        std::cout << "  logs [COUNT]            Show recent log entries\n";
-        std::cout << "\nExamples:\n";
-        std::cout << "  wine-cli run /path/to/program.exe\n";
-        std::cout << "  wine-cli exec /path/to/installer.exe /S\n";
-        std::cout << "  wine-cli -p ~/.wine32 run notepad.exe\n";
-        std::cout << "  wine-cli prefix-create gaming\n";
-        std::cout << "  wine-cli install d3dx9\n";
+        out << "Wine Application Manager - Command Line Interface\n";
+        out << "Usage: wine-cli [OPTIONS] COMMAND [ARGS...]\n\n";
+        out << "Options:\n";
+        out << "  -h, --help              Show this help message\n";
+        out << "  -v, --verbose           Enable verbose output\n";
+        out << "  -q, --quiet             Suppress output\n";
+        out << "  -f, --follow            Stream captured process output\n";
+        out << "  -c, --config DIR        Set configuration directory\n";
+        out << "  -p, --prefix PATH       Set Wine prefix path\n";
+        out << "  -a, --arch ARCH         Set architecture (win32/win64/auto)\n";
+        out << "  -t, --trace FILE        Record a Chrome/Perfetto trace of this run\n";
+        out << "\nCommands:\n";
+        out << "  run EXE [ARGS...]       Run an executable\n";
+        out << "  exec EXE [ARGS...]      Execute and wait for completion\n";
+        out << "  kill PID                Kill a process by PID\n";
+        out << "  killall                 Kill all Wine processes\n";
+        out << "  list-processes          List running Wine processes\n";
+        out << "  prefix-create NAME      Create a new Wine prefix\n";
+        out << "  prefix-delete NAME      Delete a Wine prefix\n";
+        out << "  prefix-list             List all Wine prefixes\n";
+        out << "  prefix-switch NAME      Switch to a Wine prefix\n";
+        out << "  prefix-info NAME        Show prefix information\n";
+        out << "  prefix-dedup NAME       Share identical DLLs through the artifact store (--hardlink to\n";
+        out << "                          allow read-only hardlinks where reflinks are unsupported)\n";
+        out << "  install COMPONENT...    Install winetricks components (--prefixes=A,B first to install\n";
+        out << "                          into several prefixes in parallel)\n";
+        out << "  list-components         List available winetricks components\n";
+        out << "  shortcut-add NAME PATH  Add application shortcut\n";
+        out << "  shortcut-remove NAME    Remove application shortcut\n";
+        out << "  shortcut-list           List application shortcuts\n";
+        out << "  shortcut-run NAME       Run application from shortcut\n";
+        out << "  config-get KEY          Get configuration value\n";
+        out << "  config-set KEY VALUE    Set configuration value\n";
+        out << "  config-show             Show current configuration\n";
+        out << "  version                 Show version information\n";
+        out << "  info                    Show system information\n";
+        out << "  logs [COUNT]            Show recent log entries\n";
+        out << "  metrics [FILE]          Dump OpenMetrics text (to FILE for a textfile collector)\n";
+        out << "  cache [ACTION]          Shader caches: list, prune, or clear [APP]\n";
+        out << "  prefetch [ACTION]       Prefetch profiles: list or clear [APP]\n";
+        out << "  fleet [ACTION]          Fleet nodes: status, or run/exec/shortcut-run on the best node\n";
+        out << "\nExamples:\n";
+        out << "  wine-cli run /path/to/program.exe\n";
+        out << "  wine-cli exec /path/to/installer.exe /S\n";
+        out << "  wine-cli -p ~/.wine32 run notepad.exe\n";
+        out << "  wine-cli prefix-create gaming\n";
+        out << "  wine-cli install d3dx9\n";
     }
     
     void print_error(const std::string& message) {
         if (!quiet) {
-            std::cerr << "Error: " << message << std::endl;
+            err << "Error: " << message << std::endl;
         }
     }
     
     void print_info(const std::string& message) {
         if (!quiet) {
-            std::cout << message << std::endl;
+            out << message << std::endl;
         }
     }
     
     void print_verbose(const std::string& message) {
         if (verbose && !quiet) {
-            std::cout << "[VERBOSE] " << message << std::endl;
+            out << "[VERBOSE] " << message << std::endl;
         }
     }
     
-    void print_process_info(const ProcessInfo& info) {
-        std::cout << "PID: " << info.pid << "\n";
-        std::cout << "  State: ";
+    void print_process_info(const ProcessSummary& info) {
+        out << "PID: " << info.pid << "\n";
+        out << "  State: ";
         switch (info.state) {
-            case ProcessState::IDLE: std::cout << "Idle"; break;
-            case ProcessState::STARTING: std::cout << "Starting"; break;
-            case ProcessState::RUNNING: std::cout << "Running"; break;
-            case ProcessState::PAUSED: std::cout << "Paused"; break;
-            case ProcessState::STOPPING: std::cout << "Stopping"; break;
-            case ProcessState::STOPPED: std::cout << "Stopped"; break;
-            case ProcessState::ERROR: std::cout << "Error"; break;
-            case ProcessState::KILLED: std::cout << "Killed"; break;
+            case ProcessState::IDLE: out << "Idle"; break;
+            case ProcessState::STARTING: out << "Starting"; break;
+            case ProcessState::RUNNING: out << "Running"; break;
+            case ProcessState::PAUSED: out << "Paused"; break;
+            case ProcessState::STOPPING: out << "Stopping"; break;
+            case ProcessState::STOPPED: out << "Stopped"; break;
+            case ProcessState::ERROR: out << "Error"; break;
+            case ProcessState::KILLED: out << "Killed"; break;
         }
-        std::cout << "\n";
-        std::cout << "  Executable: " << info.executable_path << "\n";
-        std::cout << "  Memory: " << (info.memory_usage / 1024.0 / 1024.0) << " MB\n";
-        std::cout << "  CPU: " << std::fixed << std::setprecision(2) << info.cpu_usage << "%\n";
+        out << "\n";
+        out << "  Executable: " << info.executable_path << "\n";
+        out << "  Memory: " << (info.memory_usage / 1024.0 / 1024.0) << " MB\n";
+        out << "  CPU: " << std::fixed << std::setprecision(2) << info.cpu_usage << "%\n";
+        out << "  Process Tree: " << info.tree_process_count << " processes, "
+                  << (info.tree_memory_usage / 1024.0 / 1024.0) << " MB, "
+                  << info.tree_cpu_usage << "% CPU\n";
     }
     
     int cmd_run(int argc, char** argv) {
@@ -131,8 +149,24 @@ private:
         
         print_verbose("Executing synchronously: " + exe_path);
         
+        int subscription = -1;
+        auto& capture = manager.get_monitor().get_output_capture();
+        if (follow) {
+            subscription = capture.subscribe(0, [this](pid_t, OutputStream stream, const char* data, size_t length) {
+                std::ostream& target = (stream == OutputStream::STDOUT) ? out : err;
+                target.write(data, length);
+                target.flush();
+            });
+        }
+        
         int exit_code = manager.run_executable_sync(exe_path, args);
         
+        if (subscription != -1) {
+            pid_t pid = manager.get_executor().get_current_pid();
+            capture.wait_for_eof(pid, std::chrono::milliseconds(500));
+            capture.unsubscribe(subscription);
+        }
+        
         print_info("Process exited with code: " + std::to_string(exit_code));
         
         return exit_code;
@@ -164,19 +198,20 @@ private:
     }
     
     int cmd_list_processes(int argc, char** argv) {
-        auto processes = manager.get_all_running_processes();
+        auto snapshot = manager.get_process_snapshot();
+        const auto& processes = snapshot->processes;
         
         if (processes.empty()) {
             print_info("No running processes");
             return 0;
         }
         
-        std::cout << "Running Wine Processes (" << processes.size() << "):\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Running Wine Processes (" << processes.size() << "):\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& info : processes) {
             print_process_info(info);
-            std::cout << std::string(80, '-') << "\n";
+            out << std::string(80, '-') << "\n";
         }
         
         return 0;
@@ -228,11 +263,11 @@ private:
             return 0;
         }
         
-        std::cout << "Available Wine Prefixes (" << prefixes.size() << "):\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Available Wine Prefixes (" << prefixes.size() << "):\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& name : prefixes) {
-            std::cout << "  " << name << "\n";
+            out << "  " << name << "\n";
         }
         
         return 0;
@@ -273,32 +308,89 @@ private:
             return 1;
         }
         
-        std::cout << "Wine Prefix Information: " << name << "\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Wine Prefix Information: " << name << "\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& pair : info) {
-            std::cout << "  " << std::setw(20) << std::left << pair.first << ": " << pair.second << "\n";
+            out << "  " << std::setw(20) << std::left << pair.first << ": " << pair.second << "\n";
         }
         
         return 0;
     }
     
+    int cmd_prefix_dedup(int argc, char** argv) {
+        if (argc < 1) {
+            print_error("Missing prefix name");
+            return 1;
+        }
+        
+        std::string name = argv[0];
+        bool hardlinks = argc >= 2 && std::string(argv[1]) == "--hardlink";
+        
+        auto& prefix_mgr = manager.get_prefix_manager();
+        if (!prefix_mgr.prefix_exists(name)) {
+            print_error("Prefix not found: " + name);
+            return 1;
+        }
+        
+        auto& store = manager.get_artifact_store();
+        size_t linked = store.deduplicate_prefix(prefix_mgr.get_prefix_path(name), hardlinks);
+        auto stats = store.get_stats();
+        
+        print_info("Deduplicated " + std::to_string(linked) + " files in " + name);
+        out << "Artifact store: " << stats.objects << " objects, " << (stats.object_bytes >> 20) << " MB\n";
+        return 0;
+    }
+    
     int cmd_install(int argc, char** argv) {
         if (argc < 1) {
             print_error("Missing component name");
             return 1;
         }
         
-        std::string component = argv[0];
+        std::vector<std::string> prefixes;
+        std::string option = argv[0];
+        if (option.compare(0, 11, "--prefixes=") == 0) {
+            std::istringstream list(option.substr(11));
+            std::string name;
+            while (std::getline(list, name, ',')) {
+                if (!name.empty()) prefixes.push_back(name);
+            }
+            argc--;
+            argv++;
+            if (argc < 1) {
+                print_error("Missing component name");
+                return 1;
+            }
+        }
+        
+        std::vector<std::string> components(argv, argv + argc);
+        std::string names;
+        for (const auto& component : components) {
+            names += (names.empty() ? "" : " ") + component;
+        }
         
-        print_verbose("Installing winetricks component: " + component);
+        print_verbose("Installing winetricks components: " + names);
         print_info("This may take several minutes...");
         
-        if (manager.install_winetricks_component(component)) {
-            print_info("Successfully installed: " + component);
+        if (!prefixes.empty()) {
+            int failed = 0;
+            for (const auto& result : manager.install_winetricks_components(prefixes, components)) {
+                if (result.second) {
+                    print_info("Successfully installed in " + result.first + ": " + names);
+                } else {
+                    print_error("Failed to install in " + result.first + ": " + names);
+                    failed = 1;
+                }
+            }
+            return failed;
+        }
+        
+        if (manager.install_winetricks_components(components)) {
+            print_info("Successfully installed: " + names);
             return 0;
         } else {
-            print_error("Failed to install: " + component);
+            print_error("Failed to install: " + names);
             return 1;
         }
     }
@@ -311,18 +403,18 @@ private:
             return 0;
         }
         
-        std::cout << "Available Winetricks Components (" << components.size() << "):\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Available Winetricks Components (" << components.size() << "):\n";
+        out << std::string(80, '=') << "\n";
         
         int count = 0;
         for (const auto& component : components) {
-            std::cout << std::setw(25) << std::left << component;
+            out << std::setw(25) << std::left << component;
             if (++count % 3 == 0) {
-                std::cout << "\n";
+                out << "\n";
             }
         }
         if (count % 3 != 0) {
-            std::cout << "\n";
+            out << "\n";
         }
         
         return 0;
@@ -375,12 +467,12 @@ private:
             return 0;
         }
         
-        std::cout << "Application Shortcuts (" << shortcuts.size() << "):\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Application Shortcuts (" << shortcuts.size() << "):\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& name : shortcuts) {
             std::string path = manager.get_application_path(name);
-            std::cout << "  " << std::setw(20) << std::left << name << " -> " << path << "\n";
+            out << "  " << std::setw(20) << std::left << name << " -> " << path << "\n";
         }
         
         return 0;
@@ -421,32 +513,202 @@ private:
     int cmd_config_show(int argc, char** argv) {
         auto config = manager.get_wine_configuration();
         
-        std::cout << "Wine Configuration:\n";
-        std::cout << std::string(80, '=') << "\n";
-        std::cout << config.to_string();
+        out << "Wine Configuration:\n";
+        out << std::string(80, '=') << "\n";
+        out << config.to_string();
         
         return 0;
     }
     
     int cmd_version(int argc, char** argv) {
-        std::cout << manager.get_version() << "\n";
-        std::cout << "Wine Version: " << manager.get_executor().get_wine_version();
+        out << manager.get_version() << "\n";
+        out << "Wine Version: " << manager.get_executor().get_wine_version();
         return 0;
     }
     
     int cmd_info(int argc, char** argv) {
         auto info = manager.get_system_info();
         
-        std::cout << "System Information:\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "System Information:\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& pair : info) {
-            std::cout << "  " << std::setw(25) << std::left << pair.first << ": " << pair.second << "\n";
+            out << "  " << std::setw(25) << std::left << pair.first << ": " << pair.second << "\n";
         }
         
         return 0;
     }
     
+    int cmd_metrics(int argc, char** argv) {
+        std::string text = manager.get_metrics_text();
+        if (argc < 1) {
+            out << text;
+            return 0;
+        }
+        
+        std::string path = argv[0];
+        std::string temp_path = path + ".tmp";
+        if (!Utils::write_file(temp_path, text) || rename(temp_path.c_str(), path.c_str()) != 0) {
+            print_error("Failed to write metrics to " + path);
+            unlink(temp_path.c_str());
+            return 1;
+        }
+        return 0;
+    }
+    
+    int cmd_cache(int argc, char** argv) {
+        auto& cache = manager.get_shader_cache();
+        std::string action = argc >= 1 ? argv[0] : "list";
+        
+        if (action == "prune") {
+            uint64_t freed = cache.prune(true);
+            print_info("Freed " + std::to_string(freed >> 20) + " MB of shader cache");
+            return 0;
+        }
+        
+        if (action == "clear") {
+            std::string application = argc >= 2 ? argv[1] : "";
+            size_t removed = cache.clear(application);
+            print_info("Removed " + std::to_string(removed) + " shader cache entries");
+            return 0;
+        }
+        
+        if (action != "list") {
+            print_error("Unknown cache action: " + action);
+            return 1;
+        }
+        
+        auto entries = cache.list();
+        uint64_t total = 0;
+        for (const auto& entry : entries) {
+            total += entry.bytes;
+        }
+        
+        out << "Shader Cache: " << cache.get_root() << "\n";
+        out << "Driver: " << cache.get_driver_key() << "\n";
+        out << "Entries: " << entries.size() << ", " << (total >> 20) << " MB\n";
+        out << std::string(80, '=') << "\n";
+        
+        for (const auto& entry : entries) {
+            char used[32];
+            strftime(used, sizeof(used), "%Y-%m-%d %H:%M", std::localtime(&entry.last_used));
+            out << "  " << std::setw(40) << std::left << (entry.driver + "/" + entry.application)
+                << std::setw(10) << std::right << (std::to_string(entry.bytes >> 20) + " MB") << "  " << used << "\n";
+        }
+        
+        return 0;
+    }
+    
+    int cmd_prefetch(int argc, char** argv) {
+        auto& prefetch = manager.get_prefetch();
+        std::string action = argc >= 1 ? argv[0] : "list";
+        
+        if (action == "clear") {
+            std::string application = argc >= 2 ? argv[1] : "";
+            size_t removed = prefetch.clear(application);
+            print_info("Removed " + std::to_string(removed) + " prefetch profiles");
+            return 0;
+        }
+        
+        if (action != "list") {
+            print_error("Unknown prefetch action: " + action);
+            return 1;
+        }
+        
+        auto applications = prefetch.list();
+        out << "Prefetch Profiles: " << prefetch.get_root() << "\n";
+        out << "Profiles: " << applications.size() << "\n";
+        out << std::string(80, '=') << "\n";
+        
+        for (const auto& application : applications) {
+            std::vector<PrefetchFile> files;
+            if (!PrefetchManager::read_profile(prefetch.profile_path(application), "", files)) continue;
+            
+            PrefetchReport report = PrefetchManager::measure(files, false);
+            char resident[16];
+            snprintf(resident, sizeof(resident), "%.1f%%", report.hit_ratio() * 100.0);
+            out << "  " << std::setw(40) << std::left << application << std::setw(8) << std::right
+                << report.files << " files" << std::setw(10) << (std::to_string(report.bytes >> 20) + " MB")
+                << std::setw(8) << resident << " cached\n";
+        }
+        
+        return 0;
+    }
+    
+    int cmd_fleet(int argc, char** argv) {
+        auto& fleet = manager.get_fleet();
+        std::string action = argc >= 1 ? argv[0] : "status";
+        std::string prefix = manager.get_wine_configuration().wine_prefix;
+        
+        if (!fleet.is_enabled()) {
+            print_error("No fleet nodes configured (set fleet_nodes)");
+            return 1;
+        }
+        
+        if (action == "status") {
+            size_t reachable = fleet.refresh(true);
+            auto nodes = fleet.get_nodes();
+            out << "Fleet Nodes: " << reachable << "/" << nodes.size() << " reachable\n";
+            out << std::string(80, '=') << "\n";
+            
+            for (const auto& node : nodes) {
+                char load[16];
+                snprintf(load, sizeof(load), "%.2f", node.load);
+                out << "  " << std::setw(16) << std::left << node.name << std::setw(6)
+                    << (node.reachable ? "up" : "down");
+                if (node.reachable) {
+                    auto driver = node.status.find("gpu_driver");
+                    out << " load " << std::setw(6) << load << " cpus " << std::setw(4) << node.cpu_count
+                        << " free " << std::setw(8) << (std::to_string(node.memory_available >> 10) + " MB")
+                        << " queue " << std::setw(4) << (node.queue_depth + node.inflight)
+                        << " prefix " << (node.warm_prefixes.count(prefix) ? "warm" :
+                                          node.prefixes.count(prefix) ? "cached" : "missing")
+                        << (driver != node.status.end() ? "  " + driver->second : "");
+                }
+                out << "\n";
+            }
+            
+            FleetPlacement placement;
+            if (fleet.place(prefix, placement)) {
+                char latency[16];
+                snprintf(latency, sizeof(latency), "%.1f", placement.latency_ms);
+                out << "\nNext launch for " << prefix << " goes to " << placement.node << " (placed in "
+                    << latency << " ms)\n";
+            }
+            return 0;
+        }
+        
+        if (action != "run" && action != "exec" && action != "shortcut-run") {
+            print_error("Unknown fleet action: " + action);
+            return 1;
+        }
+        if (argc < 2) {
+            print_error(action == "shortcut-run" ? "Missing shortcut name" : "Missing executable path");
+            return 1;
+        }
+        
+        std::vector<std::string> command(argv, argv + argc);
+        if (action == "shortcut-run") {
+            std::string path = manager.get_application_path(argv[1]);
+            if (!path.empty()) {
+                command[0] = "run";
+                command[1] = path;
+            }
+        }
+        
+        std::string node_out;
+        std::string node_err;
+        FleetPlacement placement;
+        int status = fleet.dispatch(command, prefix, node_out, node_err, placement);
+        if (!placement.node.empty()) {
+            print_verbose("Placed on fleet node " + placement.node + (placement.warm ? " (warm)" : "") +
+                          (placement.synced ? " after syncing the prefix" : ""));
+        }
+        out << node_out;
+        err << node_err;
+        return status == -1 ? 1 : status;
+    }
+    
     int cmd_logs(int argc, char** argv) {
         size_t count = 50;
         
@@ -456,38 +718,34 @@ private:
         
         auto logs = manager.get_recent_logs(count);
         
-        std::cout << "Recent Log Entries (" << logs.size() << "):\n";
-        std::cout << std::string(80, '=') << "\n";
+        out << "Recent Log Entries (" << logs.size() << "):\n";
+        out << std::string(80, '=') << "\n";
         
         for (const auto& log : logs) {
-            std::cout << log << "\n";
+            out << log << "\n";
         }
         
         return 0;
     }
     
-public:
-    WineApplicationCLI() : verbose(false), quiet(false) {}
-    
-    int run(int argc, char** argv) {
-        std::string config_dir;
-        std::string prefix_path;
-        std::string architecture;
-        
+    int parse_options(int argc, char** argv, std::string& config_dir, std::string& prefix_path,
+                      std::string& architecture) {
         static struct option long_options[] = {
             {"help",    no_argument,       0, 'h'},
             {"verbose", no_argument,       0, 'v'},
             {"quiet",   no_argument,       0, 'q'},
+            {"follow",  no_argument,       0, 'f'},
             {"config",  required_argument, 0, 'c'},
             {"prefix",  required_argument, 0, 'p'},
             {"arch",    required_argument, 0, 'a'},
+            {"trace",   required_argument, 0, 't'},
             {0, 0, 0, 0}
         };
         
         int option_index = 0;
         int c;
         
-        while ((c = getopt_long(argc, argv, "hvqc:p:a:", long_options, &option_index)) != -1) {
+        while ((c = getopt_long(argc, argv, "hvqfc:p:a:t:", long_options, &option_index)) != -1) {
             switch (c) {
                 case 'h':
                     print_usage();
@@ -498,6 +756,9 @@ public:
                 case 'q':
                     quiet = true;
                     break;
+                case 'f':
+                    follow = true;
+                    break;
                 case 'c':
                     config_dir = optarg;
                     break;
@@ -507,6 +768,9 @@ public:
                 case 'a':
                     architecture = optarg;
                     break;
+                case 't':
+                    trace_path = optarg;
+                    break;
                 case '?':
                     return 1;
                 default:
@@ -514,44 +778,39 @@ public:
             }
         }
         
-        if (!manager.initialize(config_dir)) {
-            print_error("Failed to initialize Wine Application Manager");
-            return 1;
-        }
+        return -1;
+    }
+    
+    void apply_overrides(const std::string& prefix_path, const std::string& architecture) {
+        auto config = manager.get_wine_configuration();
         
-        if (verbose) {
-            manager.set_log_level(LogLevel::DEBUG);
+        if (!prefix_path.empty()) {
+            config.wine_prefix = prefix_path;
         }
         
-        if (!prefix_path.empty() || !architecture.empty()) {
-            auto config = manager.get_wine_configuration();
-            
-            if (!prefix_path.empty()) {
-                config.wine_prefix = prefix_path;
-            }
-            
-            if (!architecture.empty()) {
-                if (architecture == "win32") {
-                    config.architecture = WineArchitecture::WIN32;
-                } else if (architecture == "win64") {
-                    config.architecture = WineArchitecture::WIN64;
-                } else {
-                    config.architecture = WineArchitecture::AUTO_DETECT;
-                }
+        if (!architecture.empty()) {
+            if (architecture == "win32") {
+                config.architecture = WineArchitecture::WIN32;
+            } else if (architecture == "win64") {
+                config.architecture = WineArchitecture::WIN64;
+            } else {
+                config.architecture = WineArchitecture::AUTO_DETECT;
             }
-            
-            manager.set_wine_configuration(config);
         }
         
-        if (optind >= argc) {
+        manager.set_wine_configuration(config);
+    }
+    
+    int dispatch(int argc, char** argv, int first) {
+        if (first >= argc) {
             print_error("No command specified");
             print_usage();
             return 1;
         }
         
-        std::string command = argv[optind];
-        int cmd_argc = argc - optind - 1;
-        char** cmd_argv = argv + optind + 1;
+        std::string command = argv[first];
+        int cmd_argc = argc - first - 1;
+        char** cmd_argv = argv + first + 1;
         
         int result = 0;
         
@@ -575,6 +834,8 @@ public:
             result = cmd_prefix_switch(cmd_argc, cmd_argv);
         } else if (command == "prefix-info") {
             result = cmd_prefix_info(cmd_argc, cmd_argv);
+        } else if (command == "prefix-dedup") {
+            result = cmd_prefix_dedup(cmd_argc, cmd_argv);
         } else if (command == "install") {
             result = cmd_install(cmd_argc, cmd_argv);
         } else if (command == "list-components") {
@@ -595,19 +856,246 @@ public:
             result = cmd_info(cmd_argc, cmd_argv);
         } else if (command == "logs") {
             result = cmd_logs(cmd_argc, cmd_argv);
+        } else if (command == "metrics") {
+            result = cmd_metrics(cmd_argc, cmd_argv);
+        } else if (command == "cache") {
+            result = cmd_cache(cmd_argc, cmd_argv);
+        } else if (command == "prefetch") {
+            result = cmd_prefetch(cmd_argc, cmd_argv);
+        } else if (command == "fleet") {
+            result = cmd_fleet(cmd_argc, cmd_argv);
         } else {
             print_error("Unknown command: " + command);
             print_usage();
             result = 1;
         }
         
+        return result;
+    }
+    
+public:
+    WineApplicationCLI(WineApplicationManager& mgr, std::ostream& output, std::ostream& error)
+        : manager(mgr), out(output), err(error), verbose(false), quiet(false), follow(false) {}
+    
+    int run(int argc, char** argv) {
+        std::string config_dir;
+        std::string prefix_path;
+        std::string architecture;
+        
+        int status = parse_options(argc, argv, config_dir, prefix_path, architecture);
+        if (status != -1) {
+            return status;
+        }
+        
+        if (!trace_path.empty() && !TraceRecorder::start(trace_path)) {
+            print_error("Failed to start trace: " + trace_path);
+            return 1;
+        }
+        
+        if (!manager.initialize(config_dir)) {
+            print_error("Failed to initialize Wine Application Manager");
+            TraceRecorder::stop();
+            return 1;
+        }
+        
+        if (verbose) {
+            manager.set_log_level(LogLevel::DEBUG);
+        }
+        
+        if (!prefix_path.empty() || !architecture.empty()) {
+            apply_overrides(prefix_path, architecture);
+        }
+        
+        int result = dispatch(argc, argv, optind);
+        
         manager.shutdown();
         
+        if (!trace_path.empty() && !TraceRecorder::stop()) {
+            print_error("Failed to write trace: " + trace_path);
+            result = result == 0 ? 1 : result;
+        }
+        
+        return result;
+    }
+    
+    int serve(const std::vector<std::string>& args, const DaemonMessage* environment) {
+        static std::mutex getopt_mutex;
+        static std::shared_mutex request_mutex;
+        
+        std::vector<std::string> storage = args;
+        storage.insert(storage.begin(), "wine-cli");
+        std::vector<char*> argv;
+        for (auto& arg : storage) {
+            argv.push_back(&arg[0]);
+        }
+        argv.push_back(nullptr);
+        int argc = static_cast<int>(storage.size());
+        
+        std::string config_dir;
+        std::string prefix_path;
+        std::string architecture;
+        int first = 0;
+        
+        {
+            std::lock_guard<std::mutex> lock(getopt_mutex);
+            optind = 0;
+            opterr = 0;
+            int status = parse_options(argc, argv.data(), config_dir, prefix_path, architecture);
+            if (status != -1) {
+                return status;
+            }
+            first = optind;
+        }
+        
+        follow = false;
+        
+        // Every request runs against the one shared configuration and launch environment, so requests that
+        // swap either (-p/-a overrides, prefix-switch, a client environment that differs from the daemon's)
+        // wait for the others to finish and run alone.
+        bool exclusive = !prefix_path.empty() || !architecture.empty() || environment ||
+                         (first < argc && strcmp(argv[first], "prefix-switch") == 0);
+        if (!exclusive) {
+            std::shared_lock<std::shared_mutex> lock(request_mutex);
+            return dispatch(argc, argv.data(), first);
+        }
+        
+        std::unique_lock<std::shared_mutex> lock(request_mutex);
+        WineExecutor& executor = manager.get_executor();
+        if (environment) {
+            executor.set_base_environment(std::make_shared<const std::map<std::string, std::string>>(*environment));
+        }
+        
+        WineConfiguration saved = manager.get_wine_configuration();
+        bool overridden = !prefix_path.empty() || !architecture.empty();
+        if (overridden) {
+            apply_overrides(prefix_path, architecture);
+        }
+        int result = dispatch(argc, argv.data(), first);
+        if (overridden) {
+            manager.set_wine_configuration(saved);
+        }
+        
+        if (environment) {
+            executor.set_base_environment(nullptr);
+        }
         return result;
     }
 };
 
+#ifdef WINE_APPD
+
+static ManagerDaemon* active_daemon = nullptr;
+
+static void handle_stop_signal(int) {
+    if (active_daemon) {
+        active_daemon->stop();
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string config_dir;
+    std::string socket_path;
+    bool verbose = false;
+    
+    int c;
+    while ((c = getopt(argc, argv, "hvc:s:")) != -1) {
+        switch (c) {
+            case 'h':
+                std::cout << "Usage: wine-appd [-v] [-c DIR] [-s SOCKET]\n";
+                return 0;
+            case 'v':
+                verbose = true;
+                break;
+            case 'c':
+                config_dir = optarg;
+                break;
+            case 's':
+                socket_path = optarg;
+                break;
+            default:
+                return 1;
+        }
+    }
+    
+    WineApplicationManager manager;
+    if (!manager.initialize(config_dir)) {
+        std::cerr << "Error: Failed to initialize Wine Application Manager" << std::endl;
+        return 1;
+    }
+    if (verbose) {
+        manager.set_log_level(LogLevel::DEBUG);
+    }
+    // Only a long-lived process can watch an application for the whole recording window.
+    manager.get_prefetch().set_recording_enabled(true);
+    
+    ManagerDaemon daemon(manager, [&manager](const std::vector<std::string>& args, const DaemonMessage* environment,
+                                             std::ostream& out, std::ostream& err) {
+        WineApplicationCLI cli(manager, out, err);
+        return cli.serve(args, environment);
+    });
+    
+    if (!daemon.start(socket_path)) {
+        std::cerr << "Error: Failed to listen on daemon socket" << std::endl;
+        manager.shutdown();
+        return 1;
+    }
+    
+    active_daemon = &daemon;
+    signal(SIGINT, handle_stop_signal);
+    signal(SIGTERM, handle_stop_signal);
+    signal(SIGPIPE, SIG_IGN);
+    
+    daemon.run();
+    
+    active_daemon = nullptr;
+    manager.shutdown();
+    return 0;
+}
+
+#else
+
+static bool wants_local_run(int argc, char** argv) {
+    if (getenv("WINE_APPD_DISABLE")) {
+        return true;
+    }
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-f" || arg == "--follow" || arg == "-c" || arg == "--config" ||
+            arg == "-t" || arg == "--trace") {
+            return true;
+        }
+        if (arg.empty() || arg[0] != '-') {
+            break;
+        }
+    }
+    return false;
+}
+
 int main(int argc, char** argv) {
-    WineApplicationCLI cli;
+    if (!wants_local_run(argc, argv)) {
+        DaemonClient client;
+        if (client.connect()) {
+            std::vector<std::string> args(argv + 1, argv + argc);
+            std::string out;
+            std::string err;
+            DaemonMessage environment = DaemonClient::forwarded_environment();
+            int status = client.execute(args, out, err, &environment);
+            std::cout << out;
+            std::cerr << err;
+            if (status == -1 && out.empty() && err.empty()) {
+                // The daemon may already have acted on the request, so running it again locally could
+                // launch the program twice.
+                std::cerr << "Error: Lost connection to wine-appd" << std::endl;
+                return 1;
+            }
+            return status;
+        }
+    }
+    
+    WineApplicationManager manager;
+    WineApplicationCLI cli(manager, std::cout, std::cerr);
     return cli.run(argc, argv);
 }
+
+#endif
@@ -0,0 +1,518 @@
+#include "wine_wrapper.hpp"
+#include <charconv>
+#include <sys/mman.h>
+
+namespace WineWrapper {
+
+namespace {
+
+#define CONFIG_FIELD(key, type, member, groups, persistent, fallback) \
+    {key, ConfigFieldType::type, groups, persistent, fallback, \
+     [](WineConfiguration& config) -> void* { return &config.member; }}
+
+const uint32_t ENV = ConfigSchema::GROUP_ENVIRONMENT;
+const uint32_t REG = ConfigSchema::GROUP_REGISTRY;
+const uint32_t MGR = ConfigSchema::GROUP_MANAGER;
+const uint32_t RUN = ConfigSchema::GROUP_LAUNCH;
+
+constexpr ConfigField CONFIG_FIELDS[] = {
+    CONFIG_FIELD("wine_prefix", STRING, wine_prefix, ENV | REG, true, nullptr),
+    CONFIG_FIELD("wine_binary", STRING, wine_binary, ENV, true, nullptr),
+    CONFIG_FIELD("architecture", ARCHITECTURE, architecture, ENV, true, "auto"),
+    CONFIG_FIELD("environment_variables", STRING_MAP, environment_variables, ENV, false, nullptr),
+    CONFIG_FIELD("registry_overrides", STRING_MAP, registry_overrides, REG, false, nullptr),
+    CONFIG_FIELD("dll_overrides", STRING_LIST, dll_overrides, ENV, false, nullptr),
+    CONFIG_FIELD("enable_virtual_desktop", BOOL, enable_virtual_desktop, ENV, true, "false"),
+    CONFIG_FIELD("virtual_desktop_resolution", STRING, virtual_desktop_resolution, ENV, true, "1024x768"),
+    CONFIG_FIELD("enable_csmt", BOOL, enable_csmt, ENV, true, "true"),
+    CONFIG_FIELD("enable_dxvk", BOOL, enable_dxvk, ENV, true, "false"),
+    CONFIG_FIELD("enable_esync", BOOL, enable_esync, ENV, true, "true"),
+    CONFIG_FIELD("enable_fsync", BOOL, enable_fsync, ENV, true, "false"),
+    CONFIG_FIELD("audio_driver", STRING, audio_driver, ENV, true, "alsa"),
+    CONFIG_FIELD("graphics_driver", STRING, graphics_driver, ENV, true, "x11"),
+    CONFIG_FIELD("nice_level", INT, nice_level, RUN, true, "0"),
+    CONFIG_FIELD("hook_timeout_seconds", INT, hook_timeout_seconds, RUN, true, "60"),
+    CONFIG_FIELD("enable_cgroup", BOOL, enable_cgroup, RUN, true, "false"),
+    CONFIG_FIELD("cgroup_root", STRING, cgroup_root, RUN, true, ""),
+    CONFIG_FIELD("cgroup_cpu_weight", INT, cgroup_cpu_weight, RUN, true, "100"),
+    CONFIG_FIELD("cgroup_cpu_max_percent", INT, cgroup_cpu_max_percent, RUN, true, "0"),
+    CONFIG_FIELD("cgroup_memory_high_mb", SIZE, cgroup_memory_high_mb, RUN, true, "0"),
+    CONFIG_FIELD("cgroup_memory_max_mb", SIZE, cgroup_memory_max_mb, RUN, true, "0"),
+    CONFIG_FIELD("cgroup_io_weight", INT, cgroup_io_weight, RUN, true, "100"),
+    CONFIG_FIELD("launch_profile", PROFILE, launch_profile, ENV, true, "default"),
+    CONFIG_FIELD("cpu_affinity", STRING, launch_profile.cpu_affinity, ENV, true, nullptr),
+    CONFIG_FIELD("numa_policy", STRING, launch_profile.numa_policy, ENV, true, nullptr),
+    CONFIG_FIELD("scheduler_policy", STRING, launch_profile.scheduler_policy, ENV, true, nullptr),
+    CONFIG_FIELD("scheduler_priority", INT, launch_profile.scheduler_priority, ENV, true, nullptr),
+    CONFIG_FIELD("io_priority", STRING, launch_profile.io_priority, ENV, true, nullptr),
+    CONFIG_FIELD("disable_thp", BOOL, launch_profile.disable_thp, ENV, true, nullptr),
+    CONFIG_FIELD("memlock_mb", SIZE, launch_profile.memlock_mb, ENV, true, nullptr),
+    CONFIG_FIELD("manager_cpu_affinity", STRING, manager_cpu_affinity, MGR, true, ""),
+    CONFIG_FIELD("trace_file", STRING, trace_file, MGR, true, ""),
+    CONFIG_FIELD("enable_shader_cache", BOOL, enable_shader_cache, MGR, true, "true"),
+    CONFIG_FIELD("shader_cache_dir", STRING, shader_cache_dir, MGR, true, ""),
+    CONFIG_FIELD("shader_cache_max_mb", SIZE, shader_cache_max_mb, MGR, true, "4096"),
+    CONFIG_FIELD("enable_prefetch", BOOL, enable_prefetch, MGR, true, "false"),
+    CONFIG_FIELD("prefetch_dir", STRING, prefetch_dir, MGR, true, ""),
+    CONFIG_FIELD("prefetch_record_seconds", INT, prefetch_record_seconds, MGR, true, "30"),
+    CONFIG_FIELD("enable_server_pool", BOOL, enable_server_pool, MGR, true, "false"),
+    CONFIG_FIELD("server_pool_idle_seconds", INT, server_pool_idle_seconds, MGR, true, "300"),
+    CONFIG_FIELD("fleet_nodes", STRING, fleet_nodes, MGR, true, ""),
+    CONFIG_FIELD("winetricks_components", STRING_LIST, winetricks_components, 0, false, nullptr),
+    CONFIG_FIELD("debug_output", BOOL, debug_output, RUN, true, "false"),
+    CONFIG_FIELD("log_file", STRING, log_file, RUN, true, ""),
+    CONFIG_FIELD("max_log_size_mb", INT, max_log_size_mb, RUN, true, "100"),
+    CONFIG_FIELD("capture_stdout", BOOL, capture_stdout, RUN, true, "true"),
+    CONFIG_FIELD("capture_stderr", BOOL, capture_stderr, RUN, true, "true"),
+};
+
+#undef CONFIG_FIELD
+
+constexpr size_t FIELD_COUNT = sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]);
+
+constexpr uint64_t fnv1a(uint64_t hash, const char* data, size_t length) {
+    for (size_t i = 0; i < length; ++i) {
+        hash = (hash ^ static_cast<unsigned char>(data[i])) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+constexpr size_t key_length(const char* key) {
+    size_t length = 0;
+    while (key[length]) ++length;
+    return length;
+}
+
+constexpr uint64_t compute_schema_hash() {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const auto& field : CONFIG_FIELDS) {
+        if (!field.persistent) continue;
+        hash = fnv1a(hash, field.key, key_length(field.key) + 1);
+        char type = static_cast<char>(field.type);
+        hash = fnv1a(hash, &type, 1);
+    }
+    return hash;
+}
+
+constexpr bool keys_unique() {
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        for (size_t j = i + 1; j < FIELD_COUNT; ++j) {
+            if (std::string_view(CONFIG_FIELDS[i].key) == std::string_view(CONFIG_FIELDS[j].key)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static_assert(FIELD_COUNT <= 64, "ConfigDiff tracks fields in a 64-bit mask");
+static_assert(keys_unique(), "configuration keys must be unique");
+
+constexpr uint64_t SCHEMA_HASH = compute_schema_hash();
+
+const char SNAPSHOT_MAGIC[8] = {'W', 'I', 'N', 'E', 'C', 'F', 'G', '\0'};
+const uint32_t ABSENT = 0xffffffffU;
+const size_t SMALL_SNAPSHOT_BYTES = 4096;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t field_count;
+    uint64_t schema_hash;
+    uint64_t source_inode;
+    uint64_t source_size;
+    int64_t source_mtime_sec;
+    int64_t source_mtime_nsec;
+    int64_t source_ctime_sec;
+    int64_t source_ctime_nsec;
+    uint64_t payload_size;
+    uint64_t checksum;
+};
+
+std::string_view trim(std::string_view value) {
+    size_t start = value.find_first_not_of(" \t\r\n");
+    if (start == std::string_view::npos) {
+        return std::string_view();
+    }
+    size_t end = value.find_last_not_of(" \t\r\n");
+    return value.substr(start, end - start + 1);
+}
+
+template <typename T>
+bool parse_number(std::string_view value, T& result) {
+    T parsed = 0;
+    auto outcome = std::from_chars(value.data(), value.data() + value.size(), parsed);
+    if (outcome.ec != std::errc() || outcome.ptr != value.data() + value.size()) {
+        return false;
+    }
+    result = parsed;
+    return true;
+}
+
+bool assign_text(const ConfigField& field, WineConfiguration& config, std::string_view value) {
+    void* target = field.address(config);
+    
+    switch (field.type) {
+        case ConfigFieldType::STRING:
+            static_cast<std::string*>(target)->assign(value.data(), value.size());
+            return true;
+        case ConfigFieldType::BOOL:
+            *static_cast<bool*>(target) = value == "true";
+            return true;
+        case ConfigFieldType::INT:
+            return parse_number(value, *static_cast<int*>(target));
+        case ConfigFieldType::SIZE:
+            return parse_number(value, *static_cast<size_t*>(target));
+        case ConfigFieldType::ARCHITECTURE:
+            *static_cast<WineArchitecture*>(target) = value == "win32" ? WineArchitecture::WIN32 :
+                                                      value == "win64" ? WineArchitecture::WIN64 :
+                                                      WineArchitecture::AUTO_DETECT;
+            return true;
+        case ConfigFieldType::PROFILE:
+            *static_cast<LaunchProfile*>(target) = LaunchProfile::preset(std::string(value));
+            return true;
+        default:
+            return false;
+    }
+}
+
+void append_text(const ConfigField& field, const WineConfiguration& config, std::string& out) {
+    const void* source = field.address(const_cast<WineConfiguration&>(config));
+    char buffer[24];
+    
+    switch (field.type) {
+        case ConfigFieldType::STRING:
+            out += *static_cast<const std::string*>(source);
+            break;
+        case ConfigFieldType::BOOL:
+            out += *static_cast<const bool*>(source) ? "true" : "false";
+            break;
+        case ConfigFieldType::INT:
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), *static_cast<const int*>(source)).ptr);
+            break;
+        case ConfigFieldType::SIZE:
+            out.append(buffer, std::to_chars(buffer, buffer + sizeof(buffer), *static_cast<const size_t*>(source)).ptr);
+            break;
+        case ConfigFieldType::ARCHITECTURE: {
+            WineArchitecture arch = *static_cast<const WineArchitecture*>(source);
+            out += arch == WineArchitecture::WIN32 ? "win32" : arch == WineArchitecture::WIN64 ? "win64" : "auto";
+            break;
+        }
+        case ConfigFieldType::PROFILE:
+            out += static_cast<const LaunchProfile*>(source)->name;
+            break;
+        default:
+            break;
+    }
+}
+
+bool scalar_field(ConfigFieldType type) {
+    return type == ConfigFieldType::BOOL || type == ConfigFieldType::INT || type == ConfigFieldType::SIZE ||
+           type == ConfigFieldType::ARCHITECTURE;
+}
+
+int64_t scalar_value(const ConfigField& field, const WineConfiguration& config) {
+    const void* source = field.address(const_cast<WineConfiguration&>(config));
+    switch (field.type) {
+        case ConfigFieldType::BOOL: return *static_cast<const bool*>(source) ? 1 : 0;
+        case ConfigFieldType::INT: return *static_cast<const int*>(source);
+        case ConfigFieldType::SIZE: return static_cast<int64_t>(*static_cast<const size_t*>(source));
+        case ConfigFieldType::ARCHITECTURE: return static_cast<int64_t>(*static_cast<const WineArchitecture*>(source));
+        default: return 0;
+    }
+}
+
+void assign_scalar(const ConfigField& field, WineConfiguration& config, int64_t value) {
+    void* target = field.address(config);
+    switch (field.type) {
+        case ConfigFieldType::BOOL: *static_cast<bool*>(target) = value != 0; break;
+        case ConfigFieldType::INT: *static_cast<int*>(target) = static_cast<int>(value); break;
+        case ConfigFieldType::SIZE: *static_cast<size_t*>(target) = static_cast<size_t>(value); break;
+        case ConfigFieldType::ARCHITECTURE: *static_cast<WineArchitecture*>(target) = static_cast<WineArchitecture>(value); break;
+        default: break;
+    }
+}
+
+bool fields_equal(const ConfigField& field, const WineConfiguration& a, const WineConfiguration& b) {
+    const void* left = field.address(const_cast<WineConfiguration&>(a));
+    const void* right = field.address(const_cast<WineConfiguration&>(b));
+    
+    switch (field.type) {
+        case ConfigFieldType::STRING:
+            return *static_cast<const std::string*>(left) == *static_cast<const std::string*>(right);
+        case ConfigFieldType::PROFILE:
+            return static_cast<const LaunchProfile*>(left)->name == static_cast<const LaunchProfile*>(right)->name;
+        case ConfigFieldType::STRING_LIST:
+            return *static_cast<const std::vector<std::string>*>(left) ==
+                   *static_cast<const std::vector<std::string>*>(right);
+        case ConfigFieldType::STRING_MAP:
+            return *static_cast<const std::map<std::string, std::string>*>(left) ==
+                   *static_cast<const std::map<std::string, std::string>*>(right);
+        default:
+            return scalar_value(field, a) == scalar_value(field, b);
+    }
+}
+
+void fill_source(SnapshotHeader& header, const struct stat& st) {
+    header.source_inode = st.st_ino;
+    header.source_size = st.st_size;
+    header.source_mtime_sec = st.st_mtim.tv_sec;
+    header.source_mtime_nsec = st.st_mtim.tv_nsec;
+    header.source_ctime_sec = st.st_ctim.tv_sec;
+    header.source_ctime_nsec = st.st_ctim.tv_nsec;
+}
+
+bool decode_snapshot(WineConfiguration& config, const char* data, size_t size, const struct stat& source) {
+    if (size < sizeof(SnapshotHeader)) {
+        return false;
+    }
+    
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof(header));
+    SnapshotHeader expected;
+    memset(&expected, 0, sizeof(expected));
+    fill_source(expected, source);
+    
+    if (memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 ||
+        header.version != ConfigSchema::SNAPSHOT_VERSION || header.schema_hash != SCHEMA_HASH ||
+        header.source_inode != expected.source_inode || header.source_size != expected.source_size ||
+        header.source_mtime_sec != expected.source_mtime_sec ||
+        header.source_mtime_nsec != expected.source_mtime_nsec ||
+        header.source_ctime_sec != expected.source_ctime_sec ||
+        header.source_ctime_nsec != expected.source_ctime_nsec ||
+        header.payload_size != size - sizeof(header)) {
+        return false;
+    }
+    
+    const char* cursor = data + sizeof(header);
+    const char* end = data + size;
+    if (fnv1a(14695981039346656037ULL, cursor, header.payload_size) != header.checksum) {
+        return false;
+    }
+    
+    std::string_view records[FIELD_COUNT];
+    uint64_t present = 0;
+    uint32_t decoded = 0;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        if (!field.persistent) continue;
+        
+        uint32_t length;
+        if (end - cursor < static_cast<ptrdiff_t>(sizeof(length))) return false;
+        memcpy(&length, cursor, sizeof(length));
+        cursor += sizeof(length);
+        ++decoded;
+        
+        if (length == ABSENT) continue;
+        if (static_cast<size_t>(end - cursor) < length) return false;
+        if (scalar_field(field.type) && length != sizeof(int64_t)) return false;
+        
+        records[i] = std::string_view(cursor, length);
+        present |= 1ULL << i;
+        cursor += length;
+    }
+    
+    if (cursor != end || decoded != header.field_count) {
+        return false;
+    }
+    
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        if (!(present & (1ULL << i))) continue;
+        const ConfigField& field = CONFIG_FIELDS[i];
+        if (scalar_field(field.type)) {
+            int64_t value;
+            memcpy(&value, records[i].data(), sizeof(value));
+            assign_scalar(field, config, value);
+        } else {
+            assign_text(field, config, records[i]);
+        }
+    }
+    return true;
+}
+
+}
+
+std::string ConfigDiff::to_string() const {
+    std::string keys;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        if (fields & (1ULL << i)) {
+            keys += (keys.empty() ? "" : ", ") + std::string(CONFIG_FIELDS[i].key);
+        }
+    }
+    return keys;
+}
+
+const ConfigField* ConfigSchema::fields() {
+    return CONFIG_FIELDS;
+}
+
+size_t ConfigSchema::field_count() {
+    return FIELD_COUNT;
+}
+
+const ConfigField* ConfigSchema::find(std::string_view key) {
+    for (const auto& field : CONFIG_FIELDS) {
+        if (key == field.key) {
+            return &field;
+        }
+    }
+    return nullptr;
+}
+
+uint64_t ConfigSchema::schema_hash() {
+    return SCHEMA_HASH;
+}
+
+uint64_t ConfigSchema::parse_ini(WineConfiguration& config, std::string_view text) {
+    std::string_view values[FIELD_COUNT];
+    uint64_t present = 0;
+    
+    while (!text.empty()) {
+        size_t newline = text.find('\n');
+        std::string_view line = trim(text.substr(0, newline));
+        text = newline == std::string_view::npos ? std::string_view() : text.substr(newline + 1);
+        
+        if (line.empty() || line[0] == '#' || line[0] == ';') continue;
+        size_t eq = line.find('=');
+        if (eq == std::string_view::npos) continue;
+        
+        const ConfigField* field = find(trim(line.substr(0, eq)));
+        if (!field || !field->persistent) continue;
+        
+        size_t index = field - CONFIG_FIELDS;
+        values[index] = trim(line.substr(eq + 1));
+        present |= 1ULL << index;
+    }
+    
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        if (!field.persistent) continue;
+        if ((present & (1ULL << i)) && assign_text(field, config, values[i])) continue;
+        if (field.default_value) {
+            assign_text(field, config, field.default_value);
+        }
+    }
+    
+    return present;
+}
+
+std::string ConfigSchema::to_ini(const WineConfiguration& config) {
+    std::string out;
+    out.reserve(1024);
+    
+    for (const auto& field : CONFIG_FIELDS) {
+        if (!field.persistent) continue;
+        out += field.key;
+        out += '=';
+        append_text(field, config, out);
+        out += '\n';
+    }
+    
+    return out;
+}
+
+ConfigDiff ConfigSchema::diff(const WineConfiguration& from, const WineConfiguration& to) {
+    ConfigDiff result;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        if (!fields_equal(CONFIG_FIELDS[i], from, to)) {
+            result.fields |= 1ULL << i;
+            result.groups |= CONFIG_FIELDS[i].groups;
+        }
+    }
+    return result;
+}
+
+std::string ConfigSchema::snapshot_path(const std::string& config_file) {
+    return config_file + ".snapshot";
+}
+
+bool ConfigSchema::load_snapshot(WineConfiguration& config, const std::string& config_file) {
+    struct stat source;
+    if (stat(config_file.c_str(), &source) != 0) {
+        return false;
+    }
+    
+    int fd = open(snapshot_path(config_file).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    char buffer[SMALL_SNAPSHOT_BYTES];
+    ssize_t length = pread(fd, buffer, sizeof(buffer), 0);
+    if (length >= 0 && static_cast<size_t>(length) < sizeof(buffer)) {
+        close(fd);
+        return decode_snapshot(config, buffer, length, source);
+    }
+    
+    struct stat st;
+    if (length < 0 || fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    
+    bool loaded = decode_snapshot(config, static_cast<const char*>(data), st.st_size, source);
+    munmap(data, st.st_size);
+    return loaded;
+}
+
+bool ConfigSchema::save_snapshot(const WineConfiguration& config, const std::string& config_file, uint64_t present,
+                                 const struct stat& source) {
+    std::string payload;
+    payload.reserve(1024);
+    uint32_t field_total = 0;
+    for (size_t i = 0; i < FIELD_COUNT; ++i) {
+        const ConfigField& field = CONFIG_FIELDS[i];
+        if (!field.persistent) continue;
+        ++field_total;
+        
+        uint32_t length = ABSENT;
+        if (!(present & (1ULL << i)) && !field.default_value) {
+            payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            continue;
+        }
+        
+        if (scalar_field(field.type)) {
+            int64_t value = scalar_value(field, config);
+            length = sizeof(value);
+            payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            payload.append(reinterpret_cast<const char*>(&value), sizeof(value));
+        } else {
+            std::string text;
+            append_text(field, config, text);
+            length = static_cast<uint32_t>(text.size());
+            payload.append(reinterpret_cast<const char*>(&length), sizeof(length));
+            payload += text;
+        }
+    }
+    
+    SnapshotHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.field_count = field_total;
+    header.schema_hash = SCHEMA_HASH;
+    fill_source(header, source);
+    header.payload_size = payload.size();
+    header.checksum = fnv1a(14695981039346656037ULL, payload.data(), payload.size());
+    
+    std::string path = snapshot_path(config_file);
+    std::string temp_path = path + ".tmp";
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents += payload;
+    if (!Utils::write_file(temp_path, contents)) {
+        return false;
+    }
+    if (rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,874 @@
+#include "wine_wrapper.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/eventfd.h>
+#include <sched.h>
+#include <poll.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+namespace {
+
+const size_t MAX_REQUEST_SIZE = 1 << 20;
+
+// Session and Wine variables a client forwards so daemon launches see the same display, locale and debug
+// settings a local run would.
+const char* const FORWARDED_VARIABLES[] = {
+    "DISPLAY", "WAYLAND_DISPLAY", "XAUTHORITY", "XDG_SESSION_TYPE", "DBUS_SESSION_BUS_ADDRESS",
+    "PULSE_SERVER", "LANG", "LANGUAGE", "TZ"
+};
+const char* const FORWARDED_PREFIXES[] = {"LC_", "WINE", "DXVK_", "VKD3D_"};
+
+// Protocol fields carried as JSON numbers; every other field is a string, whatever its content.
+const char* const NUMERIC_FIELDS[] = {
+    "id", "ok", "status", "pid", "exit_code", "memory", "tree_processes", "tree_memory", "sequence",
+    "running_processes", "queue_depth"
+};
+
+bool numeric_field(const std::string& key) {
+    for (const char* field : NUMERIC_FIELDS) {
+        if (key == field) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool is_integer(const std::string& value) {
+    size_t i = (!value.empty() && value[0] == '-') ? 1 : 0;
+    if (i >= value.size()) {
+        return false;
+    }
+    if (value[i] == '0') {
+        return i + 1 == value.size();
+    }
+    for (; i < value.size(); ++i) {
+        if (value[i] < '0' || value[i] > '9') {
+            return false;
+        }
+    }
+    return true;
+}
+
+void append_json_string(std::string& out, const std::string& value) {
+    out += '"';
+    for (unsigned char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (c < 0x20) {
+                    char escape[8];
+                    snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += static_cast<char>(c);
+                }
+        }
+    }
+    out += '"';
+}
+
+void skip_space(const std::string& line, size_t& pos) {
+    while (pos < line.size() && (line[pos] == ' ' || line[pos] == '\t' || line[pos] == '\r' || line[pos] == '\n')) {
+        pos++;
+    }
+}
+
+void append_utf8(std::string& out, unsigned code) {
+    if (code < 0x80) {
+        out += static_cast<char>(code);
+    } else if (code < 0x800) {
+        out += static_cast<char>(0xC0 | (code >> 6));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else if (code < 0x10000) {
+        out += static_cast<char>(0xE0 | (code >> 12));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (code >> 18));
+        out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (code & 0x3F));
+    }
+}
+
+bool parse_hex4(const std::string& line, size_t pos, unsigned& code) {
+    if (pos + 4 > line.size()) {
+        return false;
+    }
+    code = 0;
+    for (size_t i = pos; i < pos + 4; ++i) {
+        char c = line[i];
+        code <<= 4;
+        if (c >= '0' && c <= '9') code |= static_cast<unsigned>(c - '0');
+        else if (c >= 'a' && c <= 'f') code |= static_cast<unsigned>(c - 'a' + 10);
+        else if (c >= 'A' && c <= 'F') code |= static_cast<unsigned>(c - 'A' + 10);
+        else return false;
+    }
+    return true;
+}
+
+bool parse_string(const std::string& line, size_t& pos, std::string& value) {
+    if (pos >= line.size() || line[pos] != '"') {
+        return false;
+    }
+    pos++;
+    value.clear();
+    
+    while (pos < line.size()) {
+        char c = line[pos++];
+        if (c == '"') {
+            return true;
+        }
+        if (c != '\\') {
+            value += c;
+            continue;
+        }
+        if (pos >= line.size()) {
+            return false;
+        }
+        
+        char escape = line[pos++];
+        switch (escape) {
+            case 'n': value += '\n'; break;
+            case 'r': value += '\r'; break;
+            case 't': value += '\t'; break;
+            case 'b': value += '\b'; break;
+            case 'f': value += '\f'; break;
+            case 'u': {
+                unsigned code;
+                if (!parse_hex4(line, pos, code)) {
+                    return false;
+                }
+                pos += 4;
+                if (code >= 0xD800 && code < 0xDC00 && pos + 6 <= line.size() && line[pos] == '\\' &&
+                    line[pos + 1] == 'u') {
+                    unsigned low;
+                    if (parse_hex4(line, pos + 2, low) && low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                        pos += 6;
+                    }
+                }
+                append_utf8(value, code);
+                break;
+            }
+            default: value += escape; break;
+        }
+    }
+    return false;
+}
+
+bool skip_value(const std::string& line, size_t& pos) {
+    skip_space(line, pos);
+    if (pos >= line.size()) {
+        return false;
+    }
+    
+    if (line[pos] == '"') {
+        std::string ignored;
+        return parse_string(line, pos, ignored);
+    }
+    
+    if (line[pos] == '{' || line[pos] == '[') {
+        int depth = 0;
+        while (pos < line.size()) {
+            char c = line[pos];
+            if (c == '"') {
+                std::string ignored;
+                if (!parse_string(line, pos, ignored)) {
+                    return false;
+                }
+                continue;
+            }
+            if (c == '{' || c == '[') depth++;
+            if (c == '}' || c == ']') depth--;
+            pos++;
+            if (depth == 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    while (pos < line.size() && line[pos] != ',' && line[pos] != '}' && line[pos] != ']') {
+        pos++;
+    }
+    return true;
+}
+
+bool parse_scalar(const std::string& line, size_t& pos, std::string& value) {
+    skip_space(line, pos);
+    if (pos < line.size() && line[pos] == '"') {
+        return parse_string(line, pos, value);
+    }
+    
+    size_t start = pos;
+    if (!skip_value(line, pos)) {
+        return false;
+    }
+    value = line.substr(start, pos - start);
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+        value.pop_back();
+    }
+    return true;
+}
+
+const char* state_name(ProcessState state) {
+    switch (state) {
+        case ProcessState::IDLE: return "idle";
+        case ProcessState::STARTING: return "starting";
+        case ProcessState::RUNNING: return "running";
+        case ProcessState::PAUSED: return "paused";
+        case ProcessState::STOPPING: return "stopping";
+        case ProcessState::STOPPED: return "stopped";
+        case ProcessState::ERROR: return "error";
+        case ProcessState::KILLED: return "killed";
+    }
+    return "unknown";
+}
+
+DaemonMessage process_fields(const ProcessSummary& info) {
+    char cpu[32];
+    snprintf(cpu, sizeof(cpu), "%.1f", info.cpu_usage);
+    char tree_cpu[32];
+    snprintf(tree_cpu, sizeof(tree_cpu), "%.1f", info.tree_cpu_usage);
+    
+    return {
+        {"pid", std::to_string(info.pid)},
+        {"state", state_name(info.state)},
+        {"executable", info.executable_path},
+        {"prefix", info.wine_prefix},
+        {"exit_code", std::to_string(info.exit_code)},
+        {"cpu", cpu},
+        {"memory", std::to_string(info.memory_usage)},
+        {"tree_processes", std::to_string(info.tree_process_count)},
+        {"tree_memory", std::to_string(info.tree_memory_usage)},
+        {"tree_cpu", tree_cpu}
+    };
+}
+
+bool fill_address(const std::string& path, struct sockaddr_un& address) {
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+bool write_all(int fd, const std::string& data, int flags) {
+    size_t offset = 0;
+    while (offset < data.size()) {
+        ssize_t n = send(fd, data.data() + offset, data.size() - offset, flags | MSG_NOSIGNAL);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        offset += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Builds the environment a request's launches inherit: the daemon's own environment with the forwarded
+// variables replaced by the client's. Returns false when the client's values match the daemon's.
+bool client_environment(const DaemonMessage& client, DaemonMessage& environment) {
+    bool differs = false;
+    for (char** entry = ::environ; entry && *entry; ++entry) {
+        const char* eq = strchr(*entry, '=');
+        if (!eq || eq == *entry) continue;
+        
+        std::string name(*entry, static_cast<size_t>(eq - *entry));
+        if (!ManagerDaemon::forwarded_variable(name)) {
+            environment.insert({name, eq + 1});
+            continue;
+        }
+        auto it = client.find(name);
+        differs = differs || it == client.end() || it->second != eq + 1;
+    }
+    
+    for (const auto& pair : client) {
+        if (!ManagerDaemon::forwarded_variable(pair.first)) continue;
+        const char* own = getenv(pair.first.c_str());
+        differs = differs || !own || pair.second != own;
+        environment[pair.first] = pair.second;
+    }
+    return differs;
+}
+
+}
+
+ManagerDaemon::ManagerDaemon(WineApplicationManager& mgr, DaemonCommandHandler command_handler)
+    : manager(mgr), logger(mgr.get_logger()), handler(std::move(command_handler)), listen_fd(-1), wake_fd(-1),
+      running(false), active_connections(0), callback_id(-1) {
+}
+
+ManagerDaemon::~ManagerDaemon() {
+    stop();
+    
+    {
+        std::unique_lock<std::mutex> lock(connections_mutex);
+        for (auto& pair : connections) {
+            shutdown(pair.first, SHUT_RDWR);
+        }
+        connections_cv.wait(lock, [this] { return active_connections == 0; });
+    }
+    
+    if (callback_id != -1) {
+        manager.get_monitor().get_event_bus().unsubscribe(callback_id);
+    }
+    if (listen_fd != -1) {
+        close(listen_fd);
+        unlink(socket_path.c_str());
+    }
+    if (wake_fd != -1) {
+        close(wake_fd);
+    }
+}
+
+std::string ManagerDaemon::default_socket_path() {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    if (runtime_dir && *runtime_dir && Utils::directory_exists(runtime_dir)) {
+        return Utils::join_paths(runtime_dir, "wine-appd.sock");
+    }
+    return "/tmp/wine-appd-" + std::to_string(getuid()) + ".sock";
+}
+
+bool ManagerDaemon::start(const std::string& path) {
+    socket_path = path.empty() ? default_socket_path() : path;
+    
+    struct sockaddr_un address;
+    if (!fill_address(socket_path, address)) {
+        logger.error("Invalid daemon socket path: " + socket_path);
+        return false;
+    }
+    
+    DaemonClient probe;
+    if (probe.connect(socket_path) && probe.ping()) {
+        logger.error("Another daemon is already listening on " + socket_path);
+        return false;
+    }
+    probe.disconnect();
+    
+    struct stat st;
+    if (lstat(socket_path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            logger.error("Refusing to replace non-socket file " + socket_path);
+            return false;
+        }
+        unlink(socket_path.c_str());
+    }
+    
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd == -1) {
+        logger.error("Failed to create daemon socket: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    mode_t old_mask = umask(0077);
+    int bound = bind(listen_fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address));
+    umask(old_mask);
+    
+    if (bound != 0 || chmod(socket_path.c_str(), 0600) != 0 || listen(listen_fd, 64) != 0) {
+        logger.error("Failed to listen on " + socket_path + ": " + strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+    
+    wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wake_fd == -1) {
+        logger.error("Failed to create daemon wake descriptor: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    uint32_t event_mask = ProcessEventBus::ALL_EVENTS & ~ProcessEventBus::mask(ProcessEventType::STATS_UPDATED);
+    callback_id = manager.get_monitor().get_event_bus().subscribe("daemon", [this](const std::vector<ProcessEvent>& batch) {
+        for (const auto& event : batch) {
+            broadcast_process_event(event);
+        }
+    }, event_mask);
+    
+    running = true;
+    logger.info("Daemon listening on " + socket_path);
+    return true;
+}
+
+void ManagerDaemon::run() {
+    while (running) {
+        struct pollfd fds[2] = {{listen_fd, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+        int ready = poll(fds, 2, -1);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            logger.error("Daemon poll failed: " + std::string(strerror(errno)));
+            break;
+        }
+        
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        if (!(fds[0].revents & POLLIN)) {
+            continue;
+        }
+        
+        int client_fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client_fd == -1) {
+            continue;
+        }
+        
+        struct ucred credentials;
+        socklen_t length = sizeof(credentials);
+        if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0 ||
+            credentials.uid != getuid()) {
+            logger.warning("Rejected daemon connection from uid " + std::to_string(credentials.uid));
+            close(client_fd);
+            continue;
+        }
+        
+        auto connection = std::make_shared<Connection>();
+        connection->fd = client_fd;
+        connection->subscribed = false;
+        
+        {
+            std::lock_guard<std::mutex> lock(connections_mutex);
+            connections[client_fd] = connection;
+            active_connections++;
+        }
+        std::thread(&ManagerDaemon::serve_connection, this, connection).detach();
+    }
+    
+    running = false;
+    logger.info("Daemon stopped");
+}
+
+void ManagerDaemon::stop() {
+    running = false;
+    if (wake_fd != -1) {
+        uint64_t value = 1;
+        ssize_t ignored = write(wake_fd, &value, sizeof(value));
+        (void)ignored;
+    }
+}
+
+void ManagerDaemon::serve_connection(std::shared_ptr<Connection> connection) {
+    std::string buffer;
+    char chunk[8192];
+    bool open = true;
+    bool private_cwd = unshare(CLONE_FS) == 0;
+    
+    while (open) {
+        ssize_t n = recv(connection->fd, chunk, sizeof(chunk), 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(n));
+        
+        size_t newline;
+        while (open && (newline = buffer.find('\n')) != std::string::npos) {
+            std::string line = buffer.substr(0, newline);
+            buffer.erase(0, newline + 1);
+            if (!line.empty()) {
+                open = handle_request(*connection, line, private_cwd);
+            }
+        }
+        
+        if (buffer.size() > MAX_REQUEST_SIZE) {
+            logger.warning("Dropping daemon client with oversized request");
+            break;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(connections_mutex);
+    connections.erase(connection->fd);
+    close(connection->fd);
+    if (--active_connections == 0) {
+        connections_cv.notify_all();
+    }
+}
+
+bool ManagerDaemon::handle_request(Connection& connection, const std::string& line, bool private_cwd) {
+    DaemonMessage request;
+    std::vector<std::string> args;
+    std::map<std::string, DaemonMessage> objects;
+    if (!decode_message(line, request, &args, &objects)) {
+        return send_line(connection, encode_message({{"ok", "0"}, {"error", "malformed request"}}));
+    }
+    
+    const std::string& method = request["method"];
+    DaemonMessage response = {{"id", request["id"]}, {"ok", "1"}};
+    
+    if (method == "ping") {
+        response["version"] = manager.get_version();
+        response["pid"] = std::to_string(getpid());
+        return send_line(connection, encode_message(response));
+    }
+    
+    if (method == "execute") {
+        if (private_cwd && !request["cwd"].empty() && chdir(request["cwd"].c_str()) != 0) {
+            logger.warning("Client working directory unavailable: " + request["cwd"]);
+        }
+        
+        DaemonMessage environment;
+        auto env = objects.find("env");
+        bool custom_environment = env != objects.end() && client_environment(env->second, environment);
+        
+        std::ostringstream out;
+        std::ostringstream err;
+        int status = handler ? handler(args, custom_environment ? &environment : nullptr, out, err) : 1;
+        response["status"] = std::to_string(status);
+        response["stdout"] = out.str();
+        response["stderr"] = err.str();
+        return send_line(connection, encode_message(response));
+    }
+    
+    if (method == "node_status") {
+        for (const auto& pair : manager.get_node_status()) {
+            response[pair.first] = pair.second;
+        }
+        return send_line(connection, encode_message(response));
+    }
+    
+    if (method == "processes") {
+        return send_line(connection, encode_message(response, "\"processes\":" + encode_processes()));
+    }
+    
+    if (method == "subscribe") {
+        bool sent = send_line(connection, encode_message(response));
+        std::lock_guard<std::mutex> lock(connection.write_mutex);
+        connection.subscribed = true;
+        return sent;
+    }
+    
+    if (method == "shutdown") {
+        send_line(connection, encode_message(response));
+        logger.info("Daemon shutdown requested by client");
+        stop();
+        return false;
+    }
+    
+    response["ok"] = "0";
+    response["error"] = "unknown method: " + method;
+    return send_line(connection, encode_message(response));
+}
+
+bool ManagerDaemon::send_line(Connection& connection, const std::string& line) {
+    std::lock_guard<std::mutex> lock(connection.write_mutex);
+    return write_all(connection.fd, line + "\n", 0);
+}
+
+void ManagerDaemon::broadcast_process_event(const ProcessEvent& process_event) {
+    DaemonMessage event = process_fields(process_event.process);
+    event["event"] = "process";
+    event["type"] = ProcessEventBus::type_name(process_event.type);
+    event["sequence"] = std::to_string(process_event.sequence);
+    std::string line = encode_message(event) + "\n";
+    
+    std::vector<std::shared_ptr<Connection>> targets;
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (const auto& pair : connections) {
+            targets.push_back(pair.second);
+        }
+    }
+    
+    for (const auto& connection : targets) {
+        std::lock_guard<std::mutex> lock(connection->write_mutex);
+        if (connection->subscribed && !write_all(connection->fd, line, MSG_DONTWAIT)) {
+            connection->subscribed = false;
+            shutdown(connection->fd, SHUT_RDWR);
+        }
+    }
+}
+
+std::string ManagerDaemon::encode_processes() {
+    std::string json = "[";
+    bool first = true;
+    auto snapshot = manager.get_process_snapshot();
+    for (const auto& info : snapshot->processes) {
+        if (!first) {
+            json += ',';
+        }
+        first = false;
+        json += encode_message(process_fields(info));
+    }
+    json += ']';
+    return json;
+}
+
+std::string ManagerDaemon::encode_message(const DaemonMessage& fields, const std::string& raw_fields) {
+    std::string json = "{";
+    bool first = true;
+    for (const auto& pair : fields) {
+        if (!first) {
+            json += ',';
+        }
+        first = false;
+        append_json_string(json, pair.first);
+        json += ':';
+        if (numeric_field(pair.first) && is_integer(pair.second)) {
+            json += pair.second;
+        } else {
+            append_json_string(json, pair.second);
+        }
+    }
+    if (!raw_fields.empty()) {
+        if (!first) {
+            json += ',';
+        }
+        json += raw_fields;
+    }
+    json += '}';
+    return json;
+}
+
+bool ManagerDaemon::forwarded_variable(const std::string& name) {
+    for (const char* variable : FORWARDED_VARIABLES) {
+        if (name == variable) {
+            return true;
+        }
+    }
+    for (const char* prefix : FORWARDED_PREFIXES) {
+        if (name.compare(0, strlen(prefix), prefix) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ManagerDaemon::decode_message(const std::string& line, DaemonMessage& fields, std::vector<std::string>* args,
+                                   std::map<std::string, DaemonMessage>* objects) {
+    size_t pos = 0;
+    skip_space(line, pos);
+    if (pos >= line.size() || line[pos] != '{') {
+        return false;
+    }
+    pos++;
+    
+    skip_space(line, pos);
+    if (pos < line.size() && line[pos] == '}') {
+        return true;
+    }
+    
+    while (pos < line.size()) {
+        skip_space(line, pos);
+        std::string key;
+        if (!parse_string(line, pos, key)) {
+            return false;
+        }
+        skip_space(line, pos);
+        if (pos >= line.size() || line[pos] != ':') {
+            return false;
+        }
+        pos++;
+        skip_space(line, pos);
+        
+        if (key == "args" && args && pos < line.size() && line[pos] == '[') {
+            pos++;
+            skip_space(line, pos);
+            while (pos < line.size() && line[pos] != ']') {
+                std::string arg;
+                if (!parse_scalar(line, pos, arg)) {
+                    return false;
+                }
+                args->push_back(arg);
+                skip_space(line, pos);
+                if (pos < line.size() && line[pos] == ',') {
+                    pos++;
+                    skip_space(line, pos);
+                }
+            }
+            if (pos >= line.size()) {
+                return false;
+            }
+            pos++;
+        } else if (pos < line.size() && (line[pos] == '{' || line[pos] == '[')) {
+            size_t start = pos;
+            if (!skip_value(line, pos)) {
+                return false;
+            }
+            if (objects && line[start] == '{' &&
+                !decode_message(line.substr(start, pos - start), (*objects)[key])) {
+                return false;
+            }
+        } else {
+            std::string value;
+            if (!parse_scalar(line, pos, value)) {
+                return false;
+            }
+            fields[key] = value;
+        }
+        
+        skip_space(line, pos);
+        if (pos < line.size() && line[pos] == ',') {
+            pos++;
+            continue;
+        }
+        return pos < line.size() && line[pos] == '}';
+    }
+    return false;
+}
+
+DaemonClient::DaemonClient() : fd(-1), next_id(1) {
+}
+
+DaemonClient::~DaemonClient() {
+    disconnect();
+}
+
+bool DaemonClient::connect(const std::string& path) {
+    disconnect();
+    
+    struct sockaddr_un address;
+    if (!fill_address(path.empty() ? ManagerDaemon::default_socket_path() : path, address)) {
+        return false;
+    }
+    
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return false;
+    }
+    
+    if (::connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) {
+        close(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void DaemonClient::disconnect() {
+    if (fd != -1) {
+        close(fd);
+        fd = -1;
+    }
+    read_buffer.clear();
+}
+
+bool DaemonClient::send_request(const DaemonMessage& fields, const std::vector<std::string>* args,
+                                const std::string& raw_fields) {
+    if (fd == -1) {
+        return false;
+    }
+    
+    DaemonMessage request = fields;
+    request["id"] = std::to_string(next_id++);
+    
+    std::string raw;
+    if (args) {
+        raw = "\"args\":[";
+        for (size_t i = 0; i < args->size(); ++i) {
+            if (i > 0) {
+                raw += ',';
+            }
+            append_json_string(raw, (*args)[i]);
+        }
+        raw += ']';
+    }
+    if (!raw_fields.empty()) {
+        raw += (raw.empty() ? "" : ",") + raw_fields;
+    }
+    
+    if (!write_all(fd, ManagerDaemon::encode_message(request, raw) + "\n", 0)) {
+        disconnect();
+        return false;
+    }
+    return true;
+}
+
+bool DaemonClient::read_message(DaemonMessage& fields) {
+    for (;;) {
+        size_t newline = read_buffer.find('\n');
+        if (newline != std::string::npos) {
+            std::string line = read_buffer.substr(0, newline);
+            read_buffer.erase(0, newline + 1);
+            fields.clear();
+            return ManagerDaemon::decode_message(line, fields);
+        }
+        
+        char chunk[8192];
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n == -1 && errno == EINTR) continue;
+        if (n <= 0) {
+            disconnect();
+            return false;
+        }
+        read_buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+DaemonMessage DaemonClient::forwarded_environment() {
+    DaemonMessage environment;
+    for (char** entry = ::environ; entry && *entry; ++entry) {
+        const char* eq = strchr(*entry, '=');
+        if (eq && eq != *entry) {
+            std::string name(*entry, static_cast<size_t>(eq - *entry));
+            if (ManagerDaemon::forwarded_variable(name)) {
+                environment[name] = eq + 1;
+            }
+        }
+    }
+    return environment;
+}
+
+int DaemonClient::execute(const std::vector<std::string>& args, std::string& out, std::string& err,
+                          const DaemonMessage* environment) {
+    DaemonMessage response;
+    char cwd[PATH_MAX];
+    DaemonMessage request = {{"method", "execute"}};
+    if (getcwd(cwd, sizeof(cwd))) {
+        request["cwd"] = cwd;
+    }
+    
+    std::string raw;
+    if (environment) {
+        raw = "\"env\":" + ManagerDaemon::encode_message(*environment);
+    }
+    
+    if (!send_request(request, &args, raw) || !read_message(response) || response["ok"] != "1") {
+        return -1;
+    }
+    
+    out = response["stdout"];
+    err = response["stderr"];
+    return atoi(response["status"].c_str());
+}
+
+bool DaemonClient::set_timeout(int milliseconds) {
+    struct timeval timeout;
+    timeout.tv_sec = milliseconds / 1000;
+    timeout.tv_usec = (milliseconds % 1000) * 1000;
+    return fd != -1 && setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+           setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+bool DaemonClient::ping() {
+    DaemonMessage response;
+    return send_request({{"method", "ping"}}, nullptr) && read_message(response) && response["ok"] == "1";
+}
+
+bool DaemonClient::node_status(DaemonMessage& status) {
+    return send_request({{"method", "node_status"}}, nullptr) && read_message(status) && status["ok"] == "1";
+}
+
+bool DaemonClient::request_shutdown() {
+    DaemonMessage response;
+    return send_request({{"method", "shutdown"}}, nullptr) && read_message(response) && response["ok"] == "1";
+}
+
+bool DaemonClient::subscribe(const std::function<bool(const DaemonMessage&)>& callback) {
+    DaemonMessage response;
+    if (!send_request({{"method", "subscribe"}}, nullptr) || !read_message(response) || response["ok"] != "1") {
+        return false;
+    }
+    
+    while (read_message(response)) {
+        if (!callback(response)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+}
@@ -0,0 +1,287 @@
+#include "wine_wrapper.hpp"
+
+namespace WineWrapper {
+
+namespace {
+
+const size_t MAX_BATCH_EVENTS = 256;
+
+}
+
+ProcessEventBus::ProcessEventBus(Logger& log)
+    : logger(log), subscribers(std::make_shared<const SubscriberList>()), next_subscriber_id(1), next_sequence(1) {
+}
+
+ProcessEventBus::~ProcessEventBus() {
+    shutdown();
+}
+
+const char* ProcessEventBus::type_name(ProcessEventType type) {
+    switch (type) {
+        case ProcessEventType::STARTED: return "started";
+        case ProcessEventType::STATE_CHANGED: return "state";
+        case ProcessEventType::EXITED: return "exited";
+        case ProcessEventType::STATS_UPDATED: return "stats";
+        case ProcessEventType::MEMORY_THRESHOLD: return "memory_threshold";
+        case ProcessEventType::CPU_THRESHOLD: return "cpu_threshold";
+    }
+    return "unknown";
+}
+
+bool ProcessEventBus::try_enqueue(Subscriber& subscriber, const ProcessEvent& event) {
+    size_t pos = subscriber.enqueue_pos.load(std::memory_order_relaxed);
+    EventSlot* slot;
+    
+    for (;;) {
+        slot = &subscriber.slots[pos & subscriber.slot_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        
+        if (diff == 0) {
+            if (subscriber.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = subscriber.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+    
+    slot->event = event;
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+bool ProcessEventBus::try_dequeue(Subscriber& subscriber, ProcessEvent& event) {
+    size_t pos = subscriber.dequeue_pos.load(std::memory_order_relaxed);
+    EventSlot* slot = &subscriber.slots[pos & subscriber.slot_mask];
+    size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    
+    if (static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1) != 0) {
+        return false;
+    }
+    
+    event = std::move(slot->event);
+    subscriber.dequeue_pos.store(pos + 1, std::memory_order_relaxed);
+    slot->sequence.store(pos + subscriber.slot_mask + 1, std::memory_order_release);
+    return true;
+}
+
+void ProcessEventBus::coalesce(Subscriber& subscriber, std::vector<ProcessEvent>& batch) {
+    std::map<pid_t, size_t> latest_stats;
+    size_t out = 0;
+    
+    for (size_t i = 0; i < batch.size(); ++i) {
+        pid_t pid = batch[i].process.pid;
+        if (batch[i].type != ProcessEventType::STATS_UPDATED) {
+            latest_stats.erase(pid);
+        } else {
+            auto it = latest_stats.find(pid);
+            if (it != latest_stats.end()) {
+                batch[it->second] = std::move(batch[i]);
+                subscriber.coalesced.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            latest_stats[pid] = out;
+        }
+        
+        if (out != i) {
+            batch[out] = std::move(batch[i]);
+        }
+        ++out;
+    }
+    
+    batch.resize(out);
+}
+
+void ProcessEventBus::deliver(const std::shared_ptr<Subscriber>& subscriber) {
+    std::vector<ProcessEvent> batch;
+    batch.reserve(64);
+    
+    for (;;) {
+        batch.clear();
+        ProcessEvent event;
+        while (batch.size() < MAX_BATCH_EVENTS && try_dequeue(*subscriber, event)) {
+            batch.push_back(std::move(event));
+        }
+        
+        if (batch.size() < MAX_BATCH_EVENTS && subscriber->overflowed.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(subscriber->overflow_mutex);
+            while (!subscriber->overflow.empty() && batch.size() < MAX_BATCH_EVENTS) {
+                batch.push_back(std::move(subscriber->overflow.front()));
+                subscriber->overflow.pop_front();
+            }
+            subscriber->overflowed.store(!subscriber->overflow.empty(), std::memory_order_release);
+        }
+        
+        if (batch.empty()) {
+            if (subscriber->stopping.load(std::memory_order_acquire)) {
+                return;
+            }
+            
+            std::unique_lock<std::mutex> lock(subscriber->wake_mutex);
+            subscriber->waiting.store(true, std::memory_order_seq_cst);
+            subscriber->wake_cv.wait_for(lock, std::chrono::milliseconds(100), [&subscriber] {
+                return subscriber->stopping.load(std::memory_order_acquire) ||
+                       subscriber->overflowed.load(std::memory_order_acquire) ||
+                       subscriber->slots[subscriber->dequeue_pos.load(std::memory_order_relaxed) &
+                                         subscriber->slot_mask].sequence.load(std::memory_order_acquire) ==
+                           subscriber->dequeue_pos.load(std::memory_order_relaxed) + 1;
+            });
+            subscriber->waiting.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        
+        coalesce(*subscriber, batch);
+        
+        int64_t lag = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - batch.front().timestamp).count();
+        subscriber->last_lag_us.store(lag, std::memory_order_relaxed);
+        if (lag > subscriber->max_lag_us.load(std::memory_order_relaxed)) {
+            subscriber->max_lag_us.store(lag, std::memory_order_relaxed);
+        }
+        
+        subscriber->handler(batch);
+        subscriber->delivered.fetch_add(batch.size(), std::memory_order_relaxed);
+        subscriber->batches.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+int ProcessEventBus::subscribe(const std::string& name, ProcessEventHandler handler, uint32_t type_mask,
+                               size_t capacity) {
+    auto subscriber = std::make_shared<Subscriber>();
+    subscriber->name = name;
+    subscriber->type_mask = type_mask;
+    subscriber->handler = std::move(handler);
+    
+    size_t slots = 2;
+    while (slots < capacity) {
+        slots <<= 1;
+    }
+    subscriber->slots.reset(new EventSlot[slots]);
+    for (size_t i = 0; i < slots; ++i) {
+        subscriber->slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+    subscriber->slot_mask = slots - 1;
+    subscriber->enqueue_pos = 0;
+    subscriber->dequeue_pos = 0;
+    subscriber->overflowed = false;
+    subscriber->waiting = false;
+    subscriber->stopping = false;
+    subscriber->delivered = 0;
+    subscriber->dropped = 0;
+    subscriber->coalesced = 0;
+    subscriber->batches = 0;
+    subscriber->last_lag_us = 0;
+    subscriber->max_lag_us = 0;
+    
+    std::lock_guard<std::mutex> lock(subscribers_mutex);
+    subscriber->id = next_subscriber_id++;
+    subscriber->worker = std::thread(&ProcessEventBus::deliver, subscriber);
+    
+    auto list = std::make_shared<SubscriberList>(*std::atomic_load(&subscribers));
+    list->push_back(subscriber);
+    std::atomic_store(&subscribers, std::shared_ptr<const SubscriberList>(std::move(list)));
+    
+    logger.debug("Event subscriber " + name + " registered with id " + std::to_string(subscriber->id));
+    return subscriber->id;
+}
+
+void ProcessEventBus::unsubscribe(int id) {
+    std::shared_ptr<Subscriber> removed;
+    {
+        std::lock_guard<std::mutex> lock(subscribers_mutex);
+        auto list = std::make_shared<SubscriberList>(*std::atomic_load(&subscribers));
+        for (auto it = list->begin(); it != list->end(); ++it) {
+            if ((*it)->id == id) {
+                removed = *it;
+                list->erase(it);
+                break;
+            }
+        }
+        if (!removed) {
+            return;
+        }
+        std::atomic_store(&subscribers, std::shared_ptr<const SubscriberList>(std::move(list)));
+    }
+    
+    removed->stopping.store(true, std::memory_order_release);
+    removed->wake_cv.notify_all();
+    if (removed->worker.get_id() == std::this_thread::get_id()) {
+        removed->worker.detach();
+    } else if (removed->worker.joinable()) {
+        removed->worker.join();
+    }
+}
+
+void ProcessEventBus::publish(ProcessEventType type, const ProcessSummary& process) {
+    auto list = std::atomic_load(&subscribers);
+    if (list->empty()) {
+        return;
+    }
+    
+    ProcessEvent event;
+    event.type = type;
+    event.sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+    event.timestamp = std::chrono::steady_clock::now();
+    event.process = process;
+    
+    bool lifecycle = type != ProcessEventType::STATS_UPDATED;
+    for (const auto& subscriber : *list) {
+        if (!(subscriber->type_mask & mask(type)) || subscriber->stopping.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        
+        if (subscriber->overflowed.load(std::memory_order_acquire) || !try_enqueue(*subscriber, event)) {
+            if (!lifecycle) {
+                subscriber->dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            std::lock_guard<std::mutex> lock(subscriber->overflow_mutex);
+            subscriber->overflow.push_back(event);
+            subscriber->overflowed.store(true, std::memory_order_release);
+        }
+        
+        if (subscriber->waiting.load(std::memory_order_seq_cst)) {
+            subscriber->wake_cv.notify_one();
+        }
+    }
+}
+
+std::vector<EventSubscriberStats> ProcessEventBus::get_stats() {
+    std::vector<EventSubscriberStats> stats;
+    auto list = std::atomic_load(&subscribers);
+    
+    for (const auto& subscriber : *list) {
+        EventSubscriberStats entry;
+        entry.name = subscriber->name;
+        entry.delivered = subscriber->delivered.load(std::memory_order_relaxed);
+        entry.dropped = subscriber->dropped.load(std::memory_order_relaxed);
+        entry.coalesced = subscriber->coalesced.load(std::memory_order_relaxed);
+        entry.batches = subscriber->batches.load(std::memory_order_relaxed);
+        entry.queue_depth = subscriber->enqueue_pos.load(std::memory_order_relaxed) -
+                            subscriber->dequeue_pos.load(std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(subscriber->overflow_mutex);
+            entry.queue_depth += subscriber->overflow.size();
+        }
+        entry.last_lag_ms = subscriber->last_lag_us.load(std::memory_order_relaxed) / 1000.0;
+        entry.max_lag_ms = subscriber->max_lag_us.load(std::memory_order_relaxed) / 1000.0;
+        stats.push_back(entry);
+    }
+    
+    return stats;
+}
+
+void ProcessEventBus::shutdown() {
+    std::vector<int> ids;
+    for (const auto& subscriber : *std::atomic_load(&subscribers)) {
+        ids.push_back(subscriber->id);
+    }
+    for (int id : ids) {
+        unsubscribe(id);
+    }
+}
+
+}
@@ -4,26 +4,147 @@
 #include <unistd.h>
 #include <signal.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <cerrno>
 
 namespace WineWrapper {
 
+namespace {
+
+struct SpawnRequest {
+    const char* path;
+    char* const* argv;
+    char* const* envp;
+    int stdout_fd;
+    int stderr_fd;
+    int nice_level;
+    int cgroup_fd;
+    const PreparedLaunchProfile* profile;
+    const cpu_set_t* affinity;
+    volatile int error;
+    volatile int cgroup_error;
+    volatile int profile_failed;
+    volatile int profile_error;
+};
+
+int spawn_child(void* arg) {
+    SpawnRequest* request = static_cast<SpawnRequest*>(arg);
+    
+    signal(SIGPIPE, SIG_DFL);
+    signal(SIGCHLD, SIG_DFL);
+    
+    if (request->cgroup_fd != -1 && write(request->cgroup_fd, "0", 1) != 1) {
+        request->cgroup_error = errno;
+    }
+    
+    if (request->stdout_fd != -1 && dup2(request->stdout_fd, STDOUT_FILENO) == -1) {
+        request->error = errno;
+        _exit(127);
+    }
+    if (request->stderr_fd != -1 && dup2(request->stderr_fd, STDERR_FILENO) == -1) {
+        request->error = errno;
+        _exit(127);
+    }
+    
+    if (request->nice_level != 0) {
+        errno = 0;
+        int current = getpriority(PRIO_PROCESS, 0);
+        if (errno == 0) {
+            setpriority(PRIO_PROCESS, 0, current + request->nice_level);
+        }
+    }
+    
+    if (request->affinity) {
+        sched_setaffinity(0, sizeof(cpu_set_t), request->affinity);
+    }
+    
+    if (request->profile->active) {
+        int failed = request->profile->apply();
+        if (failed != 0) {
+            request->profile_error = errno;
+            request->profile_failed = failed;
+        }
+    }
+    
+    sigset_t empty_mask;
+    sigemptyset(&empty_mask);
+    sigprocmask(SIG_SETMASK, &empty_mask, nullptr);
+    
+    execve(request->path, request->argv, request->envp);
+    request->error = errno;
+    _exit(127);
+}
+
+std::string find_in_path(const std::string& binary) {
+    if (binary.empty() || binary.find('/') != std::string::npos) {
+        return binary;
+    }
+    
+    const char* path_env = getenv("PATH");
+    std::string search_path = path_env ? path_env : "/usr/local/bin:/usr/bin:/bin";
+    
+    size_t start = 0;
+    while (start <= search_path.size()) {
+        size_t end = search_path.find(':', start);
+        if (end == std::string::npos) end = search_path.size();
+        
+        std::string directory = search_path.substr(start, end - start);
+        std::string candidate = (directory.empty() ? "." : directory) + "/" + binary;
+        if (access(candidate.c_str(), X_OK) == 0) {
+            return candidate;
+        }
+        start = end + 1;
+    }
+    
+    return binary;
+}
+
+std::vector<char*> extend_environment(const std::vector<char*>& base, std::vector<std::string>& variables) {
+    std::vector<char*> envp(base.begin(), base.end() - 1);
+    envp.reserve(base.size() + variables.size());
+    
+    for (auto& variable : variables) {
+        size_t key_length = variable.find('=') + 1;
+        bool present = false;
+        for (size_t i = 0; i + 1 < base.size() && !present; ++i) {
+            present = strncmp(base[i], variable.c_str(), key_length) == 0;
+        }
+        if (!present) {
+            envp.push_back(&variable[0]);
+        }
+    }
+    
+    envp.push_back(nullptr);
+    return envp;
+}
+
+}
+
 WineExecutor::WineExecutor(Logger& log, ProcessMonitor& mon, WinePrefixManager& pm)
     : logger(log), monitor(mon), prefix_manager(pm), 
-      execution_active(false), current_process_pid(-1) {
-    stdout_pipe[0] = stdout_pipe[1] = -1;
-    stderr_pipe[0] = stderr_pipe[1] = -1;
+      execution_active(false), current_process_pid(-1), metrics(nullptr), shader_cache(nullptr), prefetch(nullptr) {
     logger.info("WineExecutor initialized");
 }
 
 WineExecutor::~WineExecutor() {
-    close_pipes();
     logger.info("WineExecutor shutting down");
 }
 
 void WineExecutor::set_configuration(const WineConfiguration& cfg) {
+    WineConfiguration validated = cfg;
+    validated.validate();
+    
     std::lock_guard<std::mutex> lock(execution_mutex);
-    config = cfg;
-    config.validate();
+    ConfigDiff changes = config.diff(validated);
+    config = std::move(validated);
+    if (changes.affects(ConfigSchema::GROUP_ENVIRONMENT)) {
+        invalidate_environment();
+    }
+    if (!changes.empty()) {
+        logger.debug("Changed configuration fields: " + changes.to_string());
+    }
     logger.info("Wine configuration updated");
 }
 
@@ -31,92 +152,89 @@ WineConfiguration WineExecutor::get_configuration() const {
     return config;
 }
 
-bool WineExecutor::setup_environment() {
-    setenv("WINEPREFIX", config.wine_prefix.c_str(), 1);
+bool WineExecutor::setup_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env) {
+    env["WINEPREFIX"] = cfg.wine_prefix;
     
-    if (config.architecture == WineArchitecture::WIN32) {
-        setenv("WINEARCH", "win32", 1);
-    } else if (config.architecture == WineArchitecture::WIN64) {
-        setenv("WINEARCH", "win64", 1);
+    if (cfg.architecture == WineArchitecture::WIN32) {
+        env["WINEARCH"] = "win32";
+    } else if (cfg.architecture == WineArchitecture::WIN64) {
+        env["WINEARCH"] = "win64";
     }
     
-    if (config.enable_virtual_desktop && !config.virtual_desktop_resolution.empty()) {
-        setenv("WINE_VD_RESOLUTION", config.virtual_desktop_resolution.c_str(), 1);
+    if (cfg.enable_virtual_desktop && !cfg.virtual_desktop_resolution.empty()) {
+        env["WINE_VD_RESOLUTION"] = cfg.virtual_desktop_resolution;
     }
     
-    if (config.enable_csmt) {
-        setenv("CSMT", "enabled", 1);
+    if (cfg.enable_csmt) {
+        env["CSMT"] = "enabled";
     }
     
-    if (config.enable_esync) {
-        setenv("WINEESYNC", "1", 1);
+    if (cfg.enable_esync) {
+        env["WINEESYNC"] = "1";
     }
     
-    if (config.enable_fsync) {
-        setenv("WINEFSYNC", "1", 1);
+    if (cfg.enable_fsync) {
+        env["WINEFSYNC"] = "1";
     }
     
-    if (!config.audio_driver.empty()) {
-        setenv("WINEDLLOVERRIDES", "winemapi.dll=n,b", 1);
+    if (!cfg.audio_driver.empty()) {
+        env["WINEDLLOVERRIDES"] = "winemapi.dll=n,b";
     }
     
     for (const auto& pair : custom_environment) {
-        setenv(pair.first.c_str(), pair.second.c_str(), 1);
+        env[pair.first] = pair.second;
     }
     
-    for (const auto& pair : config.environment_variables) {
-        setenv(pair.first.c_str(), pair.second.c_str(), 1);
+    for (const auto& pair : cfg.environment_variables) {
+        env[pair.first] = pair.second;
     }
     
     logger.debug("Environment setup completed");
     return true;
 }
 
-bool WineExecutor::setup_pipes() {
-    if (config.capture_stdout) {
-        if (pipe(stdout_pipe) == -1) {
+bool WineExecutor::setup_pipes(const WineConfiguration& cfg, int stdout_pipe[2], int stderr_pipe[2]) {
+    if (cfg.capture_stdout) {
+        if (pipe2(stdout_pipe, O_CLOEXEC) == -1) {
             logger.error("Failed to create stdout pipe");
             return false;
         }
         fcntl(stdout_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(stdout_pipe[0], F_SETPIPE_SZ, 1024 * 1024);
     }
     
-    if (config.capture_stderr) {
-        if (pipe(stderr_pipe) == -1) {
+    if (cfg.capture_stderr) {
+        if (pipe2(stderr_pipe, O_CLOEXEC) == -1) {
             logger.error("Failed to create stderr pipe");
-            close_pipes();
+            close_pipes(stdout_pipe, stderr_pipe);
             return false;
         }
         fcntl(stderr_pipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(stderr_pipe[0], F_SETPIPE_SZ, 1024 * 1024);
     }
     
     return true;
 }
 
-void WineExecutor::close_pipes() {
-    if (stdout_pipe[0] != -1) {
-        close(stdout_pipe[0]);
-        stdout_pipe[0] = -1;
-    }
-    if (stdout_pipe[1] != -1) {
-        close(stdout_pipe[1]);
-        stdout_pipe[1] = -1;
-    }
-    if (stderr_pipe[0] != -1) {
-        close(stderr_pipe[0]);
-        stderr_pipe[0] = -1;
-    }
-    if (stderr_pipe[1] != -1) {
-        close(stderr_pipe[1]);
-        stderr_pipe[1] = -1;
+void WineExecutor::close_pipes(int stdout_pipe[2], int stderr_pipe[2]) {
+    for (int i = 0; i < 2; ++i) {
+        if (stdout_pipe[i] != -1) {
+            close(stdout_pipe[i]);
+            stdout_pipe[i] = -1;
+        }
+        if (stderr_pipe[i] != -1) {
+            close(stderr_pipe[i]);
+            stderr_pipe[i] = -1;
+        }
     }
 }
 
-std::vector<std::string> WineExecutor::build_wine_command(const std::string& exe_path, 
+std::vector<std::string> WineExecutor::build_wine_command(const LaunchEnvironment& env,
+                                                          const std::string& exe_path, 
                                                           const std::vector<std::string>& args) {
     std::vector<std::string> command;
     
-    command.push_back(config.wine_binary);
+    command.push_back(env.binary);
     command.push_back(exe_path);
     
     for (const auto& arg : args) {
@@ -126,32 +244,56 @@ std::vector<std::string> WineExecutor::build_wine_command(const std::string& exe
     return command;
 }
 
-bool WineExecutor::execute_pre_launch_commands() {
-    for (const auto& cmd : pre_launch_commands) {
-        logger.debug("Executing pre-launch command: " + cmd);
-        std::string output = Utils::execute_command(cmd);
-        logger.debug("Pre-launch command output: " + output);
+// Hooks are best-effort: a failing or hung command is logged, killed at the timeout (0 disables it)
+// and the launch carries on.
+void WineExecutor::run_hook(const std::string& phase, const std::string& command, std::chrono::seconds timeout) {
+    logger.debug("Executing " + phase + " command: " + command);
+    
+    CommandOptions options;
+    options.timeout = timeout;
+    options.capture_stderr = false;
+    CommandResult result = Utils::run_command({"/bin/sh", "-c", command}, options);
+    
+    logger.debug("Output of " + phase + " command: " + result.output);
+    if (result.timed_out) {
+        logger.warning(phase + " command timed out after " + std::to_string(timeout.count()) + "s: " + command);
+    } else if (result.exit_code != 0) {
+        logger.warning(phase + " command exited with code " + std::to_string(result.exit_code) + ": " + command);
+    }
+}
+
+bool WineExecutor::execute_pre_launch_commands(const std::vector<std::string>& commands,
+                                               std::chrono::seconds timeout) {
+    for (const auto& cmd : commands) {
+        run_hook("pre-launch", cmd, timeout);
     }
     return true;
 }
 
 bool WineExecutor::execute_post_launch_commands() {
-    for (const auto& cmd : post_launch_commands) {
-        logger.debug("Executing post-launch command: " + cmd);
-        std::string output = Utils::execute_command(cmd);
-        logger.debug("Post-launch command output: " + output);
+    std::vector<std::string> commands;
+    std::chrono::seconds timeout;
+    {
+        std::lock_guard<std::mutex> lock(execution_mutex);
+        commands = post_launch_commands;
+        timeout = std::chrono::seconds(config.hook_timeout_seconds);
+    }
+    
+    PhaseTimer timer(commands.empty() ? nullptr : metrics, MetricPhase::POST_LAUNCH);
+    for (const auto& cmd : commands) {
+        run_hook("post-launch", cmd, timeout);
     }
     return true;
 }
 
-void WineExecutor::setup_dll_overrides() {
-    if (!config.dll_overrides.empty()) {
+void WineExecutor::setup_dll_overrides(const WineConfiguration& cfg, std::map<std::string, std::string>& env) {
+    if (!cfg.dll_overrides.empty()) {
         std::string overrides;
-        for (size_t i = 0; i < config.dll_overrides.size(); ++i) {
+        for (size_t i = 0; i < cfg.dll_overrides.size(); ++i) {
             if (i > 0) overrides += ";";
-            overrides += config.dll_overrides[i];
+            overrides += cfg.dll_overrides[i];
         }
-        setenv("WINEDLLOVERRIDES", overrides.c_str(), 1);
+        env["WINEDLLOVERRIDES"] = overrides;
         logger.debug("DLL overrides set: " + overrides);
     }
 }
@@ -176,102 +318,188 @@ bool WineExecutor::validate_executable(const std::string& exe_path) {
     return true;
 }
 
-std::string WineExecutor::resolve_path(const std::string& path) {
+std::string WineExecutor::resolve_path(const WineConfiguration& cfg, const std::string& path) {
     if (path.empty()) return path;
     
+    PathResolver resolver(cfg.wine_prefix);
+    if (path.length() >= 3 && path[1] == ':' && std::isalpha(static_cast<unsigned char>(path[0]))) {
+        return resolver.windows_to_unix(path);
+    }
+    
     if (path[0] == '~') {
-        return Utils::get_home_directory() + path.substr(1);
+        return resolver.resolve_case(Utils::get_home_directory() + path.substr(1));
     }
     
     if (path[0] != '/') {
-        return Utils::get_current_directory() + "/" + path;
+        return resolver.resolve_case(Utils::get_current_directory() + "/" + path);
     }
     
-    return path;
+    return resolver.resolve_case(path);
 }
 
-void WineExecutor::setup_graphics_environment() {
-    if (config.graphics_driver == "x11") {
-        setenv("DISPLAY", ":0", 0);
-    } else if (config.graphics_driver == "wayland") {
-        setenv("WAYLAND_DISPLAY", "wayland-0", 0);
+void WineExecutor::setup_graphics_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env) {
+    if (cfg.graphics_driver == "x11") {
+        env.insert({"DISPLAY", ":0"});
+    } else if (cfg.graphics_driver == "wayland") {
+        env.insert({"WAYLAND_DISPLAY", "wayland-0"});
     }
     
-    if (config.enable_dxvk) {
-        setenv("DXVK_HUD", "devinfo,fps", 0);
+    if (cfg.enable_dxvk) {
+        env.insert({"DXVK_HUD", "devinfo,fps"});
     }
 }
 
-void WineExecutor::setup_audio_environment() {
-    if (config.audio_driver == "alsa") {
-        setenv("WINE_AUDIO_DRIVER", "alsa", 1);
-    } else if (config.audio_driver == "pulse") {
-        setenv("WINE_AUDIO_DRIVER", "pulse", 1);
-    } else if (config.audio_driver == "oss") {
-        setenv("WINE_AUDIO_DRIVER", "oss", 1);
+void WineExecutor::setup_audio_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env) {
+    if (cfg.audio_driver == "alsa") {
+        env["WINE_AUDIO_DRIVER"] = "alsa";
+    } else if (cfg.audio_driver == "pulse") {
+        env["WINE_AUDIO_DRIVER"] = "pulse";
+    } else if (cfg.audio_driver == "oss") {
+        env["WINE_AUDIO_DRIVER"] = "oss";
     }
 }
 
-char** WineExecutor::build_environment_array() {
-    std::vector<std::string> env_strings;
+std::shared_ptr<const LaunchEnvironment> WineExecutor::build_environment_array(const WineConfiguration& cfg) {
+    PhaseTimer timer(metrics, MetricPhase::ENVIRONMENT);
+    std::map<std::string, std::string> env;
+    
+    if (base_environment) {
+        env = *base_environment;
+    } else {
+        for (char** env_ptr = ::environ; env_ptr && *env_ptr; ++env_ptr) {
+            const char* entry = *env_ptr;
+            const char* eq = strchr(entry, '=');
+            if (eq && eq != entry) {
+                env.insert({std::string(entry, eq - entry), std::string(eq + 1)});
+            }
+        }
+    }
     
-    char** env_ptr = ::environ;
+    setup_environment(cfg, env);
+    setup_dll_overrides(cfg, env);
+    setup_graphics_environment(cfg, env);
+    setup_audio_environment(cfg, env);
     
-    while (env_ptr && *env_ptr) {
-        env_strings.push_back(*env_ptr);
-        env_ptr++;
+    size_t total = 0;
+    for (const auto& pair : env) {
+        total += pair.first.size() + pair.second.size() + 2;
     }
     
-    char** env_array = new char*[env_strings.size() + 1];
-    for (size_t i = 0; i < env_strings.size(); ++i) {
-        env_array[i] = strdup(env_strings[i].c_str());
+    auto launch_env = std::make_shared<LaunchEnvironment>();
+    launch_env->arena.assign(total, '\0');
+    launch_env->envp.reserve(env.size() + 1);
+    
+    char* cursor = launch_env->arena.data();
+    for (const auto& pair : env) {
+        launch_env->envp.push_back(cursor);
+        memcpy(cursor, pair.first.data(), pair.first.size());
+        cursor += pair.first.size();
+        *cursor++ = '=';
+        memcpy(cursor, pair.second.data(), pair.second.size());
+        cursor += pair.second.size();
+        *cursor++ = '\0';
     }
-    env_array[env_strings.size()] = nullptr;
+    launch_env->envp.push_back(nullptr);
+    launch_env->binary = find_in_path(cfg.wine_binary);
     
-    return env_array;
+    std::string profile_error;
+    if (!launch_env->profile.prepare(cfg.launch_profile, profile_error)) {
+        logger.error("Invalid launch profile '" + cfg.launch_profile.name + "': " + profile_error);
+        return nullptr;
+    }
+    
+    logger.debug("Built launch environment with " + std::to_string(env.size()) + " variables");
+    return launch_env;
 }
 
-void WineExecutor::free_environment_array(char** env) {
-    if (env == nullptr) return;
-    
-    for (char** ptr = env; *ptr != nullptr; ptr++) {
-        free(*ptr);
-    }
-    delete[] env;
+void WineExecutor::invalidate_environment() {
+    launch_environment.reset();
 }
 
-void WineExecutor::handle_child_process(const std::vector<std::string>& command) {
-    if (config.capture_stdout && stdout_pipe[1] != -1) {
-        dup2(stdout_pipe[1], STDOUT_FILENO);
-        close(stdout_pipe[0]);
-        close(stdout_pipe[1]);
+pid_t WineExecutor::spawn_process(const WineConfiguration& cfg, const LaunchEnvironment& env, char* const* envp,
+                                  const std::vector<std::string>& command,
+                                  int stdout_fd, int stderr_fd, int cgroup_fd, int& cgroup_error) {
+    std::vector<char*> argv;
+    argv.reserve(command.size() + 1);
+    for (const auto& arg : command) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
     }
+    argv.push_back(nullptr);
     
-    if (config.capture_stderr && stderr_pipe[1] != -1) {
-        dup2(stderr_pipe[1], STDERR_FILENO);
-        close(stderr_pipe[0]);
-        close(stderr_pipe[1]);
+    SpawnRequest request;
+    request.path = env.binary.c_str();
+    request.argv = argv.data();
+    request.envp = envp;
+    request.stdout_fd = stdout_fd;
+    request.stderr_fd = stderr_fd;
+    request.nice_level = cfg.nice_level;
+    request.cgroup_fd = cgroup_fd;
+    request.profile = &env.profile;
+    request.affinity = nullptr;
+    request.error = 0;
+    
+    // The manager may be pinned to housekeeping CPUs; children without their own affinity get the
+    // CPUs the manager started with, minus those.
+    cpu_set_t child_cpus;
+    std::vector<int> manager_cpus;
+    if (!env.profile.has_affinity && !cfg.manager_cpu_affinity.empty() &&
+        LaunchProfile::parse_cpu_list(cfg.manager_cpu_affinity, manager_cpus)) {
+        child_cpus = PreparedLaunchProfile::original_affinity();
+        for (int cpu : manager_cpus) {
+            CPU_CLR(cpu, &child_cpus);
+        }
+        request.affinity = CPU_COUNT(&child_cpus) > 0 ? &child_cpus : &PreparedLaunchProfile::original_affinity();
     }
-    
-    if (config.nice_level != 0) {
-        nice(config.nice_level);
+    request.cgroup_error = 0;
+    request.profile_failed = 0;
+    request.profile_error = 0;
+    
+    const size_t stack_size = 64 * 1024;
+    void* stack = mmap(nullptr, stack_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+    if (stack == MAP_FAILED) {
+        logger.error("Failed to allocate spawn stack");
+        return -1;
     }
     
-    std::vector<char*> argv;
-    for (const auto& arg : command) {
-        argv.push_back(const_cast<char*>(arg.c_str()));
+    sigset_t all_signals;
+    sigset_t previous_mask;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &previous_mask);
+    
+    pid_t pid = clone(spawn_child, static_cast<char*>(stack) + stack_size,
+                      CLONE_VM | CLONE_VFORK | SIGCHLD, &request);
+    int clone_error = errno;
+    
+    pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+    munmap(stack, stack_size);
+    cgroup_error = request.cgroup_error;
+    
+    if (pid == -1) {
+        logger.error("Failed to spawn process: " + std::string(strerror(clone_error)));
+        return -1;
     }
-    argv.push_back(nullptr);
     
-    char** env = build_environment_array();
+    if (request.error != 0) {
+        waitpid(pid, nullptr, 0);
+        logger.error("Failed to execute " + env.binary + ": " + strerror(request.error));
+        return -1;
+    }
     
-    execvpe(command[0].c_str(), argv.data(), env);
+    if (request.profile_failed != 0) {
+        logger.warning("Launch profile '" + cfg.launch_profile.name + "' could not apply " +
+                       PreparedLaunchProfile::describe_failure(request.profile_failed) + ": " +
+                       strerror(request.profile_error));
+    }
     
-    perror("execvpe failed");
-    exit(1);
+    return pid;
 }
 
 int WineExecutor::wait_for_process(pid_t pid) {
+    if (monitor.is_process_monitored(pid)) {
+        return monitor.wait_for_exit(pid);
+    }
+    
     int status;
     waitpid(pid, &status, 0);
     
@@ -284,68 +512,179 @@ int WineExecutor::wait_for_process(pid_t pid) {
     return -1;
 }
 
+std::shared_ptr<const LaunchEnvironment> WineExecutor::prepare_environment(const WineConfiguration& cfg) {
+    std::lock_guard<std::mutex> lock(execution_mutex);
+    return build_environment_array(cfg);
+}
+
 pid_t WineExecutor::execute(const std::string& exe_path, 
                            const std::vector<std::string>& arguments) {
-    std::lock_guard<std::mutex> lock(execution_mutex);
+    WineConfiguration launch_config;
+    std::shared_ptr<const LaunchEnvironment> env;
+    {
+        TraceSpan wait_span("wait execution_mutex", "lock");
+        std::lock_guard<std::mutex> lock(execution_mutex);
+        wait_span.end();
+        if (!launch_environment) {
+            launch_environment = build_environment_array(config);
+        }
+        launch_config = config;
+        env = launch_environment;
+    }
     
-    std::string resolved_path = resolve_path(exe_path);
+    return execute(launch_config, env, exe_path, arguments);
+}
+
+pid_t WineExecutor::execute(const WineConfiguration& cfg,
+                           const std::shared_ptr<const LaunchEnvironment>& env,
+                           const std::string& exe_path,
+                           const std::vector<std::string>& arguments) {
+    PhaseTimer launch_timer(metrics, MetricPhase::LAUNCH);
+    std::string resolved_path = resolve_path(cfg, exe_path);
     
-    if (!validate_executable(resolved_path)) {
+    PhaseTimer validate_timer(metrics, MetricPhase::VALIDATE);
+    if (!env || !validate_executable(resolved_path)) {
         return -1;
     }
+    validate_timer.stop();
     
     logger.info("Executing: " + resolved_path);
     
-    if (!execute_pre_launch_commands()) {
+    bool record_prefetch = prefetch && cfg.enable_prefetch && !prefetch->start(resolved_path, cfg.wine_prefix);
+    
+    std::vector<std::string> commands;
+    {
+        TraceSpan wait_span("wait execution_mutex", "lock");
+        std::lock_guard<std::mutex> lock(execution_mutex);
+        wait_span.end();
+        commands = pre_launch_commands;
+    }
+    
+    PhaseTimer pre_launch_timer(commands.empty() ? nullptr : metrics, MetricPhase::PRE_LAUNCH);
+    if (!execute_pre_launch_commands(commands, std::chrono::seconds(cfg.hook_timeout_seconds))) {
         logger.error("Pre-launch commands failed");
         return -1;
     }
+    pre_launch_timer.stop();
     
-    setup_environment();
-    setup_dll_overrides();
-    setup_graphics_environment();
-    setup_audio_environment();
     setup_registry_settings();
-    
-    if (!setup_pipes()) {
+    WineserverPool& server_pool = prefix_manager.get_server_pool();
+    PhaseTimer wineserver_timer(server_pool.is_enabled() ? metrics : nullptr, MetricPhase::WINESERVER);
+    server_pool.acquire(cfg.wine_prefix, cfg.wine_binary);
+    wineserver_timer.stop();
+    
+    int stdout_pipe[2] = {-1, -1};
+    int stderr_pipe[2] = {-1, -1};
+    if (!setup_pipes(cfg, stdout_pipe, stderr_pipe)) {
         return -1;
     }
     
-    std::vector<std::string> command = build_wine_command(resolved_path, arguments);
+    std::vector<std::string> command = build_wine_command(*env, resolved_path, arguments);
+    
+    std::vector<std::string> cache_variables;
+    std::vector<char*> cache_envp;
+    if (shader_cache && cfg.enable_shader_cache) {
+        std::string cache_dir = shader_cache->prepare(resolved_path, cfg.wine_prefix);
+        if (!cache_dir.empty()) {
+            cache_variables = ShaderCacheManager::environment(cache_dir);
+            cache_envp = extend_environment(env->envp, cache_variables);
+            logger.debug("Using shader cache " + cache_dir);
+        }
+    }
+    
+    std::vector<int> manager_cpus;
+    if (env->profile.has_affinity && LaunchProfile::parse_cpu_list(cfg.manager_cpu_affinity, manager_cpus)) {
+        for (int cpu : manager_cpus) {
+            if (CPU_ISSET(cpu, &env->profile.cpus)) {
+                logger.warning("Launch CPUs " + cfg.launch_profile.cpu_affinity + " overlap manager CPUs " +
+                               cfg.manager_cpu_affinity);
+                break;
+            }
+        }
+    }
+    
+    CgroupManager& cgroups = monitor.get_cgroups();
+    std::string cgroup_path;
+    int cgroup_fd = -1;
+    if (cfg.enable_cgroup) {
+        PhaseTimer cgroup_timer(metrics, MetricPhase::CGROUP);
+        cgroup_path = cgroups.create(Utils::get_filename(resolved_path), cfg);
+        if (!cgroup_path.empty() && (cgroup_fd = cgroups.open_procs(cgroup_path)) == -1) {
+            logger.warning("Cannot open " + cgroup_path + "/cgroup.procs: " + strerror(errno));
+            cgroups.remove(cgroup_path);
+            cgroup_path.clear();
+        }
+    }
+    
+    int cgroup_error = 0;
+    PhaseTimer spawn_timer(metrics, MetricPhase::SPAWN);
+    pid_t pid = spawn_process(cfg, *env, cache_envp.empty() ? env->envp.data() : cache_envp.data(), command,
+                              stdout_pipe[1], stderr_pipe[1], cgroup_fd, cgroup_error);
+    spawn_timer.stop();
+    if (cgroup_fd != -1) close(cgroup_fd);
     
-    pid_t pid = fork();
+    if (!cgroup_path.empty() && (pid == -1 || cgroup_error != 0)) {
+        if (pid != -1) {
+            logger.warning("Failed to place process in cgroup " + cgroup_path + ": " + strerror(cgroup_error));
+        }
+        cgroups.remove(cgroup_path);
+        cgroup_path.clear();
+    }
+    
+    if (stdout_pipe[1] != -1) close(stdout_pipe[1]);
+    if (stderr_pipe[1] != -1) close(stderr_pipe[1]);
+    stdout_pipe[1] = stderr_pipe[1] = -1;
     
     if (pid == -1) {
-        logger.error("Failed to fork process");
-        close_pipes();
+        close_pipes(stdout_pipe, stderr_pipe);
         return -1;
-    } else if (pid == 0) {
-        handle_child_process(command);
-    } else {
-        if (stdout_pipe[1] != -1) close(stdout_pipe[1]);
-        if (stderr_pipe[1] != -1) close(stderr_pipe[1]);
-        
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(execution_mutex);
         current_process_pid = pid;
         execution_active = true;
-        
-        ProcessInfo info;
-        info.pid = pid;
-        info.state = ProcessState::STARTING;
-        info.executable_path = resolved_path;
-        info.arguments = arguments;
-        info.start_time = std::chrono::system_clock::now();
-        info.exit_code = 0;
-        info.wine_prefix = config.wine_prefix;
-        info.architecture = config.architecture;
-        
-        monitor.add_process(pid, info);
-        
-        logger.info("Started process with PID: " + std::to_string(pid));
-        
-        return pid;
     }
     
-    return -1;
+    ProcessInfo info;
+    info.pid = pid;
+    info.state = ProcessState::STARTING;
+    info.executable_path = resolved_path;
+    info.arguments = arguments;
+    info.start_time = std::chrono::system_clock::now();
+    info.exit_code = 0;
+    info.memory_usage = 0;
+    info.cpu_usage = 0.0;
+    info.tree_process_count = 1;
+    info.tree_memory_usage = 0;
+    info.tree_cpu_usage = 0.0;
+    info.wine_prefix = cfg.wine_prefix;
+    info.architecture = cfg.architecture;
+    info.cgroup_path = cgroup_path;
+    if (env->profile.has_affinity) {
+        cpu_set_t actual;
+        if (sched_getaffinity(pid, sizeof(actual), &actual) == 0 && CPU_EQUAL(&actual, &env->profile.cpus)) {
+            info.assigned_cpus = env->profile.cpu_list;
+        }
+    }
+    info.offcore_threads = 0;
+    info.core_migrations = 0;
+    
+    monitor.add_process(pid, info);
+    
+    if (record_prefetch) {
+        prefetch->track(pid, resolved_path, cfg.wine_prefix);
+    }
+    
+    if (stdout_pipe[0] != -1 || stderr_pipe[0] != -1) {
+        monitor.attach_output(pid, stdout_pipe[0], stderr_pipe[0], cfg.log_file);
+        stdout_pipe[0] = stderr_pipe[0] = -1;
+    }
+    
+    logger.info("Started process with PID: " + std::to_string(pid) +
+                (cgroup_path.empty() ? "" : " in cgroup " + cgroup_path));
+    
+    return pid;
 }
 
 bool WineExecutor::execute_async(const std::string& exe_path, 
@@ -367,31 +706,45 @@ int WineExecutor::execute_sync(const std::string& exe_path,
     execute_post_launch_commands();
     
     execution_active = false;
-    close_pipes();
     
     logger.info("Process " + std::to_string(pid) + " exited with code: " + std::to_string(exit_code));
     
     return exit_code;
 }
 
+int WineExecutor::wait_for_exit(pid_t pid) {
+    return wait_for_process(pid);
+}
+
 void WineExecutor::add_environment_variable(const std::string& key, const std::string& value) {
     std::lock_guard<std::mutex> lock(execution_mutex);
     custom_environment[key] = value;
+    invalidate_environment();
     logger.debug("Added environment variable: " + key + "=" + value);
 }
 
 void WineExecutor::remove_environment_variable(const std::string& key) {
     std::lock_guard<std::mutex> lock(execution_mutex);
     custom_environment.erase(key);
+    invalidate_environment();
     logger.debug("Removed environment variable: " + key);
 }
 
 void WineExecutor::clear_environment_variables() {
     std::lock_guard<std::mutex> lock(execution_mutex);
     custom_environment.clear();
+    invalidate_environment();
     logger.debug("Cleared custom environment variables");
 }
 
+void WineExecutor::set_base_environment(std::shared_ptr<const std::map<std::string, std::string>> env) {
+    std::lock_guard<std::mutex> lock(execution_mutex);
+    if (env != base_environment) {
+        base_environment = std::move(env);
+        invalidate_environment();
+    }
+}
+
 void WineExecutor::add_pre_launch_command(const std::string& command) {
     std::lock_guard<std::mutex> lock(execution_mutex);
     pre_launch_commands.push_back(command);
@@ -428,8 +781,9 @@ void WineExecutor::terminate_current_process() {
 }
 
 std::string WineExecutor::get_wine_version() {
-    std::string cmd = config.wine_binary + " --version 2>&1";
-    return Utils::execute_command(cmd);
+    CommandOptions options;
+    options.timeout = std::chrono::seconds(30);
+    return Utils::run_command({config.wine_binary, "--version"}, options).output;
 }
 
 std::vector<std::string> WineExecutor::get_installed_dlls() {
@@ -452,12 +806,17 @@ std::vector<std::string> WineExecutor::get_installed_dlls() {
 bool WineExecutor::install_component(const std::string& component) {
     logger.info("Installing component: " + component);
     
-    std::string cmd = "WINEPREFIX=" + config.wine_prefix + " winetricks -q " + component + " 2>&1";
-    std::string output = Utils::execute_command(cmd);
+    CommandOptions options;
+    options.environment["WINEPREFIX"] = config.wine_prefix;
+    options.timeout = WinetricksManager::DEFAULT_INSTALL_TIMEOUT;
+    CommandResult result = Utils::run_command({"winetricks", "-q", component}, options);
     
-    logger.debug("Install output: " + output);
+    logger.debug("Install output: " + result.output);
+    if (result.timed_out) {
+        logger.error("winetricks timed out installing " + component);
+    }
     
-    return true;
+    return result.exit_code == 0;
 }
 
 std::map<std::string, std::string> WineExecutor::get_wine_info() {
@@ -473,14 +832,30 @@ std::map<std::string, std::string> WineExecutor::get_wine_info() {
 }
 
 RegistryManager::RegistryManager(const std::string& prefix, Logger& log)
-    : prefix_path(prefix), logger(log) {
+    : prefix_path(prefix), logger(log), server_pool(nullptr), metrics(nullptr), transaction_depth(0),
+      pending_changes(0), rollback_only(false),
+      commits(0), committed_changes(0), failed_commits(0), last_commit_ms(0.0), total_commit_ms(0.0) {
     logger.info("RegistryManager initialized for prefix: " + prefix);
 }
 
 RegistryManager::~RegistryManager() {
+    if (transaction_depth > 0 && pending_changes > 0) {
+        logger.warning("Discarding " + std::to_string(pending_changes) + " uncommitted registry changes");
+    }
     logger.info("RegistryManager shutting down");
 }
 
+void RegistryManager::set_server_pool(WineserverPool* pool, const std::string& binary) {
+    server_pool = pool;
+    wine_binary = binary;
+}
+
+void RegistryManager::warm_server() {
+    if (server_pool) {
+        server_pool->acquire(prefix_path, wine_binary);
+    }
+}
+
 std::string RegistryManager::get_registry_file_path(const std::string& hive) {
     std::string filename;
     
@@ -488,8 +863,6 @@ std::string RegistryManager::get_registry_file_path(const std::string& hive) {
         filename = "system.reg";
     } else if (hive == "HKEY_CURRENT_USER" || hive == "HKCU") {
         filename = "user.reg";
-    } else if (hive == "HKEY_USERS" || hive == "HKU") {
-        filename = "userdef.reg";
     } else {
         return "";
     }
@@ -497,37 +870,118 @@ std::string RegistryManager::get_registry_file_path(const std::string& hive) {
     return Utils::join_paths(prefix_path, filename);
 }
 
+std::shared_ptr<RegistryHive> RegistryManager::load_hive(const std::string& file_path) {
+    auto now = std::chrono::steady_clock::now();
+    std::shared_ptr<RegistryHive> current;
+    
+    {
+        std::lock_guard<std::mutex> lock(hive_mutex);
+        auto it = hives.find(file_path);
+        if (it != hives.end()) {
+            current = it->second.hive;
+            if (now - it->second.checked < std::chrono::seconds(1)) {
+                return current;
+            }
+            it->second.checked = now;
+        }
+    }
+    
+    if (current && !current->is_stale()) {
+        return current;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    auto hive = std::make_shared<RegistryHive>();
+    PhaseTimer timer(metrics, MetricPhase::REGISTRY_LOAD);
+    bool loaded = hive->load(file_path);
+    timer.stop();
+    if (loaded) {
+        double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        logger.debug("Indexed registry hive " + file_path + ": " + std::to_string(hive->key_count()) +
+                     " keys, " + std::to_string(hive->value_count()) + " values in " +
+                     std::to_string(elapsed) + " ms");
+    }
+    
+    std::lock_guard<std::mutex> lock(hive_mutex);
+    hives[file_path] = {hive, now};
+    return hive;
+}
+
+std::vector<RegistryManager::HiveTarget> RegistryManager::resolve_key(const std::string& key) {
+    // Wine gives the prefix's only user this fixed SID; HKCU is a link to HKU\<sid>.
+    static const std::string USER_SID = "S-1-5-21-0-0-0-1000";
+    std::vector<HiveTarget> targets;
+    
+    size_t slash = key.find('\\');
+    std::string root = key.substr(0, slash);
+    std::string subkey = slash == std::string::npos ? "" : key.substr(slash + 1);
+    
+    if (root == "HKEY_USERS" || root == "HKU") {
+        size_t user_end = subkey.find('\\');
+        std::string user = subkey.substr(0, user_end);
+        std::string rest = user_end == std::string::npos ? "" : subkey.substr(user_end + 1);
+        const char* file = nullptr;
+        if (RegistryHive::compare_names(user, false, ".Default", false) == 0) {
+            file = "userdef.reg";
+        } else if (RegistryHive::compare_names(user, false, USER_SID, false) == 0) {
+            file = "user.reg";
+        }
+        if (file) {
+            targets.push_back({load_hive(Utils::join_paths(prefix_path, file)), root + "\\" + user, rest, ""});
+        }
+        return targets;
+    }
+    
+    if (root == "HKEY_CLASSES_ROOT" || root == "HKCR") {
+        std::string classes = subkey.empty() ? "Software\\Classes" : "Software\\Classes\\" + subkey;
+        for (const char* file : {"user.reg", "system.reg"}) {
+            targets.push_back({load_hive(Utils::join_paths(prefix_path, file)), root, classes, "Software\\Classes"});
+        }
+        return targets;
+    }
+    
+    std::string file_path = get_registry_file_path(root);
+    if (file_path.empty()) {
+        // Keys without a root key name are looked up as hive-relative paths in every hive.
+        for (const char* file : {"system.reg", "user.reg", "userdef.reg"}) {
+            targets.push_back({load_hive(Utils::join_paths(prefix_path, file)), "", key, ""});
+        }
+        return targets;
+    }
+    
+    targets.push_back({load_hive(file_path), root, subkey, ""});
+    return targets;
+}
+
+bool RegistryManager::is_deleted(const std::string& key) const {
+    if (deleted_keys.empty()) {
+        return false;
+    }
+    
+    for (size_t pos = key.size(); pos != std::string::npos && pos > 0; pos = key.rfind('\\', pos - 1)) {
+        if (deleted_keys.count(key.substr(0, pos))) {
+            return true;
+        }
+    }
+    return false;
+}
+
 bool RegistryManager::parse_registry_file(const std::string& file_path) {
-    std::ifstream file(file_path);
-    if (!file.is_open()) {
+    RegistryHive hive;
+    if (!hive.load(file_path)) {
         logger.error("Failed to open registry file: " + file_path);
         return false;
     }
     
-    std::string line;
-    std::string current_key;
-    
-    while (std::getline(file, line)) {
-        if (line.empty() || line[0] == '#') continue;
-        
-        if (line[0] == '[') {
-            size_t end = line.find(']');
-            if (end != std::string::npos) {
-                current_key = line.substr(1, end - 1);
-            }
-        } else if (!current_key.empty() && line.find('=') != std::string::npos) {
-            size_t eq_pos = line.find('=');
-            std::string name = line.substr(0, eq_pos);
-            std::string value = line.substr(eq_pos + 1);
-            
-            name.erase(0, name.find_first_not_of(" \t\""));
-            name.erase(name.find_last_not_of(" \t\"") + 1);
-            value.erase(0, value.find_first_not_of(" \t\""));
-            value.erase(value.find_last_not_of(" \t\"") + 1);
-            
-            registry_cache[current_key][name] = value;
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    hive.for_each_value([this](const std::string& key, const std::string& name, const std::string& value) {
+        registry_cache[key][name] = value;
+        deleted_keys.erase(key);
+        auto it = deleted_values.find(key);
+        if (it != deleted_values.end()) {
+            it->second.erase(name);
         }
-    }
+    });
     
     return true;
 }
@@ -582,39 +1036,293 @@ std::string RegistryManager::unescape_registry_value(const std::string& value) {
 }
 
 bool RegistryManager::execute_regedit_command(const std::string& command) {
-    std::string temp_file = "/tmp/wine_regedit_" + std::to_string(getpid()) + ".reg";
-    Utils::write_file(temp_file, command);
+    char temp_file[] = "/tmp/wine_regedit_XXXXXX.reg";
+    int fd = mkstemps(temp_file, 4);
+    if (fd == -1) {
+        logger.error("Failed to create registry import file: " + std::string(strerror(errno)));
+        return false;
+    }
+    
+    bool written = true;
+    for (size_t offset = 0; offset < command.size();) {
+        ssize_t n = write(fd, command.data() + offset, command.size() - offset);
+        if (n <= 0) {
+            if (n == -1 && errno == EINTR) continue;
+            written = false;
+            break;
+        }
+        offset += static_cast<size_t>(n);
+    }
+    close(fd);
+    
+    if (!written) {
+        logger.error("Failed to write registry import file: " + std::string(temp_file));
+        Utils::delete_file(temp_file);
+        return false;
+    }
     
-    std::string cmd = "WINEPREFIX=" + prefix_path + " wine regedit " + temp_file + " 2>&1";
-    std::string output = Utils::execute_command(cmd);
+    warm_server();
+    
+    CommandResult result = run_regedit({temp_file});
     
     Utils::delete_file(temp_file);
     
-    return true;
+    return result.exit_code == 0;
 }
 
-bool RegistryManager::set_value(const std::string& key, const std::string& name, 
-                               const std::string& value) {
+CommandResult RegistryManager::run_regedit(const std::vector<std::string>& args) {
+    std::vector<std::string> argv = {"wine", "regedit"};
+    argv.insert(argv.end(), args.begin(), args.end());
+    
+    CommandOptions options;
+    options.environment["WINEPREFIX"] = prefix_path;
+    options.timeout = std::chrono::minutes(2);
+    
+    CommandResult result = Utils::run_command(argv, options);
+    if (result.timed_out) {
+        logger.error("regedit timed out for prefix: " + prefix_path);
+    }
+    return result;
+}
+
+std::string RegistryManager::format_value_name(const std::string& name) {
+    return name == "@" ? name : "\"" + escape_registry_value(name) + "\"";
+}
+
+std::unique_lock<std::mutex> RegistryManager::lock_writer() {
+    std::unique_lock<std::mutex> lock(commit_mutex);
+    writer_cv.wait(lock, [this] {
+        return transaction_depth == 0 || transaction_owner == std::this_thread::get_id();
+    });
+    return lock;
+}
+
+void RegistryManager::save_key_locked(const std::string& key) {
+    if (pending_undo.count(key)) {
+        return;
+    }
+    
+    SavedKey saved;
+    auto cache_it = registry_cache.find(key);
+    saved.cached = cache_it != registry_cache.end();
+    if (saved.cached) {
+        saved.values = cache_it->second;
+    }
+    auto deleted_it = deleted_values.find(key);
+    saved.has_deleted_values = deleted_it != deleted_values.end();
+    if (saved.has_deleted_values) {
+        saved.deleted_values = deleted_it->second;
+    }
+    saved.deleted = deleted_keys.count(key) > 0;
+    pending_undo.emplace(key, std::move(saved));
+}
+
+void RegistryManager::restore_keys_locked(const std::map<std::string, SavedKey, RegistryNameLess>& saved) {
+    for (const auto& pair : saved) {
+        const SavedKey& state = pair.second;
+        if (state.cached) {
+            registry_cache[pair.first] = state.values;
+        } else {
+            registry_cache.erase(pair.first);
+        }
+        if (state.has_deleted_values) {
+            deleted_values[pair.first] = state.deleted_values;
+        } else {
+            deleted_values.erase(pair.first);
+        }
+        if (state.deleted) {
+            deleted_keys.insert(pair.first);
+        } else {
+            deleted_keys.erase(pair.first);
+        }
+    }
+}
+
+void RegistryManager::queue_change(const std::string& header, const std::string& line) {
+    if (header != pending_key || pending_changes == 0) {
+        pending_import += "\n[" + header + "]\n";
+        pending_key = header;
+    }
+    pending_import += line;
+    pending_changes++;
+}
+
+// Called with commit_mutex held through lock_writer(), so no other thread stages changes meanwhile.
+bool RegistryManager::flush_pending() {
+    std::string import;
+    size_t changes = 0;
+    std::map<std::string, SavedKey, RegistryNameLess> undo;
+    
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        if (transaction_depth > 0 || pending_changes == 0) {
+            return true;
+        }
+        import = "REGEDIT4\n" + pending_import;
+        changes = pending_changes;
+        undo.swap(pending_undo);
+        pending_import.clear();
+        pending_key.clear();
+        pending_changes = 0;
+    }
+    
+    auto start = std::chrono::steady_clock::now();
+    PhaseTimer timer(metrics, MetricPhase::REGISTRY_COMMIT);
+    bool success = execute_regedit_command(import);
+    timer.stop();
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        if (success) {
+            commits++;
+            committed_changes += changes;
+            last_commit_ms = elapsed;
+            total_commit_ms += elapsed;
+        } else {
+            // The overlay holds values regedit never wrote; put back what the touched keys held before.
+            failed_commits++;
+            restore_keys_locked(undo);
+        }
+    }
+    
+    if (success) {
+        logger.debug("Committed " + std::to_string(changes) + " registry changes in " +
+                     std::to_string(static_cast<int>(elapsed)) + " ms");
+    } else {
+        logger.error("Failed to commit " + std::to_string(changes) + " registry changes");
+    }
+    return success;
+}
+
+void RegistryManager::begin_transaction() {
+    std::unique_lock<std::mutex> writer = lock_writer();
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    
+    if (transaction_depth++ == 0) {
+        transaction_owner = std::this_thread::get_id();
+        rollback_only = false;
+        logger.debug("Began registry transaction");
+    }
+}
+
+bool RegistryManager::commit_transaction() {
+    std::unique_lock<std::mutex> writer = lock_writer();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        if (transaction_depth == 0) {
+            logger.warning("No registry transaction to commit");
+            return false;
+        }
+        if (--transaction_depth > 0) {
+            return !rollback_only;
+        }
+        transaction_owner = std::thread::id();
+        if (rollback_only) {
+            logger.warning("Registry transaction was rolled back by a nested transaction");
+            discard_transaction_locked();
+            writer_cv.notify_all();
+            return false;
+        }
+    }
+    
+    bool success = flush_pending();
+    writer_cv.notify_all();
+    return success;
+}
+
+void RegistryManager::rollback_transaction() {
+    std::unique_lock<std::mutex> writer = lock_writer();
     std::lock_guard<std::mutex> lock(registry_mutex);
     
-    registry_cache[key][name] = value;
+    if (transaction_depth == 0) {
+        return;
+    }
+    if (--transaction_depth > 0) {
+        rollback_only = true;
+        logger.debug("Rolled back nested registry transaction, enclosing transaction will roll back");
+        return;
+    }
     
-    logger.debug("Set registry value: " + key + "\\" + name + " = " + value);
+    discard_transaction_locked();
+    writer_cv.notify_all();
+}
+
+void RegistryManager::discard_transaction_locked() {
+    restore_keys_locked(pending_undo);
+    
+    logger.info("Rolled back " + std::to_string(pending_changes) + " registry changes");
+    transaction_depth = 0;
+    transaction_owner = std::thread::id();
+    rollback_only = false;
+    pending_import.clear();
+    pending_key.clear();
+    pending_undo.clear();
+    pending_changes = 0;
+}
+
+bool RegistryManager::in_transaction() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    return transaction_depth > 0;
+}
+
+RegistryTransactionStats RegistryManager::get_transaction_stats() {
+    std::lock_guard<std::mutex> lock(registry_mutex);
     
-    std::string reg_command = "REGEDIT4\n\n[" + key + "]\n\"" + name + "\"=\"" + 
-                             escape_registry_value(value) + "\"\n";
+    RegistryTransactionStats stats;
+    stats.commits = commits;
+    stats.committed_changes = committed_changes;
+    stats.failed_commits = failed_commits;
+    stats.pending_changes = pending_changes;
+    stats.last_commit_ms = last_commit_ms;
+    stats.average_commit_ms = commits > 0 ? total_commit_ms / static_cast<double>(commits) : 0.0;
+    return stats;
+}
+
+bool RegistryManager::set_value(const std::string& key, const std::string& name, 
+                               const std::string& value) {
+    std::unique_lock<std::mutex> writer = lock_writer();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        
+        save_key_locked(key);
+        registry_cache[key][name] = value;
+        deleted_keys.erase(key);
+        auto deleted_it = deleted_values.find(key);
+        if (deleted_it != deleted_values.end()) {
+            deleted_it->second.erase(name);
+        }
+        
+        logger.debug("Set registry value: " + key + "\\" + name + " = " + value);
+        
+        queue_change(key, format_value_name(name) + "=\"" + escape_registry_value(value) + "\"\n");
+    }
     
-    return execute_regedit_command(reg_command);
+    return flush_pending();
 }
 
 std::string RegistryManager::get_value(const std::string& key, const std::string& name) {
-    std::lock_guard<std::mutex> lock(registry_mutex);
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        
+        auto key_it = registry_cache.find(key);
+        if (key_it != registry_cache.end()) {
+            auto value_it = key_it->second.find(name);
+            if (value_it != key_it->second.end()) {
+                return value_it->second;
+            }
+        }
+        
+        auto deleted_it = deleted_values.find(key);
+        if (is_deleted(key) || (deleted_it != deleted_values.end() && deleted_it->second.count(name))) {
+            return "";
+        }
+    }
     
-    auto key_it = registry_cache.find(key);
-    if (key_it != registry_cache.end()) {
-        auto value_it = key_it->second.find(name);
-        if (value_it != key_it->second.end()) {
-            return value_it->second;
+    std::string value;
+    for (const auto& target : resolve_key(key)) {
+        if (target.hive->get_value(target.subkey, name, value)) {
+            return value;
         }
     }
     
@@ -622,72 +1330,158 @@ std::string RegistryManager::get_value(const std::string& key, const std::string
 }
 
 bool RegistryManager::delete_value(const std::string& key, const std::string& name) {
-    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::unique_lock<std::mutex> writer = lock_writer();
+    bool existed = false;
+    
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        auto key_it = registry_cache.find(key);
+        if (key_it != registry_cache.end()) {
+            save_key_locked(key);
+            key_it->second.erase(name);
+            existed = true;
+        }
+    }
     
-    auto key_it = registry_cache.find(key);
-    if (key_it != registry_cache.end()) {
-        key_it->second.erase(name);
+    for (const auto& target : resolve_key(key)) {
+        existed = target.hive->key_exists(target.subkey) || existed;
+    }
+    
+    if (!existed) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        save_key_locked(key);
+        deleted_values[key].insert(name);
         logger.debug("Deleted registry value: " + key + "\\" + name);
-        return true;
+        queue_change(key, format_value_name(name) + "=-\n");
     }
     
-    return false;
+    return flush_pending();
 }
 
 bool RegistryManager::create_key(const std::string& key) {
-    std::lock_guard<std::mutex> lock(registry_mutex);
+    std::unique_lock<std::mutex> writer = lock_writer();
+    if (key_exists(key)) {
+        return true;
+    }
     
-    if (registry_cache.find(key) == registry_cache.end()) {
-        registry_cache[key] = std::map<std::string, std::string>();
-        logger.debug("Created registry key: " + key);
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
         
-        std::string reg_command = "REGEDIT4\n\n[" + key + "]\n";
-        return execute_regedit_command(reg_command);
+        save_key_locked(key);
+        registry_cache[key];
+        deleted_keys.erase(key);
+        logger.debug("Created registry key: " + key);
+        queue_change(key, "");
     }
     
-    return true;
+    return flush_pending();
 }
 
 bool RegistryManager::delete_key(const std::string& key) {
-    std::lock_guard<std::mutex> lock(registry_mutex);
-    
-    registry_cache.erase(key);
-    logger.debug("Deleted registry key: " + key);
+    std::unique_lock<std::mutex> writer = lock_writer();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        
+        save_key_locked(key);
+        auto it = registry_cache.lower_bound(key);
+        while (it != registry_cache.end() &&
+               RegistryHive::compare_names(it->first, false, key, false, true) == 0) {
+            if (it->first.size() == key.size() || it->first[key.size()] == '\\') {
+                save_key_locked(it->first);
+                it = registry_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        deleted_keys.insert(key);
+        logger.debug("Deleted registry key: " + key);
+        queue_change("-" + key, "");
+    }
     
-    std::string reg_command = "REGEDIT4\n\n[-" + key + "]\n";
-    return execute_regedit_command(reg_command);
+    return flush_pending();
 }
 
 bool RegistryManager::key_exists(const std::string& key) {
-    std::lock_guard<std::mutex> lock(registry_mutex);
-    return registry_cache.find(key) != registry_cache.end();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        if (registry_cache.find(key) != registry_cache.end()) {
+            return true;
+        }
+        if (is_deleted(key)) {
+            return false;
+        }
+    }
+    
+    for (const auto& target : resolve_key(key)) {
+        if (target.hive->key_exists(target.subkey)) {
+            return true;
+        }
+    }
+    
+    return false;
 }
 
 std::vector<std::string> RegistryManager::list_keys(const std::string& parent_key) {
+    std::set<std::string, RegistryNameLess> keys;
+    std::vector<HiveTarget> targets = resolve_key(parent_key);
+    
     std::lock_guard<std::mutex> lock(registry_mutex);
-    std::vector<std::string> keys;
     
-    for (const auto& pair : registry_cache) {
-        if (pair.first.find(parent_key) == 0) {
-            keys.push_back(pair.first);
+    for (auto it = registry_cache.lower_bound(parent_key);
+         it != registry_cache.end() &&
+         RegistryHive::compare_names(it->first, false, parent_key, false, true) == 0; ++it) {
+        keys.insert(it->first);
+    }
+    
+    for (const auto& target : targets) {
+        for (const auto& name : target.hive->list_keys(target.subkey)) {
+            std::string relative = target.base.empty() ? name
+                                                       : name.substr(std::min(name.size(), target.base.size() + 1));
+            std::string key = target.root.empty() ? relative : target.root + "\\" + relative;
+            if (!is_deleted(key)) {
+                keys.insert(key);
+            }
         }
     }
     
-    return keys;
+    return std::vector<std::string>(keys.begin(), keys.end());
 }
 
 std::vector<std::string> RegistryManager::list_values(const std::string& key) {
+    std::set<std::string, RegistryNameLess> values;
+    std::vector<HiveTarget> targets = resolve_key(key);
+    
     std::lock_guard<std::mutex> lock(registry_mutex);
-    std::vector<std::string> values;
     
     auto it = registry_cache.find(key);
     if (it != registry_cache.end()) {
         for (const auto& pair : it->second) {
-            values.push_back(pair.first);
+            values.insert(pair.first);
+        }
+    }
+    
+    if (!is_deleted(key)) {
+        for (const auto& target : targets) {
+            for (const auto& name : target.hive->list_values(target.subkey)) {
+                values.insert(name);
+            }
+        }
+    }
+    
+    auto deleted_it = deleted_values.find(key);
+    if (deleted_it != deleted_values.end()) {
+        for (const auto& name : deleted_it->second) {
+            if (it == registry_cache.end() || it->second.find(name) == it->second.end()) {
+                values.erase(name);
+            }
         }
     }
     
-    return values;
+    return std::vector<std::string>(values.begin(), values.end());
 }
 
 bool RegistryManager::import_registry_file(const std::string& reg_file) {
@@ -697,46 +1491,64 @@ bool RegistryManager::import_registry_file(const std::string& reg_file) {
     }
     
     logger.info("Importing registry file: " + reg_file);
+    std::unique_lock<std::mutex> writer = lock_writer();
+    warm_server();
     
-    std::string cmd = "WINEPREFIX=" + prefix_path + " wine regedit " + reg_file + " 2>&1";
-    std::string output = Utils::execute_command(cmd);
+    CommandResult result = run_regedit({reg_file});
     
-    logger.debug("Import output: " + output);
+    logger.debug("Import output: " + result.output);
     
     return parse_registry_file(reg_file);
 }
 
 bool RegistryManager::export_registry_file(const std::string& reg_file, const std::string& key) {
     logger.info("Exporting registry to file: " + reg_file);
+    warm_server();
     
-    std::string cmd = "WINEPREFIX=" + prefix_path + " wine regedit /E " + reg_file;
+    std::vector<std::string> args = {"/E", reg_file};
     if (!key.empty()) {
-        cmd += " \"" + key + "\"";
+        args.push_back(key);
     }
-    cmd += " 2>&1";
     
-    std::string output = Utils::execute_command(cmd);
-    logger.debug("Export output: " + output);
+    CommandResult result = run_regedit(args);
+    logger.debug("Export output: " + result.output);
     
     return Utils::file_exists(reg_file);
 }
 
 void RegistryManager::clear_cache() {
-    std::lock_guard<std::mutex> lock(registry_mutex);
-    registry_cache.clear();
+    std::unique_lock<std::mutex> writer = lock_writer();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry_cache.clear();
+        deleted_values.clear();
+        deleted_keys.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(hive_mutex);
+        hives.clear();
+    }
     logger.debug("Cleared registry cache");
 }
 
 void RegistryManager::refresh_cache() {
-    std::lock_guard<std::mutex> lock(registry_mutex);
-    registry_cache.clear();
+    std::unique_lock<std::mutex> writer = lock_writer();
+    {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry_cache.clear();
+        deleted_values.clear();
+        deleted_keys.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(hive_mutex);
+        for (auto& pair : hives) {
+            pair.second.checked = std::chrono::steady_clock::time_point();
+        }
+    }
     
     std::vector<std::string> reg_files = {"system.reg", "user.reg", "userdef.reg"};
     for (const auto& file : reg_files) {
-        std::string file_path = Utils::join_paths(prefix_path, file);
-        if (Utils::file_exists(file_path)) {
-            parse_registry_file(file_path);
-        }
+        load_hive(Utils::join_paths(prefix_path, file));
     }
     
     logger.debug("Refreshed registry cache");
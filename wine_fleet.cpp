@@ -0,0 +1,419 @@
+#include "wine_wrapper.hpp"
+#include <spawn.h>
+#include <cerrno>
+#include <cmath>
+
+namespace WineWrapper {
+
+namespace {
+
+const char* const SSH_SCHEME = "ssh://";
+const char* const SSH_OPTIONS[] = {"-o", "BatchMode=yes", "-o", "ConnectTimeout=5"};
+
+const std::chrono::seconds STATUS_TTL(2);
+const std::chrono::seconds TUNNEL_TIMEOUT(10);
+const int STATUS_TIMEOUT_MS = 3000;
+const std::chrono::seconds MKDIR_TIMEOUT(30);
+const std::chrono::hours SYNC_TIMEOUT(1);
+
+const uint64_t LOW_MEMORY_KB = 512 * 1024;
+const double LOW_MEMORY_PENALTY = 1.0;
+const double WARM_BONUS = 0.25;
+const double SYNC_PENALTY = 1.0;
+
+std::string runtime_directory() {
+    const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+    return runtime_dir && *runtime_dir && Utils::directory_exists(runtime_dir) ? runtime_dir : "/tmp";
+}
+
+std::set<std::string> split_lines(const std::string& text) {
+    std::set<std::string> lines;
+    std::istringstream input(text);
+    std::string line;
+    while (std::getline(input, line)) {
+        if (!line.empty()) lines.insert(line);
+    }
+    return lines;
+}
+
+double number(const std::map<std::string, std::string>& status, const std::string& key) {
+    auto it = status.find(key);
+    return it != status.end() ? atof(it->second.c_str()) : 0.0;
+}
+
+std::string shell_quote(const std::string& value) {
+    std::string quoted = "'";
+    for (char c : value) {
+        quoted += c == '\'' ? std::string("'\\''") : std::string(1, c);
+    }
+    return quoted + "'";
+}
+
+pid_t spawn_tunnel(const std::vector<std::string>& args) {
+    std::vector<char*> argv;
+    for (const auto& arg : args) {
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+    argv.push_back(nullptr);
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    
+    pid_t pid = -1;
+    int result = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), ::environ);
+    posix_spawn_file_actions_destroy(&actions);
+    
+    if (result != 0) {
+        errno = result;
+        return -1;
+    }
+    return pid;
+}
+
+}
+
+FleetCoordinator::FleetCoordinator(Logger& log) : logger(log), metrics(nullptr) {
+}
+
+FleetCoordinator::~FleetCoordinator() {
+    for (auto& pair : nodes) {
+        close_tunnel(pair.second);
+    }
+}
+
+bool FleetCoordinator::parse_node(const std::string& spec, FleetNode& node) {
+    size_t equals = spec.find('=');
+    if (equals == std::string::npos || equals == 0 || equals + 1 == spec.size()) {
+        return false;
+    }
+    
+    node = FleetNode();
+    node.name = spec.substr(0, equals);
+    for (char c : node.name) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '-' && c != '_' && c != '.') return false;
+    }
+    
+    std::string target = spec.substr(equals + 1);
+    if (target.compare(0, strlen(SSH_SCHEME), SSH_SCHEME) != 0) {
+        node.socket = target;
+        return target[0] == '/';
+    }
+    
+    target = target.substr(strlen(SSH_SCHEME));
+    size_t slash = target.find('/');
+    node.host = target.substr(0, slash);
+    node.remote_socket = slash == std::string::npos
+        ? "/run/user/" + std::to_string(getuid()) + "/wine-appd.sock"
+        : target.substr(slash);
+    node.socket = runtime_directory() + "/wine-fleet-" + std::to_string(getuid()) + "-" + node.name + ".sock";
+    return !node.host.empty() && node.host[0] != '-';
+}
+
+void FleetCoordinator::configure(const std::string& specs) {
+    std::lock_guard<std::mutex> refresh_lock(refresh_mutex);
+    std::lock_guard<std::mutex> lock(fleet_mutex);
+    if (specs == node_specs) {
+        return;
+    }
+    
+    for (auto& pair : nodes) {
+        close_tunnel(pair.second);
+    }
+    nodes.clear();
+    node_specs = specs;
+    
+    std::istringstream entries(specs);
+    std::string entry;
+    while (std::getline(entries, entry, ',')) {
+        entry.erase(0, entry.find_first_not_of(" \t"));
+        entry.erase(entry.find_last_not_of(" \t") + 1);
+        if (entry.empty()) continue;
+        
+        FleetNode node;
+        if (!parse_node(entry, node)) {
+            logger.warning("Ignoring invalid fleet node '" + entry + "'");
+            continue;
+        }
+        nodes[node.name] = node;
+    }
+    
+    if (!nodes.empty()) {
+        logger.info("Fleet configured with " + std::to_string(nodes.size()) + " nodes");
+    }
+}
+
+bool FleetCoordinator::is_enabled() {
+    std::lock_guard<std::mutex> lock(fleet_mutex);
+    return !nodes.empty();
+}
+
+bool FleetCoordinator::open_tunnel(FleetNode& node) {
+    if (node.host.empty()) {
+        return true;
+    }
+    if (node.tunnel_pid > 0 && waitpid(node.tunnel_pid, nullptr, WNOHANG) == 0) {
+        return true;
+    }
+    
+    unlink(node.socket.c_str());
+    std::vector<std::string> args = {"ssh", "-N"};
+    args.insert(args.end(), std::begin(SSH_OPTIONS), std::end(SSH_OPTIONS));
+    args.insert(args.end(), {"-o", "ExitOnForwardFailure=yes", "-o", "StreamLocalBindUnlink=yes",
+                             "-L", node.socket + ":" + node.remote_socket, node.host});
+    
+    node.tunnel_pid = spawn_tunnel(args);
+    if (node.tunnel_pid == -1) {
+        logger.warning("Cannot start ssh for fleet node " + node.name + ": " + strerror(errno));
+        return false;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() + TUNNEL_TIMEOUT;
+    while (std::chrono::steady_clock::now() < deadline) {
+        DaemonClient probe;
+        if (probe.connect(node.socket)) {
+            return true;
+        }
+        if (waitpid(node.tunnel_pid, nullptr, WNOHANG) == node.tunnel_pid) {
+            node.tunnel_pid = -1;
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    
+    logger.warning("Cannot forward daemon socket of fleet node " + node.name + " (" + node.host + ":" +
+                   node.remote_socket + ")");
+    close_tunnel(node);
+    return false;
+}
+
+void FleetCoordinator::close_tunnel(FleetNode& node) {
+    if (node.tunnel_pid <= 0) {
+        return;
+    }
+    
+    kill(node.tunnel_pid, SIGTERM);
+    waitpid(node.tunnel_pid, nullptr, 0);
+    unlink(node.socket.c_str());
+    node.tunnel_pid = -1;
+}
+
+bool FleetCoordinator::query_node(FleetNode& node) {
+    DaemonClient client;
+    DaemonMessage status;
+    node.refreshed = std::chrono::steady_clock::now();
+    node.reachable = open_tunnel(node) && client.connect(node.socket) && client.set_timeout(STATUS_TIMEOUT_MS) &&
+                     client.node_status(status);
+    if (!node.reachable) {
+        return false;
+    }
+    
+    node.status = status;
+    node.cpu_count = static_cast<size_t>(std::max(1.0, number(status, "cpu_count")));
+    node.load = number(status, "load_1min") / static_cast<double>(node.cpu_count);
+    node.memory_available = static_cast<uint64_t>(number(status, "memory_available"));
+    node.queue_depth = static_cast<size_t>(number(status, "queue_depth") + number(status, "running_processes"));
+    node.prefixes = split_lines(status["prefixes"]);
+    node.warm_prefixes = split_lines(status["warm_prefixes"]);
+    for (const auto& path : split_lines(status["templates"])) {
+        node.prefixes.insert(path);
+    }
+    return true;
+}
+
+size_t FleetCoordinator::refresh(bool force) {
+    // Queries work on copies of the nodes, so two concurrent refreshes would each open a tunnel for the
+    // same node and one write-back would leak the other's ssh process.
+    std::lock_guard<std::mutex> refresh_lock(refresh_mutex);
+    std::vector<FleetNode> stale;
+    {
+        std::lock_guard<std::mutex> lock(fleet_mutex);
+        auto now = std::chrono::steady_clock::now();
+        for (const auto& pair : nodes) {
+            if (force || now - pair.second.refreshed >= STATUS_TTL) {
+                stale.push_back(pair.second);
+            }
+        }
+    }
+    
+    std::vector<std::future<void>> queries;
+    for (auto& node : stale) {
+        queries.push_back(std::async(std::launch::async, [this, &node] { query_node(node); }));
+    }
+    for (auto& query : queries) {
+        query.wait();
+    }
+    
+    std::lock_guard<std::mutex> lock(fleet_mutex);
+    for (auto& node : stale) {
+        auto it = nodes.find(node.name);
+        if (it == nodes.end()) {
+            close_tunnel(node);
+            continue;
+        }
+        node.inflight = it->second.inflight;
+        it->second = node;
+    }
+    
+    size_t reachable = 0;
+    for (const auto& pair : nodes) {
+        reachable += pair.second.reachable ? 1 : 0;
+    }
+    return reachable;
+}
+
+std::vector<FleetNode> FleetCoordinator::get_nodes() {
+    std::lock_guard<std::mutex> lock(fleet_mutex);
+    std::vector<FleetNode> result;
+    for (const auto& pair : nodes) {
+        result.push_back(pair.second);
+    }
+    return result;
+}
+
+double FleetCoordinator::score(const FleetNode& node, const std::string& prefix_path) {
+    if (!node.reachable) {
+        return HUGE_VAL;
+    }
+    
+    double value = node.load + static_cast<double>(node.queue_depth + node.inflight) / node.cpu_count;
+    if (node.memory_available > 0 && node.memory_available < LOW_MEMORY_KB) {
+        value += LOW_MEMORY_PENALTY;
+    }
+    
+    if (prefix_path.empty() || node.warm_prefixes.count(prefix_path)) {
+        value -= prefix_path.empty() ? 0.0 : WARM_BONUS;
+    } else if (!node.prefixes.count(prefix_path)) {
+        value += SYNC_PENALTY;
+    }
+    return value;
+}
+
+bool FleetCoordinator::place(const std::string& prefix_path, FleetPlacement& placement) {
+    auto start = std::chrono::steady_clock::now();
+    PhaseTimer timer(metrics, MetricPhase::FLEET_PLACEMENT);
+    refresh();
+    
+    std::lock_guard<std::mutex> lock(fleet_mutex);
+    const FleetNode* best = nullptr;
+    double best_score = HUGE_VAL;
+    for (const auto& pair : nodes) {
+        double value = score(pair.second, prefix_path);
+        if (value < best_score) {
+            best = &pair.second;
+            best_score = value;
+        }
+    }
+    
+    placement = FleetPlacement();
+    placement.latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (!best) {
+        return false;
+    }
+    
+    placement.node = best->name;
+    placement.warm = best->warm_prefixes.count(prefix_path) > 0;
+    placement.score = best_score;
+    return true;
+}
+
+bool FleetCoordinator::sync_prefix(const FleetNode& node, const std::string& prefix_path) {
+    if (!Utils::directory_exists(prefix_path)) {
+        logger.error("Cannot sync missing prefix " + prefix_path + " to fleet node " + node.name);
+        return false;
+    }
+    
+    PhaseTimer timer(metrics, MetricPhase::FLEET_SYNC);
+    TraceSpan span("fleet sync", "fleet", node.name);
+    logger.info("Syncing prefix " + prefix_path + " to fleet node " + node.name);
+    
+    std::vector<std::string> mkdir = {"ssh"};
+    mkdir.insert(mkdir.end(), std::begin(SSH_OPTIONS), std::end(SSH_OPTIONS));
+    mkdir.insert(mkdir.end(), {node.host, "mkdir -p -- " + shell_quote(prefix_path)});
+    
+    // --inplace --no-whole-file rewrites only changed blocks, so extents a reflinked prefix shares with
+    // its template stay shared; --timeout aborts a transfer that stops making progress.
+    std::string source = prefix_path;
+    while (source.size() > 1 && source.back() == '/') source.pop_back();
+    std::vector<std::string> rsync = {
+        "rsync", "-aH", "--protect-args", "--delete", "--inplace", "--no-whole-file", "--timeout=60",
+        "-e", "ssh -o BatchMode=yes -o ConnectTimeout=5", source + "/", node.host + ":" + source + "/"
+    };
+    
+    CommandOptions options;
+    options.timeout = MKDIR_TIMEOUT;
+    CommandResult result = Utils::run_command(mkdir, options);
+    if (result.exit_code == 0) {
+        options.timeout = SYNC_TIMEOUT;
+        result = Utils::run_command(rsync, options);
+    }
+    int status = result.timed_out ? -1 : result.exit_code;
+    if (status != 0) {
+        logger.error("Prefix sync to fleet node " + node.name + (result.timed_out ? " timed out" :
+                     " failed with status " + std::to_string(status)) + ": " + result.output);
+        return false;
+    }
+    return true;
+}
+
+int FleetCoordinator::dispatch(const std::vector<std::string>& command, const std::string& prefix_path,
+                               std::string& out, std::string& err, FleetPlacement& placement) {
+    if (!place(prefix_path, placement)) {
+        err = "No reachable fleet node\n";
+        return -1;
+    }
+    
+    FleetNode node;
+    {
+        std::lock_guard<std::mutex> lock(fleet_mutex);
+        // The node may have been dropped by a reload between place() and here
+        auto target = nodes.find(placement.node);
+        if (target == nodes.end()) {
+            err = "Fleet node " + placement.node + " is no longer configured\n";
+            return -1;
+        }
+        target->second.inflight++;
+        node = target->second;
+    }
+    
+    bool present = prefix_path.empty() || node.prefixes.count(prefix_path) > 0;
+    bool ready = present || node.host.empty();
+    if (!ready) {
+        placement.synced = sync_prefix(node, prefix_path);
+        ready = placement.synced;
+    }
+    
+    std::vector<std::string> args;
+    if (!prefix_path.empty()) {
+        args = {"-p", prefix_path};
+    }
+    args.insert(args.end(), command.begin(), command.end());
+    
+    DaemonClient client;
+    int status = -1;
+    if (!ready) {
+        err = "Cannot sync prefix to fleet node " + node.name + "\n";
+    } else if (!client.connect(node.socket) || (status = client.execute(args, out, err)) == -1) {
+        err += "Fleet node " + node.name + " did not answer\n";
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(fleet_mutex);
+        auto it = nodes.find(placement.node);
+        if (it != nodes.end()) {
+            it->second.inflight--;
+            if (placement.synced) it->second.prefixes.insert(prefix_path);
+            if (status == -1) it->second.reachable = false;
+        }
+    }
+    
+    char latency[16];
+    snprintf(latency, sizeof(latency), "%.1f", placement.latency_ms);
+    logger.info("Placed '" + (command.empty() ? std::string() : command[0]) + "' on fleet node " + node.name +
+                " (" + (placement.warm ? "warm" : placement.synced ? "synced" : present ? "cold" : "no prefix") +
+                ", placement " + latency + " ms), status " + std::to_string(status));
+    return status;
+}
+
+}
@@ -492,10 +492,57 @@ class ProcessesTab(QWidget):
         self.refresh_timer.timeout.connect(self.refresh_processes)
         self.refresh_timer.start(2000)
     
+    def query_daemon_processes(self):
+        """Fetch managed processes from wine-appd, or None if it is not running"""
+        import json
+        import socket
+        
+        runtime_dir = os.environ.get('XDG_RUNTIME_DIR')
+        if runtime_dir and os.path.isdir(runtime_dir):
+            path = os.path.join(runtime_dir, 'wine-appd.sock')
+        else:
+            path = f"/tmp/wine-appd-{os.getuid()}.sock"
+        
+        try:
+            with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+                sock.settimeout(1.0)
+                sock.connect(path)
+                sock.sendall(b'{"id":1,"method":"processes"}\n')
+                data = b''
+                while not data.endswith(b'\n'):
+                    chunk = sock.recv(65536)
+                    if not chunk:
+                        break
+                    data += chunk
+            response = json.loads(data)
+            if response.get('ok') != 1:
+                return None
+            return response.get('processes', [])
+        except (OSError, ValueError):
+            return None
+    
     def refresh_processes(self):
         """Refresh process list"""
         import subprocess
         
+        processes = self.query_daemon_processes()
+        if processes is not None:
+            self.process_table.setRowCount(len(processes))
+            for i, proc in enumerate(processes):
+                pid = str(proc.get('pid', ''))
+                memory_mb = int(proc.get('tree_memory', 0)) / (1024 * 1024)
+                
+                self.process_table.setItem(i, 0, QTableWidgetItem(pid))
+                self.process_table.setItem(i, 1, QTableWidgetItem(proc.get('executable', '')[:50]))
+                self.process_table.setItem(i, 2, QTableWidgetItem(
+                    f"CPU: {proc.get('tree_cpu', '0')}% MEM: {memory_mb:.1f} MB"))
+                self.process_table.setItem(i, 3, QTableWidgetItem(proc.get('state', '')))
+                
+                kill_btn = QPushButton("Kill")
+                kill_btn.clicked.connect(lambda checked, p=pid: self.kill_process(p))
+                self.process_table.setCellWidget(i, 4, kill_btn)
+            return
+        
         try:
             output = subprocess.check_output(['ps', 'aux'], universal_newlines=True)
             wine_processes = [line for line in output.split('\n') if 'wine' in line.lower()]
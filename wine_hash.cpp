@@ -0,0 +1,225 @@
+#include "wine_wrapper.hpp"
+#include <cerrno>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#include <cpuid.h>
+#define WINE_WRAPPER_SHA_NI 1
+#endif
+
+namespace WineWrapper {
+
+namespace {
+
+alignas(16) const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+inline uint32_t rotate_right(uint32_t value, int bits) {
+    return (value >> bits) | (value << (32 - bits));
+}
+
+void compress_portable(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    for (; blocks > 0; --blocks, data += 64) {
+        uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = (static_cast<uint32_t>(data[i * 4]) << 24) | (static_cast<uint32_t>(data[i * 4 + 1]) << 16) |
+                   (static_cast<uint32_t>(data[i * 4 + 2]) << 8) | static_cast<uint32_t>(data[i * 4 + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            uint32_t s0 = rotate_right(w[i - 15], 7) ^ rotate_right(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotate_right(w[i - 2], 17) ^ rotate_right(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t s1 = rotate_right(e, 6) ^ rotate_right(e, 11) ^ rotate_right(e, 25);
+            uint32_t choice = (e & f) ^ (~e & g);
+            uint32_t t1 = h + s1 + choice + SHA256_K[i] + w[i];
+            uint32_t s0 = rotate_right(a, 2) ^ rotate_right(a, 13) ^ rotate_right(a, 22);
+            uint32_t majority = (a & b) ^ (a & c) ^ (b & c);
+            uint32_t t2 = s0 + majority;
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+}
+
+#ifdef WINE_WRAPPER_SHA_NI
+__attribute__((target("sha,sse4.1,ssse3")))
+void compress_sha_ni(uint32_t state[8], const unsigned char* data, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+    
+    for (; blocks > 0; --blocks, data += 64) {
+        __m128i saved0 = state0;
+        __m128i saved1 = state1;
+        __m128i w[4];
+        
+        for (int group = 0; group < 16; ++group) {
+            __m128i& current = w[group & 3];
+            if (group < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + group * 16)),
+                                           byte_swap);
+            } else {
+                __m128i previous = w[(group - 1) & 3];
+                __m128i mixed = _mm_sha256msg1_epu32(current, w[(group - 3) & 3]);
+                mixed = _mm_add_epi32(mixed, _mm_alignr_epi8(previous, w[(group - 2) & 3], 4));
+                current = _mm_sha256msg2_epu32(mixed, previous);
+            }
+            
+            __m128i message = _mm_add_epi32(current,
+                                            _mm_load_si128(reinterpret_cast<const __m128i*>(&SHA256_K[group * 4])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, message);
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(message, 0x0E));
+        }
+        
+        state0 = _mm_add_epi32(state0, saved0);
+        state1 = _mm_add_epi32(state1, saved1);
+    }
+    
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    state0 = _mm_blend_epi16(tmp, state1, 0xF0);
+    state1 = _mm_alignr_epi8(state1, tmp, 8);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), state0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), state1);
+}
+
+bool detect_sha_ni() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSE4_1) || !(ecx & bit_SSSE3)) {
+        return false;
+    }
+    if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (ebx & (1u << 29)) != 0;
+}
+#endif
+
+using CompressFunction = void (*)(uint32_t*, const unsigned char*, size_t);
+
+CompressFunction select_compress() {
+#ifdef WINE_WRAPPER_SHA_NI
+    if (detect_sha_ni()) {
+        return compress_sha_ni;
+    }
+#endif
+    return compress_portable;
+}
+
+const CompressFunction compress_blocks = select_compress();
+
+}
+
+Sha256::Sha256() : total_length(0), block_length(0) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+    };
+    memcpy(state, initial, sizeof(state));
+}
+
+bool Sha256::hardware_accelerated() {
+    return compress_blocks != compress_portable;
+}
+
+void Sha256::update(const void* data, size_t length) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    total_length += length;
+    
+    if (block_length > 0) {
+        size_t take = std::min(length, sizeof(block) - block_length);
+        memcpy(block + block_length, bytes, take);
+        block_length += take;
+        bytes += take;
+        length -= take;
+        if (block_length < sizeof(block)) {
+            return;
+        }
+        compress_blocks(state, block, 1);
+        block_length = 0;
+    }
+    
+    if (length >= 64) {
+        compress_blocks(state, bytes, length / 64);
+        bytes += length - length % 64;
+        length %= 64;
+    }
+    
+    memcpy(block, bytes, length);
+    block_length = length;
+}
+
+std::string Sha256::final_hex() {
+    uint64_t bit_length = total_length * 8;
+    unsigned char padding[72] = {0x80};
+    size_t pad = (block_length < 56) ? 56 - block_length : 120 - block_length;
+    for (int i = 0; i < 8; ++i) {
+        padding[pad + i] = static_cast<unsigned char>(bit_length >> (56 - i * 8));
+    }
+    update(padding, pad + 8);
+    
+    static const char digits[] = "0123456789abcdef";
+    std::string hex(64, '0');
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 8; ++j) {
+            hex[i * 8 + j] = digits[(state[i] >> (28 - j * 4)) & 0xF];
+        }
+    }
+    return hex;
+}
+
+std::string Sha256::hash(const std::string& data) {
+    Sha256 hasher;
+    hasher.update(data.data(), data.size());
+    return hasher.final_hex();
+}
+
+std::string Sha256::hash_file(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return "";
+    }
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    
+    Sha256 hasher;
+    std::vector<unsigned char> buffer(1 << 20);
+    for (;;) {
+        ssize_t n = read(fd, buffer.data(), buffer.size());
+        if (n == -1 && errno == EINTR) continue;
+        if (n < 0) {
+            close(fd);
+            return "";
+        }
+        if (n == 0) break;
+        hasher.update(buffer.data(), static_cast<size_t>(n));
+    }
+    
+    close(fd);
+    return hasher.final_hex();
+}
+
+}
@@ -0,0 +1,318 @@
+#include "wine_wrapper.hpp"
+#include <sys/resource.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+namespace {
+
+const int STEP_AFFINITY = 1 << 0;
+const int STEP_NUMA = 1 << 1;
+const int STEP_IO_PRIORITY = 1 << 2;
+const int STEP_THP = 1 << 3;
+const int STEP_MEMLOCK = 1 << 4;
+const int STEP_SCHEDULER = 1 << 5;
+
+const int IOPRIO_CLASS_SHIFT = 13;
+const int IOPRIO_WHO_PROCESS = 1;
+
+const int NUMA_NONE = -1;
+
+int io_class(const std::string& name) {
+    if (name == "rt") return 1;
+    if (name == "be") return 2;
+    if (name == "idle") return 3;
+    return -1;
+}
+
+}
+
+LaunchProfile::LaunchProfile() : name("default"), scheduler_priority(0), disable_thp(false), memlock_mb(0) {
+}
+
+bool LaunchProfile::is_default() const {
+    return cpu_affinity.empty() && numa_policy.empty() && scheduler_policy.empty() && io_priority.empty() &&
+           !disable_thp && memlock_mb == 0;
+}
+
+std::string LaunchProfile::to_string() const {
+    std::string description = name;
+    std::vector<std::string> parts;
+    if (!cpu_affinity.empty()) parts.push_back("cpus " + cpu_affinity);
+    if (!numa_policy.empty()) parts.push_back("numa " + numa_policy);
+    if (!scheduler_policy.empty()) {
+        parts.push_back("sched " + scheduler_policy +
+                        (scheduler_priority > 0 ? ":" + std::to_string(scheduler_priority) : ""));
+    }
+    if (!io_priority.empty()) parts.push_back("io " + io_priority);
+    if (disable_thp) parts.push_back("thp off");
+    if (memlock_mb > 0) parts.push_back("memlock " + std::to_string(memlock_mb) + " MB");
+    
+    for (size_t i = 0; i < parts.size(); ++i) {
+        description += (i == 0 ? " (" : ", ") + parts[i];
+    }
+    return parts.empty() ? description : description + ")";
+}
+
+LaunchProfile LaunchProfile::preset(const std::string& name) {
+    LaunchProfile profile;
+    profile.name = name.empty() ? "default" : name;
+    
+    if (name == "latency") {
+        profile.scheduler_policy = "rr";
+        profile.scheduler_priority = 10;
+        profile.io_priority = "be:0";
+        profile.disable_thp = true;
+    } else if (name == "background") {
+        profile.scheduler_policy = "idle";
+        profile.io_priority = "idle";
+    } else if (name == "batch") {
+        profile.scheduler_policy = "batch";
+        profile.io_priority = "be:7";
+    }
+    
+    return profile;
+}
+
+bool LaunchProfile::parse_cpu_list(const std::string& list, std::vector<int>& cpus) {
+    cpus.clear();
+    std::set<int> unique;
+    
+    std::istringstream ranges(list);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        if (range.empty()) continue;
+        
+        char* end = nullptr;
+        long first = strtol(range.c_str(), &end, 10);
+        long last = first;
+        if (end == range.c_str()) return false;
+        if (*end == '-') {
+            const char* start = end + 1;
+            last = strtol(start, &end, 10);
+            if (end == start) return false;
+        }
+        if (*end != '\0' || first < 0 || last < first || last >= CPU_SETSIZE) {
+            return false;
+        }
+        
+        for (long cpu = first; cpu <= last; ++cpu) {
+            unique.insert(static_cast<int>(cpu));
+        }
+    }
+    
+    cpus.assign(unique.begin(), unique.end());
+    return !cpus.empty();
+}
+
+std::string LaunchProfile::format_cpu_list(const std::vector<int>& cpus) {
+    std::string result;
+    for (size_t i = 0; i < cpus.size();) {
+        size_t j = i;
+        while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) ++j;
+        if (!result.empty()) result += ",";
+        result += std::to_string(cpus[i]);
+        if (j > i) result += "-" + std::to_string(cpus[j]);
+        i = j + 1;
+    }
+    return result;
+}
+
+PreparedLaunchProfile::PreparedLaunchProfile()
+    : active(false), has_affinity(false), numa_mode(NUMA_NONE), max_node(0), io_priority(-1),
+      disable_thp(false), memlock_bytes(0), scheduler_policy(-1), scheduler_priority(0) {
+    CPU_ZERO(&cpus);
+    memset(nodemask, 0, sizeof(nodemask));
+}
+
+bool PreparedLaunchProfile::prepare(const LaunchProfile& profile, std::string& error) {
+    *this = PreparedLaunchProfile();
+    
+    if (!profile.cpu_affinity.empty()) {
+        if (!LaunchProfile::parse_cpu_list(profile.cpu_affinity, cpu_list)) {
+            error = "invalid cpu_affinity '" + profile.cpu_affinity + "'";
+            return false;
+        }
+        for (int cpu : cpu_list) {
+            CPU_SET(cpu, &cpus);
+        }
+        has_affinity = true;
+    }
+    
+    if (!profile.numa_policy.empty()) {
+        size_t colon = profile.numa_policy.find(':');
+        std::string mode = profile.numa_policy.substr(0, colon);
+        std::vector<int> nodes;
+        if (colon != std::string::npos && !LaunchProfile::parse_cpu_list(profile.numa_policy.substr(colon + 1), nodes)) {
+            error = "invalid numa_policy nodes '" + profile.numa_policy + "'";
+            return false;
+        }
+        
+        if (mode == "default") numa_mode = 0;
+        else if (mode == "preferred") numa_mode = 1;
+        else if (mode == "bind") numa_mode = 2;
+        else if (mode == "interleave") numa_mode = 3;
+        else if (mode == "local") numa_mode = 4;
+        else {
+            error = "unknown numa_policy mode '" + mode + "'";
+            return false;
+        }
+        
+        if (numa_mode >= 1 && numa_mode <= 3 && nodes.empty()) {
+            error = "numa_policy '" + mode + "' needs a node list";
+            return false;
+        }
+        for (int node : nodes) {
+            if (node >= static_cast<int>(sizeof(nodemask) * 8)) {
+                error = "numa node " + std::to_string(node) + " is out of range";
+                return false;
+            }
+            nodemask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+        }
+        max_node = nodes.empty() ? 0 : sizeof(nodemask) * 8 + 1;
+    }
+    
+    if (!profile.scheduler_policy.empty()) {
+        const std::string& policy = profile.scheduler_policy;
+        if (policy == "other") scheduler_policy = SCHED_OTHER;
+        else if (policy == "batch") scheduler_policy = SCHED_BATCH;
+        else if (policy == "idle") scheduler_policy = SCHED_IDLE;
+        else if (policy == "rr") scheduler_policy = SCHED_RR;
+        else if (policy == "fifo") scheduler_policy = SCHED_FIFO;
+        else {
+            error = "unknown scheduler_policy '" + policy + "'";
+            return false;
+        }
+        
+        if (scheduler_policy == SCHED_RR || scheduler_policy == SCHED_FIFO) {
+            scheduler_priority = std::max(sched_get_priority_min(scheduler_policy),
+                                          std::min(sched_get_priority_max(scheduler_policy),
+                                                   profile.scheduler_priority));
+        }
+    }
+    
+    if (!profile.io_priority.empty()) {
+        size_t colon = profile.io_priority.find(':');
+        int cls = io_class(profile.io_priority.substr(0, colon));
+        int level = colon == std::string::npos ? 4 : atoi(profile.io_priority.c_str() + colon + 1);
+        if (cls == -1 || level < 0 || level > 7) {
+            error = "invalid io_priority '" + profile.io_priority + "'";
+            return false;
+        }
+        io_priority = (cls << IOPRIO_CLASS_SHIFT) | (cls == 3 ? 0 : level);
+    }
+    
+    disable_thp = profile.disable_thp;
+    memlock_bytes = static_cast<unsigned long long>(profile.memlock_mb) << 20;
+    
+    active = has_affinity || numa_mode != NUMA_NONE || scheduler_policy != -1 || io_priority != -1 ||
+             disable_thp || memlock_bytes > 0;
+    return true;
+}
+
+int PreparedLaunchProfile::apply() const {
+    int failed = 0;
+    int saved_errno = 0;
+    
+    if (has_affinity && sched_setaffinity(0, sizeof(cpus), &cpus) != 0) {
+        failed |= STEP_AFFINITY;
+        saved_errno = errno;
+    }
+    if (numa_mode != NUMA_NONE &&
+        syscall(SYS_set_mempolicy, numa_mode, max_node > 0 ? nodemask : nullptr, max_node) != 0) {
+        failed |= STEP_NUMA;
+        saved_errno = errno;
+    }
+    if (io_priority != -1 && syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0, io_priority) != 0) {
+        failed |= STEP_IO_PRIORITY;
+        saved_errno = errno;
+    }
+    if (disable_thp && prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) != 0) {
+        failed |= STEP_THP;
+        saved_errno = errno;
+    }
+    if (memlock_bytes > 0) {
+        struct rlimit limit;
+        if (getrlimit(RLIMIT_MEMLOCK, &limit) == 0) {
+            limit.rlim_cur = memlock_bytes;
+            if (limit.rlim_max != RLIM_INFINITY && limit.rlim_max < memlock_bytes) {
+                limit.rlim_max = memlock_bytes;
+            }
+        }
+        if (setrlimit(RLIMIT_MEMLOCK, &limit) != 0) {
+            failed |= STEP_MEMLOCK;
+            saved_errno = errno;
+        }
+    }
+    if (scheduler_policy != -1) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = scheduler_priority;
+        if (sched_setscheduler(0, scheduler_policy, &param) != 0) {
+            failed |= STEP_SCHEDULER;
+            saved_errno = errno;
+        }
+    }
+    
+    errno = saved_errno;
+    return failed;
+}
+
+std::string PreparedLaunchProfile::describe_failure(int failed_step) {
+    std::string steps;
+    const std::pair<int, const char*> names[] = {
+        {STEP_AFFINITY, "cpu affinity"}, {STEP_NUMA, "numa policy"}, {STEP_IO_PRIORITY, "io priority"},
+        {STEP_THP, "thp"}, {STEP_MEMLOCK, "memlock limit"}, {STEP_SCHEDULER, "scheduler policy"}
+    };
+    for (const auto& name : names) {
+        if (failed_step & name.first) {
+            steps += (steps.empty() ? "" : ", ") + std::string(name.second);
+        }
+    }
+    return steps;
+}
+
+const cpu_set_t& PreparedLaunchProfile::original_affinity() {
+    static const cpu_set_t original = [] {
+        cpu_set_t set;
+        if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+            CPU_ZERO(&set);
+            for (long cpu = 0; cpu < std::min<long>(CPU_SETSIZE, sysconf(_SC_NPROCESSORS_CONF)); cpu++) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        return set;
+    }();
+    return original;
+}
+
+bool PreparedLaunchProfile::pin_current_process(const std::vector<int>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        CPU_SET(cpu, &set);
+    }
+    return pin_current_process(set);
+}
+
+bool PreparedLaunchProfile::pin_current_process(const cpu_set_t& set) {
+    DIR* tasks = opendir("/proc/self/task");
+    if (!tasks) {
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+    
+    bool ok = true;
+    while (struct dirent* entry = readdir(tasks)) {
+        if (entry->d_name[0] == '.') continue;
+        pid_t tid = static_cast<pid_t>(atoi(entry->d_name));
+        ok = sched_setaffinity(tid, sizeof(set), &set) == 0 && ok;
+    }
+    
+    closedir(tasks);
+    return ok;
+}
+
+}
@@ -0,0 +1,324 @@
+#include "wine_wrapper.hpp"
+
+namespace WineWrapper {
+
+LaunchScheduler::LaunchScheduler(Logger& log, WineExecutor& exec, WinePrefixManager& pm,
+                                 ProcessMonitor& mon)
+    : logger(log), executor(exec), prefix_manager(pm), monitor(mon),
+      active_total(0), max_concurrency(8), max_per_prefix(0), launcher_count(4),
+      stopping(false), next_launch_id(1), exit_callback_id(0) {
+    exit_callback_id = monitor.get_event_bus().subscribe("launch-scheduler", [this](const std::vector<ProcessEvent>& batch) {
+        for (const auto& event : batch) {
+            complete_launch(event.process.pid, event.process.exit_code);
+        }
+    }, ProcessEventBus::mask(ProcessEventType::EXITED));
+}
+
+LaunchScheduler::~LaunchScheduler() {
+    shutdown();
+    monitor.get_event_bus().unsubscribe(exit_callback_id);
+}
+
+void LaunchScheduler::set_max_concurrency(size_t limit) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    max_concurrency = limit > 0 ? limit : 1;
+    scheduler_cv.notify_all();
+}
+
+void LaunchScheduler::set_max_per_prefix(size_t limit) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    max_per_prefix = limit;
+    scheduler_cv.notify_all();
+}
+
+void LaunchScheduler::set_launcher_threads(size_t count) {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    launcher_count = count > 0 ? count : 1;
+}
+
+LaunchHandle LaunchScheduler::submit(const LaunchRequest& request) {
+    return submit_batch({request}).front();
+}
+
+std::vector<LaunchHandle> LaunchScheduler::submit_batch(const std::vector<LaunchRequest>& requests) {
+    std::vector<LaunchHandle> handles;
+    handles.reserve(requests.size());
+    
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    
+    for (const auto& request : requests) {
+        auto launch = std::make_shared<PendingLaunch>();
+        launch->id = next_launch_id++;
+        launch->request = request;
+        launch->pid = -1;
+        if (request.config) {
+            launch->prefix_key = request.config->wine_prefix;
+        } else if (!request.prefix.empty()) {
+            launch->prefix_key = request.prefix;
+        } else {
+            launch->prefix_key = executor.get_configuration().wine_prefix;
+        }
+        
+        LaunchHandle handle;
+        handle.id = launch->id;
+        handle.prefix = launch->prefix_key;
+        handle.pid = launch->pid_promise.get_future().share();
+        handle.exit_code = launch->exit_promise.get_future().share();
+        handles.push_back(handle);
+        
+        if (stopping) {
+            launch->pid_promise.set_value(-1);
+            launch->exit_promise.set_value(-1);
+            continue;
+        }
+        pending.push_back(launch);
+    }
+    
+    size_t wanted = std::min(launcher_count, std::max<size_t>(pending.size(), 1));
+    while (!stopping && launchers.size() < wanted) {
+        launchers.emplace_back(&LaunchScheduler::launcher_loop, this);
+    }
+    
+    scheduler_cv.notify_all();
+    logger.info("Queued " + std::to_string(requests.size()) + " launches");
+    return handles;
+}
+
+bool LaunchScheduler::cancel(uint64_t launch_id) {
+    std::shared_ptr<PendingLaunch> cancelled;
+    
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        for (auto it = pending.begin(); it != pending.end(); ++it) {
+            if ((*it)->id == launch_id) {
+                cancelled = *it;
+                pending.erase(it);
+                break;
+            }
+        }
+        if (pending.empty() && running.empty() && active_total == 0) {
+            idle_cv.notify_all();
+        }
+    }
+    
+    if (!cancelled) {
+        return false;
+    }
+    
+    cancelled->pid_promise.set_value(-1);
+    cancelled->exit_promise.set_value(-1);
+    logger.info("Cancelled queued launch " + std::to_string(launch_id));
+    return true;
+}
+
+bool LaunchScheduler::wait_idle(std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(scheduler_mutex);
+    return idle_cv.wait_for(lock, timeout, [this] {
+        return pending.empty() && active_total == 0;
+    });
+}
+
+size_t LaunchScheduler::pending_count() {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    return pending.size();
+}
+
+size_t LaunchScheduler::running_count() {
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    return active_total;
+}
+
+void LaunchScheduler::shutdown() {
+    std::deque<std::shared_ptr<PendingLaunch>> abandoned;
+    std::vector<std::thread> threads;
+    
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        if (stopping && launchers.empty()) {
+            return;
+        }
+        stopping = true;
+        abandoned.swap(pending);
+        threads.swap(launchers);
+        scheduler_cv.notify_all();
+    }
+    
+    for (auto& launch : abandoned) {
+        launch->pid_promise.set_value(-1);
+        launch->exit_promise.set_value(-1);
+    }
+    
+    for (auto& thread : threads) {
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+    
+    std::map<pid_t, std::shared_ptr<PendingLaunch>> detached;
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        detached.swap(running);
+        active_per_prefix.clear();
+        environments.clear();
+        active_total = 0;
+        idle_cv.notify_all();
+    }
+    
+    for (auto& pair : detached) {
+        pair.second->exit_promise.set_value(-1);
+    }
+    
+    if (!abandoned.empty() || !detached.empty()) {
+        logger.info("Launch scheduler stopped with " + std::to_string(abandoned.size()) +
+                    " queued and " + std::to_string(detached.size()) + " running launches");
+    }
+}
+
+std::shared_ptr<LaunchScheduler::PendingLaunch> LaunchScheduler::take_next_launch() {
+    if (active_total >= max_concurrency) {
+        return nullptr;
+    }
+    
+    for (auto it = pending.begin(); it != pending.end(); ++it) {
+        size_t& active = active_per_prefix[(*it)->prefix_key];
+        if (max_per_prefix == 0 || active < max_per_prefix) {
+            auto launch = *it;
+            pending.erase(it);
+            active++;
+            active_total++;
+            return launch;
+        }
+    }
+    
+    return nullptr;
+}
+
+bool LaunchScheduler::resolve_launch(PendingLaunch& launch, WineConfiguration& config,
+                                     std::shared_ptr<const LaunchEnvironment>& env) {
+    const LaunchRequest& request = launch.request;
+    
+    if (request.config) {
+        config = *request.config;
+        config.validate();
+        env = executor.prepare_environment(config);
+        return env != nullptr;
+    }
+    
+    if (request.prefix.empty()) {
+        return true;
+    }
+    
+    if (!prefix_manager.prefix_exists(request.prefix)) {
+        logger.error("Wine prefix does not exist: " + request.prefix);
+        return false;
+    }
+    
+    config = prefix_manager.get_prefix_config(request.prefix);
+    
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        auto it = environments.find(request.prefix);
+        if (it != environments.end()) {
+            env = it->second;
+            return true;
+        }
+    }
+    
+    env = executor.prepare_environment(config);
+    if (!env) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(scheduler_mutex);
+    environments[request.prefix] = env;
+    return true;
+}
+
+void LaunchScheduler::launcher_loop() {
+    for (;;) {
+        std::shared_ptr<PendingLaunch> launch;
+        
+        {
+            std::unique_lock<std::mutex> lock(scheduler_mutex);
+            scheduler_cv.wait(lock, [this, &launch] {
+                if (stopping) return true;
+                launch = take_next_launch();
+                return launch != nullptr;
+            });
+            if (!launch) {
+                return;
+            }
+        }
+        
+        WineConfiguration config;
+        std::shared_ptr<const LaunchEnvironment> env;
+        pid_t pid = -1;
+        
+        if (resolve_launch(*launch, config, env)) {
+            if (env) {
+                pid = executor.execute(config, env, launch->request.exe_path, launch->request.arguments);
+            } else {
+                pid = executor.execute(launch->request.exe_path, launch->request.arguments);
+            }
+        }
+        
+        launch->pid = pid;
+        launch->pid_promise.set_value(pid);
+        
+        if (pid <= 0) {
+            logger.error("Queued launch " + std::to_string(launch->id) + " failed: " +
+                         launch->request.exe_path);
+            launch->exit_promise.set_value(-1);
+            std::lock_guard<std::mutex> lock(scheduler_mutex);
+            release_slot(launch->prefix_key);
+            continue;
+        }
+        
+        {
+            std::lock_guard<std::mutex> lock(scheduler_mutex);
+            running[pid] = launch;
+        }
+        
+        int exit_code;
+        if (monitor.has_exited(pid, exit_code)) {
+            complete_launch(pid, exit_code);
+        }
+    }
+}
+
+void LaunchScheduler::release_slot(const std::string& prefix_key) {
+    auto it = active_per_prefix.find(prefix_key);
+    if (it != active_per_prefix.end() && it->second > 0 && --it->second == 0) {
+        active_per_prefix.erase(it);
+    }
+    if (active_total > 0) {
+        active_total--;
+    }
+    
+    if (pending.empty() && active_total == 0) {
+        environments.clear();
+        idle_cv.notify_all();
+    }
+    scheduler_cv.notify_all();
+}
+
+void LaunchScheduler::complete_launch(pid_t pid, int exit_code) {
+    std::shared_ptr<PendingLaunch> launch;
+    
+    {
+        std::lock_guard<std::mutex> lock(scheduler_mutex);
+        auto it = running.find(pid);
+        if (it == running.end()) {
+            return;
+        }
+        launch = it->second;
+        running.erase(it);
+        release_slot(launch->prefix_key);
+    }
+    
+    launch->exit_promise.set_value(exit_code);
+    logger.debug("Queued launch " + std::to_string(launch->id) + " finished with code " +
+                 std::to_string(exit_code));
+}
+
+}
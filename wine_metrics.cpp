@@ -0,0 +1,151 @@
+#include "wine_wrapper.hpp"
+
+namespace WineWrapper {
+
+namespace {
+
+const uint64_t BUCKET_BOUNDS_NS[MetricsRegistry::BUCKET_COUNT - 1] = {
+    10000ULL, 25000ULL, 50000ULL, 100000ULL, 250000ULL, 500000ULL,
+    1000000ULL, 2500000ULL, 5000000ULL, 10000000ULL, 25000000ULL, 50000000ULL,
+    100000000ULL, 250000000ULL, 500000000ULL, 1000000000ULL, 2500000000ULL, 5000000000ULL,
+    10000000000ULL, 30000000000ULL, 60000000000ULL
+};
+
+std::string escape_label(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+            escaped += c;
+        } else if (c == '\n') {
+            escaped += "\\n";
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+std::string format_value(double value) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+}
+
+MetricsRegistry::MetricsRegistry() {
+    for (auto& histogram : histograms) {
+        for (auto& bucket : histogram.buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.sum_ns.store(0, std::memory_order_relaxed);
+    }
+}
+
+const char* MetricsRegistry::phase_name(MetricPhase phase) {
+    switch (phase) {
+        case MetricPhase::LAUNCH: return "launch";
+        case MetricPhase::PRE_LAUNCH: return "pre_launch";
+        case MetricPhase::VALIDATE: return "validate";
+        case MetricPhase::ENVIRONMENT: return "environment";
+        case MetricPhase::WINESERVER: return "wineserver";
+        case MetricPhase::CGROUP: return "cgroup";
+        case MetricPhase::SPAWN: return "spawn";
+        case MetricPhase::POST_LAUNCH: return "post_launch";
+        case MetricPhase::PREFIX_CREATE: return "prefix_create";
+        case MetricPhase::PREFIX_CLONE: return "prefix_clone";
+        case MetricPhase::REGISTRY_LOAD: return "registry_load";
+        case MetricPhase::REGISTRY_COMMIT: return "registry_commit";
+        case MetricPhase::WINETRICKS_INSTALL: return "winetricks_install";
+        case MetricPhase::FLEET_PLACEMENT: return "fleet_placement";
+        case MetricPhase::FLEET_SYNC: return "fleet_sync";
+    }
+    return "unknown";
+}
+
+void MetricsRegistry::observe(MetricPhase phase, uint64_t nanoseconds) {
+    Histogram& histogram = histograms[static_cast<size_t>(phase)];
+    
+    size_t bucket = std::lower_bound(BUCKET_BOUNDS_NS, BUCKET_BOUNDS_NS + BUCKET_COUNT - 1, nanoseconds) -
+                    BUCKET_BOUNDS_NS;
+    histogram.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    histogram.sum_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t MetricsRegistry::get_count(MetricPhase phase) const {
+    return histograms[static_cast<size_t>(phase)].count.load(std::memory_order_relaxed);
+}
+
+void MetricsRegistry::add_family(std::string& out, const std::string& name, const std::string& type,
+                                 const std::string& help) {
+    out += "# TYPE " + name + " " + type + "\n";
+    out += "# HELP " + name + " " + help + "\n";
+}
+
+void MetricsRegistry::add_sample(std::string& out, const std::string& name,
+                                 const std::map<std::string, std::string>& labels, double value) {
+    out += name;
+    if (!labels.empty()) {
+        out += '{';
+        bool first = true;
+        for (const auto& label : labels) {
+            out += (first ? "" : ",") + label.first + "=\"" + escape_label(label.second) + "\"";
+            first = false;
+        }
+        out += '}';
+    }
+    out += " " + format_value(value) + "\n";
+}
+
+void MetricsRegistry::render(std::string& out) const {
+    const std::string name = "wine_phase_duration_seconds";
+    add_family(out, name, "histogram", "Time spent in each launch and management phase.");
+    
+    for (size_t i = 0; i < PHASE_COUNT; ++i) {
+        const Histogram& histogram = histograms[i];
+        uint64_t count = histogram.count.load(std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        
+        std::string phase = phase_name(static_cast<MetricPhase>(i));
+        uint64_t cumulative = 0;
+        for (size_t bucket = 0; bucket < BUCKET_COUNT; ++bucket) {
+            cumulative += histogram.buckets[bucket].load(std::memory_order_relaxed);
+            std::string bound = bucket + 1 < BUCKET_COUNT ? format_value(BUCKET_BOUNDS_NS[bucket] / 1e9) : "+Inf";
+            add_sample(out, name + "_bucket", {{"phase", phase}, {"le", bound}}, static_cast<double>(cumulative));
+        }
+        add_sample(out, name + "_count", {{"phase", phase}}, static_cast<double>(cumulative));
+        add_sample(out, name + "_sum", {{"phase", phase}}, histogram.sum_ns.load(std::memory_order_relaxed) / 1e9);
+    }
+}
+
+PhaseTimer::PhaseTimer(MetricsRegistry* registry, MetricPhase timed_phase)
+    : metrics(registry), phase(timed_phase), traced(TraceRecorder::is_enabled()),
+      start_ns(registry || traced ? TraceRecorder::now_ns() : 0) {
+}
+
+PhaseTimer::~PhaseTimer() {
+    stop();
+}
+
+void PhaseTimer::stop() {
+    if (!metrics && !traced) {
+        return;
+    }
+    
+    uint64_t end_ns = TraceRecorder::now_ns();
+    if (metrics) {
+        metrics->observe(phase, end_ns - start_ns);
+    }
+    if (traced) {
+        TraceRecorder::record(MetricsRegistry::phase_name(phase), "phase", "", start_ns, end_ns);
+    }
+    metrics = nullptr;
+    traced = false;
+}
+
+}
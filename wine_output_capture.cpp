@@ -0,0 +1,382 @@
+#include "wine_wrapper.hpp"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+OutputRingBuffer::OutputRingBuffer(size_t capacity)
+    : storage(capacity > 0 ? capacity : 1), head(0) {
+}
+
+ssize_t OutputRingBuffer::fill_from(int fd, struct iovec* written, int& written_count) {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    
+    size_t cap = storage.size();
+    size_t pos = static_cast<size_t>(head % cap);
+    
+    struct iovec space[2];
+    space[0].iov_base = storage.data() + pos;
+    space[0].iov_len = cap - pos;
+    space[1].iov_base = storage.data();
+    space[1].iov_len = pos;
+    
+    ssize_t count;
+    do {
+        count = readv(fd, space, pos == 0 ? 1 : 2);
+    } while (count == -1 && errno == EINTR);
+    
+    written_count = 0;
+    if (count > 0) {
+        size_t first = std::min(static_cast<size_t>(count), cap - pos);
+        written[0].iov_base = storage.data() + pos;
+        written[0].iov_len = first;
+        written_count = 1;
+        
+        if (static_cast<size_t>(count) > first) {
+            written[1].iov_base = storage.data();
+            written[1].iov_len = static_cast<size_t>(count) - first;
+            written_count = 2;
+        }
+        
+        head += static_cast<uint64_t>(count);
+    }
+    
+    return count;
+}
+
+std::string OutputRingBuffer::read_all() const {
+    uint64_t offset = 0;
+    std::string output;
+    read_since(offset, output);
+    return output;
+}
+
+size_t OutputRingBuffer::read_since(uint64_t& offset, std::string& output) const {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    
+    size_t cap = storage.size();
+    uint64_t oldest = head > cap ? head - cap : 0;
+    if (offset < oldest) offset = oldest;
+    if (offset >= head) {
+        offset = head;
+        return 0;
+    }
+    
+    size_t length = static_cast<size_t>(head - offset);
+    size_t pos = static_cast<size_t>(offset % cap);
+    size_t first = std::min(length, cap - pos);
+    
+    output.append(storage.data() + pos, first);
+    output.append(storage.data(), length - first);
+    
+    offset = head;
+    return length;
+}
+
+uint64_t OutputRingBuffer::total_written() const {
+    std::lock_guard<std::mutex> lock(ring_mutex);
+    return head;
+}
+
+size_t OutputRingBuffer::capacity() const {
+    return storage.size();
+}
+
+OutputCapture::OutputCapture(Logger& log)
+    : logger(log), subscribers(std::make_shared<std::vector<Subscriber>>()),
+      capture_active(false), epoll_fd(-1), wake_fd(-1), next_subscriber_id(1),
+      buffer_capacity(256 * 1024) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    if (epoll_fd != -1 && wake_fd != -1) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.fd = wake_fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    } else {
+        logger.error("Failed to initialize output capture");
+    }
+}
+
+OutputCapture::~OutputCapture() {
+    stop();
+    
+    for (const auto& pair : channels) {
+        close(pair.first);
+    }
+    for (const auto& pair : buffers) {
+        if (pair.second.tee_fd != -1) {
+            close(pair.second.tee_fd);
+        }
+    }
+    
+    if (wake_fd != -1) close(wake_fd);
+    if (epoll_fd != -1) close(epoll_fd);
+}
+
+void OutputCapture::start() {
+    if (epoll_fd == -1 || capture_active.exchange(true)) {
+        return;
+    }
+    
+    io_thread = std::thread(&OutputCapture::io_loop, this);
+}
+
+void OutputCapture::stop() {
+    if (!capture_active.exchange(false)) {
+        return;
+    }
+    
+    uint64_t one = 1;
+    ssize_t ignored = write(wake_fd, &one, sizeof(one));
+    (void)ignored;
+    
+    if (io_thread.joinable()) {
+        io_thread.join();
+    }
+}
+
+bool OutputCapture::attach(pid_t pid, int stdout_fd, int stderr_fd, const std::string& tee_path) {
+    if (epoll_fd == -1) {
+        return false;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(capture_mutex);
+        
+        Buffers entry;
+        entry.stdout_buffer = std::make_shared<OutputRingBuffer>(buffer_capacity);
+        entry.stderr_buffer = std::make_shared<OutputRingBuffer>(buffer_capacity);
+        entry.tee_fd = -1;
+        entry.open_channels = 0;
+        
+        if (!tee_path.empty()) {
+            entry.tee_fd = open(tee_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+            if (entry.tee_fd == -1) {
+                logger.warning("Failed to open output log file: " + tee_path);
+            }
+        }
+        
+        int fds[2] = {stdout_fd, stderr_fd};
+        OutputStream streams[2] = {OutputStream::STDOUT, OutputStream::STDERR};
+        
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i] == -1) continue;
+            
+            fcntl(fds[i], F_SETFL, fcntl(fds[i], F_GETFL) | O_NONBLOCK);
+            
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = EPOLLIN;
+            ev.data.fd = fds[i];
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fds[i], &ev) == -1) {
+                logger.error("Failed to watch output of process " + std::to_string(pid));
+                close(fds[i]);
+                continue;
+            }
+            
+            channels[fds[i]] = {pid, streams[i]};
+            entry.open_channels++;
+        }
+        
+        auto existing = buffers.find(pid);
+        if (existing != buffers.end() && existing->second.tee_fd != -1) {
+            close(existing->second.tee_fd);
+        }
+        buffers[pid] = entry;
+    }
+    
+    start();
+    
+    logger.debug("Capturing output of process " + std::to_string(pid));
+    return true;
+}
+
+void OutputCapture::detach(pid_t pid) {
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    
+    std::vector<int> fds;
+    for (const auto& pair : channels) {
+        if (pair.second.pid == pid) {
+            fds.push_back(pair.first);
+        }
+    }
+    for (int fd : fds) {
+        close_channel(fd);
+    }
+    
+    auto it = buffers.find(pid);
+    if (it != buffers.end()) {
+        if (it->second.tee_fd != -1) {
+            close(it->second.tee_fd);
+        }
+        buffers.erase(it);
+    }
+}
+
+void OutputCapture::close_channel(int fd) {
+    auto it = channels.find(fd);
+    if (it == channels.end()) {
+        return;
+    }
+    
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    
+    auto buffer_it = buffers.find(it->second.pid);
+    if (buffer_it != buffers.end() && --buffer_it->second.open_channels == 0 &&
+        buffer_it->second.tee_fd != -1) {
+        close(buffer_it->second.tee_fd);
+        buffer_it->second.tee_fd = -1;
+    }
+    
+    channels.erase(it);
+    drain_cv.notify_all();
+}
+
+bool OutputCapture::wait_for_eof(pid_t pid, std::chrono::milliseconds timeout) {
+    std::unique_lock<std::mutex> lock(capture_mutex);
+    
+    return drain_cv.wait_for(lock, timeout, [this, pid] {
+        auto it = buffers.find(pid);
+        return it == buffers.end() || it->second.open_channels == 0;
+    });
+}
+
+void OutputCapture::drain_channel(int fd) {
+    for (int round = 0; round < 16; ++round) {
+        std::shared_ptr<OutputRingBuffer> buffer;
+        std::shared_ptr<const std::vector<Subscriber>> current;
+        struct iovec written[2];
+        int written_count = 0;
+        pid_t pid;
+        OutputStream stream;
+        
+        {
+            std::lock_guard<std::mutex> lock(capture_mutex);
+            
+            auto it = channels.find(fd);
+            if (it == channels.end()) {
+                return;
+            }
+            pid = it->second.pid;
+            stream = it->second.stream;
+            
+            auto buffer_it = buffers.find(pid);
+            if (buffer_it == buffers.end()) {
+                close_channel(fd);
+                return;
+            }
+            
+            buffer = stream == OutputStream::STDOUT ? buffer_it->second.stdout_buffer
+                                                    : buffer_it->second.stderr_buffer;
+            
+            ssize_t count = buffer->fill_from(fd, written, written_count);
+            if (count == 0 || (count == -1 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                close_channel(fd);
+                return;
+            }
+            if (count == -1) {
+                return;
+            }
+            
+            if (buffer_it->second.tee_fd != -1) {
+                ssize_t ignored = writev(buffer_it->second.tee_fd, written, written_count);
+                (void)ignored;
+            }
+            
+            current = subscribers;
+        }
+        
+        for (const auto& subscriber : *current) {
+            if (subscriber.pid != 0 && subscriber.pid != pid) continue;
+            for (int i = 0; i < written_count; ++i) {
+                subscriber.callback(pid, stream, static_cast<const char*>(written[i].iov_base),
+                                    written[i].iov_len);
+            }
+        }
+    }
+}
+
+void OutputCapture::io_loop() {
+    struct epoll_event events[64];
+    
+    while (capture_active) {
+        int count = epoll_wait(epoll_fd, events, 64, -1);
+        if (count == -1) {
+            if (errno != EINTR) {
+                logger.error("Output capture epoll_wait failed: " + std::string(strerror(errno)));
+                return;
+            }
+            continue;
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.fd == wake_fd) {
+                uint64_t value;
+                ssize_t ignored = read(wake_fd, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            drain_channel(events[i].data.fd);
+        }
+    }
+}
+
+std::shared_ptr<OutputRingBuffer> OutputCapture::find_buffer(pid_t pid, OutputStream stream) {
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    
+    auto it = buffers.find(pid);
+    if (it == buffers.end()) {
+        return nullptr;
+    }
+    
+    return stream == OutputStream::STDOUT ? it->second.stdout_buffer : it->second.stderr_buffer;
+}
+
+std::string OutputCapture::read_output(pid_t pid, OutputStream stream) {
+    auto buffer = find_buffer(pid, stream);
+    return buffer ? buffer->read_all() : "";
+}
+
+size_t OutputCapture::read_output_since(pid_t pid, OutputStream stream, uint64_t& offset,
+                                        std::string& output) {
+    auto buffer = find_buffer(pid, stream);
+    return buffer ? buffer->read_since(offset, output) : 0;
+}
+
+int OutputCapture::subscribe(pid_t pid, OutputCallback callback) {
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    
+    auto updated = std::make_shared<std::vector<Subscriber>>(*subscribers);
+    int id = next_subscriber_id++;
+    updated->push_back({id, pid, callback});
+    subscribers = updated;
+    
+    return id;
+}
+
+void OutputCapture::unsubscribe(int subscriber_id) {
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    
+    auto updated = std::make_shared<std::vector<Subscriber>>();
+    for (const auto& subscriber : *subscribers) {
+        if (subscriber.id != subscriber_id) {
+            updated->push_back(subscriber);
+        }
+    }
+    subscribers = updated;
+}
+
+void OutputCapture::set_buffer_capacity(size_t bytes) {
+    std::lock_guard<std::mutex> lock(capture_mutex);
+    buffer_capacity = bytes;
+}
+
+}
@@ -0,0 +1,209 @@
+#include "wine_wrapper.hpp"
+
+namespace WineWrapper {
+
+namespace {
+
+const size_t MAX_CACHED_DIRECTORIES = 4096;
+
+std::mutex registry_mutex;
+std::map<std::string, std::shared_ptr<PrefixPathCache>> registry;
+
+bool same_version(const struct stat& st, const struct timespec& mtime, ino_t inode) {
+    return st.st_ino == inode && st.st_mtim.tv_sec == mtime.tv_sec && st.st_mtim.tv_nsec == mtime.tv_nsec;
+}
+
+std::string strip_trailing_slashes(std::string path) {
+    while (path.size() > 1 && path.back() == '/') {
+        path.pop_back();
+    }
+    return path;
+}
+
+std::string absolute_target(const std::string& directory, const std::string& target) {
+    std::string joined = target[0] == '/' ? target : directory + "/" + target;
+    std::vector<std::string> parts;
+    
+    std::istringstream components(joined);
+    std::string component;
+    while (std::getline(components, component, '/')) {
+        if (component.empty() || component == ".") continue;
+        if (component == ".." && !parts.empty() && parts.back() != "..") {
+            parts.pop_back();
+        } else {
+            parts.push_back(component);
+        }
+    }
+    
+    std::string result;
+    for (const auto& part : parts) {
+        result += "/" + part;
+    }
+    return result.empty() ? "/" : result;
+}
+
+}
+
+PrefixPathCache::PrefixPathCache(const std::string& prefix)
+    : wine_prefix(prefix), drives_loaded(false), dosdevices_inode(0), directory_scans(0) {
+    dosdevices_mtime.tv_sec = 0;
+    dosdevices_mtime.tv_nsec = 0;
+}
+
+std::shared_ptr<PrefixPathCache> PrefixPathCache::for_prefix(const std::string& prefix) {
+    std::string key = strip_trailing_slashes(prefix);
+    
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    auto& cache = registry[key];
+    if (!cache) {
+        cache = std::make_shared<PrefixPathCache>(key);
+    }
+    return cache;
+}
+
+std::string PrefixPathCache::fold_case(const std::string& name) {
+    std::string folded = name;
+    std::transform(folded.begin(), folded.end(), folded.begin(), ::tolower);
+    return folded;
+}
+
+void PrefixPathCache::refresh_drives_locked() {
+    std::string dosdevices = Utils::join_paths(wine_prefix, "dosdevices");
+    struct stat st;
+    bool present = stat(dosdevices.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+    
+    if (drives_loaded && (present ? same_version(st, dosdevices_mtime, dosdevices_inode) : dosdevices_inode == 0)) {
+        return;
+    }
+    
+    drive_mappings.clear();
+    drives_loaded = true;
+    dosdevices_inode = present ? st.st_ino : 0;
+    dosdevices_mtime = present ? st.st_mtim : timespec();
+    if (!present) {
+        return;
+    }
+    
+    for (const auto& entry : Utils::list_directory(dosdevices)) {
+        if (entry.length() != 2 || entry[1] != ':') continue;
+        
+        std::string link_path = Utils::join_paths(dosdevices, entry);
+        char target[PATH_MAX];
+        ssize_t len = readlink(link_path.c_str(), target, sizeof(target) - 1);
+        if (len > 0) {
+            target[len] = '\0';
+            drive_mappings[std::string(1, std::toupper(entry[0]))] = absolute_target(dosdevices, target);
+        }
+    }
+}
+
+const PrefixPathCache::DirectoryEntries* PrefixPathCache::directory_locked(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || !S_ISDIR(st.st_mode)) {
+        directories.erase(path);
+        return nullptr;
+    }
+    
+    auto it = directories.find(path);
+    if (it != directories.end() && same_version(st, it->second.mtime, it->second.inode)) {
+        return &it->second;
+    }
+    
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return nullptr;
+    }
+    
+    if (it == directories.end() && directories.size() >= MAX_CACHED_DIRECTORIES) {
+        directories.clear();
+    }
+    
+    DirectoryEntries& entries = directories[path];
+    entries.mtime = st.st_mtim;
+    entries.inode = st.st_ino;
+    entries.names.clear();
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name != "." && name != "..") {
+            entries.names.emplace(fold_case(name), name);
+        }
+    }
+    closedir(dir);
+    
+    ++directory_scans;
+    return &entries;
+}
+
+std::map<std::string, std::string> PrefixPathCache::get_drive_mappings() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    refresh_drives_locked();
+    return drive_mappings;
+}
+
+std::string PrefixPathCache::resolve_drive(char drive) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    refresh_drives_locked();
+    
+    auto it = drive_mappings.find(std::string(1, std::toupper(drive)));
+    return it != drive_mappings.end() ? it->second : "";
+}
+
+std::string PrefixPathCache::resolve_case(const std::string& root, const std::string& relative) {
+    std::string result = root == "/" ? "" : strip_trailing_slashes(root);
+    bool missing = false;
+    
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    size_t start = 0;
+    while (start <= relative.size()) {
+        size_t end = relative.find('/', start);
+        if (end == std::string::npos) end = relative.size();
+        std::string component = relative.substr(start, end - start);
+        start = end + 1;
+        
+        if (component.empty()) continue;
+        
+        if (!missing && component != "." && component != "..") {
+            const DirectoryEntries* entries = directory_locked(result.empty() ? "/" : result);
+            std::string actual;
+            if (entries) {
+                auto range = entries->names.equal_range(fold_case(component));
+                for (auto it = range.first; it != range.second; ++it) {
+                    if (actual.empty() || it->second == component) {
+                        actual = it->second;
+                    }
+                }
+            }
+            
+            if (actual.empty()) {
+                missing = true;
+            } else {
+                component = actual;
+            }
+        }
+        
+        result += "/" + component;
+    }
+    
+    if (!relative.empty() && relative.back() == '/') {
+        result += "/";
+    }
+    return result.empty() ? "/" : result;
+}
+
+void PrefixPathCache::invalidate_drives() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    drives_loaded = false;
+}
+
+void PrefixPathCache::clear() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    drives_loaded = false;
+    directories.clear();
+}
+
+size_t PrefixPathCache::get_directory_scans() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    return directory_scans;
+}
+
+}
@@ -0,0 +1,447 @@
+#include "wine_wrapper.hpp"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <dirent.h>
+
+namespace WineWrapper {
+
+namespace {
+
+const char* const PROFILE_EXTENSION = ".profile";
+const char* const PROFILE_HEADER = "# wine-wrapper prefetch profile";
+const char* const PREFIX_MARKER = "# prefix ";
+
+const size_t REPLAY_WORKERS = 4;
+const uint64_t MAX_OPEN_FILE_BYTES = 64ULL << 20;
+const uint64_t MINCORE_CHUNK_BYTES = 64ULL << 20;
+const std::chrono::milliseconds RECORD_INTERVAL(250);
+const size_t REJECTED = static_cast<size_t>(-1);
+
+bool ignored_path(const std::string& path) {
+    return path.empty() || path[0] != '/' || path.compare(0, 5, "/dev/") == 0 ||
+           path.compare(0, 6, "/proc/") == 0 || path.compare(0, 5, "/sys/") == 0 ||
+           path.find('\t') != std::string::npos || path.find('\n') != std::string::npos;
+}
+
+PrefetchFile* find_file(const std::string& path, std::vector<PrefetchFile>& files,
+                        std::map<std::string, size_t>& index, uint64_t& size) {
+    auto it = index.find(path);
+    if (it != index.end()) {
+        return it->second == REJECTED ? nullptr : &files[it->second];
+    }
+    
+    struct stat st;
+    if (ignored_path(path) || stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+        index[path] = REJECTED;
+        return nullptr;
+    }
+    
+    size = static_cast<uint64_t>(st.st_size);
+    index[path] = files.size();
+    files.push_back(PrefetchFile());
+    files.back().path = path;
+    return &files.back();
+}
+
+uint64_t resident_bytes(int fd, uint64_t offset, uint64_t length, size_t page_size) {
+    uint64_t resident = 0;
+    std::vector<unsigned char> pages;
+    
+    for (uint64_t position = offset; position < offset + length; position += MINCORE_CHUNK_BYTES) {
+        size_t chunk = static_cast<size_t>(std::min(MINCORE_CHUNK_BYTES, offset + length - position));
+        void* mapping = mmap(nullptr, chunk, PROT_READ, MAP_SHARED, fd, static_cast<off_t>(position));
+        if (mapping == MAP_FAILED) {
+            break;
+        }
+        
+        pages.resize((chunk + page_size - 1) / page_size);
+        if (mincore(mapping, chunk, pages.data()) == 0) {
+            for (unsigned char page : pages) {
+                resident += (page & 1) ? page_size : 0;
+            }
+        }
+        munmap(mapping, chunk);
+    }
+    
+    return std::min(resident, length);
+}
+
+}
+
+PrefetchManager::PrefetchManager(Logger& log)
+    : logger(log), record_seconds(30), record_enabled(false), stopping(false) {
+}
+
+PrefetchManager::~PrefetchManager() {
+    stopping = true;
+    for (auto& task : tasks) {
+        if (task.valid()) {
+            task.wait();
+        }
+    }
+}
+
+void PrefetchManager::configure(const std::string& directory, int seconds) {
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    root = directory;
+    record_seconds = seconds;
+}
+
+void PrefetchManager::set_recording_enabled(bool enabled) {
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    record_enabled = enabled;
+}
+
+std::string PrefetchManager::profile_path(const std::string& application) const {
+    return Utils::join_paths(root, application + PROFILE_EXTENSION);
+}
+
+void PrefetchManager::add_range(std::vector<PrefetchRange>& ranges, uint64_t offset, uint64_t length) {
+    if (length == 0) {
+        return;
+    }
+    
+    uint64_t end = offset + length;
+    auto it = std::lower_bound(ranges.begin(), ranges.end(), offset,
+                               [](const PrefetchRange& range, uint64_t value) {
+                                   return range.offset + range.length < value;
+                               });
+    
+    auto last = it;
+    while (last != ranges.end() && last->offset <= end) {
+        offset = std::min(offset, last->offset);
+        end = std::max(end, last->offset + last->length);
+        ++last;
+    }
+    
+    it = ranges.erase(it, last);
+    ranges.insert(it, PrefetchRange{offset, end - offset});
+}
+
+bool PrefetchManager::collect_files(pid_t pid, std::vector<PrefetchFile>& files,
+                                    std::map<std::string, size_t>& index) {
+    std::string proc = "/proc/" + std::to_string(pid);
+    std::ifstream maps(proc + "/maps");
+    if (!maps.is_open()) {
+        return false;
+    }
+    
+    std::string line;
+    while (std::getline(maps, line)) {
+        unsigned long long start, end, offset;
+        unsigned long inode;
+        int path_start = 0;
+        if (sscanf(line.c_str(), "%llx-%llx %*s %llx %*s %lu %n", &start, &end, &offset, &inode, &path_start) < 4 ||
+            inode == 0 || path_start == 0) {
+            continue;
+        }
+        
+        std::string path = line.substr(static_cast<size_t>(path_start));
+        uint64_t size = 0;
+        PrefetchFile* file = find_file(path, files, index, size);
+        if (file && (size == 0 || offset < size)) {
+            uint64_t length = end - start;
+            if (size > 0) length = std::min<uint64_t>(length, size - offset);
+            add_range(file->ranges, offset, length);
+        }
+    }
+    
+    std::string fd_directory = proc + "/fd";
+    for (const auto& fd : Utils::list_directory(fd_directory)) {
+        char target[PATH_MAX];
+        ssize_t len = readlink(Utils::join_paths(fd_directory, fd).c_str(), target, sizeof(target) - 1);
+        if (len <= 0) continue;
+        target[len] = '\0';
+        
+        uint64_t size = 0;
+        PrefetchFile* file = find_file(target, files, index, size);
+        if (file && size > 0 && file->ranges.empty()) {
+            add_range(file->ranges, 0, std::min(size, MAX_OPEN_FILE_BYTES));
+        }
+    }
+    
+    return true;
+}
+
+bool PrefetchManager::read_profile(const std::string& path, const std::string& wine_prefix,
+                                   std::vector<PrefetchFile>& files) {
+    std::ifstream input(path);
+    std::string line;
+    if (!input.is_open() || !std::getline(input, line) || line != PROFILE_HEADER) {
+        return false;
+    }
+    
+    std::string prefix = wine_prefix;
+    files.clear();
+    while (std::getline(input, line)) {
+        if (line.compare(0, strlen(PREFIX_MARKER), PREFIX_MARKER) == 0) {
+            if (prefix.empty()) prefix = line.substr(strlen(PREFIX_MARKER));
+            continue;
+        }
+        
+        size_t tab = line.find('\t');
+        if (line.empty() || line[0] == '#' || tab == std::string::npos) continue;
+        
+        PrefetchFile file;
+        file.path = line.substr(0, tab);
+        if (file.path[0] != '/') {
+            file.path = Utils::join_paths(prefix, file.path);
+        }
+        
+        std::istringstream ranges(line.substr(tab + 1));
+        std::string range;
+        while (std::getline(ranges, range, ',')) {
+            unsigned long long offset, length;
+            if (sscanf(range.c_str(), "%llu+%llu", &offset, &length) == 2) {
+                add_range(file.ranges, offset, length);
+            }
+        }
+        
+        if (!file.ranges.empty()) {
+            files.push_back(file);
+        }
+    }
+    
+    return !files.empty();
+}
+
+bool PrefetchManager::write_profile(const std::string& path, const std::string& wine_prefix,
+                                    const std::vector<PrefetchFile>& files) {
+    std::string prefix = wine_prefix;
+    while (!prefix.empty() && prefix.back() == '/') prefix.pop_back();
+    prefix += "/";
+    
+    std::string content = std::string(PROFILE_HEADER) + "\n" + PREFIX_MARKER + wine_prefix + "\n";
+    for (const auto& file : files) {
+        if (file.ranges.empty()) continue;
+        
+        bool in_prefix = prefix.size() > 1 && file.path.compare(0, prefix.size(), prefix) == 0;
+        content += in_prefix ? file.path.substr(prefix.size()) : file.path;
+        for (size_t i = 0; i < file.ranges.size(); ++i) {
+            content += (i == 0 ? "\t" : ",") + std::to_string(file.ranges[i].offset) + "+" +
+                       std::to_string(file.ranges[i].length);
+        }
+        content += "\n";
+    }
+    
+    std::string temp_path = path + ".tmp";
+    if (!Utils::write_file(temp_path, content) || rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+PrefetchReport PrefetchManager::measure(const std::vector<PrefetchFile>& files, bool load) {
+    size_t page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    std::atomic<size_t> next(0);
+    std::atomic<size_t> opened(0);
+    std::atomic<uint64_t> total(0);
+    std::atomic<uint64_t> resident(0);
+    auto start = std::chrono::steady_clock::now();
+    
+    auto worker = [&]() {
+        for (size_t i = next++; i < files.size(); i = next++) {
+            int fd = open(files[i].path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd == -1) continue;
+            
+            struct stat st;
+            uint64_t size = fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+            for (const auto& range : files[i].ranges) {
+                uint64_t offset = range.offset / page_size * page_size;
+                if (offset >= size) break;
+                uint64_t length = std::min(range.offset + range.length, size) - offset;
+                
+                total += length;
+                resident += resident_bytes(fd, offset, length, page_size);
+                if (load && readahead(fd, static_cast<off64_t>(offset), static_cast<size_t>(length)) != 0) {
+                    posix_fadvise(fd, static_cast<off_t>(offset), static_cast<off_t>(length), POSIX_FADV_WILLNEED);
+                }
+            }
+            
+            ++opened;
+            close(fd);
+        }
+    };
+    
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < std::min(REPLAY_WORKERS, files.size()); ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+    
+    PrefetchReport report;
+    report.files = opened;
+    report.bytes = total;
+    report.resident_bytes = resident;
+    report.duration_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return report;
+}
+
+void PrefetchManager::reap_tasks_locked() {
+    tasks.erase(std::remove_if(tasks.begin(), tasks.end(), [](std::future<void>& task) {
+        return !task.valid() || task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }), tasks.end());
+}
+
+void PrefetchManager::replay(const std::string& application, std::vector<PrefetchFile> files) {
+    TraceSpan span("prefetch replay", "prefetch", application);
+    PrefetchReport report = measure(files, true);
+    report.application = application;
+    
+    char ratio[16];
+    snprintf(ratio, sizeof(ratio), "%.1f%%", report.hit_ratio() * 100.0);
+    logger.info("Prefetched " + std::to_string(report.files) + " files (" + std::to_string(report.bytes >> 20) +
+                " MB) for " + application + " in " + std::to_string(static_cast<long>(report.duration_ms)) +
+                " ms, page cache hit ratio " + ratio);
+    
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    reports[application] = report;
+}
+
+void PrefetchManager::record(const std::string& application, const std::string& wine_prefix, pid_t pid,
+                             int seconds) {
+    std::vector<PrefetchFile> files;
+    std::map<std::string, size_t> index;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+    
+    bool interrupted = false;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (stopping) {
+            interrupted = true;
+            break;
+        }
+        
+        std::map<pid_t, ProcStat> processes;
+        ProcessTree::scan_proc(processes);
+        
+        std::set<pid_t> tree = {pid};
+        for (bool grew = true; grew;) {
+            grew = false;
+            for (const auto& process : processes) {
+                if (tree.count(process.second.parent_pid) && tree.insert(process.first).second) {
+                    grew = true;
+                }
+            }
+        }
+        
+        bool alive = false;
+        for (pid_t member : tree) {
+            auto it = processes.find(member);
+            if (it != processes.end() && it->second.state != 'Z') {
+                alive = collect_files(member, files, index) || alive;
+            }
+        }
+        if (!alive) break;
+        
+        std::this_thread::sleep_for(RECORD_INTERVAL);
+    }
+    
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        recording.erase(application);
+        path = profile_path(application);
+    }
+    
+    if (interrupted) {
+        logger.debug("Discarding interrupted prefetch recording of " + application);
+        return;
+    }
+    
+    uint64_t bytes = 0;
+    size_t count = 0;
+    for (const auto& file : files) {
+        for (const auto& range : file.ranges) {
+            bytes += range.length;
+        }
+        count += file.ranges.empty() ? 0 : 1;
+    }
+    
+    if (count == 0) {
+        logger.debug("No file accesses recorded for " + application);
+    } else if (!Utils::create_directory(Utils::get_directory(path)) || !write_profile(path, wine_prefix, files)) {
+        logger.warning("Cannot write prefetch profile " + path + ": " + strerror(errno));
+    } else {
+        logger.info("Recorded prefetch profile for " + application + ": " + std::to_string(count) + " files, " +
+                    std::to_string(bytes >> 20) + " MB");
+    }
+}
+
+bool PrefetchManager::start(const std::string& exe_path, const std::string& wine_prefix) {
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    reap_tasks_locked();
+    if (root.empty()) {
+        return true;
+    }
+    
+    std::string application = ShaderCacheManager::application_id(exe_path, wine_prefix);
+    if (recording.count(application)) {
+        return true;
+    }
+    
+    std::vector<PrefetchFile> files;
+    if (!read_profile(profile_path(application), wine_prefix, files)) {
+        return false;
+    }
+    
+    tasks.push_back(std::async(std::launch::async, [this, application, files]() mutable {
+        replay(application, std::move(files));
+    }));
+    return true;
+}
+
+void PrefetchManager::track(pid_t pid, const std::string& exe_path, const std::string& wine_prefix) {
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    std::string application = ShaderCacheManager::application_id(exe_path, wine_prefix);
+    if (root.empty() || record_seconds <= 0 || !record_enabled || !recording.insert(application).second) {
+        return;
+    }
+    
+    logger.info("Recording file accesses of " + application + " for " + std::to_string(record_seconds) + "s");
+    tasks.push_back(std::async(std::launch::async, [this, application, wine_prefix, pid, seconds = record_seconds]() {
+        record(application, wine_prefix, pid, seconds);
+    }));
+}
+
+std::vector<std::string> PrefetchManager::list() {
+    std::string directory;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        directory = root;
+    }
+    
+    std::vector<std::string> applications;
+    size_t extension = strlen(PROFILE_EXTENSION);
+    for (const auto& name : Utils::list_directory(directory)) {
+        if (name.size() > extension && name.compare(name.size() - extension, extension, PROFILE_EXTENSION) == 0) {
+            applications.push_back(name.substr(0, name.size() - extension));
+        }
+    }
+    std::sort(applications.begin(), applications.end());
+    return applications;
+}
+
+std::vector<PrefetchReport> PrefetchManager::get_reports() {
+    std::lock_guard<std::mutex> lock(prefetch_mutex);
+    std::vector<PrefetchReport> result;
+    for (const auto& report : reports) {
+        result.push_back(report.second);
+    }
+    return result;
+}
+
+size_t PrefetchManager::clear(const std::string& application) {
+    size_t removed = 0;
+    for (const auto& name : list()) {
+        if ((application.empty() || name == application) && unlink(profile_path(name).c_str()) == 0) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+}
@@ -0,0 +1,240 @@
+#include "wine_wrapper.hpp"
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#include <cerrno>
+
+#ifndef FICLONE
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
+namespace WineWrapper {
+
+PrefixCloner::PrefixCloner(Logger& log) : logger(log), method(CloneMethod::AUTO) {
+}
+
+void PrefixCloner::set_method(CloneMethod value) {
+    method = value;
+}
+
+bool PrefixCloner::always_copied(const std::string& path) {
+    std::string name = Utils::get_filename(path);
+    return Utils::get_extension(path) == ".reg" || name == "config.ini";
+}
+
+bool PrefixCloner::collect_entries(const std::string& root, const std::string& relative,
+                                   std::vector<Entry>& entries) {
+    std::string directory = relative.empty() ? root : Utils::join_paths(root, relative);
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) {
+        logger.error("Failed to read directory " + directory + ": " + strerror(errno));
+        return false;
+    }
+    
+    std::vector<std::string> subdirectories;
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        
+        std::string child = relative.empty() ? entry->d_name : relative + "/" + entry->d_name;
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        
+        entries.push_back({child, st.st_mode, S_ISREG(st.st_mode) ? static_cast<uint64_t>(st.st_size) : 0});
+        if (S_ISDIR(st.st_mode)) {
+            subdirectories.push_back(child);
+        }
+    }
+    closedir(dir);
+    
+    for (const auto& subdirectory : subdirectories) {
+        if (!collect_entries(root, subdirectory, entries)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool PrefixCloner::clone_file(const std::string& source, const std::string& destination,
+                              const struct stat& st, CloneProgress& progress) {
+    if (method == CloneMethod::HARDLINK && !always_copied(source)) {
+        if (link(source.c_str(), destination.c_str()) == 0) {
+            progress.hardlinked_files++;
+            return true;
+        }
+        if (errno != EXDEV && errno != EPERM && errno != EMLINK) {
+            logger.error("Failed to link " + source + ": " + strerror(errno));
+            return false;
+        }
+    }
+    
+    int in = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in == -1) {
+        logger.error("Failed to open " + source + ": " + strerror(errno));
+        return false;
+    }
+    
+    int out = open(destination.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, st.st_mode & 07777);
+    if (out == -1) {
+        logger.error("Failed to create " + destination + ": " + strerror(errno));
+        close(in);
+        return false;
+    }
+    
+    bool success = false;
+    
+    if (method != CloneMethod::COPY && ioctl(out, FICLONE, in) == 0) {
+        progress.reflinked_files++;
+        success = true;
+    } else if (method == CloneMethod::REFLINK) {
+        logger.error("Filesystem does not support reflinks for " + source + ": " + strerror(errno));
+    } else {
+        off_t remaining = st.st_size;
+        bool use_copy_range = true;
+        
+        while (remaining > 0) {
+            ssize_t n = -1;
+            if (use_copy_range) {
+                n = copy_file_range(in, nullptr, out, nullptr, static_cast<size_t>(remaining), 0);
+                if (n == -1 && remaining == st.st_size &&
+                    (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)) {
+                    use_copy_range = false;
+                    continue;
+                }
+            } else {
+                char buffer[1 << 16];
+                n = read(in, buffer, sizeof(buffer));
+                for (ssize_t offset = 0; n > 0 && offset < n;) {
+                    ssize_t written = write(out, buffer + offset, static_cast<size_t>(n - offset));
+                    if (written <= 0) {
+                        n = -1;
+                        break;
+                    }
+                    offset += written;
+                }
+            }
+            
+            if (n == -1 && errno == EINTR) continue;
+            if (n <= 0) break;
+            remaining -= n;
+        }
+        
+        success = remaining <= 0;
+        if (success) {
+            progress.copied_files++;
+        } else {
+            logger.error("Failed to copy " + source + ": " + strerror(errno));
+        }
+    }
+    
+    if (success) {
+        struct timespec times[2] = {st.st_atim, st.st_mtim};
+        futimens(out, times);
+    }
+    
+    close(in);
+    close(out);
+    return success;
+}
+
+bool PrefixCloner::clone_symlink(const std::string& source, const std::string& destination,
+                                 const std::string& source_root, const std::string& destination_root) {
+    char target[PATH_MAX];
+    ssize_t length = readlink(source.c_str(), target, sizeof(target) - 1);
+    if (length == -1) {
+        logger.error("Failed to read link " + source + ": " + strerror(errno));
+        return false;
+    }
+    
+    std::string link_target(target, static_cast<size_t>(length));
+    if (link_target.compare(0, source_root.size(), source_root) == 0 &&
+        (link_target.size() == source_root.size() || link_target[source_root.size()] == '/')) {
+        link_target = destination_root + link_target.substr(source_root.size());
+    }
+    
+    if (symlink(link_target.c_str(), destination.c_str()) != 0) {
+        logger.error("Failed to create link " + destination + ": " + strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+bool PrefixCloner::clone_tree(const std::string& source, const std::string& destination,
+                              const CloneProgressCallback& callback, CloneProgress& progress) {
+    auto start = std::chrono::steady_clock::now();
+    memset(&progress, 0, sizeof(progress));
+    
+    struct stat root_stat;
+    if (stat(source.c_str(), &root_stat) != 0 || !S_ISDIR(root_stat.st_mode)) {
+        logger.error("Clone source is not a directory: " + source);
+        return false;
+    }
+    
+    if (mkdir(destination.c_str(), (root_stat.st_mode & 07777) | S_IRWXU) != 0) {
+        logger.error("Failed to create " + destination + ": " + strerror(errno));
+        return false;
+    }
+    
+    std::vector<Entry> entries;
+    if (!collect_entries(source, "", entries)) {
+        return false;
+    }
+    
+    for (const auto& entry : entries) {
+        if (S_ISREG(entry.mode)) {
+            progress.files_total++;
+            progress.bytes_total += entry.size;
+        }
+    }
+    
+    auto report = [&]() {
+        progress.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (callback) {
+            callback(progress);
+        }
+    };
+    
+    uint64_t reported_bytes = 0;
+    for (const auto& entry : entries) {
+        std::string from = Utils::join_paths(source, entry.relative_path);
+        std::string to = Utils::join_paths(destination, entry.relative_path);
+        
+        if (S_ISDIR(entry.mode)) {
+            if (mkdir(to.c_str(), (entry.mode & 07777) | S_IRWXU) != 0 && errno != EEXIST) {
+                logger.error("Failed to create " + to + ": " + strerror(errno));
+                return false;
+            }
+        } else if (S_ISLNK(entry.mode)) {
+            if (!clone_symlink(from, to, source, destination)) {
+                return false;
+            }
+        } else if (S_ISREG(entry.mode)) {
+            struct stat st;
+            if (lstat(from.c_str(), &st) != 0 || !clone_file(from, to, st, progress)) {
+                return false;
+            }
+            progress.files_done++;
+            progress.bytes_done += entry.size;
+            
+            if (progress.files_done % 256 == 0 || progress.bytes_done - reported_bytes >= (64u << 20)) {
+                reported_bytes = progress.bytes_done;
+                report();
+            }
+        }
+    }
+    
+    report();
+    logger.info("Cloned " + std::to_string(progress.files_done) + " files (" +
+                std::to_string(progress.bytes_done >> 20) + " MB) from " + source + " in " +
+                std::to_string(static_cast<int>(progress.elapsed_ms)) + " ms: " +
+                std::to_string(progress.reflinked_files) + " reflinked, " +
+                std::to_string(progress.hardlinked_files) + " hardlinked, " +
+                std::to_string(progress.copied_files) + " copied");
+    return true;
+}
+
+}
@@ -0,0 +1,340 @@
+#include "wine_wrapper.hpp"
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <dirent.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+namespace {
+
+struct LinuxDirent64 {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+};
+
+const size_t MAX_QUEUED_DIRECTORIES = 512;
+
+const char* const SIGNATURE_PATHS[] = {
+    ".", "drive_c", "drive_c/windows", "drive_c/users", "drive_c/Program Files",
+    "drive_c/Program Files (x86)", "dosdevices", "system.reg", "user.reg", "userdef.reg"
+};
+
+}
+
+PrefixScanner::PrefixScanner(Logger& log)
+    : logger(log), thread_count(std::max(1u, std::min(8u, std::thread::hardware_concurrency()))),
+      max_age(std::chrono::seconds(600)) {
+    cache_directory = Utils::join_paths(Utils::get_home_directory(), ".cache/wine-wrapper/prefix-scan");
+}
+
+void PrefixScanner::set_threads(size_t count) {
+    thread_count = count > 0 ? count : 1;
+}
+
+void PrefixScanner::set_max_age(std::chrono::seconds age) {
+    max_age = age;
+}
+
+void PrefixScanner::push_task(ScanRun& run, int fd, ScanTarget* target) {
+    {
+        std::lock_guard<std::mutex> lock(run.run_mutex);
+        if (run.tasks.size() < MAX_QUEUED_DIRECTORIES) {
+            run.tasks.push_back({fd, target});
+            run.outstanding++;
+            run.run_cv.notify_one();
+            return;
+        }
+    }
+    
+    scan_directory(run, fd, target);
+}
+
+void PrefixScanner::scan_directory(ScanRun& run, int fd, ScanTarget* target) {
+    target->directories.fetch_add(1, std::memory_order_relaxed);
+    
+    char buffer[32768];
+    for (;;) {
+        long n = syscall(SYS_getdents64, fd, buffer, sizeof(buffer));
+        if (n <= 0) {
+            break;
+        }
+        
+        for (long offset = 0; offset < n;) {
+            auto* entry = reinterpret_cast<LinuxDirent64*>(buffer + offset);
+            offset += entry->d_reclen;
+            
+            const char* name = entry->d_name;
+            if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) {
+                continue;
+            }
+            
+            unsigned char type = entry->d_type;
+            struct stat st;
+            if (type == DT_REG || type == DT_UNKNOWN) {
+                if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                    continue;
+                }
+                type = S_ISDIR(st.st_mode) ? DT_DIR : S_ISREG(st.st_mode) ? DT_REG : DT_LNK;
+            }
+            
+            if (type == DT_DIR) {
+                int child = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+                if (child != -1) {
+                    push_task(run, child, target);
+                }
+            } else if (type == DT_REG) {
+                if (st.st_nlink > 1) {
+                    std::lock_guard<std::mutex> lock(target->linked_mutex);
+                    if (!target->linked_inodes.insert({st.st_dev, st.st_ino}).second) {
+                        continue;
+                    }
+                }
+                target->files.fetch_add(1, std::memory_order_relaxed);
+                target->bytes.fetch_add(static_cast<uint64_t>(st.st_size), std::memory_order_relaxed);
+            }
+        }
+    }
+    
+    close(fd);
+}
+
+void PrefixScanner::scan_worker(ScanRun& run) {
+    for (;;) {
+        ScanTask task;
+        
+        {
+            std::unique_lock<std::mutex> lock(run.run_mutex);
+            run.run_cv.wait(lock, [&run] { return !run.tasks.empty() || run.outstanding == 0; });
+            if (run.tasks.empty()) {
+                return;
+            }
+            task = run.tasks.back();
+            run.tasks.pop_back();
+        }
+        
+        scan_directory(run, task.fd, task.target);
+        
+        std::lock_guard<std::mutex> lock(run.run_mutex);
+        if (--run.outstanding == 0) {
+            run.run_cv.notify_all();
+        }
+    }
+}
+
+std::map<std::string, PrefixScanResult> PrefixScanner::scan_many(const std::vector<std::string>& prefix_paths) {
+    auto start = std::chrono::steady_clock::now();
+    
+    std::vector<std::unique_ptr<ScanTarget>> targets;
+    std::vector<std::string> signatures;
+    ScanRun run;
+    run.outstanding = 0;
+    
+    for (const auto& path : prefix_paths) {
+        auto target = std::make_unique<ScanTarget>();
+        target->bytes = 0;
+        target->files = 0;
+        target->directories = 0;
+        signatures.push_back(compute_signature(path));
+        
+        int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd != -1) {
+            run.tasks.push_back({fd, target.get()});
+            run.outstanding++;
+        }
+        targets.push_back(std::move(target));
+    }
+    
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers.emplace_back(&PrefixScanner::scan_worker, this, std::ref(run));
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    time_t now = time(nullptr);
+    
+    std::map<std::string, PrefixScanResult> results;
+    for (size_t i = 0; i < prefix_paths.size(); ++i) {
+        CachedScan entry;
+        entry.result.total_bytes = targets[i]->bytes;
+        entry.result.file_count = targets[i]->files;
+        entry.result.directory_count = targets[i]->directories;
+        entry.result.valid = check_integrity(prefix_paths[i]);
+        entry.result.cached = false;
+        entry.result.scan_ms = elapsed;
+        entry.result.scanned_at = now;
+        entry.signature = signatures[i];
+        
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            cache[prefix_paths[i]] = entry;
+        }
+        store_cached(prefix_paths[i], entry);
+        results[prefix_paths[i]] = entry.result;
+    }
+    
+    logger.debug("Scanned " + std::to_string(prefix_paths.size()) + " prefixes with " +
+                 std::to_string(thread_count) + " threads in " + std::to_string(static_cast<int>(elapsed)) + " ms");
+    return results;
+}
+
+PrefixScanResult PrefixScanner::get(const std::string& prefix_path) {
+    return get_many({prefix_path})[prefix_path];
+}
+
+std::map<std::string, PrefixScanResult> PrefixScanner::get_many(const std::vector<std::string>& prefix_paths) {
+    std::map<std::string, PrefixScanResult> results;
+    std::vector<std::string> stale;
+    time_t now = time(nullptr);
+    
+    for (const auto& path : prefix_paths) {
+        CachedScan entry;
+        bool found = false;
+        
+        {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto it = cache.find(path);
+            if (it != cache.end()) {
+                entry = it->second;
+                found = true;
+            }
+        }
+        if (!found) {
+            found = load_cached(path, entry);
+        }
+        
+        if (found && now - entry.result.scanned_at < max_age.count() && entry.signature == compute_signature(path)) {
+            entry.result.cached = true;
+            results[path] = entry.result;
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            cache[path] = entry;
+        } else {
+            stale.push_back(path);
+        }
+    }
+    
+    if (!stale.empty()) {
+        auto scanned = scan_many(stale);
+        results.insert(scanned.begin(), scanned.end());
+    }
+    
+    return results;
+}
+
+void PrefixScanner::invalidate(const std::string& prefix_path) {
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cache.erase(prefix_path);
+    }
+    unlink(cache_file(prefix_path).c_str());
+}
+
+bool PrefixScanner::check_integrity(const std::string& prefix_path) {
+    int fd = open(prefix_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    bool valid = true;
+    struct stat st;
+    for (const char* file : {"system.reg", "user.reg", "userdef.reg"}) {
+        valid = valid && fstatat(fd, file, &st, 0) == 0 && S_ISREG(st.st_mode);
+    }
+    for (const char* dir : {"dosdevices", "drive_c"}) {
+        valid = valid && fstatat(fd, dir, &st, 0) == 0 && S_ISDIR(st.st_mode);
+    }
+    
+    close(fd);
+    return valid;
+}
+
+std::string PrefixScanner::compute_signature(const std::string& prefix_path) {
+    int fd = open(prefix_path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd == -1) {
+        return "";
+    }
+    
+    std::string signature;
+    char part[96];
+    for (const char* path : SIGNATURE_PATHS) {
+        struct stat st;
+        if (fstatat(fd, path, &st, AT_SYMLINK_NOFOLLOW) == 0) {
+            snprintf(part, sizeof(part), "%llx:%lld.%ld:%lld;", static_cast<unsigned long long>(st.st_ino),
+                     static_cast<long long>(st.st_mtim.tv_sec), st.st_mtim.tv_nsec,
+                     static_cast<long long>(st.st_size));
+            signature += part;
+        } else {
+            signature += "-;";
+        }
+    }
+    
+    close(fd);
+    return signature;
+}
+
+std::string PrefixScanner::cache_file(const std::string& prefix_path) {
+    char name[32];
+    snprintf(name, sizeof(name), "%016zx", std::hash<std::string>()(prefix_path));
+    return Utils::join_paths(cache_directory, name);
+}
+
+bool PrefixScanner::load_cached(const std::string& prefix_path, CachedScan& entry) {
+    std::ifstream file(cache_file(prefix_path));
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::map<std::string, std::string> fields;
+    std::string line;
+    while (std::getline(file, line)) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            fields[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+    
+    if (fields["path"] != prefix_path || fields["signature"].empty()) {
+        return false;
+    }
+    
+    entry.signature = fields["signature"];
+    entry.result.total_bytes = strtoull(fields["bytes"].c_str(), nullptr, 10);
+    entry.result.file_count = strtoull(fields["files"].c_str(), nullptr, 10);
+    entry.result.directory_count = strtoull(fields["directories"].c_str(), nullptr, 10);
+    entry.result.valid = fields["valid"] == "1";
+    entry.result.cached = true;
+    entry.result.scan_ms = strtod(fields["scan_ms"].c_str(), nullptr);
+    entry.result.scanned_at = static_cast<time_t>(strtoll(fields["scanned"].c_str(), nullptr, 10));
+    return true;
+}
+
+void PrefixScanner::store_cached(const std::string& prefix_path, const CachedScan& entry) {
+    if (!Utils::create_directory(cache_directory)) {
+        return;
+    }
+    
+    std::string path = cache_file(prefix_path);
+    std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    
+    std::ostringstream content;
+    content << "path=" << prefix_path << "\n"
+            << "signature=" << entry.signature << "\n"
+            << "bytes=" << entry.result.total_bytes << "\n"
+            << "files=" << entry.result.file_count << "\n"
+            << "directories=" << entry.result.directory_count << "\n"
+            << "valid=" << (entry.result.valid ? 1 : 0) << "\n"
+            << "scan_ms=" << entry.result.scan_ms << "\n"
+            << "scanned=" << static_cast<long long>(entry.result.scanned_at) << "\n";
+    
+    if (Utils::write_file(temp_path, content.str()) && rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+    }
+}
+
+}
@@ -0,0 +1,388 @@
+#include "wine_wrapper.hpp"
+#include <unistd.h>
+#include <fcntl.h>
+#include <cstdio>
+#include <cerrno>
+#include <dirent.h>
+
+namespace WineWrapper {
+
+namespace {
+
+const char* skip_spaces(const char* p, const char* end) {
+    while (p < end && *p == ' ') ++p;
+    return p;
+}
+
+const char* parse_number(const char* p, const char* end, unsigned long long& value) {
+    p = skip_spaces(p, end);
+    bool negative = false;
+    if (p < end && *p == '-') {
+        negative = true;
+        ++p;
+    }
+    
+    value = 0;
+    const char* start = p;
+    while (p < end && *p >= '0' && *p <= '9') {
+        value = value * 10 + static_cast<unsigned long long>(*p - '0');
+        ++p;
+    }
+    
+    if (p == start) return nullptr;
+    if (negative) value = static_cast<unsigned long long>(-static_cast<long long>(value));
+    return p;
+}
+
+const char* skip_fields(const char* p, const char* end, int count) {
+    unsigned long long ignored;
+    for (int i = 0; i < count && p; ++i) {
+        p = parse_number(p, end, ignored);
+    }
+    return p;
+}
+
+ssize_t read_proc_fd(int fd, char* buffer, size_t size) {
+    ssize_t length;
+    do {
+        length = pread(fd, buffer, size - 1, 0);
+    } while (length == -1 && errno == EINTR);
+    
+    if (length > 0) {
+        buffer[length] = '\0';
+    }
+    return length;
+}
+
+}
+
+ProcessSampler::ProcessSampler() {
+    clock_ticks = sysconf(_SC_CLK_TCK);
+    if (clock_ticks <= 0) clock_ticks = 100;
+    
+    long page = sysconf(_SC_PAGESIZE);
+    page_size = page > 0 ? static_cast<size_t>(page) : 4096;
+}
+
+ProcessSampler::~ProcessSampler() {
+    for (auto& pair : handles) {
+        close_handle(pair.second);
+    }
+}
+
+bool ProcessSampler::open_handle(pid_t pid, SampleHandle& handle) {
+    char path[64];
+    
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    handle.stat_fd = open(path, O_RDONLY | O_CLOEXEC);
+    
+    snprintf(path, sizeof(path), "/proc/%d/statm", static_cast<int>(pid));
+    handle.statm_fd = open(path, O_RDONLY | O_CLOEXEC);
+    
+    handle.start_time = 0;
+    handle.last_ticks = 0;
+    handle.has_baseline = false;
+    
+    if (handle.stat_fd == -1 || handle.statm_fd == -1) {
+        close_handle(handle);
+        return false;
+    }
+    
+    return true;
+}
+
+void ProcessSampler::close_handle(SampleHandle& handle) {
+    if (handle.stat_fd != -1) {
+        close(handle.stat_fd);
+        handle.stat_fd = -1;
+    }
+    if (handle.statm_fd != -1) {
+        close(handle.statm_fd);
+        handle.statm_fd = -1;
+    }
+}
+
+bool ProcessSampler::read_handle(SampleHandle& handle, ProcStat& stat, ProcStatm& statm) {
+    char buffer[1024];
+    
+    ssize_t length = read_proc_fd(handle.stat_fd, buffer, sizeof(buffer));
+    if (length <= 0 || !parse_stat(buffer, static_cast<size_t>(length), stat)) {
+        return false;
+    }
+    
+    length = read_proc_fd(handle.statm_fd, buffer, sizeof(buffer));
+    if (length <= 0 || !parse_statm(buffer, static_cast<size_t>(length), statm)) {
+        return false;
+    }
+    
+    return true;
+}
+
+bool ProcessSampler::sample(pid_t pid, ProcessStats& stats) {
+    auto it = handles.find(pid);
+    if (it == handles.end()) {
+        SampleHandle handle;
+        if (!open_handle(pid, handle)) {
+            return false;
+        }
+        it = handles.emplace(pid, handle).first;
+    }
+    
+    SampleHandle& handle = it->second;
+    ProcStat stat;
+    ProcStatm statm;
+    
+    if (!read_handle(handle, stat, statm)) {
+        close_handle(handle);
+        if (!open_handle(pid, handle) || !read_handle(handle, stat, statm)) {
+            close_handle(handle);
+            handles.erase(it);
+            return false;
+        }
+    }
+    
+    auto now = std::chrono::steady_clock::now();
+    unsigned long long ticks = stat.utime + stat.stime;
+    
+    if (handle.has_baseline && handle.start_time == stat.start_time && ticks >= handle.last_ticks) {
+        double elapsed = std::chrono::duration<double>(now - handle.last_sample).count();
+        double cpu_seconds = static_cast<double>(ticks - handle.last_ticks) / clock_ticks;
+        stats.cpu_usage = elapsed > 0.0 ? cpu_seconds / elapsed * 100.0 : 0.0;
+    } else {
+        stats.cpu_usage = 0.0;
+    }
+    
+    handle.start_time = stat.start_time;
+    handle.last_ticks = ticks;
+    handle.last_sample = now;
+    handle.has_baseline = true;
+    
+    stats.pid = pid;
+    stats.state = state_from_code(stat.state);
+    stats.memory_usage = statm.resident_pages * page_size;
+    
+    return true;
+}
+
+void ProcessSampler::retain(const std::vector<pid_t>& pids) {
+    for (auto it = handles.begin(); it != handles.end();) {
+        if (std::find(pids.begin(), pids.end(), it->first) == pids.end()) {
+            close_handle(it->second);
+            it = handles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ProcessSampler::parse_stat(const char* buffer, size_t length, ProcStat& stat) {
+    const char* end = buffer + length;
+    const char* p = end;
+    
+    while (p > buffer && *(p - 1) != ')') --p;
+    if (p == buffer) return false;
+    
+    p = skip_spaces(p, end);
+    if (p >= end) return false;
+    stat.state = *p++;
+    
+    unsigned long long value;
+    
+    p = parse_number(p, end, value);
+    if (!p) return false;
+    stat.parent_pid = static_cast<pid_t>(value);
+    
+    p = skip_fields(p, end, 9);
+    p = p ? parse_number(p, end, stat.utime) : nullptr;
+    p = p ? parse_number(p, end, stat.stime) : nullptr;
+    p = p ? skip_fields(p, end, 4) : nullptr;
+    p = p ? parse_number(p, end, value) : nullptr;
+    if (!p) return false;
+    stat.num_threads = static_cast<long>(value);
+    
+    p = skip_fields(p, end, 1);
+    p = p ? parse_number(p, end, stat.start_time) : nullptr;
+    p = p ? skip_fields(p, end, 1) : nullptr;
+    p = p ? parse_number(p, end, value) : nullptr;
+    if (!p) return false;
+    stat.rss_pages = static_cast<size_t>(value);
+    
+    p = skip_fields(p, end, 14);
+    stat.processor = (p && parse_number(p, end, value)) ? static_cast<int>(value) : -1;
+    
+    return true;
+}
+
+bool ProcessSampler::parse_statm(const char* buffer, size_t length, ProcStatm& statm) {
+    const char* end = buffer + length;
+    unsigned long long size, resident, shared;
+    
+    const char* p = parse_number(buffer, end, size);
+    p = p ? parse_number(p, end, resident) : nullptr;
+    p = p ? parse_number(p, end, shared) : nullptr;
+    if (!p) return false;
+    
+    statm.size_pages = static_cast<size_t>(size);
+    statm.resident_pages = static_cast<size_t>(resident);
+    statm.shared_pages = static_cast<size_t>(shared);
+    return true;
+}
+
+ProcessState ProcessSampler::state_from_code(char code) {
+    switch (code) {
+        case 'R': return ProcessState::RUNNING;
+        case 'S': return ProcessState::RUNNING;
+        case 'D': return ProcessState::RUNNING;
+        case 'T': return ProcessState::PAUSED;
+        case 't': return ProcessState::PAUSED;
+        case 'Z': return ProcessState::STOPPED;
+        case 'X': return ProcessState::STOPPED;
+        default: return ProcessState::RUNNING;
+    }
+}
+
+bool ProcessTree::scan_proc(std::map<pid_t, ProcStat>& processes) {
+    int proc_fd = open("/proc", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (proc_fd == -1) {
+        return false;
+    }
+    
+    DIR* proc_dir = fdopendir(proc_fd);
+    if (!proc_dir) {
+        close(proc_fd);
+        return false;
+    }
+    
+    char path[64];
+    char buffer[1024];
+    struct dirent* entry;
+    
+    while ((entry = readdir(proc_dir)) != nullptr) {
+        if (entry->d_name[0] < '1' || entry->d_name[0] > '9') continue;
+        
+        if (snprintf(path, sizeof(path), "%s/stat", entry->d_name) >= static_cast<int>(sizeof(path))) continue;
+        int fd = openat(proc_fd, path, O_RDONLY | O_CLOEXEC);
+        if (fd == -1) continue;
+        
+        ssize_t length = read_proc_fd(fd, buffer, sizeof(buffer));
+        close(fd);
+        
+        ProcStat stat;
+        if (length > 0 && ProcessSampler::parse_stat(buffer, static_cast<size_t>(length), stat)) {
+            processes[static_cast<pid_t>(atoi(entry->d_name))] = stat;
+        }
+    }
+    
+    closedir(proc_dir);
+    return true;
+}
+
+void ProcessTree::rebuild(const std::vector<pid_t>& roots, const ProcessTree& previous) {
+    nodes.clear();
+    members.clear();
+    totals.clear();
+    scan_time = std::chrono::steady_clock::now();
+    
+    if (roots.empty()) {
+        return;
+    }
+    
+    std::map<pid_t, ProcStat> processes;
+    if (!scan_proc(processes)) {
+        return;
+    }
+    
+    std::map<pid_t, std::vector<pid_t>> children;
+    for (const auto& pair : processes) {
+        children[pair.second.parent_pid].push_back(pair.first);
+    }
+    
+    std::vector<std::pair<pid_t, pid_t>> queue;
+    for (pid_t root : roots) {
+        queue.push_back({root, root});
+    }
+    
+    for (const auto& pair : previous.nodes) {
+        auto it = processes.find(pair.first);
+        if (it != processes.end() && it->second.start_time == pair.second.start_time &&
+            std::find(roots.begin(), roots.end(), pair.second.root_pid) != roots.end()) {
+            queue.push_back({pair.first, pair.second.root_pid});
+        }
+    }
+    
+    long clock_ticks = sysconf(_SC_CLK_TCK);
+    long page = sysconf(_SC_PAGESIZE);
+    if (clock_ticks <= 0) clock_ticks = 100;
+    if (page <= 0) page = 4096;
+    
+    double elapsed = std::chrono::duration<double>(scan_time - previous.scan_time).count();
+    
+    for (size_t i = 0; i < queue.size(); ++i) {
+        pid_t pid = queue[i].first;
+        pid_t root = queue[i].second;
+        
+        auto proc_it = processes.find(pid);
+        if (proc_it == processes.end() || nodes.find(pid) != nodes.end()) {
+            continue;
+        }
+        
+        const ProcStat& stat = proc_it->second;
+        Node node;
+        node.parent_pid = stat.parent_pid;
+        node.root_pid = root;
+        node.start_time = stat.start_time;
+        node.ticks = stat.utime + stat.stime;
+        node.rss_bytes = stat.rss_pages * static_cast<size_t>(page);
+        nodes[pid] = node;
+        members[root].push_back(pid);
+        
+        Totals& total = totals[root];
+        total.process_count++;
+        total.memory_usage += node.rss_bytes;
+        
+        auto prev_it = previous.nodes.find(pid);
+        if (prev_it != previous.nodes.end() && prev_it->second.start_time == node.start_time &&
+            node.ticks >= prev_it->second.ticks && elapsed > 0.0) {
+            double cpu_seconds = static_cast<double>(node.ticks - prev_it->second.ticks) / clock_ticks;
+            total.cpu_usage += cpu_seconds / elapsed * 100.0;
+        }
+        
+        auto child_it = children.find(pid);
+        if (child_it != children.end()) {
+            for (pid_t child : child_it->second) {
+                queue.push_back({child, root});
+            }
+        }
+    }
+}
+
+std::vector<pid_t> ProcessTree::get_members(pid_t root) const {
+    auto it = members.find(root);
+    if (it != members.end()) {
+        return it->second;
+    }
+    return {root};
+}
+
+bool ProcessTree::get_start_time(pid_t pid, unsigned long long& start_time) const {
+    auto it = nodes.find(pid);
+    if (it == nodes.end()) {
+        return false;
+    }
+    start_time = it->second.start_time;
+    return true;
+}
+
+bool ProcessTree::get_totals(pid_t root, ProcessStats& stats) const {
+    auto it = totals.find(root);
+    if (it == totals.end()) {
+        return false;
+    }
+    
+    stats.tree_process_count = it->second.process_count;
+    stats.tree_memory_usage = it->second.memory_usage;
+    stats.tree_cpu_usage = it->second.cpu_usage;
+    return true;
+}
+
+}
@@ -0,0 +1,430 @@
+#include "wine_wrapper.hpp"
+#include <sys/mman.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+namespace {
+
+int fold_ascii(int c) {
+    return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+}
+
+int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+int encode_utf8(unsigned code_point, char* out) {
+    if (code_point < 0x80) {
+        out[0] = static_cast<char>(code_point);
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = static_cast<char>(0xC0 | (code_point >> 6));
+        out[1] = static_cast<char>(0x80 | (code_point & 0x3F));
+        return 2;
+    }
+    out[0] = static_cast<char>(0xE0 | (code_point >> 12));
+    out[1] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    out[2] = static_cast<char>(0x80 | (code_point & 0x3F));
+    return 3;
+}
+
+class NameCursor {
+private:
+    const char* p;
+    const char* end;
+    bool escaped;
+    bool fold;
+    char pending[4];
+    int pending_length;
+    int pending_position;
+    
+public:
+    NameCursor(std::string_view text, bool is_escaped, bool fold_case)
+        : p(text.data()), end(text.data() + text.size()), escaped(is_escaped), fold(fold_case),
+          pending_length(0), pending_position(0) {
+    }
+    
+    int next() {
+        if (pending_position < pending_length) {
+            return static_cast<unsigned char>(pending[pending_position++]);
+        }
+        if (p >= end) {
+            return -1;
+        }
+        
+        int c = static_cast<unsigned char>(*p++);
+        if (escaped && c == '\\' && p < end) {
+            char e = *p++;
+            switch (e) {
+                case 'n': c = '\n'; break;
+                case 'r': c = '\r'; break;
+                case 't': c = '\t'; break;
+                case '0': c = 0; break;
+                case 'x': {
+                    unsigned code_point = 0;
+                    int digits = 0;
+                    while (digits < 4 && p < end && hex_digit(*p) >= 0) {
+                        code_point = code_point * 16 + static_cast<unsigned>(hex_digit(*p++));
+                        ++digits;
+                    }
+                    pending_length = encode_utf8(code_point, pending);
+                    pending_position = 1;
+                    c = static_cast<unsigned char>(pending[0]);
+                    break;
+                }
+                default: c = static_cast<unsigned char>(e); break;
+            }
+        }
+        
+        return fold ? fold_ascii(c) : c;
+    }
+};
+
+std::string append_utf16(const std::vector<unsigned char>& bytes, bool multi) {
+    std::string text;
+    char buffer[4];
+    
+    for (size_t i = 0; i + 1 < bytes.size(); i += 2) {
+        unsigned code_unit = bytes[i] | (static_cast<unsigned>(bytes[i + 1]) << 8);
+        if (code_unit == 0) {
+            if (!multi) break;
+            text.push_back('\n');
+            continue;
+        }
+        text.append(buffer, static_cast<size_t>(encode_utf8(code_unit, buffer)));
+    }
+    
+    while (!text.empty() && text.back() == '\n') {
+        text.pop_back();
+    }
+    return text;
+}
+
+}
+
+bool RegistryNameLess::operator()(const std::string& a, const std::string& b) const {
+    return RegistryHive::compare_names(a, false, b, false) < 0;
+}
+
+RegistryHive::RegistryHive()
+    : mapping(nullptr), mapping_size(0), escaped_keys(false), file_device(0), file_inode(0),
+      file_size(0) {
+    file_mtime.tv_sec = 0;
+    file_mtime.tv_nsec = 0;
+}
+
+RegistryHive::~RegistryHive() {
+    unmap();
+}
+
+void RegistryHive::unmap() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+    }
+    keys.clear();
+    values.clear();
+}
+
+bool RegistryHive::load(const std::string& path) {
+    unmap();
+    file_path = path;
+    
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    
+    file_device = st.st_dev;
+    file_inode = st.st_ino;
+    file_size = st.st_size;
+    file_mtime = st.st_mtim;
+    
+    if (st.st_size > 0) {
+        void* data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            return false;
+        }
+        mapping = data;
+        mapping_size = static_cast<size_t>(st.st_size);
+        madvise(mapping, mapping_size, MADV_SEQUENTIAL);
+    }
+    close(fd);
+    
+    parse();
+    return true;
+}
+
+bool RegistryHive::is_stale() const {
+    struct stat st;
+    if (stat(file_path.c_str(), &st) != 0) {
+        return mapping != nullptr || !keys.empty();
+    }
+    
+    return st.st_dev != file_device || st.st_ino != file_inode || st.st_size != file_size ||
+           st.st_mtim.tv_sec != file_mtime.tv_sec || st.st_mtim.tv_nsec != file_mtime.tv_nsec;
+}
+
+void RegistryHive::parse() {
+    const char* data = static_cast<const char*>(mapping);
+    const char* end = data + mapping_size;
+    const char* p = data;
+    
+    static const char header[] = "WINE REGISTRY";
+    escaped_keys = mapping_size >= sizeof(header) - 1 && memcmp(data, header, sizeof(header) - 1) == 0;
+    
+    const size_t no_key = static_cast<size_t>(-1);
+    size_t current = no_key;
+    
+    while (p < end) {
+        const char* line_end = static_cast<const char*>(memchr(p, '\n', static_cast<size_t>(end - p)));
+        if (!line_end) line_end = end;
+        
+        const char* line = p;
+        while (line < line_end && (*line == ' ' || *line == '\t')) ++line;
+        
+        if (line < line_end && *line == '[') {
+            const char* q = line + 1;
+            while (q < line_end && *q != ']') {
+                q += (*q == '\\' && q + 1 < line_end && escaped_keys) ? 2 : 1;
+            }
+            keys.push_back({std::string_view(line + 1, static_cast<size_t>(q - line - 1)), values.size(), 0});
+            current = keys.size() - 1;
+        } else if (line < line_end && (*line == '"' || *line == '@') && current != no_key) {
+            const char* q = line + 1;
+            std::string_view name;
+            
+            if (*line == '"') {
+                while (q < line_end && *q != '"') {
+                    q += (*q == '\\' && q + 1 < line_end) ? 2 : 1;
+                }
+                name = std::string_view(line + 1, static_cast<size_t>(q - line - 1));
+                ++q;
+            }
+            
+            while (q < line_end && (*q == ' ' || *q == '\t')) ++q;
+            if (q < line_end && *q == '=') {
+                const char* value_start = q + 1;
+                
+                for (;;) {
+                    const char* last = line_end;
+                    while (last > value_start && (last[-1] == '\r' || last[-1] == ' ')) --last;
+                    if (last == value_start || last[-1] != '\\' || line_end >= end) {
+                        break;
+                    }
+                    const char* next = static_cast<const char*>(
+                        memchr(line_end + 1, '\n', static_cast<size_t>(end - line_end - 1)));
+                    line_end = next ? next : end;
+                }
+                
+                const char* value_end = line_end;
+                while (value_end > value_start && value_end[-1] == '\r') --value_end;
+                
+                values.push_back({name, std::string_view(value_start, static_cast<size_t>(value_end - value_start))});
+                keys[current].value_count++;
+            }
+        }
+        
+        p = line_end + 1;
+    }
+    
+    bool escaped = escaped_keys;
+    auto less = [escaped](const KeyEntry& a, const KeyEntry& b) {
+        return compare_names(a.name, escaped, b.name, escaped) < 0;
+    };
+    if (!std::is_sorted(keys.begin(), keys.end(), less)) {
+        std::stable_sort(keys.begin(), keys.end(), less);
+    }
+}
+
+int RegistryHive::compare_names(std::string_view a, bool a_escaped, std::string_view b, bool b_escaped,
+                                bool prefix_only) {
+    NameCursor left(a, a_escaped, true);
+    NameCursor right(b, b_escaped, true);
+    
+    for (;;) {
+        int ca = left.next();
+        int cb = right.next();
+        
+        if (prefix_only && cb == -1) return 0;
+        if (ca != cb) return ca < cb ? -1 : 1;
+        if (ca == -1) return 0;
+    }
+}
+
+std::string RegistryHive::unescape(std::string_view raw) {
+    std::string text;
+    text.reserve(raw.size());
+    
+    NameCursor cursor(raw, true, false);
+    for (int c = cursor.next(); c != -1; c = cursor.next()) {
+        text.push_back(static_cast<char>(c));
+    }
+    return text;
+}
+
+std::string RegistryHive::decode_value(std::string_view data) {
+    size_t start = data.find_first_not_of(" \t");
+    if (start == std::string_view::npos) {
+        return "";
+    }
+    data.remove_prefix(start);
+    
+    if (data.compare(0, 4, "str(") == 0) {
+        size_t colon = data.find("):");
+        if (colon != std::string_view::npos) {
+            data.remove_prefix(colon + 2);
+        }
+    }
+    
+    if (!data.empty() && data[0] == '"') {
+        size_t i = 1;
+        while (i < data.size() && data[i] != '"') {
+            i += (data[i] == '\\' && i + 1 < data.size()) ? 2 : 1;
+        }
+        return unescape(data.substr(1, i - 1));
+    }
+    
+    if (data.compare(0, 6, "dword:") == 0) {
+        std::string digits(data.substr(6, 8));
+        return std::to_string(strtoul(digits.c_str(), nullptr, 16));
+    }
+    
+    if (data.compare(0, 3, "hex") == 0) {
+        size_t colon = data.find(':');
+        if (colon == std::string_view::npos) {
+            return std::string(data);
+        }
+        
+        std::string_view type = data.substr(0, colon);
+        std::vector<unsigned char> bytes;
+        int high = -1;
+        
+        for (size_t i = colon + 1; i < data.size(); ++i) {
+            int digit = hex_digit(data[i]);
+            if (digit < 0) {
+                high = -1;
+                continue;
+            }
+            if (high < 0) {
+                high = digit;
+            } else {
+                bytes.push_back(static_cast<unsigned char>(high * 16 + digit));
+                high = -1;
+            }
+        }
+        
+        if (type == "hex(1)" || type == "hex(2)") {
+            return append_utf16(bytes, false);
+        }
+        if (type == "hex(7)") {
+            return append_utf16(bytes, true);
+        }
+        
+        static const char digits[] = "0123456789abcdef";
+        std::string text(type);
+        text.push_back(':');
+        for (size_t i = 0; i < bytes.size(); ++i) {
+            if (i > 0) text.push_back(',');
+            text.push_back(digits[bytes[i] >> 4]);
+            text.push_back(digits[bytes[i] & 0x0F]);
+        }
+        return text;
+    }
+    
+    size_t end = data.find_last_not_of(" \t");
+    return std::string(data.substr(0, end + 1));
+}
+
+const RegistryHive::KeyEntry* RegistryHive::find_key(const std::string& key) const {
+    bool escaped = escaped_keys;
+    auto it = std::lower_bound(keys.begin(), keys.end(), key,
+                               [escaped](const KeyEntry& entry, const std::string& query) {
+        return compare_names(entry.name, escaped, query, false) < 0;
+    });
+    
+    if (it != keys.end() && compare_names(it->name, escaped_keys, key, false) == 0) {
+        return &*it;
+    }
+    return nullptr;
+}
+
+std::string RegistryHive::key_name(const KeyEntry& entry) const {
+    return escaped_keys ? unescape(entry.name) : std::string(entry.name);
+}
+
+bool RegistryHive::key_exists(const std::string& key) const {
+    return find_key(key) != nullptr;
+}
+
+bool RegistryHive::get_value(const std::string& key, const std::string& name, std::string& value) const {
+    const KeyEntry* entry = find_key(key);
+    if (!entry) {
+        return false;
+    }
+    
+    std::string_view query = name == "@" ? std::string_view() : std::string_view(name);
+    for (size_t i = entry->first_value; i < entry->first_value + entry->value_count; ++i) {
+        if (compare_names(values[i].name, true, query, false) == 0) {
+            value = decode_value(values[i].data);
+            return true;
+        }
+    }
+    
+    return false;
+}
+
+std::vector<std::string> RegistryHive::list_keys(const std::string& prefix) const {
+    std::vector<std::string> result;
+    bool escaped = escaped_keys;
+    
+    auto it = std::lower_bound(keys.begin(), keys.end(), prefix,
+                               [escaped](const KeyEntry& entry, const std::string& query) {
+        return compare_names(entry.name, escaped, query, false) < 0;
+    });
+    
+    for (; it != keys.end() && compare_names(it->name, escaped, prefix, false, true) == 0; ++it) {
+        result.push_back(key_name(*it));
+    }
+    
+    return result;
+}
+
+std::vector<std::string> RegistryHive::list_values(const std::string& key) const {
+    std::vector<std::string> result;
+    
+    const KeyEntry* entry = find_key(key);
+    if (entry) {
+        for (size_t i = entry->first_value; i < entry->first_value + entry->value_count; ++i) {
+            result.push_back(values[i].name.empty() ? "@" : unescape(values[i].name));
+        }
+    }
+    
+    return result;
+}
+
+void RegistryHive::for_each_value(const std::function<void(const std::string&, const std::string&,
+                                                           const std::string&)>& callback) const {
+    for (const auto& entry : keys) {
+        std::string key = key_name(entry);
+        for (size_t i = entry.first_value; i < entry.first_value + entry.value_count; ++i) {
+            callback(key, values[i].name.empty() ? "@" : unescape(values[i].name),
+                     decode_value(values[i].data));
+        }
+    }
+}
+
+}
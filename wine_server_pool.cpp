@@ -0,0 +1,339 @@
+#include "wine_wrapper.hpp"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <spawn.h>
+#include <cerrno>
+
+namespace WineWrapper {
+
+WineserverPool::WineserverPool(Logger& log)
+    : logger(log), enabled(false), stopping(false), idle_timeout(std::chrono::seconds(300)),
+      hits(0), spawns(0), spawn_failures(0), idle_evictions(0),
+      last_spawn_ms(0.0), total_spawn_ms(0.0) {
+}
+
+WineserverPool::~WineserverPool() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        stopping = true;
+        pool_cv.notify_all();
+    }
+    
+    if (maintenance_thread.joinable()) {
+        maintenance_thread.join();
+    }
+    
+    if (idle_timeout.count() == 0) {
+        evict_all();
+    }
+}
+
+void WineserverPool::set_enabled(bool value) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    enabled = value;
+    
+    if (value && !maintenance_thread.joinable()) {
+        maintenance_thread = std::thread(&WineserverPool::maintenance_loop, this);
+    }
+    
+    logger.info(std::string("Wineserver warm pool ") + (value ? "enabled" : "disabled"));
+}
+
+bool WineserverPool::is_enabled() const {
+    return enabled;
+}
+
+void WineserverPool::set_idle_timeout(std::chrono::seconds timeout) {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    idle_timeout = timeout;
+}
+
+std::string WineserverPool::find_wineserver(const std::string& wine_binary) {
+    size_t slash = wine_binary.rfind('/');
+    if (slash == std::string::npos) {
+        return "wineserver";
+    }
+    
+    std::string candidate = wine_binary.substr(0, slash + 1) + "wineserver";
+    return access(candidate.c_str(), X_OK) == 0 ? candidate : "wineserver";
+}
+
+std::string WineserverPool::socket_path(const std::string& prefix_path) {
+    struct stat st;
+    if (stat(prefix_path.c_str(), &st) != 0) {
+        return "";
+    }
+    
+    char path[128];
+    snprintf(path, sizeof(path), "/tmp/.wine-%u/server-%llx-%llx/socket",
+             static_cast<unsigned>(getuid()), static_cast<unsigned long long>(st.st_dev),
+             static_cast<unsigned long long>(st.st_ino));
+    return path;
+}
+
+bool WineserverPool::server_listening(const std::string& prefix_path) {
+    std::string path = socket_path(prefix_path);
+    if (path.empty() || path.size() >= sizeof(sockaddr_un::sun_path)) {
+        return false;
+    }
+    
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return false;
+    }
+    
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.c_str(), path.size());
+    
+    bool listening = connect(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == 0;
+    close(fd);
+    return listening;
+}
+
+pid_t WineserverPool::spawn_server(const std::string& prefix_path, const std::string& wine_binary,
+                                   long idle_seconds) {
+    std::string binary = find_wineserver(wine_binary);
+    std::string persist = idle_seconds > 0 ? "-p" + std::to_string(idle_seconds) : "-p";
+    
+    std::vector<std::string> env_strings;
+    for (char** env_ptr = ::environ; env_ptr && *env_ptr; ++env_ptr) {
+        if (strncmp(*env_ptr, "WINEPREFIX=", 11) != 0) {
+            env_strings.push_back(*env_ptr);
+        }
+    }
+    env_strings.push_back("WINEPREFIX=" + prefix_path);
+    
+    std::vector<char*> envp;
+    for (auto& entry : env_strings) {
+        envp.push_back(&entry[0]);
+    }
+    envp.push_back(nullptr);
+    
+    char* argv[] = {const_cast<char*>(binary.c_str()), const_cast<char*>("-f"),
+                    const_cast<char*>(persist.c_str()), nullptr};
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    
+    pid_t pid = -1;
+    int result = posix_spawnp(&pid, binary.c_str(), &actions, nullptr, argv, envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    
+    if (result != 0) {
+        logger.error("Failed to start " + binary + " for " + prefix_path + ": " + strerror(result));
+        return -1;
+    }
+    
+    return pid;
+}
+
+bool WineserverPool::wait_until_ready(const std::string& prefix_path, pid_t pid,
+                                      std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    auto delay = std::chrono::milliseconds(1);
+    
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (server_listening(prefix_path)) {
+            return true;
+        }
+        if (waitpid(pid, nullptr, WNOHANG) == pid) {
+            return false;
+        }
+        
+        std::this_thread::sleep_for(delay);
+        delay = std::min(delay * 2, std::chrono::milliseconds(50));
+    }
+    
+    return false;
+}
+
+bool WineserverPool::acquire(const std::string& prefix_path, const std::string& wine_binary) {
+    if (!enabled || prefix_path.empty()) {
+        return false;
+    }
+    
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    
+    for (;;) {
+        auto it = servers.find(prefix_path);
+        if (it == servers.end()) {
+            break;
+        }
+        
+        if (!it->second.ready) {
+            pool_cv.wait(lock);
+            continue;
+        }
+        
+        bool alive = it->second.pid > 0 ? waitpid(it->second.pid, nullptr, WNOHANG) == 0
+                                        : server_listening(prefix_path);
+        if (alive) {
+            it->second.last_used = std::chrono::steady_clock::now();
+            hits++;
+            return true;
+        }
+        
+        servers.erase(it);
+        idle_evictions++;
+        break;
+    }
+    
+    Server& entry = servers[prefix_path];
+    entry.pid = -1;
+    entry.ready = false;
+    long idle_seconds = static_cast<long>(idle_timeout.count());
+    lock.unlock();
+    
+    auto start = std::chrono::steady_clock::now();
+    bool external = server_listening(prefix_path);
+    pid_t pid = external ? -1 : spawn_server(prefix_path, wine_binary, idle_seconds);
+    bool ready = external || (pid > 0 && wait_until_ready(prefix_path, pid, std::chrono::seconds(10)));
+    double elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    
+    lock.lock();
+    
+    if (!ready) {
+        if (pid > 0) {
+            kill(pid, SIGTERM);
+            waitpid(pid, nullptr, 0);
+        }
+        servers.erase(prefix_path);
+        spawn_failures++;
+        pool_cv.notify_all();
+        logger.warning("Failed to warm wineserver for prefix: " + prefix_path);
+        return false;
+    }
+    
+    Server& server = servers[prefix_path];
+    server.pid = pid;
+    server.ready = true;
+    server.last_used = std::chrono::steady_clock::now();
+    pool_cv.notify_all();
+    
+    if (external) {
+        hits++;
+        logger.debug("Attached to running wineserver for prefix: " + prefix_path);
+    } else {
+        spawns++;
+        last_spawn_ms = elapsed;
+        total_spawn_ms += elapsed;
+        logger.info("Started persistent wineserver " + std::to_string(pid) + " for " + prefix_path +
+                    " in " + std::to_string(static_cast<int>(elapsed)) + " ms");
+    }
+    return true;
+}
+
+void WineserverPool::prewarm(const std::string& prefix_path, const std::string& wine_binary) {
+    if (!enabled || prefix_path.empty()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    warm_queue.push_back({prefix_path, wine_binary});
+    pool_cv.notify_all();
+}
+
+void WineserverPool::evict(const std::string& prefix_path) {
+    pid_t pid = -1;
+    
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        auto it = servers.find(prefix_path);
+        if (it == servers.end() || !it->second.ready) {
+            return;
+        }
+        pid = it->second.pid;
+        servers.erase(it);
+        pool_cv.notify_all();
+    }
+    
+    if (pid > 0) {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        logger.info("Stopped pooled wineserver for prefix: " + prefix_path);
+    }
+}
+
+void WineserverPool::evict_all() {
+    std::vector<std::string> prefixes;
+    
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        for (const auto& pair : servers) {
+            prefixes.push_back(pair.first);
+        }
+    }
+    
+    for (const auto& prefix : prefixes) {
+        evict(prefix);
+    }
+}
+
+void WineserverPool::reap_servers() {
+    for (auto it = servers.begin(); it != servers.end();) {
+        if (it->second.ready && it->second.pid > 0 && waitpid(it->second.pid, nullptr, WNOHANG) != 0) {
+            logger.info("Pooled wineserver for " + it->first + " exited after idle timeout");
+            idle_evictions++;
+            it = servers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void WineserverPool::maintenance_loop() {
+    std::unique_lock<std::mutex> lock(pool_mutex);
+    
+    while (!stopping) {
+        pool_cv.wait_for(lock, std::chrono::seconds(1), [this] {
+            return stopping || !warm_queue.empty();
+        });
+        if (stopping) {
+            break;
+        }
+        
+        reap_servers();
+        
+        std::vector<std::pair<std::string, std::string>> requests;
+        requests.swap(warm_queue);
+        
+        lock.unlock();
+        for (const auto& request : requests) {
+            acquire(request.first, request.second);
+        }
+        lock.lock();
+    }
+}
+
+std::vector<std::string> WineserverPool::get_warm_prefixes() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    
+    std::vector<std::string> prefixes;
+    for (const auto& pair : servers) {
+        if (pair.second.ready) prefixes.push_back(pair.first);
+    }
+    return prefixes;
+}
+
+WineserverPoolStats WineserverPool::get_stats() {
+    std::lock_guard<std::mutex> lock(pool_mutex);
+    
+    WineserverPoolStats stats;
+    stats.hits = hits;
+    stats.spawns = spawns;
+    stats.spawn_failures = spawn_failures;
+    stats.idle_evictions = idle_evictions;
+    stats.last_spawn_ms = last_spawn_ms;
+    stats.average_spawn_ms = spawns > 0 ? total_spawn_ms / static_cast<double>(spawns) : 0.0;
+    stats.active_servers = 0;
+    for (const auto& pair : servers) {
+        if (pair.second.ready) stats.active_servers++;
+    }
+    return stats;
+}
+
+}
@@ -0,0 +1,285 @@
+#include "wine_wrapper.hpp"
+#include <sys/stat.h>
+
+namespace WineWrapper {
+
+namespace {
+
+const char* const CACHE_KINDS[] = {"dxvk", "vkd3d", "mesa", "nvidia"};
+const char* const PORTABLE_KINDS[] = {"dxvk", "vkd3d"};
+const char* const LAST_USED_FILE = ".last-used";
+
+const std::chrono::minutes PRUNE_INTERVAL(10);
+const time_t RECENT_SECONDS = 600;
+
+std::string sanitize(const std::string& name) {
+    std::string result;
+    for (char c : name) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        result += std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '-' || c == '_' ? c : '_';
+    }
+    return result;
+}
+
+time_t last_used_time(const std::string& directory) {
+    struct stat st;
+    if (stat(Utils::join_paths(directory, LAST_USED_FILE).c_str(), &st) == 0 ||
+        stat(directory.c_str(), &st) == 0) {
+        return st.st_mtime;
+    }
+    return 0;
+}
+
+}
+
+ShaderCacheManager::ShaderCacheManager(Logger& log) : logger(log), max_bytes(0), pruned_once(false) {
+}
+
+ShaderCacheManager::~ShaderCacheManager() {
+    if (prune_task.valid()) {
+        prune_task.wait();
+    }
+}
+
+void ShaderCacheManager::configure(const std::string& directory, size_t max_mb) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    root = directory;
+    max_bytes = static_cast<uint64_t>(max_mb) << 20;
+}
+
+std::string ShaderCacheManager::get_driver_key() {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (driver_key.empty()) {
+        driver_key = detect_driver();
+    }
+    return driver_key;
+}
+
+std::string ShaderCacheManager::detect_driver() {
+    std::ifstream nvidia("/sys/module/nvidia/version");
+    std::string version;
+    if (nvidia.is_open() && std::getline(nvidia, version) && !version.empty()) {
+        return "nvidia-" + sanitize(version);
+    }
+    
+    std::vector<std::string> cards = Utils::list_directory("/sys/class/drm");
+    std::sort(cards.begin(), cards.end());
+    for (const auto& card : cards) {
+        if (card.compare(0, 4, "card") != 0 || card.find('-') != std::string::npos) continue;
+        
+        char target[PATH_MAX];
+        std::string link = "/sys/class/drm/" + card + "/device/driver";
+        ssize_t len = readlink(link.c_str(), target, sizeof(target) - 1);
+        if (len > 0) {
+            target[len] = '\0';
+            return sanitize(Utils::get_filename(target));
+        }
+    }
+    
+    return "generic";
+}
+
+std::string ShaderCacheManager::application_id(const std::string& exe_path, const std::string& wine_prefix) {
+    std::string drive_c = wine_prefix;
+    while (!drive_c.empty() && drive_c.back() == '/') drive_c.pop_back();
+    drive_c += "/drive_c/";
+    
+    std::string identity = exe_path;
+    if (!wine_prefix.empty() && identity.compare(0, drive_c.size(), drive_c) == 0) {
+        identity = identity.substr(drive_c.size());
+    } else {
+        size_t slash = identity.find_last_of('/');
+        size_t parent = slash == std::string::npos || slash == 0 ? std::string::npos
+                                                                   : identity.find_last_of('/', slash - 1);
+        if (parent != std::string::npos) {
+            identity = identity.substr(parent + 1);
+        }
+    }
+    std::transform(identity.begin(), identity.end(), identity.begin(), ::tolower);
+    
+    uint32_t hash = 2166136261U;
+    for (char c : identity) {
+        hash = (hash ^ static_cast<unsigned char>(c)) * 16777619U;
+    }
+    
+    std::string stem = Utils::get_filename(exe_path);
+    std::string extension = Utils::get_extension(exe_path);
+    stem = sanitize(stem.substr(0, stem.size() - extension.size()));
+    
+    char suffix[16];
+    snprintf(suffix, sizeof(suffix), "-%08x", hash);
+    return (stem.empty() ? "app" : stem) + suffix;
+}
+
+std::vector<std::string> ShaderCacheManager::environment(const std::string& directory) {
+    return {
+        "DXVK_STATE_CACHE_PATH=" + Utils::join_paths(directory, "dxvk"),
+        "VKD3D_SHADER_CACHE_PATH=" + Utils::join_paths(directory, "vkd3d"),
+        "MESA_SHADER_CACHE_DIR=" + Utils::join_paths(directory, "mesa"),
+        "__GL_SHADER_DISK_CACHE=1",
+        "__GL_SHADER_DISK_CACHE_PATH=" + Utils::join_paths(directory, "nvidia"),
+        "__GL_SHADER_DISK_CACHE_SKIP_CLEANUP=1"
+    };
+}
+
+bool ShaderCacheManager::seed_from_other_drivers(const std::string& application, const std::string& directory) {
+    std::string source;
+    time_t newest = 0;
+    for (const auto& driver : Utils::list_directory(root)) {
+        if (driver == driver_key) continue;
+        std::string candidate = Utils::join_paths(root, driver + "/" + application);
+        time_t used = Utils::directory_exists(candidate) ? last_used_time(candidate) : 0;
+        if (used > newest) {
+            newest = used;
+            source = candidate;
+        }
+    }
+    
+    if (source.empty()) {
+        return false;
+    }
+    
+    size_t copied = 0;
+    for (const char* kind : PORTABLE_KINDS) {
+        std::string from = Utils::join_paths(source, kind);
+        std::string to = Utils::join_paths(directory, kind);
+        for (const auto& file : Utils::list_directory(from)) {
+            if (Utils::copy_file(Utils::join_paths(from, file), Utils::join_paths(to, file))) {
+                ++copied;
+            }
+        }
+    }
+    
+    if (copied > 0) {
+        logger.info("Seeded shader cache for " + application + " with " + std::to_string(copied) +
+                    " files from " + source);
+    }
+    return copied > 0;
+}
+
+void ShaderCacheManager::schedule_prune() {
+    auto now = std::chrono::steady_clock::now();
+    if (pruned_once && now - last_prune < PRUNE_INTERVAL) {
+        return;
+    }
+    if (prune_task.valid() && prune_task.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return;
+    }
+    
+    pruned_once = true;
+    last_prune = now;
+    prune_task = std::async(std::launch::async, [this] { prune(); });
+}
+
+std::string ShaderCacheManager::prepare(const std::string& exe_path, const std::string& wine_prefix) {
+    std::lock_guard<std::mutex> lock(cache_mutex);
+    if (root.empty()) {
+        return "";
+    }
+    if (driver_key.empty()) {
+        driver_key = detect_driver();
+    }
+    
+    std::string application = application_id(exe_path, wine_prefix);
+    std::string directory = Utils::join_paths(root, driver_key + "/" + application);
+    if (!Utils::directory_exists(directory)) {
+        for (const char* kind : CACHE_KINDS) {
+            if (!Utils::create_directory(Utils::join_paths(directory, kind))) {
+                logger.warning("Cannot create shader cache directory " + directory + ": " + strerror(errno));
+                return "";
+            }
+        }
+        seed_from_other_drivers(application, directory);
+    }
+    
+    int fd = open(Utils::join_paths(directory, LAST_USED_FILE).c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+    if (fd != -1) {
+        futimens(fd, nullptr);
+        close(fd);
+    }
+    
+    schedule_prune();
+    return directory;
+}
+
+std::vector<ShaderCacheEntry> ShaderCacheManager::list() {
+    std::string cache_root;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        cache_root = root;
+    }
+    
+    std::vector<ShaderCacheEntry> entries;
+    if (cache_root.empty()) {
+        return entries;
+    }
+    
+    for (const auto& driver : Utils::list_directory(cache_root)) {
+        std::string driver_path = Utils::join_paths(cache_root, driver);
+        for (const auto& application : Utils::list_directory(driver_path)) {
+            ShaderCacheEntry entry;
+            entry.driver = driver;
+            entry.application = application;
+            entry.path = Utils::join_paths(driver_path, application);
+            if (!Utils::directory_exists(entry.path)) continue;
+            entry.bytes = Utils::get_directory_size(entry.path);
+            entry.last_used = last_used_time(entry.path);
+            entries.push_back(entry);
+        }
+    }
+    
+    std::sort(entries.begin(), entries.end(), [](const ShaderCacheEntry& a, const ShaderCacheEntry& b) {
+        return a.last_used > b.last_used;
+    });
+    return entries;
+}
+
+uint64_t ShaderCacheManager::prune(bool include_recent) {
+    std::lock_guard<std::mutex> prune_lock(prune_mutex);
+    uint64_t limit;
+    {
+        std::lock_guard<std::mutex> lock(cache_mutex);
+        limit = max_bytes;
+    }
+    
+    std::vector<ShaderCacheEntry> entries = list();
+    uint64_t total = 0;
+    for (const auto& entry : entries) {
+        total += entry.bytes;
+    }
+    if (limit == 0 || total <= limit) {
+        return 0;
+    }
+    
+    uint64_t freed = 0;
+    time_t now = time(nullptr);
+    for (auto it = entries.rbegin(); it != entries.rend() && total > limit; ++it) {
+        if (!include_recent && now - it->last_used < RECENT_SECONDS) {
+            continue;
+        }
+        if (Utils::remove_directory(it->path)) {
+            total -= it->bytes;
+            freed += it->bytes;
+            logger.info("Evicted shader cache " + it->driver + "/" + it->application + " (" +
+                        std::to_string(it->bytes >> 20) + " MB)");
+        }
+    }
+    
+    if (total > limit) {
+        logger.warning("Shader cache is " + std::to_string(total >> 20) + " MB after pruning, limit is " +
+                       std::to_string(limit >> 20) + " MB");
+    }
+    return freed;
+}
+
+size_t ShaderCacheManager::clear(const std::string& application) {
+    size_t removed = 0;
+    for (const auto& entry : list()) {
+        if ((application.empty() || entry.application == application) && Utils::remove_directory(entry.path)) {
+            ++removed;
+        }
+    }
+    return removed;
+}
+
+}
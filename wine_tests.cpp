@@ -0,0 +1,302 @@
+#include "wine_wrapper.hpp"
+#include <iostream>
+
+using namespace WineWrapper;
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": check failed: " #condition << std::endl; \
+            ++failures; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(actual, expected) \
+    do { \
+        const auto& actual_value = (actual); \
+        const auto& expected_value = (expected); \
+        if (!(actual_value == expected_value)) { \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": " #actual " == " #expected " failed: got '" \
+                      << actual_value << "', expected '" << expected_value << "'" << std::endl; \
+            ++failures; \
+        } \
+    } while (0)
+
+// Scratch directory removed when the test finishes
+class TempDirectory {
+private:
+    std::string path;
+
+public:
+    TempDirectory() {
+        char pattern[] = "/tmp/wine-tests-XXXXXX";
+        const char* created = mkdtemp(pattern);
+        path = created ? created : "";
+    }
+
+    ~TempDirectory() {
+        if (!path.empty()) {
+            Utils::remove_directory(path);
+        }
+    }
+
+    const std::string& get() const { return path; }
+};
+
+std::string join_list(const std::vector<std::string>& items) {
+    std::string joined;
+    for (const auto& item : items) {
+        joined += (joined.empty() ? "" : "|") + item;
+    }
+    return joined;
+}
+
+void test_config_schema() {
+    WineConfiguration config;
+    uint64_t present = ConfigSchema::parse_ini(config,
+        "# comment\n"
+        "wine_binary = /opt/wine/bin/wine\n"
+        "enable_dxvk=true\n"
+        "nice_level=5\n"
+        "cgroup_memory_high_mb=2048\n"
+        "unknown_key=ignored\n"
+        "winetricks_components=vcrun2019\n");
+
+    CHECK(present & (1ULL << (ConfigSchema::find("wine_binary") - ConfigSchema::fields())));
+    CHECK(!(present & (1ULL << (ConfigSchema::find("winetricks_components") - ConfigSchema::fields()))));
+    CHECK_EQ(config.wine_binary, std::string("/opt/wine/bin/wine"));
+    CHECK(config.enable_dxvk);
+    CHECK_EQ(config.nice_level, 5);
+    CHECK_EQ(config.audio_driver, std::string("alsa"));
+
+    WineConfiguration reparsed;
+    ConfigSchema::parse_ini(reparsed, ConfigSchema::to_ini(config));
+    CHECK(ConfigSchema::diff(config, reparsed).empty());
+    CHECK_EQ(ConfigSchema::to_ini(reparsed), ConfigSchema::to_ini(config));
+
+    WineConfiguration changed = config;
+    changed.enable_dxvk = false;
+    changed.nice_level = 10;
+    ConfigDiff delta = ConfigSchema::diff(config, changed);
+    CHECK(!delta.empty());
+    CHECK(delta.affects(ConfigSchema::GROUP_ENVIRONMENT));
+    CHECK(delta.affects(ConfigSchema::GROUP_LAUNCH));
+    CHECK(!delta.affects(ConfigSchema::GROUP_MANAGER));
+    CHECK(!delta.affects(ConfigSchema::GROUP_REGISTRY));
+    CHECK_EQ(delta.to_string(), std::string("enable_dxvk, nice_level"));
+}
+
+void test_config_snapshot() {
+    TempDirectory dir;
+    CHECK(!dir.get().empty());
+    std::string config_file = Utils::join_paths(dir.get(), "wine.conf");
+
+    std::string text = "wine_binary=/usr/bin/wine\nenable_esync=false\n";
+    CHECK(Utils::write_file(config_file, text));
+
+    WineConfiguration config;
+    uint64_t present = ConfigSchema::parse_ini(config, text);
+    struct stat source;
+    CHECK(stat(config_file.c_str(), &source) == 0);
+    CHECK(ConfigSchema::save_snapshot(config, config_file, present, source));
+
+    WineConfiguration loaded;
+    CHECK(ConfigSchema::load_snapshot(loaded, config_file));
+    CHECK(ConfigSchema::diff(config, loaded).empty());
+
+    // Editing the source file must invalidate the snapshot
+    CHECK(Utils::write_file(config_file, text + "nice_level=3\n"));
+    WineConfiguration stale;
+    CHECK(!ConfigSchema::load_snapshot(stale, config_file));
+
+    CHECK(!ConfigSchema::load_snapshot(stale, Utils::join_paths(dir.get(), "missing.conf")));
+}
+
+void test_sha256() {
+    CHECK_EQ(Sha256::hash(""), std::string("e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"));
+    CHECK_EQ(Sha256::hash("abc"), std::string("ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"));
+    CHECK_EQ(Sha256::hash("abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq"),
+             std::string("248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"));
+
+    // Streaming across block boundaries must match the one-shot hash
+    std::string million(1000000, 'a');
+    Sha256 streaming;
+    for (size_t offset = 0; offset < million.size(); offset += 997) {
+        streaming.update(million.data() + offset, std::min<size_t>(997, million.size() - offset));
+    }
+    std::string expected = "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0";
+    CHECK_EQ(streaming.final_hex(), expected);
+    CHECK_EQ(Sha256::hash(million), expected);
+}
+
+void test_daemon_codec() {
+    DaemonMessage message;
+    message["cmd"] = "run";
+    message["id"] = "42";
+    message["text"] = "quote \" backslash \\ newline \n tab \t";
+    message["prefix"] = "123";
+
+    std::string line = ManagerDaemon::encode_message(message, "\"args\":[\"a b\",\"c\\\"d\",7]");
+    CHECK(line.find('\n') == std::string::npos);
+    CHECK(line.find("\"id\":42") != std::string::npos);
+    CHECK(line.find("\"prefix\":\"123\"") != std::string::npos);
+
+    DaemonMessage decoded;
+    std::vector<std::string> args;
+    CHECK(ManagerDaemon::decode_message(line, decoded, &args));
+    CHECK_EQ(decoded.size(), message.size());
+    CHECK_EQ(decoded["cmd"], std::string("run"));
+    CHECK_EQ(decoded["id"], std::string("42"));
+    CHECK_EQ(decoded["text"], message["text"]);
+    CHECK_EQ(join_list(args), std::string("a b|c\"d|7"));
+
+    DaemonMessage empty;
+    CHECK(ManagerDaemon::decode_message(ManagerDaemon::encode_message(empty), empty));
+    CHECK(empty.empty());
+
+    DaemonMessage rejected;
+    CHECK(!ManagerDaemon::decode_message("", rejected));
+    CHECK(!ManagerDaemon::decode_message("not json", rejected));
+    CHECK(!ManagerDaemon::decode_message("{\"cmd\":\"run\"", rejected));
+    CHECK(!ManagerDaemon::decode_message("{\"cmd\" \"run\"}", rejected));
+}
+
+void test_registry_hive() {
+    TempDirectory dir;
+    std::string path = Utils::join_paths(dir.get(), "user.reg");
+    CHECK(Utils::write_file(path, R"(WINE REGISTRY Version 2
+;; All keys relative to \\User\\S-1-5-21-0-0-0-1000
+
+#arch=win64
+
+[Software\\Wine\\Direct3D] 1700000000
+#time=1d9a0b0c0d0e0f0
+"csmt"=dword:00000001
+"renderer"="vulkan"
+@="default"
+
+[Software\\Wine\\DllOverrides] 1700000000
+"d3d11"="native,builtin"
+
+[Control Panel\\Desktop] 1700000000
+"Title"="a \"quoted\" \\ path"
+"Pattern"=hex(2):41,00,42,00,00,00
+"Blob"=hex:de,ad,\
+  be,ef
+)"));
+
+    RegistryHive hive;
+    CHECK(hive.load(path));
+    CHECK(!hive.is_stale());
+
+    CHECK(hive.key_exists("Software\\Wine\\Direct3D"));
+    CHECK(hive.key_exists("software\\wine\\direct3d"));
+    CHECK(!hive.key_exists("Software\\Wine\\Missing"));
+
+    std::string value;
+    CHECK(hive.get_value("Software\\Wine\\Direct3D", "csmt", value));
+    CHECK_EQ(value, std::string("1"));
+    CHECK(hive.get_value("Software\\Wine\\Direct3D", "Renderer", value));
+    CHECK_EQ(value, std::string("vulkan"));
+    CHECK(hive.get_value("Software\\Wine\\Direct3D", "@", value));
+    CHECK_EQ(value, std::string("default"));
+    CHECK(hive.get_value("Control Panel\\Desktop", "Title", value));
+    CHECK_EQ(value, std::string("a \"quoted\" \\ path"));
+    CHECK(hive.get_value("Control Panel\\Desktop", "Pattern", value));
+    CHECK_EQ(value, std::string("AB"));
+    CHECK(hive.get_value("Control Panel\\Desktop", "Blob", value));
+    CHECK_EQ(value, std::string("hex:de,ad,be,ef"));
+    CHECK(!hive.get_value("Software\\Wine\\Direct3D", "missing", value));
+
+    CHECK_EQ(join_list(hive.list_keys("Software\\Wine\\")),
+             std::string("Software\\Wine\\Direct3D|Software\\Wine\\DllOverrides"));
+    CHECK_EQ(join_list(hive.list_values("Software\\Wine\\Direct3D")), std::string("csmt|renderer|@"));
+
+    CHECK(Utils::write_file(path, "WINE REGISTRY Version 2\n"));
+    CHECK(hive.is_stale());
+}
+
+void test_cpu_list() {
+    std::vector<int> cpus;
+    CHECK(LaunchProfile::parse_cpu_list("0-3,8,10-11", cpus));
+    CHECK_EQ(cpus.size(), static_cast<size_t>(7));
+    CHECK_EQ(LaunchProfile::format_cpu_list(cpus), std::string("0-3,8,10-11"));
+
+    CHECK(LaunchProfile::parse_cpu_list("3,1,1-2,", cpus));
+    CHECK_EQ(LaunchProfile::format_cpu_list(cpus), std::string("1-3"));
+
+    CHECK(LaunchProfile::parse_cpu_list("5", cpus));
+    CHECK_EQ(LaunchProfile::format_cpu_list(cpus), std::string("5"));
+    CHECK_EQ(LaunchProfile::format_cpu_list(std::vector<int>()), std::string(""));
+
+    const char* invalid[] = {"", ",", "a", "1x", "3-1", "-1", "1-", "0-99999", "2,,b"};
+    for (const char* list : invalid) {
+        if (LaunchProfile::parse_cpu_list(list, cpus)) {
+            std::cerr << "parse_cpu_list accepted '" << list << "'" << std::endl;
+            ++failures;
+        }
+    }
+}
+
+void test_path_cache() {
+    TempDirectory dir;
+    std::string root = dir.get();
+    CHECK(Utils::create_directory(Utils::join_paths(root, "Program Files/Game")));
+    CHECK(Utils::write_file(Utils::join_paths(root, "Program Files/Game/Data.PAK"), "x"));
+
+    CHECK_EQ(PrefixPathCache::fold_case("C:/Program Files/GAME"), std::string("c:/program files/game"));
+
+    PrefixPathCache cache(root);
+    CHECK_EQ(cache.resolve_case(root, "program files/GAME/data.pak"), root + "/Program Files/Game/Data.PAK");
+    size_t scans = cache.get_directory_scans();
+    CHECK(scans > 0);
+
+    // Cached listings are reused until a directory changes
+    CHECK_EQ(cache.resolve_case(root + "/", "PROGRAM FILES/game/"), root + "/Program Files/Game/");
+    CHECK_EQ(cache.get_directory_scans(), scans);
+
+    CHECK_EQ(cache.resolve_case(root, "program files/missing/Data.pak"), root + "/Program Files/missing/Data.pak");
+
+    CHECK(Utils::write_file(Utils::join_paths(root, "Program Files/Game/New.txt"), "y"));
+    CHECK_EQ(cache.resolve_case(root, "program files/game/new.TXT"), root + "/Program Files/Game/New.txt");
+    CHECK(cache.get_directory_scans() > scans);
+}
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+const TestCase TESTS[] = {
+    {"config_schema", test_config_schema},
+    {"config_snapshot", test_config_snapshot},
+    {"sha256", test_sha256},
+    {"daemon_codec", test_daemon_codec},
+    {"registry_hive", test_registry_hive},
+    {"cpu_list", test_cpu_list},
+    {"path_cache", test_path_cache},
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    bool matched = false;
+    for (const auto& test : TESTS) {
+        if (argc > 1 && std::string(argv[1]) != test.name) continue;
+        matched = true;
+
+        int before = failures;
+        test.run();
+        std::cout << (failures == before ? "PASS " : "FAIL ") << test.name << std::endl;
+    }
+
+    if (!matched) {
+        std::cerr << "Unknown test: " << argv[1] << std::endl;
+        return 2;
+    }
+    return failures == 0 ? 0 : 1;
+}
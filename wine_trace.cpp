@@ -0,0 +1,384 @@
+#include "wine_wrapper.hpp"
+#include <sys/syscall.h>
+
+namespace WineWrapper {
+
+namespace {
+
+const size_t CHUNK_EVENTS = 1024;
+const size_t MAX_CHUNKS_PER_THREAD = 256;
+
+struct TraceEvent {
+    const char* name;
+    const char* category;
+    std::string detail;
+    uint64_t start_ns;
+    uint64_t end_ns;
+};
+
+struct TraceChunk {
+    TraceEvent events[CHUNK_EVENTS];
+    std::atomic<size_t> count;
+    std::atomic<TraceChunk*> next;
+    
+    TraceChunk() : count(0), next(nullptr) {}
+};
+
+struct ThreadBuffer {
+    pid_t tid;
+    char name[32];
+    std::atomic<uint64_t> session;
+    std::atomic<TraceChunk*> head;
+    TraceChunk* tail;
+    size_t chunks;
+    std::atomic<uint64_t> dropped;
+    
+    ThreadBuffer() : tid(0), session(0), head(nullptr), tail(nullptr), chunks(0), dropped(0) {
+        name[0] = '\0';
+    }
+    
+    ~ThreadBuffer() {
+        clear();
+    }
+    
+    void clear() {
+        TraceChunk* chunk = head.exchange(nullptr, std::memory_order_relaxed);
+        while (chunk) {
+            TraceChunk* next = chunk->next.load(std::memory_order_relaxed);
+            delete chunk;
+            chunk = next;
+        }
+        tail = nullptr;
+        chunks = 0;
+        dropped.store(0, std::memory_order_relaxed);
+    }
+};
+
+std::atomic<bool> tracing_enabled(false);
+std::atomic<uint64_t> current_session(0);
+std::mutex session_mutex;
+std::string trace_path;
+std::vector<std::shared_ptr<ThreadBuffer>> thread_buffers;
+
+thread_local std::shared_ptr<ThreadBuffer> local_buffer;
+
+ThreadBuffer* acquire_buffer(uint64_t session) {
+    if (!local_buffer) {
+        auto buffer = std::make_shared<ThreadBuffer>();
+        buffer->tid = static_cast<pid_t>(syscall(SYS_gettid));
+        if (pthread_getname_np(pthread_self(), buffer->name, sizeof(buffer->name)) != 0) {
+            buffer->name[0] = '\0';
+        }
+        
+        std::lock_guard<std::mutex> lock(session_mutex);
+        thread_buffers.push_back(buffer);
+        local_buffer = buffer;
+    }
+    
+    ThreadBuffer* buffer = local_buffer.get();
+    if (buffer->session.load(std::memory_order_relaxed) != session) {
+        buffer->clear();
+        buffer->session.store(session, std::memory_order_release);
+    }
+    return buffer;
+}
+
+void put_varint(std::string& out, uint64_t value) {
+    while (value >= 0x80) {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+void put_uint(std::string& out, int field, uint64_t value) {
+    put_varint(out, static_cast<uint64_t>(field) << 3);
+    put_varint(out, value);
+}
+
+void put_bytes(std::string& out, int field, const std::string& value) {
+    put_varint(out, (static_cast<uint64_t>(field) << 3) | 2);
+    put_varint(out, value.size());
+    out += value;
+}
+
+std::string json_escape(const std::string& value) {
+    std::string escaped;
+    for (char c : value) {
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char buffer[8];
+            snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+struct ThreadEvents {
+    pid_t tid;
+    std::string name;
+    std::vector<const TraceEvent*> events;
+};
+
+std::string encode_json(const std::vector<ThreadEvents>& threads, const std::string& process_name,
+                        uint64_t dropped) {
+    std::string json = "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"dropped_spans\":\"" +
+                       std::to_string(dropped) + "\"},\"traceEvents\":[";
+    std::string pid = std::to_string(getpid());
+    json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":0,\"args\":{\"name\":\"" +
+            json_escape(process_name) + "\"}}";
+    
+    char timing[64];
+    for (const auto& thread : threads) {
+        std::string tid = std::to_string(thread.tid);
+        json += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid +
+                ",\"args\":{\"name\":\"" + json_escape(thread.name) + "\"}}";
+        
+        for (const TraceEvent* event : thread.events) {
+            snprintf(timing, sizeof(timing), "\"ts\":%.3f,\"dur\":%.3f", event->start_ns / 1000.0,
+                     (event->end_ns - event->start_ns) / 1000.0);
+            json += ",\n{\"name\":\"" + json_escape(event->name) + "\",\"cat\":\"" + json_escape(event->category) +
+                    "\",\"ph\":\"X\"," + timing + ",\"pid\":" + pid + ",\"tid\":" + tid;
+            if (!event->detail.empty()) {
+                json += ",\"args\":{\"detail\":\"" + json_escape(event->detail) + "\"}";
+            }
+            json += "}";
+        }
+    }
+    
+    json += "\n]}\n";
+    return json;
+}
+
+std::string encode_perfetto(const std::vector<ThreadEvents>& threads, const std::string& process_name) {
+    const int TRACE_PACKET = 1;
+    const int PACKET_TIMESTAMP = 8;
+    const int PACKET_SEQUENCE_ID = 10;
+    const int PACKET_TRACK_EVENT = 11;
+    const int PACKET_SEQUENCE_FLAGS = 13;
+    const int PACKET_CLOCK_ID = 58;
+    const int PACKET_TRACK_DESCRIPTOR = 60;
+    const uint64_t CLOCK_MONOTONIC_ID = 3;
+    const uint64_t SLICE_BEGIN = 1;
+    const uint64_t SLICE_END = 2;
+    
+    std::string trace;
+    uint64_t pid = static_cast<uint64_t>(getpid());
+    uint64_t process_uuid = pid << 32;
+    
+    auto add_packet = [&trace](const std::string& packet) {
+        put_bytes(trace, TRACE_PACKET, packet);
+    };
+    
+    std::string process;
+    put_uint(process, 1, pid);
+    put_bytes(process, 6, process_name);
+    std::string process_track;
+    put_uint(process_track, 1, process_uuid);
+    put_bytes(process_track, 3, process);
+    std::string packet;
+    put_uint(packet, PACKET_SEQUENCE_ID, 1);
+    put_uint(packet, PACKET_SEQUENCE_FLAGS, 1);
+    put_bytes(packet, PACKET_TRACK_DESCRIPTOR, process_track);
+    add_packet(packet);
+    
+    for (const auto& thread : threads) {
+        uint64_t track_uuid = process_uuid | static_cast<uint32_t>(thread.tid);
+        
+        std::string descriptor;
+        put_uint(descriptor, 1, pid);
+        put_uint(descriptor, 2, static_cast<uint64_t>(thread.tid));
+        put_bytes(descriptor, 5, thread.name);
+        std::string thread_track;
+        put_uint(thread_track, 1, track_uuid);
+        put_uint(thread_track, 5, process_uuid);
+        put_bytes(thread_track, 4, descriptor);
+        packet.clear();
+        put_uint(packet, PACKET_SEQUENCE_ID, 1);
+        put_bytes(packet, PACKET_TRACK_DESCRIPTOR, thread_track);
+        add_packet(packet);
+        
+        auto emit = [&](uint64_t timestamp, uint64_t type, const TraceEvent* event) {
+            std::string track_event;
+            put_uint(track_event, 9, type);
+            put_uint(track_event, 11, track_uuid);
+            if (event) {
+                put_bytes(track_event, 22, event->category);
+                put_bytes(track_event, 23, event->name);
+                if (!event->detail.empty()) {
+                    std::string annotation;
+                    put_bytes(annotation, 10, "detail");
+                    put_bytes(annotation, 6, event->detail);
+                    put_bytes(track_event, 4, annotation);
+                }
+            }
+            std::string event_packet;
+            put_uint(event_packet, PACKET_TIMESTAMP, timestamp);
+            put_uint(event_packet, PACKET_CLOCK_ID, CLOCK_MONOTONIC_ID);
+            put_uint(event_packet, PACKET_SEQUENCE_ID, 1);
+            put_bytes(event_packet, PACKET_TRACK_EVENT, track_event);
+            add_packet(event_packet);
+        };
+        
+        std::vector<uint64_t> open_ends;
+        for (const TraceEvent* event : thread.events) {
+            while (!open_ends.empty() && open_ends.back() <= event->start_ns) {
+                emit(open_ends.back(), SLICE_END, nullptr);
+                open_ends.pop_back();
+            }
+            emit(event->start_ns, SLICE_BEGIN, event);
+            open_ends.push_back(open_ends.empty() ? event->end_ns : std::min(event->end_ns, open_ends.back()));
+        }
+        while (!open_ends.empty()) {
+            emit(open_ends.back(), SLICE_END, nullptr);
+            open_ends.pop_back();
+        }
+    }
+    
+    return trace;
+}
+
+bool has_suffix(const std::string& value, const std::string& suffix) {
+    return value.size() >= suffix.size() && value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+}
+
+uint64_t TraceRecorder::now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool TraceRecorder::is_enabled() {
+    return tracing_enabled.load(std::memory_order_relaxed);
+}
+
+std::string TraceRecorder::get_path() {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    return trace_path;
+}
+
+bool TraceRecorder::start(const std::string& path) {
+    if (path.empty()) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(session_mutex);
+    if (tracing_enabled.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    
+    thread_buffers.erase(std::remove_if(thread_buffers.begin(), thread_buffers.end(),
+                                        [](const std::shared_ptr<ThreadBuffer>& buffer) {
+                                            return buffer.use_count() == 1;
+                                        }),
+                         thread_buffers.end());
+    trace_path = path;
+    current_session.fetch_add(1, std::memory_order_release);
+    tracing_enabled.store(true, std::memory_order_release);
+    return true;
+}
+
+void TraceRecorder::record(const char* name, const char* category, const std::string& detail,
+                           uint64_t start_ns, uint64_t end_ns) {
+    if (!tracing_enabled.load(std::memory_order_acquire)) {
+        return;
+    }
+    
+    ThreadBuffer* buffer = acquire_buffer(current_session.load(std::memory_order_acquire));
+    TraceChunk* chunk = buffer->tail;
+    if (!chunk || chunk->count.load(std::memory_order_relaxed) == CHUNK_EVENTS) {
+        if (buffer->chunks == MAX_CHUNKS_PER_THREAD) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        chunk = new TraceChunk();
+        if (buffer->tail) {
+            buffer->tail->next.store(chunk, std::memory_order_release);
+        } else {
+            buffer->head.store(chunk, std::memory_order_release);
+        }
+        buffer->tail = chunk;
+        buffer->chunks++;
+    }
+    
+    size_t index = chunk->count.load(std::memory_order_relaxed);
+    TraceEvent& event = chunk->events[index];
+    event.name = name;
+    event.category = category;
+    event.detail = detail;
+    event.start_ns = start_ns;
+    event.end_ns = std::max(start_ns, end_ns);
+    chunk->count.store(index + 1, std::memory_order_release);
+}
+
+bool TraceRecorder::stop() {
+    std::lock_guard<std::mutex> lock(session_mutex);
+    if (!tracing_enabled.exchange(false, std::memory_order_acq_rel)) {
+        return false;
+    }
+    
+    uint64_t session = current_session.load(std::memory_order_relaxed);
+    std::vector<ThreadEvents> threads;
+    uint64_t dropped = 0;
+    for (const auto& buffer : thread_buffers) {
+        if (buffer->session.load(std::memory_order_acquire) != session) {
+            continue;
+        }
+        
+        ThreadEvents thread;
+        thread.tid = buffer->tid;
+        thread.name = buffer->name[0] ? buffer->name : "thread " + std::to_string(buffer->tid);
+        for (TraceChunk* chunk = buffer->head.load(std::memory_order_acquire); chunk; chunk = chunk->next.load(std::memory_order_acquire)) {
+            size_t count = chunk->count.load(std::memory_order_acquire);
+            for (size_t i = 0; i < count; ++i) {
+                thread.events.push_back(&chunk->events[i]);
+            }
+        }
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+        
+        std::sort(thread.events.begin(), thread.events.end(), [](const TraceEvent* a, const TraceEvent* b) {
+            return a->start_ns != b->start_ns ? a->start_ns < b->start_ns : a->end_ns > b->end_ns;
+        });
+        if (!thread.events.empty()) {
+            threads.push_back(std::move(thread));
+        }
+    }
+    
+    std::string process_name = Utils::read_file("/proc/self/comm");
+    if (!process_name.empty() && process_name.back() == '\n') {
+        process_name.pop_back();
+    }
+    
+    bool perfetto = has_suffix(trace_path, ".pftrace") || has_suffix(trace_path, ".perfetto-trace") ||
+                    has_suffix(trace_path, ".pb");
+    std::string data = perfetto ? encode_perfetto(threads, process_name)
+                                : encode_json(threads, process_name, dropped);
+    return Utils::write_file(trace_path, data);
+}
+
+TraceSpan::TraceSpan(const char* span_name, const char* span_category, const std::string& span_detail)
+    : name(span_name), category(span_category), start_ns(0), active(TraceRecorder::is_enabled()) {
+    if (active) {
+        detail = span_detail;
+        start_ns = TraceRecorder::now_ns();
+    }
+}
+
+TraceSpan::~TraceSpan() {
+    end();
+}
+
+void TraceSpan::end() {
+    if (active) {
+        TraceRecorder::record(name, category, detail, start_ns, TraceRecorder::now_ns());
+        active = false;
+    }
+}
+
+}
@@ -8,12 +8,47 @@
 #include <cstring>
 #include <cstdlib>
 #include <pwd.h>
+#include <fcntl.h>
+#include <cmath>
+#include <limits>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
 
 namespace WineWrapper {
 
-WinetricksManager::WinetricksManager(Logger& log) : logger(log) {
+namespace {
+
+std::string trim_copy(const std::string& value) {
+    size_t start = value.find_first_not_of(" \t\n\r");
+    if (start == std::string::npos) {
+        return "";
+    }
+    return value.substr(start, value.find_last_not_of(" \t\n\r") - start + 1);
+}
+
+std::string stat_signature(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        return "";
+    }
+    char signature[96];
+    snprintf(signature, sizeof(signature), "%llx:%lld.%ld:%lld", static_cast<unsigned long long>(st.st_ino),
+             static_cast<long long>(st.st_mtim.tv_sec), st.st_mtim.tv_nsec, static_cast<long long>(st.st_size));
+    return signature;
+}
+
+}
+
+WinetricksManager::WinetricksManager(Logger& log)
+    : logger(log), catalog_loaded(false), install_timeout(DEFAULT_INSTALL_TIMEOUT), artifacts(nullptr),
+      metrics(nullptr) {
+    catalog_directory = Utils::join_paths(Utils::get_home_directory(), ".cache/wine-wrapper");
     find_winetricks_executable();
-    update_verb_list();
     logger.info("WinetricksManager initialized");
 }
 
@@ -36,7 +71,7 @@ bool WinetricksManager::find_winetricks_executable() {
         }
     }
     
-    std::string which_output = Utils::execute_command("which winetricks 2>&1");
+    std::string which_output = Utils::run_command({"which", "winetricks"}).output;
     if (!which_output.empty() && which_output.find("not found") == std::string::npos) {
         winetricks_path = which_output;
         winetricks_path.erase(winetricks_path.find_last_not_of(" \n\r\t") + 1);
@@ -49,96 +84,382 @@ bool WinetricksManager::find_winetricks_executable() {
 }
 
 bool WinetricksManager::update_verb_list() {
+    std::lock_guard<std::mutex> lock(catalog_mutex);
+    catalog_loaded = true;
+    return refresh_catalog();
+}
+
+bool WinetricksManager::ensure_catalog() {
+    std::lock_guard<std::mutex> lock(catalog_mutex);
+    if (catalog_loaded) {
+        return !available_verbs.empty();
+    }
+    catalog_loaded = true;
+    
+    if (winetricks_path.empty()) {
+        return false;
+    }
+    
+    if (load_catalog_cache(executable_signature())) {
+        return true;
+    }
+    return refresh_catalog();
+}
+
+bool WinetricksManager::refresh_catalog() {
     if (winetricks_path.empty()) {
         return false;
     }
     
-    std::string cmd = winetricks_path + " list-all 2>&1";
-    std::string output = Utils::execute_command(cmd);
+    auto start = std::chrono::steady_clock::now();
+    CommandOptions options;
+    options.timeout = std::chrono::minutes(2);
+    options.max_output = 16 << 20;
+    options.capture_stderr = false;
+    
+    auto version_result = Utils::run_command_async({winetricks_path, "--version"}, options);
+    CommandResult listing = Utils::run_command({winetricks_path, "list-all"}, options);
+    std::string version = trim_copy(version_result.get().output);
+    
+    if (listing.exit_code != 0 || !parse_verb_output(listing.output)) {
+        logger.warning("winetricks list-all failed with exit code " + std::to_string(listing.exit_code));
+        return false;
+    }
+    
+    store_catalog_cache(executable_signature(), version);
+    logger.debug("Refreshed winetricks catalog in " + std::to_string(static_cast<int>(
+        std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count())) + " ms");
+    return true;
+}
+
+std::string WinetricksManager::executable_signature() {
+    std::string signature = stat_signature(winetricks_path);
+    return signature.empty() ? "" : winetricks_path + ":" + signature;
+}
+
+bool WinetricksManager::load_catalog_cache(const std::string& signature) {
+    std::ifstream file(Utils::join_paths(catalog_directory, "winetricks-catalog"));
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::map<std::string, std::string> header;
+    std::string line;
+    while (std::getline(file, line) && !line.empty()) {
+        size_t eq = line.find('=');
+        if (eq != std::string::npos) {
+            header[line.substr(0, eq)] = line.substr(eq + 1);
+        }
+    }
+    
+    if (header["version"].empty()) {
+        return false;
+    }
+    
+    if (header["signature"] != signature) {
+        std::string version = trim_copy(run_winetricks({"--version"}, "", std::chrono::seconds(30)).output);
+        if (version != header["version"]) {
+            logger.info("Winetricks version changed, rebuilding verb catalog");
+            return false;
+        }
+    }
+    
+    std::vector<std::string> verbs;
+    std::map<std::string, std::vector<std::string>> categories;
+    std::map<std::string, std::string> descriptions;
+    
+    while (std::getline(file, line)) {
+        size_t first_tab = line.find('\t');
+        size_t second_tab = first_tab == std::string::npos ? first_tab : line.find('\t', first_tab + 1);
+        if (second_tab == std::string::npos) {
+            continue;
+        }
+        
+        std::string category = line.substr(0, first_tab);
+        std::string verb = line.substr(first_tab + 1, second_tab - first_tab - 1);
+        verbs.push_back(verb);
+        if (!category.empty()) {
+            categories[category].push_back(verb);
+        }
+        descriptions[verb] = line.substr(second_tab + 1);
+    }
+    
+    if (verbs.empty()) {
+        return false;
+    }
+    
+    available_verbs = std::move(verbs);
+    verb_categories = std::move(categories);
+    verb_descriptions = std::move(descriptions);
+    
+    if (header["signature"] != signature) {
+        store_catalog_cache(signature, header["version"]);
+    }
+    
+    logger.info("Loaded " + std::to_string(available_verbs.size()) + " winetricks verbs from cache");
+    return true;
+}
+
+void WinetricksManager::store_catalog_cache(const std::string& signature, const std::string& version) {
+    if (signature.empty() || version.empty() || !Utils::create_directory(catalog_directory)) {
+        return;
+    }
+    
+    std::map<std::string, std::string> verb_category;
+    for (const auto& pair : verb_categories) {
+        for (const auto& verb : pair.second) {
+            verb_category[verb] = pair.first;
+        }
+    }
     
-    return parse_verb_output(output);
+    std::ostringstream content;
+    content << "signature=" << signature << "\n"
+            << "version=" << version << "\n\n";
+    for (const auto& verb : available_verbs) {
+        content << verb_category[verb] << "\t" << verb << "\t" << verb_descriptions[verb] << "\n";
+    }
+    
+    std::string path = Utils::join_paths(catalog_directory, "winetricks-catalog");
+    std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    if (Utils::write_file(temp_path, content.str()) && rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+    }
 }
 
-std::string WinetricksManager::execute_winetricks_command(const std::string& command) {
+CommandResult WinetricksManager::run_winetricks(const std::vector<std::string>& args, const std::string& prefix,
+                                                std::chrono::milliseconds timeout) {
     if (winetricks_path.empty()) {
         logger.error("Winetricks executable not found");
-        return "";
+        CommandResult result;
+        result.exit_code = -1;
+        result.timed_out = false;
+        result.truncated = false;
+        result.elapsed_ms = 0.0;
+        return result;
     }
     
-    std::string cmd = winetricks_path + " " + command + " 2>&1";
-    return Utils::execute_command(cmd);
+    std::vector<std::string> argv = {winetricks_path};
+    argv.insert(argv.end(), args.begin(), args.end());
+    
+    CommandOptions options;
+    if (!prefix.empty()) {
+        options.environment["WINEPREFIX"] = prefix;
+    }
+    options.timeout = timeout;
+    options.max_output = 256 << 10;
+    
+    CommandResult result = Utils::run_command(argv, options);
+    if (result.timed_out) {
+        logger.error("winetricks timed out after " + std::to_string(static_cast<int>(result.elapsed_ms / 1000)) +
+                     " s" + (prefix.empty() ? "" : " in prefix: " + prefix));
+    }
+    return result;
 }
 
 bool WinetricksManager::parse_verb_output(const std::string& output) {
     std::istringstream stream(output);
     std::string line;
+    std::string category;
     
-    available_verbs.clear();
+    std::vector<std::string> verbs;
+    std::map<std::string, std::vector<std::string>> categories;
+    std::map<std::string, std::string> descriptions;
     
     while (std::getline(stream, line)) {
         if (line.empty() || line[0] == '#') continue;
         
+        if (line.compare(0, 5, "=====") == 0) {
+            category = trim_copy(line.substr(line.find_first_not_of('=')));
+            category.erase(category.find_last_not_of("= ") + 1);
+            continue;
+        }
+        
         size_t space_pos = line.find(' ');
         if (space_pos != std::string::npos) {
             std::string verb = line.substr(0, space_pos);
-            available_verbs.push_back(verb);
+            verbs.push_back(verb);
+            if (!category.empty()) {
+                categories[category].push_back(verb);
+            }
+            descriptions[verb] = trim_copy(line.substr(space_pos));
         }
     }
     
+    if (verbs.empty()) {
+        logger.warning("Winetricks returned no verbs");
+        return false;
+    }
+    
+    available_verbs = std::move(verbs);
+    verb_categories = std::move(categories);
+    verb_descriptions = std::move(descriptions);
+    
     logger.info("Loaded " + std::to_string(available_verbs.size()) + " winetricks verbs");
     return true;
 }
 
-bool WinetricksManager::install_verb(const std::string& verb, const std::string& prefix) {
-    std::lock_guard<std::mutex> lock(winetricks_mutex);
-    
-    logger.info("Installing winetricks verb: " + verb + " in prefix: " + prefix);
+WinetricksManager::InstalledVerbs WinetricksManager::load_installed(const std::string& prefix) {
+    std::string log_file = prefix + "/winetricks.log";
+    std::string signature = stat_signature(log_file);
     
-    std::string cmd = "WINEPREFIX=" + prefix + " " + verb + " -q";
-    std::string output = execute_winetricks_command(cmd);
+    {
+        std::lock_guard<std::mutex> lock(installed_mutex);
+        auto it = installed_cache.find(prefix);
+        if (it != installed_cache.end() && it->second.signature == signature) {
+            return it->second;
+        }
+    }
     
-    logger.debug("Winetricks output: " + output);
+    InstalledVerbs entry;
+    entry.signature = signature;
+    if (!signature.empty()) {
+        std::ifstream file(log_file);
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty() && entry.verbs.insert(line).second) {
+                entry.ordered.push_back(line);
+            }
+        }
+    }
     
-    return output.find("error") == std::string::npos;
+    std::lock_guard<std::mutex> lock(installed_mutex);
+    installed_cache[prefix] = entry;
+    return entry;
 }
 
-bool WinetricksManager::uninstall_verb(const std::string& verb, const std::string& prefix) {
-    std::lock_guard<std::mutex> lock(winetricks_mutex);
+std::shared_ptr<std::mutex> WinetricksManager::prefix_lock(const std::string& prefix) {
+    std::lock_guard<std::mutex> lock(installed_mutex);
+    auto& entry = prefix_locks[prefix];
+    if (!entry) {
+        entry = std::make_shared<std::mutex>();
+    }
+    return entry;
+}
+
+bool WinetricksManager::install_verb(const std::string& verb, const std::string& prefix) {
+    return install_verbs({verb}, prefix);
+}
+
+bool WinetricksManager::install_verbs(const std::vector<std::string>& verbs, const std::string& prefix) {
+    if (winetricks_path.empty()) {
+        logger.error("Winetricks executable not found");
+        return false;
+    }
     
-    logger.info("Uninstalling winetricks verb: " + verb + " from prefix: " + prefix);
+    auto lock = prefix_lock(prefix);
+    std::lock_guard<std::mutex> guard(*lock);
     
-    std::string cmd = "WINEPREFIX=" + prefix + " " + verb + " -q --uninstall";
-    std::string output = execute_winetricks_command(cmd);
+    InstalledVerbs installed = load_installed(prefix);
+    std::vector<std::string> pending;
+    for (const auto& verb : verbs) {
+        if (!installed.verbs.count(verb) && std::find(pending.begin(), pending.end(), verb) == pending.end()) {
+            pending.push_back(verb);
+        }
+    }
     
-    logger.debug("Winetricks output: " + output);
+    if (pending.empty()) {
+        logger.info("Winetricks verbs already installed in prefix: " + prefix);
+        return true;
+    }
     
+    std::vector<std::string> args = {"-q"};
+    std::string names;
+    for (const auto& verb : pending) {
+        args.push_back(verb);
+        names += (names.empty() ? "" : " ") + verb;
+    }
+    
+    logger.info("Installing winetricks verbs: " + names + " in prefix: " + prefix);
+    
+    auto start = std::chrono::steady_clock::now();
+    PhaseTimer timer(metrics, MetricPhase::WINETRICKS_INSTALL);
+    CommandResult result = run_winetricks(args, prefix, install_timeout);
+    timer.stop();
+    logger.debug("Winetricks output: " + result.output);
+    
+    installed = load_installed(prefix);
+    std::string missing;
+    for (const auto& verb : pending) {
+        if (!installed.verbs.count(verb)) {
+            missing += (missing.empty() ? "" : " ") + verb;
+        }
+    }
+    
+    if (!missing.empty()) {
+        logger.error("Winetricks did not install: " + missing + " in prefix: " + prefix);
+        return false;
+    }
+    
+    logger.info("Installed " + std::to_string(pending.size()) + " winetricks verbs in " +
+                std::to_string(static_cast<int>(std::chrono::duration<double, std::milli>(
+                    std::chrono::steady_clock::now() - start).count())) + " ms");
+    
+    if (artifacts && !artifacts->get_root().empty()) {
+        artifacts->deduplicate_prefix(prefix);
+    }
     return true;
 }
 
-std::vector<std::string> WinetricksManager::list_installed_verbs(const std::string& prefix) {
-    std::vector<std::string> installed;
+std::map<std::string, bool> WinetricksManager::install_batch(
+    const std::map<std::string, std::vector<std::string>>& prefix_verbs, size_t max_parallel) {
+    std::vector<std::string> prefixes;
+    for (const auto& pair : prefix_verbs) {
+        prefixes.push_back(pair.first);
+    }
     
-    std::string log_file = prefix + "/winetricks.log";
-    if (Utils::file_exists(log_file)) {
-        std::ifstream file(log_file);
-        std::string line;
-        while (std::getline(file, line)) {
-            if (!line.empty()) {
-                installed.push_back(line);
-            }
+    std::vector<char> outcomes(prefixes.size(), 0);
+    std::atomic<size_t> next(0);
+    auto worker = [&]() {
+        for (size_t i = next++; i < prefixes.size(); i = next++) {
+            outcomes[i] = install_verbs(prefix_verbs.at(prefixes[i]), prefixes[i]) ? 1 : 0;
         }
+    };
+    
+    std::vector<std::thread> workers;
+    size_t thread_count = std::min(std::max<size_t>(max_parallel, 1), prefixes.size());
+    for (size_t i = 1; i < thread_count; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
     }
     
-    return installed;
+    std::map<std::string, bool> results;
+    for (size_t i = 0; i < prefixes.size(); ++i) {
+        results[prefixes[i]] = outcomes[i] != 0;
+    }
+    return results;
+}
+
+bool WinetricksManager::uninstall_verb(const std::string& verb, const std::string& prefix) {
+    auto lock = prefix_lock(prefix);
+    std::lock_guard<std::mutex> guard(*lock);
+    
+    logger.info("Uninstalling winetricks verb: " + verb + " from prefix: " + prefix);
+    
+    CommandResult result = run_winetricks({"-q", "--uninstall", verb}, prefix, install_timeout);
+    
+    logger.debug("Winetricks output: " + result.output);
+    
+    return result.exit_code == 0;
+}
+
+std::vector<std::string> WinetricksManager::list_installed_verbs(const std::string& prefix) {
+    return load_installed(prefix).ordered;
 }
 
 std::vector<std::string> WinetricksManager::list_available_verbs() {
+    ensure_catalog();
+    std::lock_guard<std::mutex> lock(catalog_mutex);
     return available_verbs;
 }
 
 std::vector<std::string> WinetricksManager::list_verbs_by_category(const std::string& category) {
     std::vector<std::string> verbs;
     
+    ensure_catalog();
+    std::lock_guard<std::mutex> lock(catalog_mutex);
     auto it = verb_categories.find(category);
     if (it != verb_categories.end()) {
         return it->second;
@@ -150,6 +471,8 @@ std::vector<std::string> WinetricksManager::list_verbs_by_category(const std::st
 std::vector<std::string> WinetricksManager::list_categories() {
     std::vector<std::string> categories;
     
+    ensure_catalog();
+    std::lock_guard<std::mutex> lock(catalog_mutex);
     for (const auto& pair : verb_categories) {
         categories.push_back(pair.first);
     }
@@ -158,29 +481,37 @@ std::vector<std::string> WinetricksManager::list_categories() {
 }
 
 bool WinetricksManager::is_verb_installed(const std::string& verb, const std::string& prefix) {
-    auto installed = list_installed_verbs(prefix);
-    return std::find(installed.begin(), installed.end(), verb) != installed.end();
+    return load_installed(prefix).verbs.count(verb) > 0;
 }
 
 std::string WinetricksManager::get_verb_description(const std::string& verb) {
-    std::string cmd = verb + " --help";
-    return execute_winetricks_command(cmd);
+    ensure_catalog();
+    
+    {
+        std::lock_guard<std::mutex> lock(catalog_mutex);
+        auto it = verb_descriptions.find(verb);
+        if (it != verb_descriptions.end() && !it->second.empty()) {
+            return it->second;
+        }
+    }
+    
+    return run_winetricks({verb, "--help"}, "", std::chrono::seconds(30)).output;
 }
 
 bool WinetricksManager::update_winetricks() {
+    std::lock_guard<std::mutex> lock(winetricks_mutex);
+    
     logger.info("Updating winetricks");
     
-    std::string cmd = "--self-update";
-    std::string output = execute_winetricks_command(cmd);
+    CommandResult result = run_winetricks({"--self-update"}, "", std::chrono::minutes(5));
     
-    logger.debug("Update output: " + output);
+    logger.debug("Update output: " + result.output);
     
     return update_verb_list();
 }
 
 std::string WinetricksManager::get_winetricks_version() {
-    std::string cmd = "--version";
-    return execute_winetricks_command(cmd);
+    return run_winetricks({"--version"}, "", std::chrono::seconds(30)).output;
 }
 
 ConfigurationParser::ConfigurationParser() {}
@@ -294,25 +625,8 @@ std::vector<std::string> ConfigurationParser::get_keys() {
     return keys;
 }
 
-PathResolver::PathResolver(const std::string& prefix) : wine_prefix(prefix) {
-    std::string dosdevices = Utils::join_paths(prefix, "dosdevices");
-    
-    if (Utils::directory_exists(dosdevices)) {
-        auto entries = Utils::list_directory(dosdevices);
-        for (const auto& entry : entries) {
-            if (entry.length() == 2 && entry[1] == ':') {
-                char drive = entry[0];
-                std::string link_path = Utils::join_paths(dosdevices, entry);
-                
-                char resolved_path[PATH_MAX];
-                ssize_t len = readlink(link_path.c_str(), resolved_path, sizeof(resolved_path) - 1);
-                if (len != -1) {
-                    resolved_path[len] = '\0';
-                    path_mappings[std::string(1, drive)] = resolved_path;
-                }
-            }
-        }
-    }
+PathResolver::PathResolver(const std::string& prefix)
+    : wine_prefix(prefix), cache(PrefixPathCache::for_prefix(prefix)) {
 }
 
 std::string PathResolver::windows_to_unix(const std::string& windows_path) {
@@ -330,12 +644,50 @@ std::string PathResolver::windows_to_unix(const std::string& windows_path) {
     std::string path_part = windows_path.substr(2);
     std::replace(path_part.begin(), path_part.end(), '\\', '/');
     
-    return unix_path + path_part;
+    std::string exact = (unix_path == "/" ? "" : unix_path) + path_part;
+    struct stat st;
+    if (stat(exact.c_str(), &st) == 0) {
+        return exact;
+    }
+    
+    return cache->resolve_case(unix_path, path_part);
+}
+
+std::vector<std::string> PathResolver::windows_to_unix(const std::vector<std::string>& windows_paths) {
+    std::vector<std::string> unix_paths;
+    unix_paths.reserve(windows_paths.size());
+    for (const auto& path : windows_paths) {
+        unix_paths.push_back(windows_to_unix(path));
+    }
+    return unix_paths;
+}
+
+std::string PathResolver::resolve_case(const std::string& unix_path) {
+    struct stat st;
+    if (unix_path.empty() || unix_path[0] != '/' || stat(unix_path.c_str(), &st) == 0) {
+        return unix_path;
+    }
+    
+    std::string root;
+    for (const auto& pair : cache->get_drive_mappings()) {
+        const std::string& target = pair.second;
+        bool contains = target == "/" ||
+                        (unix_path.compare(0, target.size(), target) == 0 &&
+                         (unix_path.size() == target.size() || unix_path[target.size()] == '/'));
+        if (contains && target.size() > root.size()) {
+            root = target;
+        }
+    }
+    
+    if (root.empty()) {
+        return unix_path;
+    }
+    return cache->resolve_case(root, root == "/" ? unix_path : unix_path.substr(root.size()));
 }
 
 std::string PathResolver::unix_to_windows(const std::string& unix_path) {
-    for (const auto& pair : path_mappings) {
-        if (unix_path.find(pair.second) == 0) {
+    for (const auto& pair : cache->get_drive_mappings()) {
+        if (pair.second != "/" && unix_path.find(pair.second) == 0) {
             std::string windows_path = pair.first + ":" + unix_path.substr(pair.second.length());
             std::replace(windows_path.begin(), windows_path.end(), '/', '\\');
             return windows_path;
@@ -346,12 +698,7 @@ std::string PathResolver::unix_to_windows(const std::string& unix_path) {
 }
 
 std::string PathResolver::resolve_drive_letter(char drive) {
-    std::string key(1, std::toupper(drive));
-    auto it = path_mappings.find(key);
-    if (it != path_mappings.end()) {
-        return it->second;
-    }
-    return "";
+    return cache->resolve_drive(drive);
 }
 
 bool PathResolver::create_drive_mapping(char drive, const std::string& unix_path) {
@@ -360,7 +707,7 @@ bool PathResolver::create_drive_mapping(char drive, const std::string& unix_path
     std::string link_path = Utils::join_paths(dosdevices, drive_letter + ":");
     
     if (symlink(unix_path.c_str(), link_path.c_str()) == 0) {
-        path_mappings[std::string(1, std::toupper(drive))] = unix_path;
+        cache->invalidate_drives();
         return true;
     }
     
@@ -369,7 +716,7 @@ bool PathResolver::create_drive_mapping(char drive, const std::string& unix_path
 
 std::vector<std::pair<char, std::string>> PathResolver::get_drive_mappings() {
     std::vector<std::pair<char, std::string>> mappings;
-    for (const auto& pair : path_mappings) {
+    for (const auto& pair : cache->get_drive_mappings()) {
         mappings.push_back({pair.first[0], pair.second});
     }
     return mappings;
@@ -407,25 +754,199 @@ std::string PathResolver::get_dosdevices_path() {
     return Utils::join_paths(wine_prefix, "dosdevices");
 }
 
+CommandOptions::CommandOptions()
+    : timeout(0), max_output(4 << 20), capture_stderr(true) {
+}
+
 namespace Utils {
 
 std::string execute_command(const std::string& command) {
-    FILE* pipe = popen(command.c_str(), "r");
-    if (!pipe) {
-        return "";
+    CommandOptions options;
+    options.capture_stderr = false;
+    options.max_output = std::numeric_limits<size_t>::max();
+    return run_command({"/bin/sh", "-c", command}, options).output;
+}
+
+CommandResult run_command(const std::vector<std::string>& argv, const CommandOptions& options) {
+    CommandResult result;
+    result.exit_code = -1;
+    result.timed_out = false;
+    result.truncated = false;
+    result.elapsed_ms = 0.0;
+    
+    if (argv.empty()) {
+        return result;
     }
     
-    char buffer[128];
-    std::string result;
+    auto start = std::chrono::steady_clock::now();
     
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
+    int out_pipe[2];
+    int err_pipe[2] = {-1, -1};
+    if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+        return result;
+    }
+    if (options.capture_stderr && options.on_output && pipe2(err_pipe, O_CLOEXEC) != 0) {
+        close(out_pipe[0]);
+        close(out_pipe[1]);
+        return result;
     }
     
-    pclose(pipe);
+    std::vector<std::string> env_storage;
+    for (char** entry = environ; *entry; ++entry) {
+        std::string variable = *entry;
+        if (options.environment.count(variable.substr(0, variable.find('='))) == 0) {
+            env_storage.push_back(variable);
+        }
+    }
+    for (const auto& pair : options.environment) {
+        env_storage.push_back(pair.first + "=" + pair.second);
+    }
+    
+    std::vector<char*> args;
+    for (const auto& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+    std::vector<char*> envp;
+    for (auto& variable : env_storage) {
+        envp.push_back(&variable[0]);
+    }
+    envp.push_back(nullptr);
+    
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDOUT_FILENO);
+    if (err_pipe[1] != -1) {
+        posix_spawn_file_actions_adddup2(&actions, err_pipe[1], STDERR_FILENO);
+    } else if (options.capture_stderr) {
+        posix_spawn_file_actions_adddup2(&actions, out_pipe[1], STDERR_FILENO);
+    }
+    
+    posix_spawnattr_t attributes;
+    posix_spawnattr_init(&attributes);
+    posix_spawnattr_setflags(&attributes, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attributes, 0);
+    
+    pid_t pid;
+    int spawn_error = posix_spawnp(&pid, args[0], &actions, &attributes, args.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attributes);
+    close(out_pipe[1]);
+    if (err_pipe[1] != -1) {
+        close(err_pipe[1]);
+    }
+    
+    if (spawn_error != 0) {
+        close(out_pipe[0]);
+        if (err_pipe[0] != -1) {
+            close(err_pipe[0]);
+        }
+        result.output = argv[0] + ": " + strerror(spawn_error) + "\n";
+        return result;
+    }
+    
+    int pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    struct pollfd fds[3] = {{out_pipe[0], POLLIN, 0}, {err_pipe[0], POLLIN, 0}, {pid_fd, POLLIN, 0}};
+    std::vector<char> buffer(1 << 16);
+    bool terminated = false;
+    bool exited = false;
+    auto deadline = start + options.timeout;
+    
+    auto drain = [&](int index) {
+        ssize_t n = read(fds[index].fd, buffer.data(), buffer.size());
+        if (n == -1 && (errno == EINTR || errno == EAGAIN)) {
+            return n == -1 && errno == EINTR;
+        }
+        if (n <= 0) {
+            close(fds[index].fd);
+            fds[index].fd = -1;
+            return false;
+        }
+        
+        size_t length = static_cast<size_t>(n);
+        if (options.on_output) {
+            options.on_output(buffer.data(), length, index == 0 ? OutputStream::STDOUT : OutputStream::STDERR);
+        }
+        size_t room = options.max_output > result.output.size() ? options.max_output - result.output.size() : 0;
+        if (length > room) {
+            result.truncated = true;
+        }
+        result.output.append(buffer.data(), std::min(length, room));
+        return true;
+    };
+    
+    while (!exited && (fds[0].fd != -1 || fds[1].fd != -1)) {
+        int wait_ms = -1;
+        if (options.timeout.count() > 0) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0) {
+                if (terminated) {
+                    break;
+                }
+                result.timed_out = true;
+                terminated = true;
+                kill(-pid, SIGTERM);
+                deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+                continue;
+            }
+            wait_ms = static_cast<int>(remaining);
+        }
+        
+        int ready = poll(fds, 3, wait_ms);
+        if (ready == -1) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        
+        for (int i = 0; i < 2; ++i) {
+            if (fds[i].fd != -1 && (fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                drain(i);
+            }
+        }
+        exited = fds[2].fd != -1 && (fds[2].revents & POLLIN);
+    }
+    
+    for (int i = 0; i < 2; ++i) {
+        if (exited && fds[i].fd != -1) {
+            fcntl(fds[i].fd, F_SETFL, fcntl(fds[i].fd, F_GETFL) | O_NONBLOCK);
+            while (fds[i].fd != -1 && drain(i)) {
+            }
+        }
+        if (fds[i].fd != -1) {
+            close(fds[i].fd);
+        }
+    }
+    if (pid_fd != -1) {
+        close(pid_fd);
+    }
+    
+    int status = 0;
+    if (result.timed_out) {
+        kill(-pid, SIGKILL);
+    }
+    pid_t waited;
+    while ((waited = waitpid(pid, &status, 0)) == -1 && errno == EINTR) {
+    }
+    
+    if (waited != pid) {
+        result.exit_code = -1;
+    } else if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+    } else if (WIFSIGNALED(status)) {
+        result.exit_code = 128 + WTERMSIG(status);
+    }
+    result.elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
     return result;
 }
 
+std::future<CommandResult> run_command_async(const std::vector<std::string>& argv, const CommandOptions& options) {
+    return std::async(std::launch::async, [argv, options]() {
+        return run_command(argv, options);
+    });
+}
+
 bool file_exists(const std::string& path) {
     struct stat buffer;
     return (stat(path.c_str(), &buffer) == 0 && S_ISREG(buffer.st_mode));
@@ -466,8 +987,7 @@ bool create_directory(const std::string& path) {
 }
 
 bool remove_directory(const std::string& path) {
-    std::string cmd = "rm -rf \"" + path + "\" 2>&1";
-    execute_command(cmd);
+    run_command({"rm", "-rf", "--", path});
     return !directory_exists(path);
 }
 
@@ -520,23 +1040,45 @@ size_t get_file_size(const std::string& path) {
     return 0;
 }
 
-size_t get_directory_size(const std::string& path) {
+static size_t directory_size_at(int fd) {
     size_t total_size = 0;
     
-    auto entries = list_directory(path);
-    for (const auto& entry : entries) {
-        std::string full_path = join_paths(path, entry);
+    DIR* dir = fdopendir(fd);
+    if (!dir) {
+        close(fd);
+        return 0;
+    }
+    
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != nullptr) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
         
-        if (directory_exists(full_path)) {
-            total_size += get_directory_size(full_path);
-        } else {
-            total_size += get_file_size(full_path);
+        struct stat st;
+        if (fstatat(dirfd(dir), entry->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+            continue;
+        }
+        
+        if (S_ISDIR(st.st_mode)) {
+            int child = openat(dirfd(dir), entry->d_name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+            if (child != -1) {
+                total_size += directory_size_at(child);
+            }
+        } else if (S_ISREG(st.st_mode)) {
+            total_size += static_cast<size_t>(st.st_size);
         }
     }
     
+    closedir(dir);
     return total_size;
 }
 
+size_t get_directory_size(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    return fd == -1 ? 0 : directory_size_at(fd);
+}
+
 std::string get_home_directory() {
     const char* home = getenv("HOME");
     if (home) {
@@ -723,11 +1265,78 @@ std::string decode_base64(const std::string& input) {
 }
 
 std::string calculate_md5(const std::string& input) {
-    return "";
+    static const uint32_t shifts[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+    };
+    static uint32_t constants[64];
+    static std::once_flag constants_once;
+    std::call_once(constants_once, [] {
+        for (int i = 0; i < 64; ++i) {
+            constants[i] = static_cast<uint32_t>(std::fabs(std::sin(i + 1.0)) * 4294967296.0);
+        }
+    });
+    
+    std::string message = input;
+    uint64_t bit_length = static_cast<uint64_t>(input.size()) * 8;
+    message += static_cast<char>(0x80);
+    while (message.size() % 64 != 56) {
+        message += '\0';
+    }
+    for (int i = 0; i < 8; ++i) {
+        message += static_cast<char>(bit_length >> (i * 8));
+    }
+    
+    uint32_t h[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+    for (size_t offset = 0; offset < message.size(); offset += 64) {
+        uint32_t w[16];
+        for (int i = 0; i < 16; ++i) {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(message.data() + offset + i * 4);
+            w[i] = p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+        }
+        
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+        for (int i = 0; i < 64; ++i) {
+            uint32_t f;
+            int g;
+            if (i < 16) {
+                f = (b & c) | (~b & d);
+                g = i;
+            } else if (i < 32) {
+                f = (d & b) | (~d & c);
+                g = (5 * i + 1) % 16;
+            } else if (i < 48) {
+                f = b ^ c ^ d;
+                g = (3 * i + 5) % 16;
+            } else {
+                f = c ^ (b | ~d);
+                g = (7 * i) % 16;
+            }
+            uint32_t rotated = a + f + constants[i] + w[g];
+            a = d;
+            d = c;
+            c = b;
+            b += (rotated << shifts[i]) | (rotated >> (32 - shifts[i]));
+        }
+        h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    }
+    
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for (uint32_t word : h) {
+        for (int i = 0; i < 4; ++i) {
+            unsigned char byte = static_cast<unsigned char>(word >> (i * 8));
+            hex += digits[byte >> 4];
+            hex += digits[byte & 0xF];
+        }
+    }
+    return hex;
 }
 
 std::string calculate_sha256(const std::string& input) {
-    return "";
+    return Sha256::hash(input);
 }
 
 bool is_process_running(pid_t pid) {
@@ -776,11 +1385,25 @@ std::vector<pid_t> get_child_processes(pid_t parent_pid) {
 }
 
 void kill_process_tree(pid_t pid) {
-    auto children = get_child_processes(pid);
-    for (pid_t child : children) {
-        kill_process_tree(child);
+    std::map<pid_t, ProcStat> processes;
+    ProcessTree::scan_proc(processes);
+    
+    std::map<pid_t, std::vector<pid_t>> children;
+    for (const auto& pair : processes) {
+        children[pair.second.parent_pid].push_back(pair.first);
+    }
+    
+    std::vector<pid_t> tree = {pid};
+    for (size_t i = 0; i < tree.size(); ++i) {
+        auto it = children.find(tree[i]);
+        if (it != children.end()) {
+            tree.insert(tree.end(), it->second.begin(), it->second.end());
+        }
+    }
+    
+    for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+        kill(*it, SIGTERM);
     }
-    kill(pid, SIGTERM);
 }
 
 }
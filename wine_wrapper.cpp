@@ -4,6 +4,8 @@
 #include <algorithm>
 #include <fstream>
 #include <sstream>
+#include <cerrno>
+#include <sys/uio.h>
 
 namespace WineWrapper {
 
@@ -19,6 +21,19 @@ WineConfiguration::WineConfiguration() {
     audio_driver = "alsa";
     graphics_driver = "x11";
     nice_level = 0;
+    hook_timeout_seconds = 60;
+    enable_cgroup = false;
+    cgroup_cpu_weight = 100;
+    cgroup_cpu_max_percent = 0;
+    cgroup_memory_high_mb = 0;
+    cgroup_memory_max_mb = 0;
+    cgroup_io_weight = 100;
+    enable_shader_cache = true;
+    shader_cache_max_mb = 4096;
+    enable_prefetch = false;
+    prefetch_record_seconds = 30;
+    enable_server_pool = false;
+    server_pool_idle_seconds = 300;
     debug_output = false;
     max_log_size_mb = 100;
     capture_stdout = true;
@@ -26,57 +41,32 @@ WineConfiguration::WineConfiguration() {
 }
 
 void WineConfiguration::load_from_file(const std::string& config_file) {
-    ConfigurationParser parser(config_file);
-    wine_prefix = parser.get_value("wine_prefix", wine_prefix);
-    wine_binary = parser.get_value("wine_binary", wine_binary);
-    
-    std::string arch = parser.get_value("architecture", "auto");
-    if (arch == "win32") architecture = WineArchitecture::WIN32;
-    else if (arch == "win64") architecture = WineArchitecture::WIN64;
-    else architecture = WineArchitecture::AUTO_DETECT;
-    
-    enable_virtual_desktop = parser.get_value("enable_virtual_desktop", "false") == "true";
-    virtual_desktop_resolution = parser.get_value("virtual_desktop_resolution", "1024x768");
-    enable_csmt = parser.get_value("enable_csmt", "true") == "true";
-    enable_dxvk = parser.get_value("enable_dxvk", "false") == "true";
-    enable_esync = parser.get_value("enable_esync", "true") == "true";
-    enable_fsync = parser.get_value("enable_fsync", "false") == "true";
-    audio_driver = parser.get_value("audio_driver", "alsa");
-    graphics_driver = parser.get_value("graphics_driver", "x11");
-    nice_level = std::stoi(parser.get_value("nice_level", "0"));
-    debug_output = parser.get_value("debug_output", "false") == "true";
-    log_file = parser.get_value("log_file", "");
-    max_log_size_mb = std::stoi(parser.get_value("max_log_size_mb", "100"));
-    capture_stdout = parser.get_value("capture_stdout", "true") == "true";
-    capture_stderr = parser.get_value("capture_stderr", "true") == "true";
+    if (ConfigSchema::load_snapshot(*this, config_file)) {
+        return;
+    }
+    
+    struct stat source;
+    bool exists = stat(config_file.c_str(), &source) == 0;
+    std::string text = exists ? Utils::read_file(config_file) : "";
+    uint64_t present = ConfigSchema::parse_ini(*this, text);
+    
+    if (exists) {
+        ConfigSchema::save_snapshot(*this, config_file, present, source);
+    }
 }
 
 void WineConfiguration::save_to_file(const std::string& config_file) const {
-    ConfigurationParser parser;
-    parser.set_value("wine_prefix", wine_prefix);
-    parser.set_value("wine_binary", wine_binary);
-    
-    std::string arch = "auto";
-    if (architecture == WineArchitecture::WIN32) arch = "win32";
-    else if (architecture == WineArchitecture::WIN64) arch = "win64";
-    parser.set_value("architecture", arch);
-    
-    parser.set_value("enable_virtual_desktop", enable_virtual_desktop ? "true" : "false");
-    parser.set_value("virtual_desktop_resolution", virtual_desktop_resolution);
-    parser.set_value("enable_csmt", enable_csmt ? "true" : "false");
-    parser.set_value("enable_dxvk", enable_dxvk ? "true" : "false");
-    parser.set_value("enable_esync", enable_esync ? "true" : "false");
-    parser.set_value("enable_fsync", enable_fsync ? "true" : "false");
-    parser.set_value("audio_driver", audio_driver);
-    parser.set_value("graphics_driver", graphics_driver);
-    parser.set_value("nice_level", std::to_string(nice_level));
-    parser.set_value("debug_output", debug_output ? "true" : "false");
-    parser.set_value("log_file", log_file);
-    parser.set_value("max_log_size_mb", std::to_string(max_log_size_mb));
-    parser.set_value("capture_stdout", capture_stdout ? "true" : "false");
-    parser.set_value("capture_stderr", capture_stderr ? "true" : "false");
-    
-    parser.save_to_file(config_file);
+    std::string temp_file = config_file + ".tmp";
+    if (!Utils::write_file(temp_file, ConfigSchema::to_ini(*this)) ||
+        rename(temp_file.c_str(), config_file.c_str()) != 0) {
+        unlink(temp_file.c_str());
+        return;
+    }
+    
+    struct stat source;
+    if (stat(config_file.c_str(), &source) == 0) {
+        ConfigSchema::save_snapshot(*this, config_file, ~0ULL, source);
+    }
 }
 
 std::string WineConfiguration::to_string() const {
@@ -98,6 +88,32 @@ std::string WineConfiguration::to_string() const {
     ss << "  Audio Driver: " << audio_driver << "\n";
     ss << "  Graphics Driver: " << graphics_driver << "\n";
     ss << "  Nice Level: " << nice_level << "\n";
+    ss << "  Cgroup Isolation: " << (enable_cgroup ? "Enabled" : "Disabled");
+    if (enable_cgroup) {
+        ss << " (cpu.weight " << cgroup_cpu_weight << ", io.weight " << cgroup_io_weight;
+        if (cgroup_cpu_max_percent > 0) ss << ", cpu.max " << cgroup_cpu_max_percent << "%";
+        if (cgroup_memory_high_mb > 0) ss << ", memory.high " << cgroup_memory_high_mb << " MB";
+        if (cgroup_memory_max_mb > 0) ss << ", memory.max " << cgroup_memory_max_mb << " MB";
+        ss << ")";
+    }
+    ss << "\n";
+    ss << "  Launch Profile: " << launch_profile.to_string() << "\n";
+    if (!manager_cpu_affinity.empty()) ss << "  Manager CPUs: " << manager_cpu_affinity << "\n";
+    if (!trace_file.empty()) ss << "  Trace File: " << trace_file << "\n";
+    ss << "  Shader Cache: " << (enable_shader_cache ? "Enabled" : "Disabled");
+    if (enable_shader_cache) {
+        ss << " (" << (shader_cache_dir.empty() ? "default location" : shader_cache_dir) << ", "
+           << shader_cache_max_mb << " MB)";
+    }
+    ss << "\n";
+    if (enable_prefetch) {
+        ss << "  Prefetch: Enabled (" << (prefetch_dir.empty() ? "default location" : prefetch_dir) << ", "
+           << prefetch_record_seconds << "s recording)\n";
+    }
+    if (enable_server_pool) {
+        ss << "  Wineserver Pool: Enabled (" << server_pool_idle_seconds << "s idle timeout)\n";
+    }
+    if (!fleet_nodes.empty()) ss << "  Fleet Nodes: " << fleet_nodes << "\n";
     return ss.str();
 }
 
@@ -108,7 +124,19 @@ void WineConfiguration::validate() {
     
     if (nice_level < -20) nice_level = -20;
     if (nice_level > 19) nice_level = 19;
+    if (hook_timeout_seconds < 0) hook_timeout_seconds = 0;
+    
+    cgroup_cpu_weight = std::max(1, std::min(10000, cgroup_cpu_weight));
+    cgroup_io_weight = std::max(1, std::min(10000, cgroup_io_weight));
+    if (cgroup_cpu_max_percent < 0) cgroup_cpu_max_percent = 0;
+    
+    if (launch_profile.scheduler_priority < 0) launch_profile.scheduler_priority = 0;
+    if (launch_profile.scheduler_priority > 99) launch_profile.scheduler_priority = 99;
+    if (cgroup_memory_max_mb > 0 && cgroup_memory_high_mb > cgroup_memory_max_mb) {
+        cgroup_memory_high_mb = cgroup_memory_max_mb;
+    }
     
+    if (server_pool_idle_seconds < 0) server_pool_idle_seconds = 0;
     if (max_log_size_mb < 1) max_log_size_mb = 1;
     if (max_log_size_mb > 10000) max_log_size_mb = 10000;
 }
@@ -128,43 +156,69 @@ void WineConfiguration::apply_defaults() {
     }
 }
 
+ConfigDiff WineConfiguration::diff(const WineConfiguration& other) const {
+    return ConfigSchema::diff(*this, other);
+}
+
 bool WineConfiguration::is_valid() const {
     if (wine_binary.empty()) return false;
     if (wine_prefix.empty()) return false;
     return true;
 }
 
-Logger::Logger() : min_level(LogLevel::INFO), max_file_size(100 * 1024 * 1024),
-                   console_output(true), max_buffer_size(10000),
-                   async_logging(false), stop_logging(false) {
+Logger::Logger() : log_fd(-1), min_level(LogLevel::INFO), max_file_size(100 * 1024 * 1024),
+                   current_file_size(0), console_output(true), max_buffer_size(4096),
+                   slot_mask(0), enqueue_pos(0), dequeue_pos(0), async_logging(false),
+                   stop_logging(false), writer_waiting(false), producers_waiting(0),
+                   backpressure(LogBackpressure::DROP_NEWEST), messages_enqueued(0),
+                   messages_completed(0), messages_logged(0), messages_dropped(0),
+                   queue_overflows(0), recent_lines(1000), recent_head(0), recent_count(0),
+                   last_write_end(0), contiguous_lines(0) {
 }
 
-Logger::Logger(const std::string& file_path, LogLevel level)
-    : min_level(level), log_file_path(file_path), max_file_size(100 * 1024 * 1024),
-      console_output(true), max_buffer_size(10000),
-      async_logging(false), stop_logging(false) {
-    log_file.open(file_path, std::ios::app);
+Logger::Logger(const std::string& file_path, LogLevel level) : Logger() {
+    min_level = level;
+    log_file_path = file_path;
+    open_log_file();
 }
 
 Logger::~Logger() {
-    stop_logging = true;
-    if (async_logging && logging_thread.joinable()) {
-        log_cv.notify_all();
-        logging_thread.join();
+    enable_async_logging(false);
+    while (write_batch() > 0) {
+    }
+    if (log_fd != -1) {
+        close(log_fd);
+    }
+}
+
+void Logger::open_log_file() {
+    if (log_fd != -1) {
+        close(log_fd);
+        log_fd = -1;
+    }
+    current_file_size = 0;
+    recent_head = 0;
+    recent_count = 0;
+    last_write_end = 0;
+    contiguous_lines = 0;
+    if (log_file_path.empty()) {
+        return;
     }
-    flush();
-    if (log_file.is_open()) {
-        log_file.close();
+    
+    log_fd = open(log_file_path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (log_fd != -1) {
+        struct stat st;
+        if (fstat(log_fd, &st) == 0) {
+            current_file_size = static_cast<size_t>(st.st_size);
+            last_write_end = st.st_size;
+        }
     }
 }
 
 void Logger::set_log_file(const std::string& file_path) {
     std::lock_guard<std::mutex> lock(log_mutex);
-    if (log_file.is_open()) {
-        log_file.close();
-    }
     log_file_path = file_path;
-    log_file.open(file_path, std::ios::app);
+    open_log_file();
 }
 
 void Logger::set_min_level(LogLevel level) {
@@ -179,78 +233,341 @@ void Logger::set_max_file_size(size_t size_mb) {
     max_file_size = size_mb * 1024 * 1024;
 }
 
+void Logger::set_queue_capacity(size_t messages) {
+    if (!async_logging && !log_slots) {
+        max_buffer_size = messages > 0 ? messages : 1;
+    }
+}
+
+void Logger::set_backpressure_policy(LogBackpressure policy) {
+    backpressure = policy;
+}
+
+void Logger::set_recent_capacity(size_t lines) {
+    std::lock_guard<std::mutex> lock(log_mutex);
+    recent_lines.assign(lines > 0 ? lines : 1, std::string());
+    recent_head = 0;
+    recent_count = 0;
+}
+
+void Logger::allocate_slots() {
+    size_t capacity = 2;
+    while (capacity < max_buffer_size) {
+        capacity <<= 1;
+    }
+    
+    log_slots.reset(new LogSlot[capacity]);
+    for (size_t i = 0; i < capacity; ++i) {
+        log_slots[i].sequence.store(i, std::memory_order_relaxed);
+        log_slots[i].length = 0;
+    }
+    slot_mask = capacity - 1;
+    enqueue_pos.store(0, std::memory_order_relaxed);
+    dequeue_pos.store(0, std::memory_order_relaxed);
+}
+
 void Logger::enable_async_logging(bool enabled) {
     if (enabled && !async_logging) {
-        async_logging = true;
+        if (!log_slots) {
+            allocate_slots();
+        }
         stop_logging = false;
+        async_logging = true;
         logging_thread = std::thread(&Logger::async_log_worker, this);
     } else if (!enabled && async_logging) {
+        async_logging = false;
         stop_logging = true;
         log_cv.notify_all();
+        {
+            std::lock_guard<std::mutex> lock(space_mutex);
+            space_cv.notify_all();
+        }
         if (logging_thread.joinable()) {
             logging_thread.join();
         }
-        async_logging = false;
     }
 }
 
 void Logger::rotate_log_file() {
-    if (!log_file_path.empty() && Utils::file_exists(log_file_path)) {
-        size_t current_size = Utils::get_file_size(log_file_path);
-        if (current_size > max_file_size) {
-            log_file.close();
-            std::string backup_path = log_file_path + ".old";
-            Utils::move_file(log_file_path, backup_path);
-            log_file.open(log_file_path, std::ios::app);
+    if (log_fd == -1 || current_file_size <= max_file_size) {
+        return;
+    }
+    
+    close(log_fd);
+    log_fd = -1;
+    std::string backup_path = log_file_path + ".old";
+    Utils::move_file(log_file_path, backup_path);
+    open_log_file();
+}
+
+bool Logger::try_enqueue(LogLevel level, const std::string& message) {
+    size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+    LogSlot* slot;
+    
+    for (;;) {
+        slot = &log_slots[pos & slot_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+        
+        if (diff == 0) {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return false;
+        } else {
+            pos = enqueue_pos.load(std::memory_order_relaxed);
         }
     }
+    
+    slot->length = format_log_message(level, message, slot->data, sizeof(slot->data),
+                                      slot->overflow);
+    slot->sequence.store(pos + 1, std::memory_order_release);
+    messages_enqueued.fetch_add(1, std::memory_order_relaxed);
+    return true;
 }
 
-void Logger::async_log_worker() {
-    while (!stop_logging) {
-        std::unique_lock<std::mutex> lock(log_mutex);
-        log_cv.wait_for(lock, std::chrono::milliseconds(100), [this] {
-            return !log_buffer.empty() || stop_logging;
-        });
+Logger::LogSlot* Logger::try_dequeue(size_t& position) {
+    size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+    
+    for (;;) {
+        LogSlot* slot = &log_slots[pos & slot_mask];
+        size_t sequence = slot->sequence.load(std::memory_order_acquire);
+        intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
         
-        while (!log_buffer.empty()) {
-            std::string message = log_buffer.front();
-            log_buffer.pop();
-            if (log_file.is_open()) {
-                log_file << message << std::endl;
+        if (diff == 0) {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                position = pos;
+                return slot;
             }
-            if (console_output) {
-                std::cout << message << std::endl;
+        } else if (diff < 0) {
+            return nullptr;
+        } else {
+            pos = dequeue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+void Logger::release_slot(LogSlot* slot, size_t position) {
+    if (!slot->overflow.empty()) {
+        std::string().swap(slot->overflow);
+    }
+    slot->sequence.store(position + slot_mask + 1, std::memory_order_release);
+    messages_completed.fetch_add(1, std::memory_order_release);
+}
+
+void Logger::enqueue_message(LogLevel level, const std::string& message) {
+    const int spin_limit = 64;
+    bool overflowed = false;
+    int spins = 0;
+    
+    while (!try_enqueue(level, message)) {
+        if (!overflowed) {
+            queue_overflows.fetch_add(1, std::memory_order_relaxed);
+            overflowed = true;
+        }
+        
+        LogBackpressure policy = backpressure.load(std::memory_order_relaxed);
+        if (policy == LogBackpressure::DROP_NEWEST) {
+            messages_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        
+        if (policy == LogBackpressure::DROP_OLDEST) {
+            size_t position;
+            LogSlot* oldest = try_dequeue(position);
+            if (oldest) {
+                release_slot(oldest, position);
+                messages_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
             }
         }
         
-        if (log_file.is_open()) {
-            log_file.flush();
+        if (!async_logging) {
+            write_sync(level, message);
+            return;
+        }
+        log_cv.notify_one();
+        
+        // A short spin covers the writer draining a batch; past that, sleep until it frees slots
+        if (spins < spin_limit) {
+            ++spins;
+            std::this_thread::yield();
+            continue;
+        }
+        
+        uint64_t completed = messages_completed.load();
+        producers_waiting.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(space_mutex);
+            space_cv.wait_for(lock, std::chrono::milliseconds(10), [this, completed] {
+                return messages_completed.load() != completed || !async_logging;
+            });
         }
+        producers_waiting.fetch_sub(1);
+    }
+    
+    if (writer_waiting.load(std::memory_order_relaxed)) {
+        log_cv.notify_one();
     }
 }
 
-std::string Logger::format_log_message(LogLevel level, const std::string& message) {
-    std::stringstream ss;
-    ss << "[" << get_timestamp() << "] ";
-    ss << "[" << level_to_string(level) << "] ";
-    ss << message;
-    return ss.str();
+void Logger::write_output(struct iovec* lines, int count) {
+    if (log_fd != -1) {
+        int index = 0;
+        while (index < count) {
+            ssize_t written = writev(log_fd, lines + index, count - index);
+            if (written == -1) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            
+            current_file_size += static_cast<size_t>(written);
+            
+            // Other processes append to the same file; only lines written back to back with nothing
+            // in between still match the file's tail.
+            off_t end = lseek(log_fd, 0, SEEK_CUR);
+            if (end == -1 || end - written != last_write_end) {
+                contiguous_lines = 0;
+            }
+            last_write_end = end;
+            
+            size_t remaining = static_cast<size_t>(written);
+            while (index < count && remaining >= lines[index].iov_len) {
+                remaining -= lines[index].iov_len;
+                ++index;
+                ++contiguous_lines;
+            }
+            if (index < count) {
+                lines[index].iov_base = static_cast<char*>(lines[index].iov_base) + remaining;
+                lines[index].iov_len -= remaining;
+            }
+        }
+    }
 }
 
-std::string Logger::get_timestamp() {
-    auto now = std::chrono::system_clock::now();
-    auto time_t_now = std::chrono::system_clock::to_time_t(now);
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
-        now.time_since_epoch()) % 1000;
+size_t Logger::write_batch() {
+    if (!log_slots) {
+        return 0;
+    }
     
-    std::stringstream ss;
-    ss << std::put_time(std::localtime(&time_t_now), "%Y-%m-%d %H:%M:%S");
-    ss << "." << std::setfill('0') << std::setw(3) << ms.count();
-    return ss.str();
+    const int batch_size = 64;
+    LogSlot* slots[batch_size];
+    size_t positions[batch_size];
+    struct iovec lines[batch_size];
+    int count = 0;
+    
+    while (count < batch_size) {
+        LogSlot* slot = try_dequeue(positions[count]);
+        if (!slot) break;
+        slots[count] = slot;
+        lines[count].iov_base = slot->overflow.empty() ? slot->data : &slot->overflow[0];
+        lines[count].iov_len = slot->length;
+        ++count;
+    }
+    
+    if (count == 0) {
+        return 0;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(log_mutex);
+        
+        if (console_output) {
+            for (int i = 0; i < count; ++i) {
+                std::cout.write(static_cast<const char*>(lines[i].iov_base), lines[i].iov_len);
+            }
+            std::cout.flush();
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            remember_line(static_cast<const char*>(lines[i].iov_base), lines[i].iov_len);
+        }
+        write_output(lines, count);
+        rotate_log_file();
+    }
+    
+    for (int i = 0; i < count; ++i) {
+        release_slot(slots[i], positions[i]);
+    }
+    messages_logged.fetch_add(static_cast<uint64_t>(count), std::memory_order_relaxed);
+    
+    if (producers_waiting.load() > 0) {
+        std::lock_guard<std::mutex> lock(space_mutex);
+        space_cv.notify_all();
+    }
+    
+    return static_cast<size_t>(count);
+}
+
+void Logger::async_log_worker() {
+    while (!stop_logging) {
+        if (write_batch() > 0) {
+            continue;
+        }
+        
+        std::unique_lock<std::mutex> lock(log_mutex);
+        writer_waiting = true;
+        log_cv.wait_for(lock, std::chrono::milliseconds(10), [this] {
+            return stop_logging || enqueue_pos.load() != dequeue_pos.load();
+        });
+        writer_waiting = false;
+    }
+    
+    while (write_batch() > 0) {
+    }
+}
+
+size_t Logger::format_log_message(LogLevel level, const std::string& message, char* buffer,
+                                  size_t size, std::string& overflow) {
+    char prefix[64];
+    int prefix_length = snprintf(prefix, sizeof(prefix), "[%s] [%s] ", get_timestamp(),
+                                 level_to_string(level));
+    if (prefix_length < 0) prefix_length = 0;
+    if (static_cast<size_t>(prefix_length) >= sizeof(prefix)) prefix_length = sizeof(prefix) - 1;
+    
+    size_t length = static_cast<size_t>(prefix_length) + message.size() + 1;
+    char* out = buffer;
+    if (length > size) {
+        overflow.resize(length);
+        out = &overflow[0];
+    }
+    
+    memcpy(out, prefix, static_cast<size_t>(prefix_length));
+    memcpy(out + prefix_length, message.data(), message.size());
+    out[length - 1] = '\n';
+    return length;
+}
+
+const char* Logger::get_timestamp() {
+    thread_local time_t cached_second = -1;
+    thread_local long cached_millis = -1;
+    thread_local char cached_text[32] = {0};
+    
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    long millis = now.tv_nsec / 1000000;
+    
+    if (now.tv_sec != cached_second) {
+        struct tm local;
+        localtime_r(&now.tv_sec, &local);
+        strftime(cached_text, sizeof(cached_text), "%Y-%m-%d %H:%M:%S.000", &local);
+        cached_second = now.tv_sec;
+        cached_millis = -1;
+    }
+    
+    if (millis != cached_millis) {
+        char* digits = cached_text + 20;
+        digits[0] = static_cast<char>('0' + millis / 100);
+        digits[1] = static_cast<char>('0' + millis / 10 % 10);
+        digits[2] = static_cast<char>('0' + millis % 10);
+        cached_millis = millis;
+    }
+    
+    return cached_text;
 }
 
-std::string Logger::level_to_string(LogLevel level) {
+const char* Logger::level_to_string(LogLevel level) {
     switch (level) {
         case LogLevel::DEBUG: return "DEBUG";
         case LogLevel::INFO: return "INFO";
@@ -261,26 +578,33 @@ std::string Logger::level_to_string(LogLevel level) {
     }
 }
 
+void Logger::write_sync(LogLevel level, const std::string& message) {
+    char buffer[512];
+    std::string overflow;
+    size_t length = format_log_message(level, message, buffer, sizeof(buffer), overflow);
+    
+    struct iovec line;
+    line.iov_base = overflow.empty() ? buffer : &overflow[0];
+    line.iov_len = length;
+    
+    std::lock_guard<std::mutex> lock(log_mutex);
+    if (console_output) {
+        std::cout.write(static_cast<const char*>(line.iov_base), line.iov_len);
+        std::cout.flush();
+    }
+    remember_line(static_cast<const char*>(line.iov_base), line.iov_len);
+    write_output(&line, 1);
+    rotate_log_file();
+    messages_logged.fetch_add(1, std::memory_order_relaxed);
+}
+
 void Logger::log(LogLevel level, const std::string& message) {
     if (level < min_level) return;
     
-    std::string formatted_message = format_log_message(level, message);
-    
     if (async_logging) {
-        std::lock_guard<std::mutex> lock(log_mutex);
-        if (log_buffer.size() < max_buffer_size) {
-            log_buffer.push(formatted_message);
-            log_cv.notify_one();
-        }
+        enqueue_message(level, message);
     } else {
-        std::lock_guard<std::mutex> lock(log_mutex);
-        if (log_file.is_open()) {
-            log_file << formatted_message << std::endl;
-            rotate_log_file();
-        }
-        if (console_output) {
-            std::cout << formatted_message << std::endl;
-        }
+        write_sync(level, message);
     }
 }
 
@@ -291,41 +615,158 @@ void Logger::error(const std::string& message) { log(LogLevel::ERROR_LOG, messag
 void Logger::critical(const std::string& message) { log(LogLevel::CRITICAL, message); }
 
 void Logger::flush() {
+    if (async_logging) {
+        uint64_t target = messages_enqueued.load(std::memory_order_relaxed);
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        
+        while (messages_completed.load(std::memory_order_acquire) < target &&
+               std::chrono::steady_clock::now() < deadline) {
+            log_cv.notify_one();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    
     std::lock_guard<std::mutex> lock(log_mutex);
-    if (log_file.is_open()) {
-        log_file.flush();
+    if (log_fd != -1) {
+        fdatasync(log_fd);
+    }
+}
+
+LoggerStats Logger::get_stats() const {
+    LoggerStats stats;
+    stats.messages_logged = messages_logged.load(std::memory_order_relaxed);
+    stats.messages_dropped = messages_dropped.load(std::memory_order_relaxed);
+    stats.queue_overflows = queue_overflows.load(std::memory_order_relaxed);
+    
+    size_t head = enqueue_pos.load(std::memory_order_relaxed);
+    size_t tail = dequeue_pos.load(std::memory_order_relaxed);
+    stats.queue_depth = head > tail ? head - tail : 0;
+    stats.queue_capacity = log_slots ? slot_mask + 1 : 0;
+    return stats;
+}
+
+void Logger::remember_line(const char* data, size_t length) {
+    if (length > 0 && data[length - 1] == '\n') {
+        --length;
+    }
+    
+    size_t capacity = recent_lines.size();
+    recent_lines[(recent_head + recent_count) % capacity].assign(data, length);
+    if (recent_count < capacity) {
+        ++recent_count;
+    } else {
+        recent_head = (recent_head + 1) % capacity;
     }
 }
 
+bool Logger::read_tail_lines(size_t count, std::vector<std::string>& lines) {
+    int fd = open(log_file_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
+    
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+    
+    const size_t block_size = 64 * 1024;
+    off_t end = st.st_size;
+    off_t start = end;
+    size_t newlines = 0;
+    std::vector<std::vector<char>> blocks;
+    
+    if (end > 0) {
+        char last;
+        if (pread(fd, &last, 1, end - 1) == 1 && last == '\n') {
+            --end;
+            start = end;
+        }
+    }
+    
+    while (start > 0 && newlines < count) {
+        size_t length = static_cast<size_t>(std::min<off_t>(start, static_cast<off_t>(block_size)));
+        std::vector<char> block(length);
+        ssize_t got = pread(fd, block.data(), length, start - static_cast<off_t>(length));
+        if (got != static_cast<ssize_t>(length)) {
+            break;
+        }
+        start -= static_cast<off_t>(length);
+        
+        for (size_t i = length; i > 0; --i) {
+            if (block[i - 1] == '\n' && ++newlines == count) {
+                start += static_cast<off_t>(i);
+                block.erase(block.begin(), block.begin() + static_cast<std::ptrdiff_t>(i));
+                break;
+            }
+        }
+        blocks.push_back(std::move(block));
+    }
+    close(fd);
+    
+    std::vector<char> tail;
+    tail.reserve(static_cast<size_t>(end - start));
+    for (auto it = blocks.rbegin(); it != blocks.rend(); ++it) {
+        tail.insert(tail.end(), it->begin(), it->end());
+    }
+    
+    size_t line_start = 0;
+    for (size_t i = 0; i <= tail.size(); ++i) {
+        if (i == tail.size() || tail[i] == '\n') {
+            if (i > line_start || i < tail.size()) {
+                lines.emplace_back(tail.data() + line_start, i - line_start);
+            }
+            line_start = i + 1;
+        }
+    }
+    
+    return true;
+}
+
+size_t Logger::recent_tail_lines() {
+    struct stat file;
+    struct stat written;
+    if (log_fd == -1 || stat(log_file_path.c_str(), &file) != 0 || fstat(log_fd, &written) != 0 ||
+        file.st_dev != written.st_dev || file.st_ino != written.st_ino || file.st_size != last_write_end) {
+        return 0;
+    }
+    return std::min(recent_count, contiguous_lines);
+}
+
 std::vector<std::string> Logger::get_recent_logs(size_t count) {
     std::vector<std::string> logs;
-    if (log_file_path.empty() || !Utils::file_exists(log_file_path)) {
+    if (count == 0) {
         return logs;
     }
     
-    std::ifstream file(log_file_path);
-    std::string line;
-    std::deque<std::string> recent;
+    std::lock_guard<std::mutex> lock(log_mutex);
     
-    while (std::getline(file, line)) {
-        recent.push_back(line);
-        if (recent.size() > count) {
-            recent.pop_front();
+    if (log_file_path.empty() || count <= recent_tail_lines()) {
+        size_t available = std::min(count, recent_count);
+        size_t capacity = recent_lines.size();
+        logs.reserve(available);
+        for (size_t i = recent_count - available; i < recent_count; ++i) {
+            logs.push_back(recent_lines[(recent_head + i) % capacity]);
         }
+        return logs;
     }
     
-    logs.assign(recent.begin(), recent.end());
+    read_tail_lines(count, logs);
     return logs;
 }
 
 void Logger::clear_logs() {
     std::lock_guard<std::mutex> lock(log_mutex);
-    if (log_file.is_open()) {
-        log_file.close();
+    if (log_fd != -1) {
+        close(log_fd);
+        log_fd = -1;
     }
+    recent_head = 0;
+    recent_count = 0;
     if (!log_file_path.empty()) {
         Utils::delete_file(log_file_path);
-        log_file.open(log_file_path, std::ios::app);
+        open_log_file();
     }
 }
 
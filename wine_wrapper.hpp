@@ -11,6 +11,11 @@
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <future>
+#include <deque>
+#include <optional>
+#include <string_view>
+#include <set>
 #include <queue>
 #include <fstream>
 #include <sstream>
@@ -21,8 +26,10 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sched.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <dirent.h>
 #include <cstring>
 #include <algorithm>
@@ -55,6 +62,31 @@ enum class WineArchitecture {
     AUTO_DETECT
 };
 
+enum class OutputStream {
+    STDOUT,
+    STDERR
+};
+
+using CommandOutputCallback = std::function<void(const char* data, size_t length, OutputStream stream)>;
+
+struct CommandOptions {
+    std::map<std::string, std::string> environment;
+    std::chrono::milliseconds timeout;
+    size_t max_output;
+    bool capture_stderr;
+    CommandOutputCallback on_output;
+    
+    CommandOptions();
+};
+
+struct CommandResult {
+    int exit_code;
+    bool timed_out;
+    bool truncated;
+    std::string output;
+    double elapsed_ms;
+};
+
 struct ProcessInfo {
     pid_t pid;
     ProcessState state;
@@ -70,6 +102,166 @@ struct ProcessInfo {
     double cpu_usage;
     std::string wine_prefix;
     WineArchitecture architecture;
+    size_t tree_process_count;
+    size_t tree_memory_usage;
+    double tree_cpu_usage;
+    std::string cgroup_path;
+    std::vector<int> assigned_cpus;
+    size_t offcore_threads;
+    uint64_t core_migrations;
+};
+
+struct ProcessSummary {
+    pid_t pid;
+    ProcessState state;
+    std::string executable_path;
+    std::string wine_prefix;
+    std::chrono::system_clock::time_point start_time;
+    std::chrono::system_clock::time_point end_time;
+    int exit_code;
+    size_t memory_usage;
+    double cpu_usage;
+    size_t tree_process_count;
+    size_t tree_memory_usage;
+    double tree_cpu_usage;
+    size_t offcore_threads;
+    uint64_t core_migrations;
+    
+    ProcessSummary();
+    explicit ProcessSummary(const ProcessInfo& info);
+};
+
+struct ProcessTableSnapshot {
+    uint64_t generation;
+    std::chrono::steady_clock::time_point published_at;
+    std::vector<ProcessSummary> processes;
+    
+    const ProcessSummary* find(pid_t pid) const;
+};
+
+struct ProcessStats {
+    pid_t pid;
+    ProcessState state;
+    size_t memory_usage;
+    double cpu_usage;
+    size_t tree_process_count;
+    size_t tree_memory_usage;
+    double tree_cpu_usage;
+};
+
+struct ProcStat {
+    char state;
+    pid_t parent_pid;
+    unsigned long long utime;
+    unsigned long long stime;
+    long num_threads;
+    unsigned long long start_time;
+    size_t rss_pages;
+    int processor;
+};
+
+struct ProcStatm {
+    size_t size_pages;
+    size_t resident_pages;
+    size_t shared_pages;
+};
+
+struct LaunchProfile {
+    std::string name;
+    std::string cpu_affinity;
+    std::string numa_policy;
+    std::string scheduler_policy;
+    int scheduler_priority;
+    std::string io_priority;
+    bool disable_thp;
+    size_t memlock_mb;
+    
+    LaunchProfile();
+    bool is_default() const;
+    std::string to_string() const;
+    
+    static LaunchProfile preset(const std::string& name);
+    static bool parse_cpu_list(const std::string& list, std::vector<int>& cpus);
+    static std::string format_cpu_list(const std::vector<int>& cpus);
+};
+
+struct PreparedLaunchProfile {
+    bool active;
+    bool has_affinity;
+    cpu_set_t cpus;
+    int numa_mode;
+    unsigned long nodemask[16];
+    unsigned long max_node;
+    int io_priority;
+    bool disable_thp;
+    unsigned long long memlock_bytes;
+    int scheduler_policy;
+    int scheduler_priority;
+    std::vector<int> cpu_list;
+    
+    PreparedLaunchProfile();
+    bool prepare(const LaunchProfile& profile, std::string& error);
+    int apply() const;
+    
+    static std::string describe_failure(int failed_step);
+    static const cpu_set_t& original_affinity();
+    static bool pin_current_process(const std::vector<int>& cpus);
+    static bool pin_current_process(const cpu_set_t& set);
+};
+
+struct WineConfiguration;
+
+enum class ConfigFieldType {
+    STRING,
+    BOOL,
+    INT,
+    SIZE,
+    ARCHITECTURE,
+    PROFILE,
+    STRING_LIST,
+    STRING_MAP
+};
+
+struct ConfigField {
+    const char* key;
+    ConfigFieldType type;
+    uint32_t groups;
+    bool persistent;
+    const char* default_value;
+    void* (*address)(WineConfiguration& config);
+};
+
+struct ConfigDiff {
+    uint64_t fields;
+    uint32_t groups;
+    
+    ConfigDiff() : fields(0), groups(0) {}
+    bool empty() const { return fields == 0; }
+    bool affects(uint32_t group) const { return (groups & group) != 0; }
+    std::string to_string() const;
+};
+
+class ConfigSchema {
+public:
+    static const uint32_t GROUP_ENVIRONMENT = 1 << 0;
+    static const uint32_t GROUP_REGISTRY = 1 << 1;
+    static const uint32_t GROUP_MANAGER = 1 << 2;
+    static const uint32_t GROUP_LAUNCH = 1 << 3;
+    static const uint32_t SNAPSHOT_VERSION = 1;
+    
+    static const ConfigField* fields();
+    static size_t field_count();
+    static const ConfigField* find(std::string_view key);
+    static uint64_t schema_hash();
+    
+    static uint64_t parse_ini(WineConfiguration& config, std::string_view text);
+    static std::string to_ini(const WineConfiguration& config);
+    static ConfigDiff diff(const WineConfiguration& from, const WineConfiguration& to);
+    
+    static std::string snapshot_path(const std::string& config_file);
+    static bool load_snapshot(WineConfiguration& config, const std::string& config_file);
+    static bool save_snapshot(const WineConfiguration& config, const std::string& config_file, uint64_t present,
+                              const struct stat& source);
 };
 
 struct WineConfiguration {
@@ -88,6 +280,26 @@ struct WineConfiguration {
     std::string audio_driver;
     std::string graphics_driver;
     int nice_level;
+    int hook_timeout_seconds;
+    bool enable_cgroup;
+    std::string cgroup_root;
+    int cgroup_cpu_weight;
+    int cgroup_cpu_max_percent;
+    size_t cgroup_memory_high_mb;
+    size_t cgroup_memory_max_mb;
+    int cgroup_io_weight;
+    LaunchProfile launch_profile;
+    std::string manager_cpu_affinity;
+    std::string trace_file;
+    bool enable_shader_cache;
+    std::string shader_cache_dir;
+    size_t shader_cache_max_mb;
+    bool enable_prefetch;
+    std::string prefetch_dir;
+    int prefetch_record_seconds;
+    bool enable_server_pool;
+    int server_pool_idle_seconds;
+    std::string fleet_nodes;
     std::vector<std::string> winetricks_components;
     bool debug_output;
     std::string log_file;
@@ -99,31 +311,85 @@ struct WineConfiguration {
     void load_from_file(const std::string& config_file);
     void save_to_file(const std::string& config_file) const;
     std::string to_string() const;
+    ConfigDiff diff(const WineConfiguration& other) const;
     void validate();
     void apply_defaults();
     bool is_valid() const;
 };
 
+enum class LogBackpressure {
+    BLOCK,
+    DROP_OLDEST,
+    DROP_NEWEST
+};
+
+struct LoggerStats {
+    uint64_t messages_logged;
+    uint64_t messages_dropped;
+    uint64_t queue_overflows;
+    size_t queue_depth;
+    size_t queue_capacity;
+};
+
 class Logger {
 private:
-    std::ofstream log_file;
+    struct LogSlot {
+        std::atomic<size_t> sequence;
+        size_t length;
+        char data[512];
+        std::string overflow;
+    };
+    
+    int log_fd;
     LogLevel min_level;
     std::mutex log_mutex;
     std::string log_file_path;
     size_t max_file_size;
+    size_t current_file_size;
     bool console_output;
-    std::queue<std::string> log_buffer;
+    std::unique_ptr<LogSlot[]> log_slots;
     size_t max_buffer_size;
+    size_t slot_mask;
+    std::atomic<size_t> enqueue_pos;
+    std::atomic<size_t> dequeue_pos;
     std::atomic<bool> async_logging;
     std::thread logging_thread;
     std::condition_variable log_cv;
     std::atomic<bool> stop_logging;
+    std::atomic<bool> writer_waiting;
+    std::mutex space_mutex;
+    std::condition_variable space_cv;
+    std::atomic<size_t> producers_waiting;
+    std::atomic<LogBackpressure> backpressure;
+    std::atomic<uint64_t> messages_enqueued;
+    std::atomic<uint64_t> messages_completed;
+    std::atomic<uint64_t> messages_logged;
+    std::atomic<uint64_t> messages_dropped;
+    std::atomic<uint64_t> queue_overflows;
+    std::vector<std::string> recent_lines;
+    size_t recent_head;
+    size_t recent_count;
+    off_t last_write_end;
+    size_t contiguous_lines;
     
+    void open_log_file();
     void rotate_log_file();
     void async_log_worker();
-    std::string format_log_message(LogLevel level, const std::string& message);
-    std::string get_timestamp();
-    std::string level_to_string(LogLevel level);
+    size_t write_batch();
+    void write_output(struct iovec* lines, int count);
+    void remember_line(const char* data, size_t length);
+    bool read_tail_lines(size_t count, std::vector<std::string>& lines);
+    size_t recent_tail_lines();
+    void allocate_slots();
+    bool try_enqueue(LogLevel level, const std::string& message);
+    LogSlot* try_dequeue(size_t& position);
+    void release_slot(LogSlot* slot, size_t position);
+    void enqueue_message(LogLevel level, const std::string& message);
+    void write_sync(LogLevel level, const std::string& message);
+    size_t format_log_message(LogLevel level, const std::string& message, char* buffer,
+                              size_t size, std::string& overflow);
+    const char* get_timestamp();
+    const char* level_to_string(LogLevel level);
     
 public:
     Logger();
@@ -134,6 +400,9 @@ public:
     void set_min_level(LogLevel level);
     void set_console_output(bool enabled);
     void set_max_file_size(size_t size_mb);
+    void set_queue_capacity(size_t messages);
+    void set_backpressure_policy(LogBackpressure policy);
+    void set_recent_capacity(size_t lines);
     void enable_async_logging(bool enabled);
     
     void log(LogLevel level, const std::string& message);
@@ -144,24 +413,541 @@ public:
     void critical(const std::string& message);
     
     void flush();
+    LoggerStats get_stats() const;
     std::vector<std::string> get_recent_logs(size_t count);
     void clear_logs();
 };
 
+class TraceRecorder {
+public:
+    static bool start(const std::string& path);
+    static bool stop();
+    static bool is_enabled();
+    static std::string get_path();
+    static uint64_t now_ns();
+    static void record(const char* name, const char* category, const std::string& detail,
+                       uint64_t start_ns, uint64_t end_ns);
+};
+
+class TraceSpan {
+private:
+    const char* name;
+    const char* category;
+    std::string detail;
+    uint64_t start_ns;
+    bool active;
+    
+public:
+    TraceSpan(const char* span_name, const char* span_category, const std::string& span_detail = "");
+    ~TraceSpan();
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+    
+    void end();
+};
+
+enum class MetricPhase {
+    LAUNCH,
+    PRE_LAUNCH,
+    VALIDATE,
+    ENVIRONMENT,
+    WINESERVER,
+    CGROUP,
+    SPAWN,
+    POST_LAUNCH,
+    PREFIX_CREATE,
+    PREFIX_CLONE,
+    REGISTRY_LOAD,
+    REGISTRY_COMMIT,
+    WINETRICKS_INSTALL,
+    FLEET_PLACEMENT,
+    FLEET_SYNC
+};
+
+class MetricsRegistry {
+public:
+    static const size_t PHASE_COUNT = 15;
+    static const size_t BUCKET_COUNT = 22;
+    
+private:
+    struct Histogram {
+        std::atomic<uint64_t> buckets[BUCKET_COUNT];
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> sum_ns;
+    };
+    
+    Histogram histograms[PHASE_COUNT];
+    
+public:
+    MetricsRegistry();
+    
+    void observe(MetricPhase phase, uint64_t nanoseconds);
+    uint64_t get_count(MetricPhase phase) const;
+    void render(std::string& out) const;
+    
+    static const char* phase_name(MetricPhase phase);
+    static void add_family(std::string& out, const std::string& name, const std::string& type,
+                           const std::string& help);
+    static void add_sample(std::string& out, const std::string& name,
+                           const std::map<std::string, std::string>& labels, double value);
+};
+
+class PhaseTimer {
+private:
+    MetricsRegistry* metrics;
+    MetricPhase phase;
+    bool traced;
+    uint64_t start_ns;
+    
+public:
+    PhaseTimer(MetricsRegistry* registry, MetricPhase timed_phase);
+    ~PhaseTimer();
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+    
+    void stop();
+};
+
+struct WineserverPoolStats {
+    uint64_t hits;
+    uint64_t spawns;
+    uint64_t spawn_failures;
+    uint64_t idle_evictions;
+    double last_spawn_ms;
+    double average_spawn_ms;
+    size_t active_servers;
+};
+
+class WineserverPool {
+private:
+    struct Server {
+        pid_t pid;
+        bool ready;
+        std::chrono::steady_clock::time_point last_used;
+    };
+    
+    Logger& logger;
+    std::map<std::string, Server> servers;
+    std::vector<std::pair<std::string, std::string>> warm_queue;
+    std::mutex pool_mutex;
+    std::condition_variable pool_cv;
+    std::thread maintenance_thread;
+    std::atomic<bool> enabled;
+    bool stopping;
+    std::chrono::seconds idle_timeout;
+    uint64_t hits;
+    uint64_t spawns;
+    uint64_t spawn_failures;
+    uint64_t idle_evictions;
+    double last_spawn_ms;
+    double total_spawn_ms;
+    
+    std::string find_wineserver(const std::string& wine_binary);
+    std::string socket_path(const std::string& prefix_path);
+    bool server_listening(const std::string& prefix_path);
+    pid_t spawn_server(const std::string& prefix_path, const std::string& wine_binary, long idle_seconds);
+    bool wait_until_ready(const std::string& prefix_path, pid_t pid, std::chrono::milliseconds timeout);
+    void reap_servers();
+    void maintenance_loop();
+    
+public:
+    WineserverPool(Logger& log);
+    ~WineserverPool();
+    
+    void set_enabled(bool value);
+    bool is_enabled() const;
+    void set_idle_timeout(std::chrono::seconds timeout);
+    
+    bool acquire(const std::string& prefix_path, const std::string& wine_binary);
+    void prewarm(const std::string& prefix_path, const std::string& wine_binary);
+    void evict(const std::string& prefix_path);
+    void evict_all();
+    std::vector<std::string> get_warm_prefixes();
+    WineserverPoolStats get_stats();
+};
+
+enum class CloneMethod {
+    AUTO,
+    REFLINK,
+    HARDLINK,
+    COPY
+};
+
+struct CloneProgress {
+    uint64_t files_total;
+    uint64_t files_done;
+    uint64_t bytes_total;
+    uint64_t bytes_done;
+    uint64_t reflinked_files;
+    uint64_t hardlinked_files;
+    uint64_t copied_files;
+    double elapsed_ms;
+};
+
+using CloneProgressCallback = std::function<void(const CloneProgress&)>;
+
+class PrefixCloner {
+private:
+    struct Entry {
+        std::string relative_path;
+        mode_t mode;
+        uint64_t size;
+    };
+    
+    Logger& logger;
+    CloneMethod method;
+    
+    bool collect_entries(const std::string& root, const std::string& relative, std::vector<Entry>& entries);
+    bool clone_file(const std::string& source, const std::string& destination, const struct stat& st,
+                    CloneProgress& progress);
+    bool clone_symlink(const std::string& source, const std::string& destination,
+                       const std::string& source_root, const std::string& destination_root);
+    static bool always_copied(const std::string& path);
+    
+public:
+    PrefixCloner(Logger& log);
+    
+    void set_method(CloneMethod value);
+    CloneMethod get_method() const { return method; }
+    bool clone_tree(const std::string& source, const std::string& destination,
+                    const CloneProgressCallback& callback, CloneProgress& progress);
+};
+
+struct PrefixScanResult {
+    uint64_t total_bytes;
+    uint64_t file_count;
+    uint64_t directory_count;
+    bool valid;
+    bool cached;
+    double scan_ms;
+    time_t scanned_at;
+};
+
+class PrefixScanner {
+private:
+    struct ScanTarget {
+        std::atomic<uint64_t> bytes;
+        std::atomic<uint64_t> files;
+        std::atomic<uint64_t> directories;
+        std::set<std::pair<dev_t, ino_t>> linked_inodes;
+        std::mutex linked_mutex;
+    };
+    
+    struct ScanTask {
+        int fd;
+        ScanTarget* target;
+    };
+    
+    struct ScanRun {
+        std::deque<ScanTask> tasks;
+        size_t outstanding;
+        std::mutex run_mutex;
+        std::condition_variable run_cv;
+    };
+    
+    struct CachedScan {
+        PrefixScanResult result;
+        std::string signature;
+    };
+    
+    Logger& logger;
+    std::map<std::string, CachedScan> cache;
+    std::mutex cache_mutex;
+    std::string cache_directory;
+    size_t thread_count;
+    std::chrono::seconds max_age;
+    
+    void scan_worker(ScanRun& run);
+    void scan_directory(ScanRun& run, int fd, ScanTarget* target);
+    void push_task(ScanRun& run, int fd, ScanTarget* target);
+    std::string compute_signature(const std::string& prefix_path);
+    std::string cache_file(const std::string& prefix_path);
+    bool load_cached(const std::string& prefix_path, CachedScan& entry);
+    void store_cached(const std::string& prefix_path, const CachedScan& entry);
+    
+public:
+    PrefixScanner(Logger& log);
+    
+    void set_threads(size_t count);
+    void set_max_age(std::chrono::seconds age);
+    
+    PrefixScanResult get(const std::string& prefix_path);
+    std::map<std::string, PrefixScanResult> get_many(const std::vector<std::string>& prefix_paths);
+    std::map<std::string, PrefixScanResult> scan_many(const std::vector<std::string>& prefix_paths);
+    void invalidate(const std::string& prefix_path);
+    
+    static bool check_integrity(const std::string& prefix_path);
+};
+
+class Sha256 {
+private:
+    uint32_t state[8];
+    uint64_t total_length;
+    unsigned char block[64];
+    size_t block_length;
+    
+public:
+    Sha256();
+    
+    void update(const void* data, size_t length);
+    std::string final_hex();
+    
+    static std::string hash(const std::string& data);
+    static std::string hash_file(const std::string& path);
+    static bool hardware_accelerated();
+};
+
+struct ArtifactStoreStats {
+    size_t objects;
+    uint64_t object_bytes;
+    size_t files_deduplicated;
+    uint64_t bytes_deduplicated;
+    size_t integrity_failures;
+};
+
+class ArtifactStore {
+private:
+    struct HashedFile {
+        std::string signature;
+        std::string hash;
+        bool linked;
+    };
+    
+    Logger& logger;
+    std::string root;
+    CloneMethod method;
+    std::map<std::string, std::string> verified_objects;
+    std::map<std::string, HashedFile> hashed_files;
+    std::mutex store_mutex;
+    std::atomic<size_t> files_deduplicated;
+    std::atomic<uint64_t> bytes_deduplicated;
+    std::atomic<size_t> integrity_failures;
+    std::atomic<unsigned> temp_counter;
+    
+    std::string temporary_path(const std::string& directory);
+    bool import_object(const std::string& source, const std::string& hash, bool adopt);
+    bool link_object(const std::string& object, const std::string& destination, bool hardlink);
+    bool probe_reflink(const std::string& directory);
+    size_t deduplicate_directory(const std::string& directory, dev_t store_device, bool reflinks, bool hardlinks);
+    
+public:
+    ArtifactStore(Logger& log);
+    
+    void set_root(const std::string& directory);
+    const std::string& get_root() const { return root; }
+    void set_method(CloneMethod value);
+    
+    std::string object_path(const std::string& hash) const;
+    bool contains(const std::string& hash);
+    bool verify(const std::string& hash);
+    std::string store_file(const std::string& path);
+    std::string store_data(const std::string& data);
+    bool materialize(const std::string& hash, const std::string& destination);
+    size_t deduplicate_tree(const std::string& directory, bool allow_hardlinks = false);
+    size_t deduplicate_prefix(const std::string& prefix_path, bool allow_hardlinks = false);
+    ArtifactStoreStats get_stats();
+};
+
+struct ShaderCacheEntry {
+    std::string driver;
+    std::string application;
+    std::string path;
+    uint64_t bytes;
+    time_t last_used;
+};
+
+class ShaderCacheManager {
+private:
+    Logger& logger;
+    std::string root;
+    uint64_t max_bytes;
+    std::string driver_key;
+    std::mutex cache_mutex;
+    std::mutex prune_mutex;
+    std::chrono::steady_clock::time_point last_prune;
+    bool pruned_once;
+    std::future<void> prune_task;
+    
+    bool seed_from_other_drivers(const std::string& application, const std::string& directory);
+    void schedule_prune();
+    
+public:
+    ShaderCacheManager(Logger& log);
+    ~ShaderCacheManager();
+    
+    void configure(const std::string& directory, size_t max_mb);
+    const std::string& get_root() const { return root; }
+    std::string get_driver_key();
+    
+    static std::string detect_driver();
+    static std::string application_id(const std::string& exe_path, const std::string& wine_prefix);
+    static std::vector<std::string> environment(const std::string& directory);
+    
+    std::string prepare(const std::string& exe_path, const std::string& wine_prefix);
+    std::vector<ShaderCacheEntry> list();
+    uint64_t prune(bool include_recent = false);
+    size_t clear(const std::string& application);
+};
+
+struct PrefetchRange {
+    uint64_t offset;
+    uint64_t length;
+};
+
+struct PrefetchFile {
+    std::string path;
+    std::vector<PrefetchRange> ranges;
+};
+
+struct PrefetchReport {
+    std::string application;
+    size_t files;
+    uint64_t bytes;
+    uint64_t resident_bytes;
+    double duration_ms;
+    
+    PrefetchReport() : files(0), bytes(0), resident_bytes(0), duration_ms(0.0) {}
+    double hit_ratio() const { return bytes > 0 ? static_cast<double>(resident_bytes) / bytes : 0.0; }
+};
+
+class PrefetchManager {
+private:
+    Logger& logger;
+    std::string root;
+    int record_seconds;
+    bool record_enabled;
+    std::mutex prefetch_mutex;
+    std::set<std::string> recording;
+    std::map<std::string, PrefetchReport> reports;
+    std::vector<std::future<void>> tasks;
+    std::atomic<bool> stopping;
+    
+    void reap_tasks_locked();
+    void replay(const std::string& application, std::vector<PrefetchFile> files);
+    void record(const std::string& application, const std::string& wine_prefix, pid_t pid, int seconds);
+    
+public:
+    PrefetchManager(Logger& log);
+    ~PrefetchManager();
+    
+    void configure(const std::string& directory, int seconds);
+    void set_recording_enabled(bool enabled);
+    const std::string& get_root() const { return root; }
+    std::string profile_path(const std::string& application) const;
+    
+    static void add_range(std::vector<PrefetchRange>& ranges, uint64_t offset, uint64_t length);
+    static bool collect_files(pid_t pid, std::vector<PrefetchFile>& files, std::map<std::string, size_t>& index);
+    static bool read_profile(const std::string& path, const std::string& wine_prefix,
+                             std::vector<PrefetchFile>& files);
+    static bool write_profile(const std::string& path, const std::string& wine_prefix,
+                              const std::vector<PrefetchFile>& files);
+    static PrefetchReport measure(const std::vector<PrefetchFile>& files, bool load);
+    
+    bool start(const std::string& exe_path, const std::string& wine_prefix);
+    void track(pid_t pid, const std::string& exe_path, const std::string& wine_prefix);
+    std::vector<std::string> list();
+    std::vector<PrefetchReport> get_reports();
+    size_t clear(const std::string& application);
+};
+
+struct FleetNode {
+    std::string name;
+    std::string host;
+    std::string socket;
+    std::string remote_socket;
+    bool reachable;
+    std::map<std::string, std::string> status;
+    std::set<std::string> prefixes;
+    std::set<std::string> warm_prefixes;
+    double load;
+    size_t cpu_count;
+    uint64_t memory_available;
+    size_t queue_depth;
+    size_t inflight;
+    pid_t tunnel_pid;
+    std::chrono::steady_clock::time_point refreshed;
+    
+    FleetNode() : reachable(false), load(0.0), cpu_count(1), memory_available(0), queue_depth(0), inflight(0),
+                  tunnel_pid(-1) {}
+};
+
+struct FleetPlacement {
+    std::string node;
+    bool warm;
+    bool synced;
+    double score;
+    double latency_ms;
+    
+    FleetPlacement() : warm(false), synced(false), score(0.0), latency_ms(0.0) {}
+};
+
+class FleetCoordinator {
+private:
+    Logger& logger;
+    MetricsRegistry* metrics;
+    std::string node_specs;
+    std::map<std::string, FleetNode> nodes;
+    std::mutex refresh_mutex;
+    std::mutex fleet_mutex;
+    
+    bool open_tunnel(FleetNode& node);
+    void close_tunnel(FleetNode& node);
+    bool query_node(FleetNode& node);
+    bool sync_prefix(const FleetNode& node, const std::string& prefix_path);
+    
+public:
+    FleetCoordinator(Logger& log);
+    ~FleetCoordinator();
+    
+    void set_metrics(MetricsRegistry* registry) { metrics = registry; }
+    void configure(const std::string& specs);
+    bool is_enabled();
+    
+    static bool parse_node(const std::string& spec, FleetNode& node);
+    static double score(const FleetNode& node, const std::string& prefix_path);
+    
+    size_t refresh(bool force = false);
+    std::vector<FleetNode> get_nodes();
+    bool place(const std::string& prefix_path, FleetPlacement& placement);
+    int dispatch(const std::vector<std::string>& command, const std::string& prefix_path, std::string& out,
+                 std::string& err, FleetPlacement& placement);
+};
+
+class WinetricksManager;
+
 class WinePrefixManager {
 private:
     std::string base_prefix_directory;
     std::map<std::string, WineConfiguration> prefix_configs;
+    std::set<std::string> reserved_prefixes;
+    std::map<std::string, struct timespec> loaded_configs;
+    bool index_loaded;
+    struct timespec index_mtime;
+    std::string template_prefix;
     std::mutex prefix_mutex;
     Logger& logger;
+    WineserverPool server_pool;
+    PrefixCloner cloner;
+    PrefixScanner scanner;
+    WinetricksManager* winetricks;
+    MetricsRegistry* metrics;
+    
+    void ensure_index();
+    std::map<std::string, WineConfiguration>::iterator find_prefix(const std::string& prefix_name);
+    void mark_loaded(const std::string& prefix_name, const std::string& prefix_path);
+    std::string index_file_path();
+    bool load_index(const struct timespec& mtime, std::vector<std::string>& names);
+    void save_index();
+    bool reserve_prefix(const std::string& prefix_name);
+    void finish_prefix(const std::string& prefix_name, const WineConfiguration* config);
     
     bool create_directory_structure(const std::string& prefix_path);
     bool initialize_registry(const std::string& prefix_path, WineArchitecture arch);
     bool install_components(const std::string& prefix_path, const std::vector<std::string>& components);
     std::string get_wine_version(const std::string& wine_binary);
     bool verify_prefix_integrity(const std::string& prefix_path);
-    void backup_prefix(const std::string& prefix_path);
-    void restore_prefix(const std::string& prefix_path, const std::string& backup_path);
+    bool backup_prefix(const std::string& prefix_path);
+    bool restore_prefix(const std::string& prefix_path, const std::string& backup_path);
     
 public:
     WinePrefixManager(Logger& log);
@@ -178,8 +964,294 @@ public:
     bool validate_prefix(const std::string& prefix_name);
     size_t get_prefix_size(const std::string& prefix_name);
     void cleanup_prefix(const std::string& prefix_name);
-    bool clone_prefix(const std::string& source, const std::string& destination);
+    bool clone_prefix(const std::string& source, const std::string& destination,
+                      const CloneProgressCallback& progress = nullptr);
+    bool create_prefix_from_template(const std::string& prefix_name, const std::string& template_name,
+                                     const WineConfiguration& config,
+                                     const CloneProgressCallback& progress = nullptr);
+    void set_template_prefix(const std::string& template_name);
+    std::string get_template_prefix();
+    PrefixCloner& get_cloner() { return cloner; }
+    PrefixScanner& get_scanner() { return scanner; }
+    std::map<std::string, PrefixScanResult> get_prefix_scans();
     std::map<std::string, std::string> get_prefix_info(const std::string& prefix_name);
+    WineserverPool& get_server_pool() { return server_pool; }
+    void set_winetricks_manager(WinetricksManager* manager) { winetricks = manager; }
+    void set_metrics(MetricsRegistry* registry) { metrics = registry; }
+};
+
+class OutputRingBuffer {
+private:
+    std::vector<char> storage;
+    uint64_t head;
+    mutable std::mutex ring_mutex;
+    
+public:
+    explicit OutputRingBuffer(size_t capacity);
+    
+    ssize_t fill_from(int fd, struct iovec* written, int& written_count);
+    std::string read_all() const;
+    size_t read_since(uint64_t& offset, std::string& output) const;
+    uint64_t total_written() const;
+    size_t capacity() const;
+};
+
+typedef std::function<void(pid_t, OutputStream, const char*, size_t)> OutputCallback;
+
+class OutputCapture {
+private:
+    struct Channel {
+        pid_t pid;
+        OutputStream stream;
+    };
+    
+    struct Buffers {
+        std::shared_ptr<OutputRingBuffer> stdout_buffer;
+        std::shared_ptr<OutputRingBuffer> stderr_buffer;
+        int tee_fd;
+        int open_channels;
+    };
+    
+    struct Subscriber {
+        int id;
+        pid_t pid;
+        OutputCallback callback;
+    };
+    
+    Logger& logger;
+    std::map<int, Channel> channels;
+    std::map<pid_t, Buffers> buffers;
+    std::shared_ptr<const std::vector<Subscriber>> subscribers;
+    std::mutex capture_mutex;
+    std::condition_variable drain_cv;
+    std::atomic<bool> capture_active;
+    std::thread io_thread;
+    int epoll_fd;
+    int wake_fd;
+    int next_subscriber_id;
+    size_t buffer_capacity;
+    
+    void io_loop();
+    void drain_channel(int fd);
+    void close_channel(int fd);
+    std::shared_ptr<OutputRingBuffer> find_buffer(pid_t pid, OutputStream stream);
+    
+public:
+    OutputCapture(Logger& log);
+    ~OutputCapture();
+    
+    void start();
+    void stop();
+    bool attach(pid_t pid, int stdout_fd, int stderr_fd, const std::string& tee_path = "");
+    void detach(pid_t pid);
+    bool wait_for_eof(pid_t pid, std::chrono::milliseconds timeout);
+    std::string read_output(pid_t pid, OutputStream stream);
+    size_t read_output_since(pid_t pid, OutputStream stream, uint64_t& offset, std::string& output);
+    int subscribe(pid_t pid, OutputCallback callback);
+    void unsubscribe(int subscriber_id);
+    void set_buffer_capacity(size_t bytes);
+};
+
+class ProcessSampler {
+private:
+    struct SampleHandle {
+        int stat_fd;
+        int statm_fd;
+        unsigned long long start_time;
+        unsigned long long last_ticks;
+        std::chrono::steady_clock::time_point last_sample;
+        bool has_baseline;
+    };
+    
+    std::map<pid_t, SampleHandle> handles;
+    long clock_ticks;
+    size_t page_size;
+    
+    bool open_handle(pid_t pid, SampleHandle& handle);
+    void close_handle(SampleHandle& handle);
+    bool read_handle(SampleHandle& handle, ProcStat& stat, ProcStatm& statm);
+    
+public:
+    ProcessSampler();
+    ~ProcessSampler();
+    
+    bool sample(pid_t pid, ProcessStats& stats);
+    void retain(const std::vector<pid_t>& pids);
+    
+    static bool parse_stat(const char* buffer, size_t length, ProcStat& stat);
+    static bool parse_statm(const char* buffer, size_t length, ProcStatm& statm);
+    static ProcessState state_from_code(char code);
+};
+
+class ProcessTree {
+private:
+    struct Node {
+        pid_t parent_pid;
+        pid_t root_pid;
+        unsigned long long start_time;
+        unsigned long long ticks;
+        size_t rss_bytes;
+    };
+    
+    struct Totals {
+        size_t process_count;
+        size_t memory_usage;
+        double cpu_usage;
+    };
+    
+    std::map<pid_t, Node> nodes;
+    std::map<pid_t, std::vector<pid_t>> members;
+    std::map<pid_t, Totals> totals;
+    std::chrono::steady_clock::time_point scan_time;
+    
+public:
+    void rebuild(const std::vector<pid_t>& roots, const ProcessTree& previous);
+    std::vector<pid_t> get_members(pid_t root) const;
+    bool get_totals(pid_t root, ProcessStats& stats) const;
+    bool get_start_time(pid_t pid, unsigned long long& start_time) const;
+    
+    static bool scan_proc(std::map<pid_t, ProcStat>& processes);
+};
+
+struct CgroupUsage {
+    uint64_t cpu_usage_usec;
+    uint64_t cpu_user_usec;
+    uint64_t cpu_system_usec;
+    uint64_t throttled_usec;
+    uint64_t memory_current;
+    uint64_t memory_peak;
+    uint64_t process_count;
+    uint64_t oom_kills;
+    double cpu_usage;
+};
+
+class CgroupManager {
+private:
+    struct CpuBaseline {
+        uint64_t usage_usec;
+        std::chrono::steady_clock::time_point sampled_at;
+    };
+    
+    Logger& logger;
+    std::mutex cgroup_mutex;
+    std::string root_path;
+    std::set<std::string> controllers;
+    std::map<std::string, CpuBaseline> baselines;
+    std::map<std::string, CpuBaseline> query_baselines;
+    std::set<std::string> pending_removal;
+    uint64_t next_id;
+    bool root_checked;
+    
+    bool ensure_root(const std::string& configured_root);
+    bool enable_controllers();
+    bool write_control(const std::string& path, const std::string& file, const std::string& value);
+    
+public:
+    CgroupManager(Logger& log);
+    
+    bool is_available();
+    std::string get_root();
+    std::string create(const std::string& name, const WineConfiguration& cfg);
+    bool apply_limits(const std::string& path, const WineConfiguration& cfg);
+    int open_procs(const std::string& path);
+    bool sample(const std::string& path, CgroupUsage& usage, bool monitor = true);
+    std::vector<pid_t> get_members(const std::string& path);
+    bool kill_all(const std::string& path);
+    bool remove(const std::string& path);
+    void prune();
+    
+    static std::string find_unified_mount();
+    static std::string find_own_cgroup();
+};
+
+enum class ProcessEventType {
+    STARTED,
+    STATE_CHANGED,
+    EXITED,
+    STATS_UPDATED,
+    MEMORY_THRESHOLD,
+    CPU_THRESHOLD
+};
+
+struct ProcessEvent {
+    ProcessEventType type;
+    uint64_t sequence;
+    std::chrono::steady_clock::time_point timestamp;
+    ProcessSummary process;
+};
+
+struct EventSubscriberStats {
+    std::string name;
+    uint64_t delivered;
+    uint64_t dropped;
+    uint64_t coalesced;
+    uint64_t batches;
+    size_t queue_depth;
+    double last_lag_ms;
+    double max_lag_ms;
+};
+
+typedef std::function<void(const std::vector<ProcessEvent>&)> ProcessEventHandler;
+
+class ProcessEventBus {
+private:
+    struct EventSlot {
+        std::atomic<size_t> sequence;
+        ProcessEvent event;
+    };
+    
+    struct Subscriber {
+        int id;
+        std::string name;
+        uint32_t type_mask;
+        ProcessEventHandler handler;
+        std::unique_ptr<EventSlot[]> slots;
+        size_t slot_mask;
+        std::atomic<size_t> enqueue_pos;
+        std::atomic<size_t> dequeue_pos;
+        std::mutex overflow_mutex;
+        std::deque<ProcessEvent> overflow;
+        std::atomic<bool> overflowed;
+        std::mutex wake_mutex;
+        std::condition_variable wake_cv;
+        std::atomic<bool> waiting;
+        std::atomic<bool> stopping;
+        std::thread worker;
+        std::atomic<uint64_t> delivered;
+        std::atomic<uint64_t> dropped;
+        std::atomic<uint64_t> coalesced;
+        std::atomic<uint64_t> batches;
+        std::atomic<int64_t> last_lag_us;
+        std::atomic<int64_t> max_lag_us;
+    };
+    
+    typedef std::vector<std::shared_ptr<Subscriber>> SubscriberList;
+    
+    Logger& logger;
+    std::mutex subscribers_mutex;
+    std::shared_ptr<const SubscriberList> subscribers;
+    int next_subscriber_id;
+    std::atomic<uint64_t> next_sequence;
+    
+    static bool try_enqueue(Subscriber& subscriber, const ProcessEvent& event);
+    static bool try_dequeue(Subscriber& subscriber, ProcessEvent& event);
+    static void deliver(const std::shared_ptr<Subscriber>& subscriber);
+    static void coalesce(Subscriber& subscriber, std::vector<ProcessEvent>& batch);
+    
+public:
+    static const uint32_t ALL_EVENTS = 0xffffffffu;
+    static uint32_t mask(ProcessEventType type) { return 1u << static_cast<int>(type); }
+    static const char* type_name(ProcessEventType type);
+    
+    ProcessEventBus(Logger& log);
+    ~ProcessEventBus();
+    
+    int subscribe(const std::string& name, ProcessEventHandler handler, uint32_t type_mask = ALL_EVENTS,
+                  size_t capacity = 1024);
+    void unsubscribe(int id);
+    void publish(ProcessEventType type, const ProcessSummary& process);
+    std::vector<EventSubscriberStats> get_stats();
+    void shutdown();
 };
 
 class ProcessMonitor {
@@ -189,17 +1261,41 @@ private:
     std::atomic<bool> monitoring_active;
     std::thread monitor_thread;
     Logger& logger;
-    std::vector<std::function<void(const ProcessInfo&)>> state_change_callbacks;
     std::chrono::milliseconds update_interval;
+    std::map<pid_t, int> process_fds;
+    std::condition_variable exit_cv;
+    int epoll_fd;
+    int wake_fd;
+    ProcessSampler sampler;
+    ProcessTree process_tree;
+    OutputCapture output_capture;
+    CgroupManager cgroups;
+    std::map<pid_t, std::set<pid_t>> offcore_threads;
+    std::shared_ptr<const ProcessTableSnapshot> snapshot;
+    uint64_t snapshot_generation;
+    ProcessEventBus events;
+    size_t memory_threshold;
+    double cpu_threshold;
+    std::map<pid_t, int> threshold_flags;
+    std::set<int> callback_subscriptions;
+    uint64_t sample_ticks;
+    double last_sample_ms;
+    double total_sample_ms;
     
     void monitor_loop();
-    void update_process_stats(ProcessInfo& info);
-    double calculate_cpu_usage(pid_t pid);
-    size_t get_memory_usage(pid_t pid);
-    ProcessState get_process_state(pid_t pid);
+    void publish_snapshot();
+    void wake_monitor();
+    int open_process_fd(pid_t pid);
+    void unwatch_process(pid_t pid);
+    bool reap_process(pid_t pid, ProcessInfo& info);
+    void handle_process_exit(pid_t pid);
+    void poll_unwatched_processes();
+    void sample_processes();
+    void check_affinity(pid_t root, const std::vector<int>& cpus, const std::vector<pid_t>& members,
+                        size_t& offcore, uint64_t& migrations);
+    void update_process_stats(ProcessStats& stats);
     std::string read_process_stdout(pid_t pid);
     std::string read_process_stderr(pid_t pid);
-    void notify_state_change(const ProcessInfo& info);
     bool is_process_alive(pid_t pid);
     
 public:
@@ -210,9 +1306,19 @@ public:
     void stop_monitoring();
     void add_process(pid_t pid, const ProcessInfo& info);
     void remove_process(pid_t pid);
+    void attach_output(pid_t pid, int stdout_fd, int stderr_fd, const std::string& tee_path = "");
+    OutputCapture& get_output_capture() { return output_capture; }
+    CgroupManager& get_cgroups() { return cgroups; }
+    ProcessEventBus& get_event_bus() { return events; }
+    void set_event_thresholds(size_t memory_bytes, double cpu_percent);
+    bool get_cgroup_usage(pid_t pid, CgroupUsage& usage);
+    int wait_for_exit(pid_t pid);
+    bool has_exited(pid_t pid, int& exit_code);
     ProcessInfo get_process_info(pid_t pid);
     std::vector<ProcessInfo> get_all_processes();
-    void register_callback(std::function<void(const ProcessInfo&)> callback);
+    std::shared_ptr<const ProcessTableSnapshot> get_snapshot() const;
+    int register_callback(std::function<void(const ProcessInfo&)> callback);
+    void unregister_callback(int callback_id);
     void clear_callbacks();
     void set_update_interval(std::chrono::milliseconds interval);
     bool is_process_monitored(pid_t pid);
@@ -222,6 +1328,13 @@ public:
     std::map<std::string, double> get_system_stats();
 };
 
+struct LaunchEnvironment {
+    std::vector<char> arena;
+    std::vector<char*> envp;
+    std::string binary;
+    PreparedLaunchProfile profile;
+};
+
 class WineExecutor {
 private:
     WineConfiguration config;
@@ -232,40 +1345,55 @@ private:
     std::map<std::string, std::string> custom_environment;
     std::vector<std::string> pre_launch_commands;
     std::vector<std::string> post_launch_commands;
-    int stdout_pipe[2];
-    int stderr_pipe[2];
     pid_t current_process_pid;
     std::mutex execution_mutex;
+    std::shared_ptr<const LaunchEnvironment> launch_environment;
+    std::shared_ptr<const std::map<std::string, std::string>> base_environment;
+    MetricsRegistry* metrics;
+    ShaderCacheManager* shader_cache;
+    PrefetchManager* prefetch;
     
-    bool setup_environment();
-    bool setup_pipes();
-    void close_pipes();
-    std::vector<std::string> build_wine_command(const std::string& exe_path, const std::vector<std::string>& args);
-    bool execute_pre_launch_commands();
+    bool setup_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env);
+    bool setup_pipes(const WineConfiguration& cfg, int stdout_pipe[2], int stderr_pipe[2]);
+    void close_pipes(int stdout_pipe[2], int stderr_pipe[2]);
+    std::vector<std::string> build_wine_command(const LaunchEnvironment& env, const std::string& exe_path,
+                                                const std::vector<std::string>& args);
+    bool execute_pre_launch_commands(const std::vector<std::string>& commands, std::chrono::seconds timeout);
     bool execute_post_launch_commands();
-    void setup_dll_overrides();
+    void run_hook(const std::string& phase, const std::string& command, std::chrono::seconds timeout);
+    void setup_dll_overrides(const WineConfiguration& cfg, std::map<std::string, std::string>& env);
     void setup_registry_settings();
     bool validate_executable(const std::string& exe_path);
-    std::string resolve_path(const std::string& path);
-    void setup_graphics_environment();
-    void setup_audio_environment();
-    char** build_environment_array();
-    void free_environment_array(char** env);
-    void handle_child_process(const std::vector<std::string>& command);
+    std::string resolve_path(const WineConfiguration& cfg, const std::string& path);
+    void setup_graphics_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env);
+    void setup_audio_environment(const WineConfiguration& cfg, std::map<std::string, std::string>& env);
+    std::shared_ptr<const LaunchEnvironment> build_environment_array(const WineConfiguration& cfg);
+    void invalidate_environment();
+    pid_t spawn_process(const WineConfiguration& cfg, const LaunchEnvironment& env, char* const* envp,
+                        const std::vector<std::string>& command, int stdout_fd, int stderr_fd, int cgroup_fd,
+                        int& cgroup_error);
     int wait_for_process(pid_t pid);
     
 public:
     WineExecutor(Logger& log, ProcessMonitor& mon, WinePrefixManager& pm);
     ~WineExecutor();
     
+    void set_metrics(MetricsRegistry* registry) { metrics = registry; }
+    void set_shader_cache(ShaderCacheManager* cache) { shader_cache = cache; }
+    void set_prefetch(PrefetchManager* manager) { prefetch = manager; }
     void set_configuration(const WineConfiguration& cfg);
     WineConfiguration get_configuration() const;
     pid_t execute(const std::string& exe_path, const std::vector<std::string>& arguments = {});
+    pid_t execute(const WineConfiguration& cfg, const std::shared_ptr<const LaunchEnvironment>& env,
+                  const std::string& exe_path, const std::vector<std::string>& arguments = {});
+    std::shared_ptr<const LaunchEnvironment> prepare_environment(const WineConfiguration& cfg);
+    int wait_for_exit(pid_t pid);
     bool execute_async(const std::string& exe_path, const std::vector<std::string>& arguments = {});
     int execute_sync(const std::string& exe_path, const std::vector<std::string>& arguments = {});
     void add_environment_variable(const std::string& key, const std::string& value);
     void remove_environment_variable(const std::string& key);
     void clear_environment_variables();
+    void set_base_environment(std::shared_ptr<const std::map<std::string, std::string>> env);
     void add_pre_launch_command(const std::string& command);
     void add_post_launch_command(const std::string& command);
     void clear_pre_launch_commands();
@@ -279,13 +1407,204 @@ public:
     std::map<std::string, std::string> get_wine_info();
 };
 
+struct LaunchRequest {
+    std::string exe_path;
+    std::vector<std::string> arguments;
+    std::string prefix;
+    std::optional<WineConfiguration> config;
+};
+
+struct LaunchHandle {
+    uint64_t id;
+    std::string prefix;
+    std::shared_future<pid_t> pid;
+    std::shared_future<int> exit_code;
+};
+
+class LaunchScheduler {
+private:
+    struct PendingLaunch {
+        uint64_t id;
+        LaunchRequest request;
+        std::string prefix_key;
+        pid_t pid;
+        std::promise<pid_t> pid_promise;
+        std::promise<int> exit_promise;
+    };
+    
+    Logger& logger;
+    WineExecutor& executor;
+    WinePrefixManager& prefix_manager;
+    ProcessMonitor& monitor;
+    std::deque<std::shared_ptr<PendingLaunch>> pending;
+    std::map<pid_t, std::shared_ptr<PendingLaunch>> running;
+    std::map<std::string, size_t> active_per_prefix;
+    std::map<std::string, std::shared_ptr<const LaunchEnvironment>> environments;
+    size_t active_total;
+    size_t max_concurrency;
+    size_t max_per_prefix;
+    size_t launcher_count;
+    std::vector<std::thread> launchers;
+    std::mutex scheduler_mutex;
+    std::condition_variable scheduler_cv;
+    std::condition_variable idle_cv;
+    bool stopping;
+    uint64_t next_launch_id;
+    int exit_callback_id;
+    
+    void launcher_loop();
+    std::shared_ptr<PendingLaunch> take_next_launch();
+    bool resolve_launch(PendingLaunch& launch, WineConfiguration& config,
+                        std::shared_ptr<const LaunchEnvironment>& env);
+    void release_slot(const std::string& prefix_key);
+    void complete_launch(pid_t pid, int exit_code);
+    
+public:
+    LaunchScheduler(Logger& log, WineExecutor& exec, WinePrefixManager& pm, ProcessMonitor& mon);
+    ~LaunchScheduler();
+    
+    void set_max_concurrency(size_t limit);
+    void set_max_per_prefix(size_t limit);
+    void set_launcher_threads(size_t count);
+    
+    LaunchHandle submit(const LaunchRequest& request);
+    std::vector<LaunchHandle> submit_batch(const std::vector<LaunchRequest>& requests);
+    bool cancel(uint64_t launch_id);
+    bool wait_idle(std::chrono::milliseconds timeout);
+    size_t pending_count();
+    size_t running_count();
+    void shutdown();
+};
+
+struct RegistryTransactionStats {
+    uint64_t commits;
+    uint64_t committed_changes;
+    uint64_t failed_commits;
+    size_t pending_changes;
+    double last_commit_ms;
+    double average_commit_ms;
+};
+
+struct RegistryNameLess {
+    bool operator()(const std::string& a, const std::string& b) const;
+};
+
+class RegistryHive {
+private:
+    struct KeyEntry {
+        std::string_view name;
+        size_t first_value;
+        size_t value_count;
+    };
+    
+    struct ValueEntry {
+        std::string_view name;
+        std::string_view data;
+    };
+    
+    std::string file_path;
+    void* mapping;
+    size_t mapping_size;
+    bool escaped_keys;
+    dev_t file_device;
+    ino_t file_inode;
+    off_t file_size;
+    struct timespec file_mtime;
+    std::vector<KeyEntry> keys;
+    std::vector<ValueEntry> values;
+    
+    void unmap();
+    void parse();
+    const KeyEntry* find_key(const std::string& key) const;
+    std::string key_name(const KeyEntry& entry) const;
+    
+public:
+    RegistryHive();
+    ~RegistryHive();
+    RegistryHive(const RegistryHive&) = delete;
+    RegistryHive& operator=(const RegistryHive&) = delete;
+    
+    bool load(const std::string& path);
+    bool is_stale() const;
+    const std::string& get_path() const { return file_path; }
+    size_t key_count() const { return keys.size(); }
+    size_t value_count() const { return values.size(); }
+    
+    bool key_exists(const std::string& key) const;
+    bool get_value(const std::string& key, const std::string& name, std::string& value) const;
+    std::vector<std::string> list_keys(const std::string& prefix) const;
+    std::vector<std::string> list_values(const std::string& key) const;
+    void for_each_value(const std::function<void(const std::string&, const std::string&,
+                                                 const std::string&)>& callback) const;
+    
+    static int compare_names(std::string_view a, bool a_escaped, std::string_view b, bool b_escaped,
+                             bool prefix_only = false);
+    static std::string unescape(std::string_view raw);
+    static std::string decode_value(std::string_view data);
+};
+
 class RegistryManager {
 private:
+    struct LoadedHive {
+        std::shared_ptr<RegistryHive> hive;
+        std::chrono::steady_clock::time_point checked;
+    };
+    
+    struct HiveTarget {
+        std::shared_ptr<RegistryHive> hive;
+        std::string root;
+        std::string subkey;
+        std::string base;
+    };
+    
+    // Overlay state of one key before the pending changes touched it
+    struct SavedKey {
+        bool cached;
+        std::map<std::string, std::string, RegistryNameLess> values;
+        bool has_deleted_values;
+        std::set<std::string, RegistryNameLess> deleted_values;
+        bool deleted;
+    };
+    
     std::string prefix_path;
     Logger& logger;
-    std::map<std::string, std::map<std::string, std::string>> registry_cache;
+    std::map<std::string, std::map<std::string, std::string, RegistryNameLess>, RegistryNameLess> registry_cache;
+    std::map<std::string, std::set<std::string, RegistryNameLess>, RegistryNameLess> deleted_values;
+    std::set<std::string, RegistryNameLess> deleted_keys;
     std::mutex registry_mutex;
+    std::map<std::string, LoadedHive> hives;
+    std::mutex hive_mutex;
+    WineserverPool* server_pool;
+    std::string wine_binary;
+    MetricsRegistry* metrics;
     
+    size_t transaction_depth;
+    std::thread::id transaction_owner;
+    std::string pending_import;
+    std::string pending_key;
+    size_t pending_changes;
+    std::map<std::string, SavedKey, RegistryNameLess> pending_undo;
+    bool rollback_only;
+    std::mutex commit_mutex;
+    std::condition_variable writer_cv;
+    uint64_t commits;
+    uint64_t committed_changes;
+    uint64_t failed_commits;
+    double last_commit_ms;
+    double total_commit_ms;
+    
+    void warm_server();
+    CommandResult run_regedit(const std::vector<std::string>& args);
+    std::unique_lock<std::mutex> lock_writer();
+    void save_key_locked(const std::string& key);
+    void restore_keys_locked(const std::map<std::string, SavedKey, RegistryNameLess>& saved);
+    void queue_change(const std::string& header, const std::string& line);
+    bool flush_pending();
+    void discard_transaction_locked();
+    std::string format_value_name(const std::string& name);
+    std::shared_ptr<RegistryHive> load_hive(const std::string& file_path);
+    std::vector<HiveTarget> resolve_key(const std::string& key);
+    bool is_deleted(const std::string& key) const;
     std::string get_registry_file_path(const std::string& hive);
     bool parse_registry_file(const std::string& file_path);
     bool write_registry_file(const std::string& file_path);
@@ -297,6 +1616,18 @@ public:
     RegistryManager(const std::string& prefix, Logger& log);
     ~RegistryManager();
     
+    void set_server_pool(WineserverPool* pool, const std::string& binary = "wine");
+    void set_metrics(MetricsRegistry* registry) { metrics = registry; }
+    
+    // Transactions nest: inner commits only close their level, and rolling back an inner level marks
+    // the outermost transaction rollback-only, so its commit discards everything and returns false.
+    // A transaction belongs to the thread that began it; writes from other threads wait until it ends.
+    void begin_transaction();
+    bool commit_transaction();
+    void rollback_transaction();
+    bool in_transaction();
+    RegistryTransactionStats get_transaction_stats();
+    
     bool set_value(const std::string& key, const std::string& name, const std::string& value);
     std::string get_value(const std::string& key, const std::string& name);
     bool delete_value(const std::string& key, const std::string& name);
@@ -312,23 +1643,53 @@ public:
 };
 
 class WinetricksManager {
+public:
+    static constexpr std::chrono::hours DEFAULT_INSTALL_TIMEOUT{2};
+    
 private:
+    struct InstalledVerbs {
+        std::string signature;
+        std::vector<std::string> ordered;
+        std::set<std::string> verbs;
+    };
+    
     std::string winetricks_path;
     Logger& logger;
     std::vector<std::string> available_verbs;
     std::map<std::string, std::vector<std::string>> verb_categories;
+    std::map<std::string, std::string> verb_descriptions;
+    std::string catalog_directory;
+    bool catalog_loaded;
+    std::mutex catalog_mutex;
+    std::map<std::string, InstalledVerbs> installed_cache;
+    std::map<std::string, std::shared_ptr<std::mutex>> prefix_locks;
+    std::mutex installed_mutex;
     std::mutex winetricks_mutex;
+    std::chrono::milliseconds install_timeout;
+    ArtifactStore* artifacts;
+    MetricsRegistry* metrics;
     
     bool find_winetricks_executable();
     bool update_verb_list();
-    std::string execute_winetricks_command(const std::string& command);
+    bool ensure_catalog();
+    bool refresh_catalog();
+    std::string executable_signature();
+    bool load_catalog_cache(const std::string& signature);
+    void store_catalog_cache(const std::string& signature, const std::string& version);
+    CommandResult run_winetricks(const std::vector<std::string>& args, const std::string& prefix,
+                                 std::chrono::milliseconds timeout);
     bool parse_verb_output(const std::string& output);
+    InstalledVerbs load_installed(const std::string& prefix);
+    std::shared_ptr<std::mutex> prefix_lock(const std::string& prefix);
     
 public:
     WinetricksManager(Logger& log);
     ~WinetricksManager();
     
     bool install_verb(const std::string& verb, const std::string& prefix);
+    bool install_verbs(const std::vector<std::string>& verbs, const std::string& prefix);
+    std::map<std::string, bool> install_batch(const std::map<std::string, std::vector<std::string>>& prefix_verbs,
+                                              size_t max_parallel = 4);
     bool uninstall_verb(const std::string& verb, const std::string& prefix);
     std::vector<std::string> list_installed_verbs(const std::string& prefix);
     std::vector<std::string> list_available_verbs();
@@ -338,22 +1699,39 @@ public:
     std::string get_verb_description(const std::string& verb);
     bool update_winetricks();
     std::string get_winetricks_version();
+    void set_artifact_store(ArtifactStore* store) { artifacts = store; }
+    void set_metrics(MetricsRegistry* registry) { metrics = registry; }
+    void set_install_timeout(std::chrono::milliseconds timeout) { install_timeout = timeout; }
 };
 
 class WineApplicationManager {
 private:
     Logger logger;
+    MetricsRegistry metrics;
     ProcessMonitor monitor;
     WinePrefixManager prefix_manager;
     WineExecutor executor;
+    LaunchScheduler launch_scheduler;
     RegistryManager* registry_manager;
     WinetricksManager winetricks_manager;
+    ArtifactStore artifact_store;
+    ShaderCacheManager shader_cache;
+    PrefetchManager prefetch;
+    FleetCoordinator fleet;
     WineConfiguration current_config;
     std::string config_directory;
     std::map<std::string, std::string> application_shortcuts;
     std::mutex manager_mutex;
+    mutable std::mutex config_mutex;
+    bool owns_trace;
+    bool manager_pinned;
     
     bool initialize_directories();
+    void update_tracing();
+    void update_shader_cache();
+    void update_prefetch();
+    void update_server_pool();
+    void update_fleet();
     bool load_application_shortcuts();
     bool save_application_shortcuts();
     
@@ -366,6 +1744,9 @@ public:
     
     pid_t run_executable(const std::string& exe_path, const std::vector<std::string>& args = {});
     int run_executable_sync(const std::string& exe_path, const std::vector<std::string>& args = {});
+    LaunchHandle queue_launch(const LaunchRequest& request);
+    std::vector<LaunchHandle> execute_batch(const std::vector<LaunchRequest>& requests);
+    void set_launch_concurrency(size_t global_limit, size_t per_prefix_limit);
     
     void set_wine_configuration(const WineConfiguration& config);
     WineConfiguration get_wine_configuration() const;
@@ -380,6 +1761,7 @@ public:
     
     ProcessInfo get_process_info(pid_t pid);
     std::vector<ProcessInfo> get_all_running_processes();
+    std::shared_ptr<const ProcessTableSnapshot> get_process_snapshot();
     void terminate_process(pid_t pid);
     void kill_all_processes();
     
@@ -389,16 +1771,107 @@ public:
     std::vector<std::string> list_application_shortcuts();
     
     bool install_winetricks_component(const std::string& component);
+    bool install_winetricks_components(const std::vector<std::string>& components);
+    std::map<std::string, bool> install_winetricks_components(const std::vector<std::string>& prefix_names,
+                                                              const std::vector<std::string>& components);
     std::vector<std::string> list_available_components();
     
     std::map<std::string, std::string> get_system_info();
+    std::map<std::string, std::string> get_node_status();
+    std::string get_metrics_text();
     std::string get_version();
     
     Logger& get_logger() { return logger; }
+    MetricsRegistry& get_metrics() { return metrics; }
     ProcessMonitor& get_monitor() { return monitor; }
     WinePrefixManager& get_prefix_manager() { return prefix_manager; }
     WineExecutor& get_executor() { return executor; }
+    LaunchScheduler& get_launch_scheduler() { return launch_scheduler; }
     WinetricksManager& get_winetricks_manager() { return winetricks_manager; }
+    ArtifactStore& get_artifact_store() { return artifact_store; }
+    ShaderCacheManager& get_shader_cache() { return shader_cache; }
+    PrefetchManager& get_prefetch() { return prefetch; }
+    FleetCoordinator& get_fleet() { return fleet; }
+};
+
+using DaemonMessage = std::map<std::string, std::string>;
+using DaemonCommandHandler = std::function<int(const std::vector<std::string>& args, const DaemonMessage* environment,
+                                               std::ostream& out, std::ostream& err)>;
+
+class ManagerDaemon {
+private:
+    struct Connection {
+        int fd;
+        bool subscribed;
+        std::mutex write_mutex;
+    };
+    
+    WineApplicationManager& manager;
+    Logger& logger;
+    DaemonCommandHandler handler;
+    std::string socket_path;
+    int listen_fd;
+    int wake_fd;
+    std::atomic<bool> running;
+    std::map<int, std::shared_ptr<Connection>> connections;
+    size_t active_connections;
+    std::mutex connections_mutex;
+    std::condition_variable connections_cv;
+    int callback_id;
+    
+    void serve_connection(std::shared_ptr<Connection> connection);
+    bool handle_request(Connection& connection, const std::string& line, bool private_cwd);
+    bool send_line(Connection& connection, const std::string& line);
+    void broadcast_process_event(const ProcessEvent& process_event);
+    std::string encode_processes();
+    
+public:
+    ManagerDaemon(WineApplicationManager& mgr, DaemonCommandHandler command_handler);
+    ~ManagerDaemon();
+    ManagerDaemon(const ManagerDaemon&) = delete;
+    ManagerDaemon& operator=(const ManagerDaemon&) = delete;
+    
+    bool start(const std::string& path = "");
+    void run();
+    void stop();
+    
+    static std::string default_socket_path();
+    static std::string encode_message(const DaemonMessage& fields, const std::string& raw_fields = "");
+    static bool decode_message(const std::string& line, DaemonMessage& fields,
+                               std::vector<std::string>* args = nullptr,
+                               std::map<std::string, DaemonMessage>* objects = nullptr);
+    static bool forwarded_variable(const std::string& name);
+};
+
+class DaemonClient {
+private:
+    int fd;
+    uint64_t next_id;
+    std::string read_buffer;
+    
+    bool send_request(const DaemonMessage& fields, const std::vector<std::string>* args,
+                      const std::string& raw_fields = "");
+    bool read_message(DaemonMessage& fields);
+    
+public:
+    DaemonClient();
+    ~DaemonClient();
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+    
+    bool connect(const std::string& path = "");
+    void disconnect();
+    bool is_connected() const { return fd != -1; }
+    
+    static DaemonMessage forwarded_environment();
+    
+    int execute(const std::vector<std::string>& args, std::string& out, std::string& err,
+                const DaemonMessage* environment = nullptr);
+    bool set_timeout(int milliseconds);
+    bool ping();
+    bool node_status(DaemonMessage& status);
+    bool request_shutdown();
+    bool subscribe(const std::function<bool(const DaemonMessage&)>& callback);
 };
 
 class ConfigurationParser {
@@ -427,15 +1900,51 @@ public:
     std::vector<std::string> get_keys();
 };
 
+class PrefixPathCache {
+private:
+    struct DirectoryEntries {
+        struct timespec mtime;
+        ino_t inode;
+        std::multimap<std::string, std::string> names;
+    };
+    
+    std::string wine_prefix;
+    std::mutex cache_mutex;
+    std::map<std::string, std::string> drive_mappings;
+    bool drives_loaded;
+    struct timespec dosdevices_mtime;
+    ino_t dosdevices_inode;
+    std::map<std::string, DirectoryEntries> directories;
+    size_t directory_scans;
+    
+    void refresh_drives_locked();
+    const DirectoryEntries* directory_locked(const std::string& path);
+    
+public:
+    explicit PrefixPathCache(const std::string& prefix);
+    
+    static std::shared_ptr<PrefixPathCache> for_prefix(const std::string& prefix);
+    static std::string fold_case(const std::string& name);
+    
+    std::map<std::string, std::string> get_drive_mappings();
+    std::string resolve_drive(char drive);
+    std::string resolve_case(const std::string& root, const std::string& relative);
+    void invalidate_drives();
+    void clear();
+    size_t get_directory_scans();
+};
+
 class PathResolver {
 private:
     std::string wine_prefix;
-    std::map<std::string, std::string> path_mappings;
+    std::shared_ptr<PrefixPathCache> cache;
     
 public:
     PathResolver(const std::string& prefix);
     
     std::string windows_to_unix(const std::string& windows_path);
+    std::vector<std::string> windows_to_unix(const std::vector<std::string>& windows_paths);
+    std::string resolve_case(const std::string& unix_path);
     std::string unix_to_windows(const std::string& unix_path);
     std::string resolve_drive_letter(char drive);
     bool create_drive_mapping(char drive, const std::string& unix_path);
@@ -448,6 +1957,9 @@ public:
 
 namespace Utils {
     std::string execute_command(const std::string& command);
+    CommandResult run_command(const std::vector<std::string>& argv, const CommandOptions& options = CommandOptions());
+    std::future<CommandResult> run_command_async(const std::vector<std::string>& argv,
+                                                 const CommandOptions& options = CommandOptions());
     bool file_exists(const std::string& path);
     bool directory_exists(const std::string& path);
     bool create_directory(const std::string& path);
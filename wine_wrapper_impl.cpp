@@ -8,39 +8,256 @@
 #include <dirent.h>
 #include <cstring>
 #include <cstdlib>
+#include <cerrno>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+#ifndef SYS_pidfd_send_signal
+#define SYS_pidfd_send_signal 424
+#endif
 
 namespace WineWrapper {
 
-WinePrefixManager::WinePrefixManager(Logger& log) : logger(log) {
-    base_prefix_directory = Utils::get_home_directory() + "/.local/share/wineprefixes";
-    Utils::create_directory(base_prefix_directory);
+namespace {
+
+// Per-prefix processes every application in the prefix shares; killing one application must not take
+// them down with it.
+const char* const SHARED_PREFIX_PROCESSES[] = {
+    "wineserver", "wineserver64", "services.exe", "winedevice.exe", "plugplay.exe", "explorer.exe",
+    "rpcss.exe", "svchost.exe"
+};
+
+bool read_start_time(pid_t pid, unsigned long long& start_time) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%d/stat", static_cast<int>(pid));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        return false;
+    }
     
-    auto prefixes = Utils::list_directory(base_prefix_directory);
-    for (const auto& prefix_name : prefixes) {
-        std::string prefix_path = Utils::join_paths(base_prefix_directory, prefix_name);
-        if (Utils::directory_exists(prefix_path)) {
-            WineConfiguration config;
-            config.wine_prefix = prefix_path;
-            std::string config_file = Utils::join_paths(prefix_path, "config.ini");
-            if (Utils::file_exists(config_file)) {
-                config.load_from_file(config_file);
-            }
-            prefix_configs[prefix_name] = config;
+    char buffer[1024];
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    close(fd);
+    
+    ProcStat stat;
+    if (length <= 0 || !ProcessSampler::parse_stat(buffer, static_cast<size_t>(length), stat)) {
+        return false;
+    }
+    start_time = stat.start_time;
+    return true;
+}
+
+bool shared_prefix_process(pid_t pid) {
+    std::string comm = Utils::read_file("/proc/" + std::to_string(pid) + "/comm");
+    while (!comm.empty() && (comm.back() == '\n' || comm.back() == ' ')) {
+        comm.pop_back();
+    }
+    for (const char* name : SHARED_PREFIX_PROCESSES) {
+        if (comm == name) {
+            return true;
         }
     }
+    return false;
+}
+
+bool send_signal(int pid_fd, pid_t pid, int signal) {
+    if (pid_fd != -1) {
+        return syscall(SYS_pidfd_send_signal, pid_fd, signal, nullptr, 0) == 0;
+    }
+    return kill(pid, signal) == 0;
+}
+
+// Signals a tree member only if it is still the process the last scan saw. The pidfd pins the
+// process while its start time is checked, so a pid reused in between is never signalled.
+bool signal_member(pid_t pid, unsigned long long expected_start, int signal) {
+    int pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    unsigned long long start_time = 0;
+    bool sent = false;
+    if (read_start_time(pid, start_time) && start_time == expected_start && !shared_prefix_process(pid)) {
+        sent = send_signal(pid_fd, pid, signal);
+    }
+    if (pid_fd != -1) {
+        close(pid_fd);
+    }
+    return sent;
+}
+
+}
+
+WinePrefixManager::WinePrefixManager(Logger& log)
+    : index_loaded(false), logger(log), server_pool(log), cloner(log), scanner(log), winetricks(nullptr),
+      metrics(nullptr) {
+    index_mtime.tv_sec = 0;
+    index_mtime.tv_nsec = 0;
+    base_prefix_directory = Utils::get_home_directory() + "/.local/share/wineprefixes";
+    Utils::create_directory(base_prefix_directory);
     
     logger.info("WinePrefixManager initialized with base directory: " + base_prefix_directory);
 }
 
 WinePrefixManager::~WinePrefixManager() {
     for (auto& pair : prefix_configs) {
+        if (loaded_configs.count(pair.first) == 0) {
+            continue;
+        }
         std::string config_file = Utils::join_paths(pair.second.wine_prefix, "config.ini");
         pair.second.save_to_file(config_file);
     }
     logger.info("WinePrefixManager shutting down");
 }
 
+std::string WinePrefixManager::index_file_path() {
+    char name[48];
+    snprintf(name, sizeof(name), "prefix-index-%016zx", std::hash<std::string>()(base_prefix_directory));
+    return Utils::join_paths(Utils::get_home_directory(), std::string(".cache/wine-wrapper/") + name);
+}
+
+bool WinePrefixManager::load_index(const struct timespec& mtime, std::vector<std::string>& names) {
+    std::ifstream file(index_file_path());
+    if (!file.is_open()) {
+        return false;
+    }
+    
+    std::string header;
+    std::string directory;
+    long long seconds = 0;
+    long nanoseconds = 0;
+    
+    if (!std::getline(file, header) || header != "wine-prefix-index 1" ||
+        !std::getline(file, directory) || directory != base_prefix_directory ||
+        !(file >> seconds >> nanoseconds) || seconds != static_cast<long long>(mtime.tv_sec) ||
+        nanoseconds != mtime.tv_nsec) {
+        return false;
+    }
+    
+    std::string name;
+    std::getline(file, name);
+    while (std::getline(file, name)) {
+        if (!name.empty()) {
+            names.push_back(name);
+        }
+    }
+    return true;
+}
+
+void WinePrefixManager::save_index() {
+    struct stat st;
+    if (stat(base_prefix_directory.c_str(), &st) != 0) {
+        return;
+    }
+    
+    std::string path = index_file_path();
+    if (!Utils::create_directory(Utils::get_directory(path))) {
+        return;
+    }
+    
+    std::string content = "wine-prefix-index 1\n" + base_prefix_directory + "\n" +
+                          std::to_string(static_cast<long long>(st.st_mtim.tv_sec)) + " " +
+                          std::to_string(st.st_mtim.tv_nsec) + "\n";
+    for (const auto& pair : prefix_configs) {
+        content += pair.first + "\n";
+    }
+    
+    std::string temp_path = path + ".tmp." + std::to_string(getpid());
+    if (Utils::write_file(temp_path, content) && rename(temp_path.c_str(), path.c_str()) != 0) {
+        unlink(temp_path.c_str());
+    }
+}
+
+// Re-stats the base directory on every call so prefixes created or removed by other processes (local
+// wine-cli runs next to a long-lived daemon) show up without a restart.
+void WinePrefixManager::ensure_index() {
+    struct stat st;
+    if (stat(base_prefix_directory.c_str(), &st) != 0) {
+        index_loaded = true;
+        return;
+    }
+    if (index_loaded && st.st_mtim.tv_sec == index_mtime.tv_sec && st.st_mtim.tv_nsec == index_mtime.tv_nsec) {
+        return;
+    }
+    index_loaded = true;
+    index_mtime = st.st_mtim;
+    
+    std::vector<std::string> names;
+    bool from_index = load_index(st.st_mtim, names);
+    
+    if (!from_index) {
+        DIR* dir = opendir(base_prefix_directory.c_str());
+        if (dir) {
+            struct dirent* entry;
+            while ((entry = readdir(dir)) != nullptr) {
+                if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+                    continue;
+                }
+                struct stat child;
+                bool is_dir = entry->d_type == DT_DIR ||
+                              ((entry->d_type == DT_UNKNOWN || entry->d_type == DT_LNK) &&
+                               fstatat(dirfd(dir), entry->d_name, &child, 0) == 0 && S_ISDIR(child.st_mode));
+                if (is_dir) {
+                    names.push_back(entry->d_name);
+                }
+            }
+            closedir(dir);
+        }
+    }
+    
+    std::set<std::string> present(names.begin(), names.end());
+    for (auto it = prefix_configs.begin(); it != prefix_configs.end();) {
+        if (present.count(it->first) == 0) {
+            loaded_configs.erase(it->first);
+            it = prefix_configs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    for (const auto& name : names) {
+        if (prefix_configs.find(name) == prefix_configs.end() && reserved_prefixes.count(name) == 0) {
+            prefix_configs[name].wine_prefix = Utils::join_paths(base_prefix_directory, name);
+        }
+    }
+    
+    if (!from_index) {
+        save_index();
+    }
+    logger.debug("Indexed " + std::to_string(names.size()) + " prefixes" + (from_index ? " from cache" : ""));
+}
+
+std::map<std::string, WineConfiguration>::iterator WinePrefixManager::find_prefix(const std::string& prefix_name) {
+    ensure_index();
+    
+    auto it = prefix_configs.find(prefix_name);
+    if (it == prefix_configs.end()) {
+        return it;
+    }
+    
+    // Reload when another process rewrote config.ini since this one last read or wrote it
+    std::string config_file = Utils::join_paths(it->second.wine_prefix, "config.ini");
+    struct stat st;
+    bool exists = stat(config_file.c_str(), &st) == 0;
+    auto loaded = loaded_configs.find(prefix_name);
+    if (loaded == loaded_configs.end() ||
+        (exists && (st.st_mtim.tv_sec != loaded->second.tv_sec || st.st_mtim.tv_nsec != loaded->second.tv_nsec))) {
+        if (exists) {
+            it->second.load_from_file(config_file);
+        }
+        loaded_configs[prefix_name] = exists ? st.st_mtim : timespec();
+    }
+    return it;
+}
+
+void WinePrefixManager::mark_loaded(const std::string& prefix_name, const std::string& prefix_path) {
+    struct stat st;
+    bool exists = stat(Utils::join_paths(prefix_path, "config.ini").c_str(), &st) == 0;
+    loaded_configs[prefix_name] = exists ? st.st_mtim : timespec();
+}
+
 bool WinePrefixManager::create_directory_structure(const std::string& prefix_path) {
+    TraceSpan span("create_directory_structure", "prefix", prefix_path);
     if (!Utils::create_directory(prefix_path)) {
         logger.error("Failed to create prefix directory: " + prefix_path);
         return false;
@@ -73,18 +290,26 @@ bool WinePrefixManager::create_directory_structure(const std::string& prefix_pat
 }
 
 bool WinePrefixManager::initialize_registry(const std::string& prefix_path, WineArchitecture arch) {
+    TraceSpan span("initialize_registry", "prefix", prefix_path);
     logger.info("Initializing registry for prefix: " + prefix_path);
     
-    std::string wine_cmd = "WINEPREFIX=" + prefix_path + " ";
+    CommandOptions options;
+    options.environment["WINEPREFIX"] = prefix_path;
     if (arch == WineArchitecture::WIN32) {
-        wine_cmd += "WINEARCH=win32 ";
+        options.environment["WINEARCH"] = "win32";
     } else if (arch == WineArchitecture::WIN64) {
-        wine_cmd += "WINEARCH=win64 ";
+        options.environment["WINEARCH"] = "win64";
     }
-    wine_cmd += "wineboot -u 2>&1";
+    options.timeout = std::chrono::minutes(5);
     
-    std::string output = Utils::execute_command(wine_cmd);
-    logger.debug("Wineboot output: " + output);
+    CommandResult result = Utils::run_command({"wineboot", "-u"}, options);
+    logger.debug("Wineboot output: " + result.output);
+    
+    if (result.timed_out) {
+        logger.error("wineboot timed out after " + std::to_string(static_cast<int>(result.elapsed_ms)) +
+                     " ms for prefix: " + prefix_path);
+        return false;
+    }
     
     return Utils::directory_exists(Utils::join_paths(prefix_path, "system.reg"));
 }
@@ -92,22 +317,37 @@ bool WinePrefixManager::initialize_registry(const std::string& prefix_path, Wine
 bool WinePrefixManager::install_components(const std::string& prefix_path, 
                                            const std::vector<std::string>& components) {
     if (components.empty()) return true;
+    TraceSpan span("install_components", "prefix", prefix_path);
     
     logger.info("Installing components for prefix: " + prefix_path);
     
-    for (const auto& component : components) {
-        std::string cmd = "WINEPREFIX=" + prefix_path + " winetricks -q " + component + " 2>&1";
-        logger.debug("Running: " + cmd);
-        std::string output = Utils::execute_command(cmd);
-        logger.debug("Winetricks output: " + output);
+    bool success = true;
+    if (winetricks) {
+        success = winetricks->install_verbs(components, prefix_path);
+    } else {
+        std::vector<std::string> argv = {"winetricks", "-q"};
+        argv.insert(argv.end(), components.begin(), components.end());
+        
+        CommandOptions options;
+        options.environment["WINEPREFIX"] = prefix_path;
+        options.timeout = WinetricksManager::DEFAULT_INSTALL_TIMEOUT;
+        CommandResult result = Utils::run_command(argv, options);
+        logger.debug("Winetricks output: " + result.output);
+        if (result.timed_out) {
+            logger.error("winetricks timed out installing components in prefix: " + prefix_path);
+        }
+        success = result.exit_code == 0 && !result.timed_out;
     }
     
-    return true;
+    scanner.invalidate(prefix_path);
+    
+    return success;
 }
 
 std::string WinePrefixManager::get_wine_version(const std::string& wine_binary) {
-    std::string cmd = wine_binary + " --version 2>&1";
-    return Utils::execute_command(cmd);
+    CommandOptions options;
+    options.timeout = std::chrono::seconds(30);
+    return Utils::run_command({wine_binary, "--version"}, options).output;
 }
 
 bool WinePrefixManager::verify_prefix_integrity(const std::string& prefix_path) {
@@ -138,48 +378,108 @@ bool WinePrefixManager::verify_prefix_integrity(const std::string& prefix_path)
     return true;
 }
 
-void WinePrefixManager::backup_prefix(const std::string& prefix_path) {
+bool WinePrefixManager::backup_prefix(const std::string& prefix_path) {
     std::string backup_path = prefix_path + ".backup." + Utils::get_timestamp_string();
     logger.info("Creating backup: " + backup_path);
     
-    std::string cmd = "cp -r \"" + prefix_path + "\" \"" + backup_path + "\" 2>&1";
-    Utils::execute_command(cmd);
+    CloneProgress progress;
+    if (!cloner.clone_tree(prefix_path, backup_path, nullptr, progress)) {
+        logger.error("Failed to create backup: " + backup_path);
+        Utils::remove_directory(backup_path);
+        return false;
+    }
+    return true;
 }
 
-void WinePrefixManager::restore_prefix(const std::string& prefix_path, 
+// Restores into a sibling directory first so a missing or unreadable backup never costs the current prefix
+bool WinePrefixManager::restore_prefix(const std::string& prefix_path, 
                                       const std::string& backup_path) {
     logger.info("Restoring prefix from backup: " + backup_path);
     
-    if (Utils::directory_exists(prefix_path)) {
-        Utils::remove_directory(prefix_path);
+    std::string staging_path = prefix_path + ".restore";
+    if (Utils::directory_exists(staging_path)) {
+        Utils::remove_directory(staging_path);
+    }
+    
+    CloneProgress progress;
+    if (!cloner.clone_tree(backup_path, staging_path, nullptr, progress)) {
+        logger.error("Failed to restore prefix from backup: " + backup_path);
+        Utils::remove_directory(staging_path);
+        return false;
     }
     
-    std::string cmd = "cp -r \"" + backup_path + "\" \"" + prefix_path + "\" 2>&1";
-    Utils::execute_command(cmd);
+    if (Utils::directory_exists(prefix_path) && !Utils::remove_directory(prefix_path)) {
+        logger.error("Failed to remove prefix before restore: " + prefix_path);
+        Utils::remove_directory(staging_path);
+        return false;
+    }
+    
+    if (rename(staging_path.c_str(), prefix_path.c_str()) != 0) {
+        logger.error("Failed to move restored prefix into place, left at " + staging_path + ": " + strerror(errno));
+        return false;
+    }
+    scanner.invalidate(prefix_path);
+    return true;
+}
+
+bool WinePrefixManager::reserve_prefix(const std::string& prefix_name) {
+    std::lock_guard<std::mutex> lock(prefix_mutex);
+    
+    if (find_prefix(prefix_name) != prefix_configs.end() ||
+        !reserved_prefixes.insert(prefix_name).second) {
+        return false;
+    }
+    return true;
+}
+
+void WinePrefixManager::finish_prefix(const std::string& prefix_name, const WineConfiguration* config) {
+    std::lock_guard<std::mutex> lock(prefix_mutex);
+    
+    reserved_prefixes.erase(prefix_name);
+    if (config) {
+        prefix_configs[prefix_name] = *config;
+        mark_loaded(prefix_name, config->wine_prefix);
+        save_index();
+    }
 }
 
 bool WinePrefixManager::create_prefix(const std::string& prefix_name, 
                                      const WineConfiguration& config) {
-    std::lock_guard<std::mutex> lock(prefix_mutex);
+    PhaseTimer timer(metrics, MetricPhase::PREFIX_CREATE);
+    std::string template_name = get_template_prefix();
+    if (!template_name.empty() && prefix_exists(template_name)) {
+        WineArchitecture template_arch = get_prefix_config(template_name).architecture;
+        if (config.architecture == WineArchitecture::AUTO_DETECT || config.architecture == template_arch) {
+            return create_prefix_from_template(prefix_name, template_name, config);
+        }
+    }
     
-    if (prefix_configs.find(prefix_name) != prefix_configs.end()) {
+    if (!reserve_prefix(prefix_name)) {
         logger.error("Prefix already exists: " + prefix_name);
         return false;
     }
     
-    std::string prefix_path = Utils::join_paths(base_prefix_directory, prefix_name);
+    std::string prefix_path;
+    {
+        std::lock_guard<std::mutex> lock(prefix_mutex);
+        prefix_path = Utils::join_paths(base_prefix_directory, prefix_name);
+    }
     
     logger.info("Creating Wine prefix: " + prefix_name + " at " + prefix_path);
     
     if (!create_directory_structure(prefix_path)) {
+        finish_prefix(prefix_name, nullptr);
         return false;
     }
     
     WineConfiguration new_config = config;
     new_config.wine_prefix = prefix_path;
     
+    server_pool.acquire(prefix_path, new_config.wine_binary);
+    
     if (!initialize_registry(prefix_path, new_config.architecture)) {
         logger.error("Failed to initialize registry");
+        finish_prefix(prefix_name, nullptr);
         return false;
     }
     
@@ -190,16 +490,62 @@ bool WinePrefixManager::create_prefix(const std::string& prefix_name,
     std::string config_file = Utils::join_paths(prefix_path, "config.ini");
     new_config.save_to_file(config_file);
     
-    prefix_configs[prefix_name] = new_config;
+    finish_prefix(prefix_name, &new_config);
     
     logger.info("Successfully created prefix: " + prefix_name);
     return true;
 }
 
+bool WinePrefixManager::create_prefix_from_template(const std::string& prefix_name,
+                                                    const std::string& template_name,
+                                                    const WineConfiguration& config,
+                                                    const CloneProgressCallback& progress) {
+    WineConfiguration template_config = get_prefix_config(template_name);
+    
+    if (!clone_prefix(template_name, prefix_name, progress)) {
+        return false;
+    }
+    
+    WineConfiguration new_config = config;
+    new_config.wine_prefix = get_prefix_path(prefix_name);
+    
+    std::vector<std::string> missing;
+    for (const auto& component : config.winetricks_components) {
+        if (std::find(template_config.winetricks_components.begin(), template_config.winetricks_components.end(),
+                      component) == template_config.winetricks_components.end()) {
+            missing.push_back(component);
+        }
+    }
+    install_components(new_config.wine_prefix, missing);
+    
+    std::string config_file = Utils::join_paths(new_config.wine_prefix, "config.ini");
+    new_config.save_to_file(config_file);
+    
+    {
+        std::lock_guard<std::mutex> lock(prefix_mutex);
+        prefix_configs[prefix_name] = new_config;
+        mark_loaded(prefix_name, new_config.wine_prefix);
+    }
+    
+    logger.info("Created prefix " + prefix_name + " from template " + template_name);
+    return true;
+}
+
+void WinePrefixManager::set_template_prefix(const std::string& template_name) {
+    std::lock_guard<std::mutex> lock(prefix_mutex);
+    template_prefix = template_name;
+    logger.info(template_name.empty() ? "Cleared template prefix" : "Set template prefix to: " + template_name);
+}
+
+std::string WinePrefixManager::get_template_prefix() {
+    std::lock_guard<std::mutex> lock(prefix_mutex);
+    return template_prefix;
+}
+
 bool WinePrefixManager::delete_prefix(const std::string& prefix_name) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
     
-    auto it = prefix_configs.find(prefix_name);
+    auto it = find_prefix(prefix_name);
     if (it == prefix_configs.end()) {
         logger.error("Prefix not found: " + prefix_name);
         return false;
@@ -208,10 +554,16 @@ bool WinePrefixManager::delete_prefix(const std::string& prefix_name) {
     std::string prefix_path = it->second.wine_prefix;
     logger.info("Deleting Wine prefix: " + prefix_name);
     
-    backup_prefix(prefix_path);
+    if (!backup_prefix(prefix_path)) {
+        logger.error("Not deleting prefix without a backup: " + prefix_name);
+        return false;
+    }
     
     if (Utils::remove_directory(prefix_path)) {
+        scanner.invalidate(prefix_path);
         prefix_configs.erase(it);
+        loaded_configs.erase(prefix_name);
+        save_index();
         logger.info("Successfully deleted prefix: " + prefix_name);
         return true;
     } else {
@@ -224,7 +576,7 @@ bool WinePrefixManager::update_prefix(const std::string& prefix_name,
                                      const WineConfiguration& config) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
     
-    auto it = prefix_configs.find(prefix_name);
+    auto it = find_prefix(prefix_name);
     if (it == prefix_configs.end()) {
         logger.error("Prefix not found: " + prefix_name);
         return false;
@@ -235,12 +587,19 @@ bool WinePrefixManager::update_prefix(const std::string& prefix_name,
     WineConfiguration new_config = config;
     new_config.wine_prefix = it->second.wine_prefix;
     
+    ConfigDiff changes = it->second.diff(new_config);
+    if (changes.empty()) {
+        logger.debug("Prefix configuration unchanged: " + prefix_name);
+        return true;
+    }
+    
     std::string config_file = Utils::join_paths(new_config.wine_prefix, "config.ini");
     new_config.save_to_file(config_file);
     
-    prefix_configs[prefix_name] = new_config;
+    it->second = std::move(new_config);
+    mark_loaded(prefix_name, it->second.wine_prefix);
     
-    logger.info("Successfully updated prefix: " + prefix_name);
+    logger.info("Successfully updated prefix: " + prefix_name + " (" + changes.to_string() + ")");
     return true;
 }
 
@@ -248,6 +607,7 @@ std::vector<std::string> WinePrefixManager::list_prefixes() {
     std::lock_guard<std::mutex> lock(prefix_mutex);
     std::vector<std::string> prefixes;
     
+    ensure_index();
     for (const auto& pair : prefix_configs) {
         prefixes.push_back(pair.first);
     }
@@ -258,7 +618,7 @@ std::vector<std::string> WinePrefixManager::list_prefixes() {
 WineConfiguration WinePrefixManager::get_prefix_config(const std::string& prefix_name) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
     
-    auto it = prefix_configs.find(prefix_name);
+    auto it = find_prefix(prefix_name);
     if (it != prefix_configs.end()) {
         return it->second;
     }
@@ -268,13 +628,14 @@ WineConfiguration WinePrefixManager::get_prefix_config(const std::string& prefix
 
 bool WinePrefixManager::prefix_exists(const std::string& prefix_name) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
+    ensure_index();
     return prefix_configs.find(prefix_name) != prefix_configs.end();
 }
 
 std::string WinePrefixManager::get_prefix_path(const std::string& prefix_name) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
     
-    auto it = prefix_configs.find(prefix_name);
+    auto it = find_prefix(prefix_name);
     if (it != prefix_configs.end()) {
         return it->second.wine_prefix;
     }
@@ -284,31 +645,64 @@ std::string WinePrefixManager::get_prefix_path(const std::string& prefix_name) {
 
 void WinePrefixManager::set_base_directory(const std::string& directory) {
     std::lock_guard<std::mutex> lock(prefix_mutex);
+    for (auto& pair : prefix_configs) {
+        if (loaded_configs.count(pair.first)) {
+            pair.second.save_to_file(Utils::join_paths(pair.second.wine_prefix, "config.ini"));
+        }
+    }
+    prefix_configs.clear();
+    loaded_configs.clear();
     base_prefix_directory = directory;
+    index_loaded = false;
     Utils::create_directory(directory);
     logger.info("Set base prefix directory to: " + directory);
 }
 
 bool WinePrefixManager::validate_prefix(const std::string& prefix_name) {
-    auto it = prefix_configs.find(prefix_name);
-    if (it == prefix_configs.end()) {
+    std::string prefix_path = get_prefix_path(prefix_name);
+    if (prefix_path.empty()) {
         return false;
     }
     
-    return verify_prefix_integrity(it->second.wine_prefix);
+    return verify_prefix_integrity(prefix_path);
 }
 
 size_t WinePrefixManager::get_prefix_size(const std::string& prefix_name) {
-    auto it = prefix_configs.find(prefix_name);
-    if (it == prefix_configs.end()) {
+    std::string prefix_path = get_prefix_path(prefix_name);
+    if (prefix_path.empty()) {
         return 0;
     }
     
-    return Utils::get_directory_size(it->second.wine_prefix);
+    return scanner.get(prefix_path).total_bytes;
+}
+
+std::map<std::string, PrefixScanResult> WinePrefixManager::get_prefix_scans() {
+    std::map<std::string, std::string> paths;
+    
+    {
+        std::lock_guard<std::mutex> lock(prefix_mutex);
+        ensure_index();
+        for (const auto& pair : prefix_configs) {
+            paths[pair.second.wine_prefix] = pair.first;
+        }
+    }
+    
+    std::vector<std::string> prefix_paths;
+    for (const auto& pair : paths) {
+        prefix_paths.push_back(pair.first);
+    }
+    
+    std::map<std::string, PrefixScanResult> results;
+    for (const auto& pair : scanner.get_many(prefix_paths)) {
+        results[paths[pair.first]] = pair.second;
+    }
+    return results;
 }
 
 void WinePrefixManager::cleanup_prefix(const std::string& prefix_name) {
-    auto it = prefix_configs.find(prefix_name);
+    std::lock_guard<std::mutex> lock(prefix_mutex);
+    
+    auto it = find_prefix(prefix_name);
     if (it == prefix_configs.end()) {
         logger.error("Prefix not found: " + prefix_name);
         return;
@@ -332,75 +726,135 @@ void WinePrefixManager::cleanup_prefix(const std::string& prefix_name) {
             }
         }
     }
+    
+    scanner.invalidate(it->second.wine_prefix);
 }
 
 bool WinePrefixManager::clone_prefix(const std::string& source, 
-                                    const std::string& destination) {
-    std::lock_guard<std::mutex> lock(prefix_mutex);
-    
-    auto it = prefix_configs.find(source);
-    if (it == prefix_configs.end()) {
-        logger.error("Source prefix not found: " + source);
-        return false;
-    }
-    
-    if (prefix_configs.find(destination) != prefix_configs.end()) {
-        logger.error("Destination prefix already exists: " + destination);
-        return false;
+                                    const std::string& destination,
+                                    const CloneProgressCallback& progress) {
+    PhaseTimer timer(metrics, MetricPhase::PREFIX_CLONE);
+    std::string source_path;
+    std::string dest_path;
+    WineConfiguration dest_config;
+    
+    {
+        std::lock_guard<std::mutex> lock(prefix_mutex);
+        
+        auto it = find_prefix(source);
+        if (it == prefix_configs.end()) {
+            logger.error("Source prefix not found: " + source);
+            return false;
+        }
+        
+        if (prefix_configs.find(destination) != prefix_configs.end() ||
+            !reserved_prefixes.insert(destination).second) {
+            logger.error("Destination prefix already exists: " + destination);
+            return false;
+        }
+        
+        source_path = it->second.wine_prefix;
+        dest_path = Utils::join_paths(base_prefix_directory, destination);
+        dest_config = it->second;
     }
     
     logger.info("Cloning prefix from " + source + " to " + destination);
     
-    std::string source_path = it->second.wine_prefix;
-    std::string dest_path = Utils::join_paths(base_prefix_directory, destination);
+    CloneProgress result;
+    if (!cloner.clone_tree(source_path, dest_path, progress, result)) {
+        logger.error("Failed to clone prefix to: " + destination);
+        Utils::remove_directory(dest_path);
+        finish_prefix(destination, nullptr);
+        return false;
+    }
     
-    std::string cmd = "cp -r \"" + source_path + "\" \"" + dest_path + "\" 2>&1";
-    Utils::execute_command(cmd);
+    dest_config.wine_prefix = dest_path;
+    std::string config_file = Utils::join_paths(dest_path, "config.ini");
+    dest_config.save_to_file(config_file);
     
-    if (Utils::directory_exists(dest_path)) {
-        WineConfiguration dest_config = it->second;
-        dest_config.wine_prefix = dest_path;
-        prefix_configs[destination] = dest_config;
-        
-        std::string config_file = Utils::join_paths(dest_path, "config.ini");
-        dest_config.save_to_file(config_file);
-        
-        logger.info("Successfully cloned prefix to: " + destination);
-        return true;
-    }
+    finish_prefix(destination, &dest_config);
     
-    return false;
+    logger.info("Successfully cloned prefix to: " + destination);
+    return true;
 }
 
 std::map<std::string, std::string> WinePrefixManager::get_prefix_info(const std::string& prefix_name) {
     std::map<std::string, std::string> info;
     
-    auto it = prefix_configs.find(prefix_name);
-    if (it == prefix_configs.end()) {
-        return info;
+    WineConfiguration config;
+    {
+        std::lock_guard<std::mutex> lock(prefix_mutex);
+        auto it = find_prefix(prefix_name);
+        if (it == prefix_configs.end()) {
+            return info;
+        }
+        config = it->second;
     }
     
-    const WineConfiguration& config = it->second;
-    
     info["name"] = prefix_name;
     info["path"] = config.wine_prefix;
     info["wine_binary"] = config.wine_binary;
     info["architecture"] = (config.architecture == WineArchitecture::WIN32) ? "Win32" :
                           (config.architecture == WineArchitecture::WIN64) ? "Win64" : "Auto";
-    info["size"] = std::to_string(get_prefix_size(prefix_name));
-    info["valid"] = verify_prefix_integrity(config.wine_prefix) ? "Yes" : "No";
+    PrefixScanResult scan = scanner.get(config.wine_prefix);
+    info["size"] = std::to_string(scan.total_bytes);
+    info["files"] = std::to_string(scan.file_count);
+    info["valid"] = scan.valid ? "Yes" : "No";
     
     return info;
 }
 
+ProcessSummary::ProcessSummary()
+    : pid(-1), state(ProcessState::IDLE), exit_code(0), memory_usage(0), cpu_usage(0.0),
+      tree_process_count(0), tree_memory_usage(0), tree_cpu_usage(0.0), offcore_threads(0), core_migrations(0) {
+}
+
+ProcessSummary::ProcessSummary(const ProcessInfo& info)
+    : pid(info.pid), state(info.state), executable_path(info.executable_path), wine_prefix(info.wine_prefix),
+      start_time(info.start_time), end_time(info.end_time), exit_code(info.exit_code),
+      memory_usage(info.memory_usage), cpu_usage(info.cpu_usage), tree_process_count(info.tree_process_count),
+      tree_memory_usage(info.tree_memory_usage), tree_cpu_usage(info.tree_cpu_usage),
+      offcore_threads(info.offcore_threads), core_migrations(info.core_migrations) {
+}
+
+const ProcessSummary* ProcessTableSnapshot::find(pid_t pid) const {
+    auto it = std::lower_bound(processes.begin(), processes.end(), pid,
+                               [](const ProcessSummary& summary, pid_t value) { return summary.pid < value; });
+    return it != processes.end() && it->pid == pid ? &*it : nullptr;
+}
+
 ProcessMonitor::ProcessMonitor(Logger& log) 
     : logger(log), monitoring_active(false), 
-      update_interval(std::chrono::milliseconds(1000)) {
+      update_interval(std::chrono::milliseconds(1000)),
+      epoll_fd(-1), wake_fd(-1), output_capture(log), cgroups(log),
+      snapshot(std::make_shared<ProcessTableSnapshot>()), snapshot_generation(0), events(log),
+      memory_threshold(0), cpu_threshold(0.0), sample_ticks(0), last_sample_ms(0.0), total_sample_ms(0.0) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    
+    if (epoll_fd != -1 && wake_fd != -1) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN;
+        ev.data.u64 = 0;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wake_fd, &ev);
+    } else {
+        logger.warning("epoll unavailable, process exits will be detected by polling");
+    }
+    
     logger.info("ProcessMonitor initialized");
 }
 
 ProcessMonitor::~ProcessMonitor() {
     stop_monitoring();
+    events.shutdown();
+    for (const auto& pair : process_fds) {
+        if (pair.second != -1) {
+            close(pair.second);
+        }
+    }
+    if (wake_fd != -1) close(wake_fd);
+    if (epoll_fd != -1) close(epoll_fd);
     logger.info("ProcessMonitor shutting down");
 }
 
@@ -412,6 +866,7 @@ void ProcessMonitor::start_monitoring() {
     
     monitoring_active = true;
     monitor_thread = std::thread(&ProcessMonitor::monitor_loop, this);
+    output_capture.start();
     logger.info("Started process monitoring");
 }
 
@@ -420,124 +875,376 @@ void ProcessMonitor::stop_monitoring() {
         return;
     }
     
-    monitoring_active = false;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        monitoring_active = false;
+    }
+    wake_monitor();
+    exit_cv.notify_all();
     if (monitor_thread.joinable()) {
         monitor_thread.join();
     }
+    output_capture.stop();
     logger.info("Stopped process monitoring");
 }
 
-void ProcessMonitor::monitor_loop() {
-    while (monitoring_active) {
-        {
-            std::lock_guard<std::mutex> lock(monitor_mutex);
-            
-            std::vector<pid_t> dead_processes;
-            
-            for (auto& pair : monitored_processes) {
-                if (!is_process_alive(pair.first)) {
-                    pair.second.state = ProcessState::STOPPED;
-                    pair.second.end_time = std::chrono::system_clock::now();
-                    dead_processes.push_back(pair.first);
-                    notify_state_change(pair.second);
-                } else {
-                    update_process_stats(pair.second);
-                }
-            }
-            
-            for (pid_t pid : dead_processes) {
-                logger.info("Process " + std::to_string(pid) + " has terminated");
-            }
-        }
-        
-        std::this_thread::sleep_for(update_interval);
+void ProcessMonitor::wake_monitor() {
+    if (wake_fd != -1) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wake_fd, &one, sizeof(one));
+        (void)ignored;
     }
 }
 
-void ProcessMonitor::update_process_stats(ProcessInfo& info) {
-    info.cpu_usage = calculate_cpu_usage(info.pid);
-    info.memory_usage = get_memory_usage(info.pid);
-    info.state = get_process_state(info.pid);
+int ProcessMonitor::open_process_fd(pid_t pid) {
+    if (epoll_fd == -1) {
+        return -1;
+    }
+    
+    int fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+    if (fd == -1) {
+        return -1;
+    }
+    
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u64 = static_cast<uint64_t>(pid);
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == -1) {
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
 }
 
-double ProcessMonitor::calculate_cpu_usage(pid_t pid) {
-    std::string stat_file = "/proc/" + std::to_string(pid) + "/stat";
-    std::ifstream file(stat_file);
+void ProcessMonitor::unwatch_process(pid_t pid) {
+    auto it = process_fds.find(pid);
+    if (it == process_fds.end()) {
+        return;
+    }
     
-    if (!file.is_open()) {
-        return 0.0;
+    if (it->second != -1) {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, it->second, nullptr);
+        close(it->second);
+    }
+    process_fds.erase(it);
+}
+
+bool ProcessMonitor::reap_process(pid_t pid, ProcessInfo& info) {
+    siginfo_t si;
+    memset(&si, 0, sizeof(si));
+    
+    if (waitid(P_PID, pid, &si, WEXITED | WNOHANG) == 0) {
+        if (si.si_pid == 0) {
+            return false;
+        }
+        if (si.si_code == CLD_EXITED) {
+            info.exit_code = si.si_status;
+            info.state = ProcessState::STOPPED;
+        } else {
+            info.exit_code = -si.si_status;
+            info.state = ProcessState::KILLED;
+        }
+        return true;
     }
     
-    std::string line;
-    std::getline(file, line);
+    if (errno == ECHILD && !is_process_alive(pid)) {
+        info.state = ProcessState::STOPPED;
+        return true;
+    }
     
-    return 0.0;
+    return false;
 }
 
-size_t ProcessMonitor::get_memory_usage(pid_t pid) {
-    std::string status_file = "/proc/" + std::to_string(pid) + "/status";
-    std::ifstream file(status_file);
+void ProcessMonitor::handle_process_exit(pid_t pid) {
+    auto it = monitored_processes.find(pid);
+    if (it == monitored_processes.end() || process_fds.find(pid) == process_fds.end()) {
+        return;
+    }
     
-    if (!file.is_open()) {
-        return 0;
+    if (!reap_process(pid, it->second)) {
+        return;
     }
     
-    std::string line;
-    while (std::getline(file, line)) {
-        if (line.find("VmRSS:") == 0) {
-            std::istringstream iss(line);
-            std::string label;
-            size_t value;
-            iss >> label >> value;
-            return value * 1024;
-        }
+    it->second.end_time = std::chrono::system_clock::now();
+    unwatch_process(pid);
+    if (!it->second.cgroup_path.empty()) {
+        cgroups.remove(it->second.cgroup_path);
     }
     
-    return 0;
+    logger.info("Process " + std::to_string(pid) + " has terminated with code " +
+                std::to_string(it->second.exit_code));
+    publish_snapshot();
+    threshold_flags.erase(pid);
+    
+    events.publish(ProcessEventType::EXITED, ProcessSummary(it->second));
+    exit_cv.notify_all();
 }
 
-ProcessState ProcessMonitor::get_process_state(pid_t pid) {
-    std::string stat_file = "/proc/" + std::to_string(pid) + "/stat";
-    std::ifstream file(stat_file);
+void ProcessMonitor::poll_unwatched_processes() {
+    std::lock_guard<std::mutex> lock(monitor_mutex);
     
-    if (!file.is_open()) {
-        return ProcessState::STOPPED;
+    std::vector<pid_t> polled;
+    for (const auto& pair : process_fds) {
+        if (pair.second == -1) {
+            polled.push_back(pair.first);
+        }
     }
     
-    std::string line;
-    std::getline(file, line);
+    for (pid_t pid : polled) {
+        handle_process_exit(pid);
+    }
+}
+
+void ProcessMonitor::sample_processes() {
+    TraceSpan span("sample_processes", "monitor");
+    std::vector<ProcessStats> samples;
+    std::vector<pid_t> pids;
+    std::vector<pid_t> tree_roots;
+    std::map<pid_t, std::string> cgroup_paths;
+    std::map<pid_t, std::vector<int>> pinned;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        samples.reserve(process_fds.size());
+        pids.reserve(process_fds.size());
+        for (const auto& pair : process_fds) {
+            ProcessStats stats;
+            stats.pid = pair.first;
+            samples.push_back(stats);
+            pids.push_back(pair.first);
+            
+            auto it = monitored_processes.find(pair.first);
+            if (it != monitored_processes.end() && !it->second.cgroup_path.empty()) {
+                cgroup_paths[pair.first] = it->second.cgroup_path;
+            } else {
+                tree_roots.push_back(pair.first);
+            }
+            if (it != monitored_processes.end() && !it->second.assigned_cpus.empty()) {
+                pinned[pair.first] = it->second.assigned_cpus;
+            }
+        }
+    }
     
-    size_t first_paren = line.find('(');
-    size_t last_paren = line.rfind(')');
+    sampler.retain(pids);
+    for (auto& stats : samples) {
+        update_process_stats(stats);
+    }
     
-    if (first_paren == std::string::npos || last_paren == std::string::npos) {
-        return ProcessState::ERROR;
+    ProcessTree tree;
+    if (!tree_roots.empty()) {
+        tree.rebuild(tree_roots, process_tree);
+    }
+    for (auto& stats : samples) {
+        auto cgroup = cgroup_paths.find(stats.pid);
+        CgroupUsage usage;
+        if (cgroup != cgroup_paths.end() && cgroups.sample(cgroup->second, usage)) {
+            stats.tree_process_count = static_cast<size_t>(usage.process_count);
+            stats.tree_memory_usage = usage.memory_current > 0 ? static_cast<size_t>(usage.memory_current)
+                                                               : stats.memory_usage;
+            stats.tree_cpu_usage = usage.cpu_usage;
+        } else if (!tree.get_totals(stats.pid, stats)) {
+            stats.tree_process_count = 1;
+            stats.tree_memory_usage = stats.memory_usage;
+            stats.tree_cpu_usage = stats.cpu_usage;
+        }
     }
     
-    std::string after_comm = line.substr(last_paren + 2);
-    char state = after_comm[0];
+    std::map<pid_t, std::pair<size_t, uint64_t>> affinity;
+    for (const auto& pair : pinned) {
+        auto cgroup = cgroup_paths.find(pair.first);
+        std::vector<pid_t> members = cgroup != cgroup_paths.end() ? cgroups.get_members(cgroup->second)
+                                                                  : tree.get_members(pair.first);
+        check_affinity(pair.first, pair.second, members, affinity[pair.first].first, affinity[pair.first].second);
+    }
+    for (auto it = offcore_threads.begin(); it != offcore_threads.end();) {
+        it = pinned.count(it->first) ? std::next(it) : offcore_threads.erase(it);
+    }
     
-    switch (state) {
-        case 'R': return ProcessState::RUNNING;
-        case 'S': return ProcessState::RUNNING;
-        case 'T': return ProcessState::PAUSED;
-        case 'Z': return ProcessState::STOPPED;
-        default: return ProcessState::RUNNING;
+    std::lock_guard<std::mutex> lock(monitor_mutex);
+    process_tree = std::move(tree);
+    for (const auto& stats : samples) {
+        if (process_fds.find(stats.pid) == process_fds.end()) {
+            continue;
+        }
+        
+        auto it = monitored_processes.find(stats.pid);
+        if (it == monitored_processes.end()) {
+            continue;
+        }
+        
+        ProcessState previous_state = it->second.state;
+        it->second.cpu_usage = stats.cpu_usage;
+        it->second.memory_usage = stats.memory_usage;
+        it->second.tree_process_count = stats.tree_process_count;
+        it->second.tree_memory_usage = stats.tree_memory_usage;
+        it->second.tree_cpu_usage = stats.tree_cpu_usage;
+        
+        auto pinned_stats = affinity.find(stats.pid);
+        if (pinned_stats != affinity.end()) {
+            it->second.offcore_threads = pinned_stats->second.first;
+            it->second.core_migrations += pinned_stats->second.second;
+        }
+        if (stats.state != ProcessState::STOPPED) {
+            it->second.state = stats.state;
+        }
+        
+        ProcessSummary summary(it->second);
+        if (summary.state != previous_state) {
+            events.publish(ProcessEventType::STATE_CHANGED, summary);
+        }
+        events.publish(ProcessEventType::STATS_UPDATED, summary);
+        
+        int flags = 0;
+        if (memory_threshold > 0 && summary.tree_memory_usage >= memory_threshold) flags |= 1;
+        if (cpu_threshold > 0 && summary.tree_cpu_usage >= cpu_threshold) flags |= 2;
+        int& previous_flags = threshold_flags[stats.pid];
+        if ((flags & 1) && !(previous_flags & 1)) {
+            events.publish(ProcessEventType::MEMORY_THRESHOLD, summary);
+        }
+        if ((flags & 2) && !(previous_flags & 2)) {
+            events.publish(ProcessEventType::CPU_THRESHOLD, summary);
+        }
+        previous_flags = flags;
     }
+    
+    publish_snapshot();
+    cgroups.prune();
 }
 
-std::string ProcessMonitor::read_process_stdout(pid_t pid) {
-    return "";
+void ProcessMonitor::publish_snapshot() {
+    auto next = std::make_shared<ProcessTableSnapshot>();
+    next->generation = ++snapshot_generation;
+    next->published_at = std::chrono::steady_clock::now();
+    next->processes.reserve(monitored_processes.size());
+    for (const auto& pair : monitored_processes) {
+        next->processes.emplace_back(pair.second);
+    }
+    
+    std::atomic_store(&snapshot, std::shared_ptr<const ProcessTableSnapshot>(std::move(next)));
 }
 
-std::string ProcessMonitor::read_process_stderr(pid_t pid) {
-    return "";
+std::shared_ptr<const ProcessTableSnapshot> ProcessMonitor::get_snapshot() const {
+    return std::atomic_load(&snapshot);
 }
 
-void ProcessMonitor::notify_state_change(const ProcessInfo& info) {
-    for (const auto& callback : state_change_callbacks) {
-        callback(info);
+void ProcessMonitor::check_affinity(pid_t root, const std::vector<int>& cpus, const std::vector<pid_t>& members,
+                                    size_t& offcore, uint64_t& migrations) {
+    std::set<pid_t>& previous = offcore_threads[root];
+    std::set<pid_t> current;
+    char path[64];
+    char buffer[1024];
+    migrations = 0;
+    
+    for (pid_t member : members) {
+        snprintf(path, sizeof(path), "/proc/%d/task", member);
+        DIR* tasks = opendir(path);
+        if (!tasks) {
+            continue;
+        }
+        
+        while (struct dirent* entry = readdir(tasks)) {
+            if (entry->d_name[0] == '.') continue;
+            pid_t tid = static_cast<pid_t>(atoi(entry->d_name));
+            snprintf(path, sizeof(path), "/proc/%d/task/%d/stat", member, tid);
+            
+            int fd = open(path, O_RDONLY | O_CLOEXEC);
+            if (fd == -1) continue;
+            ssize_t length = read(fd, buffer, sizeof(buffer) - 1);
+            close(fd);
+            
+            ProcStat stat;
+            if (length <= 0 || !ProcessSampler::parse_stat(buffer, static_cast<size_t>(length), stat) ||
+                std::binary_search(cpus.begin(), cpus.end(), stat.processor)) {
+                continue;
+            }
+            
+            current.insert(tid);
+            if (!previous.count(tid)) {
+                migrations++;
+                logger.warning("Thread " + std::to_string(tid) + " of process " + std::to_string(root) +
+                               " migrated to CPU " + std::to_string(stat.processor) + " outside assigned CPUs " +
+                               LaunchProfile::format_cpu_list(cpus));
+            }
+        }
+        closedir(tasks);
     }
+    
+    offcore = current.size();
+    previous.swap(current);
+}
+
+void ProcessMonitor::monitor_loop() {
+    struct epoll_event events[64];
+    std::chrono::steady_clock::time_point last_sample;
+    
+    while (monitoring_active) {
+        std::chrono::milliseconds interval;
+        {
+            std::lock_guard<std::mutex> lock(monitor_mutex);
+            interval = update_interval;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        if (now - last_sample >= interval) {
+            poll_unwatched_processes();
+            sample_processes();
+            last_sample = now;
+            
+            double elapsed_ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - now).count();
+            std::lock_guard<std::mutex> lock(monitor_mutex);
+            ++sample_ticks;
+            last_sample_ms = elapsed_ms;
+            total_sample_ms += elapsed_ms;
+        }
+        
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            last_sample + interval - std::chrono::steady_clock::now());
+        int timeout = static_cast<int>(std::max<long long>(0, wait.count())) + 1;
+        
+        if (epoll_fd == -1) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            continue;
+        }
+        
+        int count = epoll_wait(epoll_fd, events, 64, timeout);
+        if (count == -1) {
+            if (errno != EINTR) {
+                logger.error("epoll_wait failed: " + std::string(strerror(errno)));
+                std::this_thread::sleep_for(std::chrono::milliseconds(timeout));
+            }
+            continue;
+        }
+        
+        for (int i = 0; i < count; ++i) {
+            if (events[i].data.u64 == 0) {
+                uint64_t value;
+                ssize_t ignored = read(wake_fd, &value, sizeof(value));
+                (void)ignored;
+                continue;
+            }
+            
+            std::lock_guard<std::mutex> lock(monitor_mutex);
+            handle_process_exit(static_cast<pid_t>(events[i].data.u64));
+        }
+    }
+}
+
+void ProcessMonitor::update_process_stats(ProcessStats& stats) {
+    if (!sampler.sample(stats.pid, stats)) {
+        stats.state = ProcessState::STOPPED;
+        stats.memory_usage = 0;
+        stats.cpu_usage = 0.0;
+    }
+}
+
+std::string ProcessMonitor::read_process_stdout(pid_t pid) {
+    return output_capture.read_output(pid, OutputStream::STDOUT);
+}
+
+std::string ProcessMonitor::read_process_stderr(pid_t pid) {
+    return output_capture.read_output(pid, OutputStream::STDERR);
 }
 
 bool ProcessMonitor::is_process_alive(pid_t pid) {
@@ -546,22 +1253,80 @@ bool ProcessMonitor::is_process_alive(pid_t pid) {
 
 void ProcessMonitor::add_process(pid_t pid, const ProcessInfo& info) {
     std::lock_guard<std::mutex> lock(monitor_mutex);
+    
+    unwatch_process(pid);
     monitored_processes[pid] = info;
+    
+    int fd = open_process_fd(pid);
+    process_fds[pid] = fd;
+    
+    if (fd == -1) {
+        logger.debug("pidfd unavailable for process " + std::to_string(pid) + ", using polled exit detection");
+    }
+    publish_snapshot();
+    events.publish(ProcessEventType::STARTED, ProcessSummary(info));
     logger.info("Added process " + std::to_string(pid) + " to monitoring");
 }
 
 void ProcessMonitor::remove_process(pid_t pid) {
     std::lock_guard<std::mutex> lock(monitor_mutex);
+    unwatch_process(pid);
     monitored_processes.erase(pid);
+    output_capture.detach(pid);
+    publish_snapshot();
     logger.info("Removed process " + std::to_string(pid) + " from monitoring");
 }
 
+void ProcessMonitor::attach_output(pid_t pid, int stdout_fd, int stderr_fd,
+                                   const std::string& tee_path) {
+    output_capture.attach(pid, stdout_fd, stderr_fd, tee_path);
+}
+
+int ProcessMonitor::wait_for_exit(pid_t pid) {
+    std::unique_lock<std::mutex> lock(monitor_mutex);
+    
+    if (monitored_processes.find(pid) == monitored_processes.end()) {
+        return -1;
+    }
+    
+    exit_cv.wait(lock, [this, pid] {
+        return process_fds.find(pid) == process_fds.end() || !monitoring_active;
+    });
+    
+    if (process_fds.find(pid) != process_fds.end()) {
+        lock.unlock();
+        siginfo_t si;
+        memset(&si, 0, sizeof(si));
+        waitid(P_PID, pid, &si, WEXITED | WNOWAIT);
+        lock.lock();
+        handle_process_exit(pid);
+    }
+    
+    auto it = monitored_processes.find(pid);
+    return it != monitored_processes.end() ? it->second.exit_code : -1;
+}
+
+bool ProcessMonitor::has_exited(pid_t pid, int& exit_code) {
+    std::lock_guard<std::mutex> lock(monitor_mutex);
+    
+    auto it = monitored_processes.find(pid);
+    if (it == monitored_processes.end() || process_fds.find(pid) != process_fds.end()) {
+        return false;
+    }
+    
+    exit_code = it->second.exit_code;
+    return true;
+}
+
 ProcessInfo ProcessMonitor::get_process_info(pid_t pid) {
     std::lock_guard<std::mutex> lock(monitor_mutex);
     
     auto it = monitored_processes.find(pid);
     if (it != monitored_processes.end()) {
-        return it->second;
+        ProcessInfo info = it->second;
+        info.stdout_data = read_process_stdout(pid);
+        info.stderr_data = read_process_stderr(pid);
+        return info;
     }
     
     return ProcessInfo();
@@ -573,23 +1338,71 @@ std::vector<ProcessInfo> ProcessMonitor::get_all_processes() {
     
     for (const auto& pair : monitored_processes) {
         processes.push_back(pair.second);
+        processes.back().stdout_data = read_process_stdout(pair.first);
+        processes.back().stderr_data = read_process_stderr(pair.first);
     }
     
     return processes;
 }
 
-void ProcessMonitor::register_callback(std::function<void(const ProcessInfo&)> callback) {
+int ProcessMonitor::register_callback(std::function<void(const ProcessInfo&)> callback) {
+    int id = events.subscribe("callback", [callback](const std::vector<ProcessEvent>& batch) {
+        for (const auto& event : batch) {
+            ProcessInfo info;
+            info.pid = event.process.pid;
+            info.state = event.process.state;
+            info.executable_path = event.process.executable_path;
+            info.wine_prefix = event.process.wine_prefix;
+            info.start_time = event.process.start_time;
+            info.end_time = event.process.end_time;
+            info.exit_code = event.process.exit_code;
+            info.memory_usage = event.process.memory_usage;
+            info.cpu_usage = event.process.cpu_usage;
+            info.tree_process_count = event.process.tree_process_count;
+            info.tree_memory_usage = event.process.tree_memory_usage;
+            info.tree_cpu_usage = event.process.tree_cpu_usage;
+            info.offcore_threads = event.process.offcore_threads;
+            info.core_migrations = event.process.core_migrations;
+            callback(info);
+        }
+    }, ProcessEventBus::mask(ProcessEventType::EXITED));
+    
     std::lock_guard<std::mutex> lock(monitor_mutex);
-    state_change_callbacks.push_back(callback);
+    callback_subscriptions.insert(id);
+    return id;
+}
+
+void ProcessMonitor::unregister_callback(int callback_id) {
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        callback_subscriptions.erase(callback_id);
+    }
+    events.unsubscribe(callback_id);
 }
 
 void ProcessMonitor::clear_callbacks() {
+    std::set<int> ids;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        ids.swap(callback_subscriptions);
+    }
+    for (int id : ids) {
+        events.unsubscribe(id);
+    }
+}
+
+void ProcessMonitor::set_event_thresholds(size_t memory_bytes, double cpu_percent) {
     std::lock_guard<std::mutex> lock(monitor_mutex);
-    state_change_callbacks.clear();
+    memory_threshold = memory_bytes;
+    cpu_threshold = cpu_percent;
 }
 
 void ProcessMonitor::set_update_interval(std::chrono::milliseconds interval) {
-    update_interval = interval;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        update_interval = interval;
+    }
+    wake_monitor();
 }
 
 bool ProcessMonitor::is_process_monitored(pid_t pid) {
@@ -614,13 +1427,67 @@ void ProcessMonitor::resume_process(pid_t pid) {
 }
 
 void ProcessMonitor::kill_process(pid_t pid, int signal) {
-    if (kill(pid, signal) == 0) {
-        logger.info("Sent signal " + std::to_string(signal) + " to process " + std::to_string(pid));
+    std::vector<std::pair<pid_t, unsigned long long>> tree;
+    int root_fd = -1;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        auto it = monitored_processes.find(pid);
+        if (it != monitored_processes.end() && !it->second.cgroup_path.empty()) {
+            // cgroup membership is current, so the start time read now identifies each member
+            for (pid_t member : cgroups.get_members(it->second.cgroup_path)) {
+                unsigned long long start_time;
+                if (read_start_time(member, start_time)) {
+                    tree.push_back({member, start_time});
+                }
+            }
+        } else {
+            for (pid_t member : process_tree.get_members(pid)) {
+                unsigned long long start_time;
+                if (process_tree.get_start_time(member, start_time)) {
+                    tree.push_back({member, start_time});
+                }
+            }
+        }
+        
+        auto fd_it = process_fds.find(pid);
+        if (fd_it != process_fds.end() && fd_it->second != -1) {
+            root_fd = fcntl(fd_it->second, F_DUPFD_CLOEXEC, 0);
+        }
+    }
+    
+    size_t signalled = 0;
+    for (auto it = tree.rbegin(); it != tree.rend(); ++it) {
+        if (it->first != pid && signal_member(it->first, it->second, signal)) {
+            signalled++;
+        }
+    }
+    
+    bool sent = send_signal(root_fd, pid, signal);
+    if (root_fd != -1) {
+        close(root_fd);
+    }
+    
+    if (sent) {
+        logger.info("Sent signal " + std::to_string(signal) + " to process " + std::to_string(pid) +
+                    " (" + std::to_string(signalled + 1) + " processes in tree)");
     } else {
         logger.error("Failed to send signal to process " + std::to_string(pid));
     }
 }
 
+bool ProcessMonitor::get_cgroup_usage(pid_t pid, CgroupUsage& usage) {
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(monitor_mutex);
+        auto it = monitored_processes.find(pid);
+        if (it == monitored_processes.end() || it->second.cgroup_path.empty()) {
+            return false;
+        }
+        path = it->second.cgroup_path;
+    }
+    return cgroups.sample(path, usage, false);
+}
+
 std::map<std::string, double> ProcessMonitor::get_system_stats() {
     std::map<std::string, double> stats;
     
@@ -653,6 +1520,41 @@ std::map<std::string, double> ProcessMonitor::get_system_stats() {
         }
     }
     
+    stats["cpu_count"] = static_cast<double>(std::max(1L, sysconf(_SC_NPROCESSORS_ONLN)));
+    
+    double gpu_count = 0;
+    for (const auto& card : Utils::list_directory("/sys/class/drm")) {
+        if (card.compare(0, 4, "card") != 0 || card.find('-') != std::string::npos) continue;
+        
+        std::string device = "/sys/class/drm/" + card + "/device/";
+        if (!Utils::file_exists(device + "vendor")) continue;
+        gpu_count++;
+        
+        double value;
+        std::ifstream vram_total(device + "mem_info_vram_total");
+        if (vram_total >> value) stats["gpu_vram_total"] += value;
+        std::ifstream vram_used(device + "mem_info_vram_used");
+        if (vram_used >> value) stats["gpu_vram_used"] += value;
+        std::ifstream busy(device + "gpu_busy_percent");
+        if (busy >> value) stats["gpu_busy_percent"] = std::max(stats["gpu_busy_percent"], value);
+    }
+    stats["gpu_count"] = gpu_count;
+    
+    CgroupUsage usage;
+    std::string root = cgroups.get_root();
+    if (!root.empty() && cgroups.sample(root, usage, false)) {
+        stats["cgroup_cpu_usage_usec"] = static_cast<double>(usage.cpu_usage_usec);
+        stats["cgroup_throttled_usec"] = static_cast<double>(usage.throttled_usec);
+        stats["cgroup_memory_current"] = static_cast<double>(usage.memory_current);
+        stats["cgroup_process_count"] = static_cast<double>(usage.process_count);
+        stats["cgroup_oom_kills"] = static_cast<double>(usage.oom_kills);
+    }
+    
+    std::lock_guard<std::mutex> lock(monitor_mutex);
+    stats["monitor_ticks"] = static_cast<double>(sample_ticks);
+    stats["monitor_last_tick_ms"] = last_sample_ms;
+    stats["monitor_total_tick_ms"] = total_sample_ms;
+    
     return stats;
 }
 